@@ -0,0 +1,167 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Project Name:        Word Locator
+//
+///////////////////////////////////////////////////////////////////////////////
+//
+// This File: bench.cpp
+// Main File: bench.cpp
+//
+// Purpose of this file: Micro benchmarks for the word locator.
+//
+// Usage: wl_bench [name ...]
+// Runs every benchmark when no name is given. Build with `make bench`, which
+// uses the same -O2 flags as the word locator itself.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include "wl.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static double SecondsSince(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void Report(const std::string& name, const std::string& what, double value,
+                   const std::string& unit)
+{
+    std::cout << name << ": " << what << " " << value << " " << unit << std::endl;
+}
+
+// Returns the distinct words of a file, most frequent first, split the way
+// wl::Dictionary::Load() splits them.
+static std::vector<std::string> WordsByFrequency(const std::string& path)
+{
+    std::unordered_map<std::string, uint32_t> counts;
+    std::ifstream f(path);
+    std::string word;
+    char ch;
+    while (f.get(ch))
+    {
+        if (isalnum(ch) || ch == '\'')
+        {
+            word += std::tolower(ch);
+        }
+        else if (!word.empty())
+        {
+            counts[word]++;
+            word.clear();
+        }
+    }
+    if (!word.empty()) counts[word]++;
+
+    std::vector<std::pair<uint32_t, std::string>> ranked;
+    for (auto& entry : counts)
+    {
+        ranked.emplace_back(entry.second, entry.first);
+    }
+    std::sort(ranked.begin(), ranked.end(),
+              [](const std::pair<uint32_t, std::string>& a, const std::pair<uint32_t, std::string>& b)
+              { return a.first != b.first ? a.first > b.first : a.second < b.second; });
+
+    std::vector<std::string> words;
+    for (auto& entry : ranked)
+    {
+        words.push_back(entry.second);
+    }
+    return words;
+}
+
+// Throughput of Locate() without and with the cache of locate results, on a
+// replay of LOCATE queries over the most frequent words of wrnpc.txt. Word
+// ranks follow a Zipf distribution and the occurrence asked for is uniform.
+static void BenchLocateZipf()
+{
+    const std::string path = "wrnpc.txt";
+    const size_t numWords = 20000;
+    const size_t numQueries = 200000;
+    const double skew = 1.1;
+    const uint32_t maxOccurrence = 5;
+
+    std::vector<std::string> words = WordsByFrequency(path);
+    if (words.size() > numWords) words.resize(numWords);
+    if (words.empty())
+    {
+        std::cout << "locate_zipf: " << path << " not found" << std::endl;
+        return;
+    }
+
+    // sample ranks through the cumulative distribution, with a fixed seed
+    std::vector<double> cdf(words.size());
+    double sum = 0;
+    for (size_t i = 0; i < words.size(); i++)
+    {
+        sum += 1 / std::pow(i + 1, skew);
+        cdf[i] = sum;
+    }
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> uniform(0, sum);
+    std::uniform_int_distribution<uint32_t> occurrence(1, maxOccurrence);
+    std::vector<std::pair<const std::string*, uint32_t>> queries;
+    for (size_t i = 0; i < numQueries; i++)
+    {
+        size_t rank = std::lower_bound(cdf.begin(), cdf.end(), uniform(rng)) - cdf.begin();
+        rank = std::min(rank, words.size() - 1);
+        queries.emplace_back(&words[rank], occurrence(rng));
+    }
+
+    const size_t capacities[] = {0, wl::LOCATE_CACHE_SIZE};
+    for (size_t capacity : capacities)
+    {
+        wl::Dictionary dictionary(capacity);
+        dictionary.Load(path);
+
+        uint64_t found = 0;
+        Clock::time_point start = Clock::now();
+        for (auto& query : queries)
+        {
+            found += dictionary.Locate(*query.first, query.second) != 0;
+        }
+        double secs = SecondsSince(start);
+
+        std::string label = capacity == 0 ? "no cache" : "cache " + std::to_string(capacity);
+        Report("locate_zipf", label + " throughput", numQueries / secs / 1e6, "M lookups/s");
+        Report("locate_zipf", label + " hit rate", dictionary.GetCache().GetHitRate(), "");
+        Report("locate_zipf", label + " found", static_cast<double>(found), "queries");
+    }
+}
+
+struct Benchmark
+{
+    const char* name;
+    void (*run)();
+};
+
+static const Benchmark benchmarks[] = {
+    {"locate_zipf", BenchLocateZipf},
+};
+
+int main(int argc, char** argv)
+{
+    const int numBenchmarks = sizeof(benchmarks) / sizeof(benchmarks[0]);
+    for (int i = 0; i < numBenchmarks; i++)
+    {
+        bool selected = argc <= 1;
+        for (int j = 1; j < argc; j++)
+        {
+            if (std::strcmp(argv[j], benchmarks[i].name) == 0)
+            {
+                selected = true;
+            }
+        }
+
+        if (selected)
+        {
+            benchmarks[i].run();
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,78 @@
+///////////////////////////////////////////////////////////////////////////////
+//
+// Project Name:        Word Locator
+//
+///////////////////////////////////////////////////////////////////////////////
+//
+// This File: test.cpp
+// Main File: test.cpp
+//
+// Purpose of this file: Tests of wl::Dictionary that the command scripts
+// cannot observe. Build and run with `make test`.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <cstdlib>
+#include "wl.h"
+
+#define checkPassFail(a, b)                                                 \
+{                                                                           \
+    if ((a) == (b))                                                         \
+        std::cout << "Test passed at line no:" << __LINE__ << "\n";         \
+    else                                                                    \
+    {                                                                       \
+        std::cout << "Test FAILS at line no:" << __LINE__;                  \
+        std::cout << "\nExpected:" << (b);                                  \
+        std::cout << "\nActual:" << (a) << std::endl;                       \
+        exit(1);                                                            \
+    }                                                                       \
+}
+
+static void WriteFile(const std::string& path, const std::string& text)
+{
+    std::ofstream f(path);
+    f << text;
+}
+
+// Results cached by Locate() do not outlive the words they came from
+static void TestLocateCache()
+{
+    const std::string first = "wl_test_1.txt";
+    const std::string second = "wl_test_2.txt";
+    WriteFile(first, "apple banana apple\n");
+    WriteFile(second, "banana banana apple apple\n");
+
+    wl::Dictionary dictionary;
+    dictionary.Load(first);
+    checkPassFail(dictionary.Locate("apple", 2), 3u)
+    checkPassFail(dictionary.GetCache().GetMisses(), 1u)
+    checkPassFail(dictionary.Locate("apple", 2), 3u)
+    checkPassFail(dictionary.GetCache().GetHits(), 1u)
+
+    // a new word list knows no words, whatever was cached
+    dictionary.New();
+    checkPassFail(dictionary.Locate("apple", 2), 0u)
+    checkPassFail(dictionary.GetCache().GetMisses(), 2u)
+    checkPassFail(dictionary.Locate("apple", 2), 0u)
+    checkPassFail(dictionary.GetCache().GetHits(), 2u)
+
+    // loading words drops the results cached before
+    dictionary.Load(second);
+    checkPassFail(dictionary.Locate("apple", 2), 4u)
+    checkPassFail(dictionary.GetCache().GetMisses(), 3u)
+    checkPassFail(dictionary.Locate("banana", 2), 2u)
+    checkPassFail(dictionary.Locate("banana", 2), 2u)
+    checkPassFail(dictionary.GetCache().GetHits(), 3u)
+    checkPassFail(dictionary.GetCache().GetMisses(), 4u)
+
+    std::remove(first.c_str());
+    std::remove(second.c_str());
+}
+
+int main()
+{
+    TestLocateCache();
+    std::cout << "Passed all tests." << std::endl;
+    return 0;
+}
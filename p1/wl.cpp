@@ -17,6 +17,8 @@
 
 #include "wl.h"
 
+// The benchmarks and tests link this file with a main function of their own
+#ifndef WL_NO_MAIN
 int main()
 {
     wl::Context context;
@@ -30,6 +32,7 @@ int main()
 
     return 0;
 }
+#endif
 
 ///////////////////////////////////////////////////////////////////////////////
 // 
@@ -216,6 +219,127 @@ void wl::Command::Receive()
     }
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// 
+// Below is the impementation of LocateCache class
+// 
+///////////////////////////////////////////////////////////////////////////////
+
+wl::LocateCache::LocateCache(size_t capacity)
+    : slots(capacity), hand(0), hits(0), misses(0)
+{
+    this->index.reserve(capacity);
+    this->Clear();
+}
+
+size_t wl::LocateCache::Hash(const std::string& word, uint32_t occurrence)
+{
+    size_t seed = std::hash<std::string>{}(word);
+    return seed ^ (occurrence + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+}
+
+bool wl::LocateCache::Get(const std::string& word, uint32_t occurrence, uint32_t& result)
+{
+    auto it = this->index.find(Hash(word, occurrence));
+    if (it != this->index.end())
+    {
+        Slot& slot = this->slots[it->second];
+
+        // Two keys may share a hash, so the key itself is compared too
+        if (slot.occurrence == occurrence && slot.word == word)
+        {
+            slot.refbit = true;
+            result = slot.result;
+            this->hits++;
+            return true;
+        }
+    }
+
+    this->misses++;
+    return false;
+}
+
+void wl::LocateCache::Put(const std::string& word, uint32_t occurrence, uint32_t result)
+{
+    size_t capacity = this->slots.size();
+    if (capacity == 0) return;
+
+    size_t key = Hash(word, occurrence);
+
+    // A colliding key already owns the index entry, so reuse its slot
+    auto it = this->index.find(key);
+    size_t victim;
+    if (it != this->index.end())
+    {
+        victim = it->second;
+    }
+    else
+    {
+        // Sweep at most twice: the first pass may only clear reference bits
+        for (size_t scanned = 0; scanned < 2 * capacity; scanned++)
+        {
+            Slot& slot = this->slots[this->hand];
+            if (!slot.valid || !slot.refbit)
+            {
+                break;
+            }
+
+            slot.refbit = false;
+            this->hand = (this->hand + 1) % capacity;
+        }
+
+        victim = this->hand;
+        this->hand = (this->hand + 1) % capacity;
+
+        Slot& old = this->slots[victim];
+        if (old.valid)
+        {
+            this->index.erase(old.key);
+        }
+
+        this->index.emplace(key, victim);
+    }
+
+    Slot& slot = this->slots[victim];
+    slot.word = word;
+    slot.occurrence = occurrence;
+    slot.result = result;
+    slot.key = key;
+    slot.valid = true;
+    slot.refbit = false;
+}
+
+void wl::LocateCache::Clear()
+{
+    for (auto& slot : this->slots)
+    {
+        slot.word.clear();
+        slot.valid = false;
+        slot.refbit = false;
+    }
+
+    this->index.clear();
+    this->hand = 0;
+}
+
+uint64_t wl::LocateCache::GetHits() const
+{
+    return this->hits;
+}
+
+uint64_t wl::LocateCache::GetMisses() const
+{
+    return this->misses;
+}
+
+double wl::LocateCache::GetHitRate() const
+{
+    uint64_t total = this->hits + this->misses;
+    if (total == 0) return 0;
+
+    return static_cast<double>(this->hits) / total;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // 
 // Below is the impementation of Dictionary::Node class
@@ -383,7 +507,8 @@ void wl::Dictionary::Node::Insert(const std::string& word, uint32_t count)
 // 
 ///////////////////////////////////////////////////////////////////////////////
 
-wl::Dictionary::Dictionary() : word_list(new Node()), is_loadable(true) { }
+wl::Dictionary::Dictionary(size_t cache_capacity)
+    : word_list(new Node()), is_loadable(true), cache(cache_capacity) { }
 
 wl::Dictionary::~Dictionary()
 {
@@ -464,6 +589,7 @@ void wl::Dictionary::New()
 
     this->word_list = new Node();
     this->is_loadable = true;
+    this->cache.Clear();
 }
 
 void wl::Dictionary::Load(const std::string& path)
@@ -491,12 +617,26 @@ void wl::Dictionary::Load(const std::string& path)
         f.close();
 
         this->is_loadable = false;
+        this->cache.Clear();
     }
 }
 
 uint32_t wl::Dictionary::Locate(const std::string& word, uint32_t occurrence) const
 {
-    return this->word_list->Search(word, occurrence);
+    uint32_t result;
+    if (this->cache.Get(word, occurrence, result))
+    {
+        return result;
+    }
+
+    result = this->word_list->Search(word, occurrence);
+    this->cache.Put(word, occurrence, result);
+    return result;
+}
+
+const wl::LocateCache& wl::Dictionary::GetCache() const
+{
+    return this->cache;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
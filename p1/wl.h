@@ -24,6 +24,7 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
 
 /// <summary>
 /// A scope used to organize identifiers used for Word Locator.
@@ -204,7 +205,158 @@ namespace wl
 	};
 
 	/// <summary>
-	/// A trie-based data structure as a dictionary to load, parse, and store 
+	/// The number of locate results a dictionary keeps cached.
+	/// </summary>
+	const size_t LOCATE_CACHE_SIZE = 4096;
+
+	/// <summary>
+	/// A bounded cache of recent locate results in front of the radix tree.
+	/// </summary>
+	///
+	/// `wl::LocateCache` maps a (word, occurrence) pair to the word count
+	/// found by `wl::Dictionary::Node::Search()`, including misses (0), so a
+	/// repeated query does not walk the tree again. Entries live in a fixed
+	/// array of slots and are replaced with the CLOCK algorithm: a hit sets
+	/// the slot's reference bit, and the clock hand clears reference bits
+	/// until it finds a slot that has not been used since its last visit.
+	/// The cache only stays correct while the dictionary does not change, so
+	/// it has to be cleared whenever a new set of words is created or loaded.
+	class LocateCache
+	{
+	private:
+		/// <summary>
+		/// A cached result together with the key it belongs to.
+		/// </summary>
+		struct Slot
+		{
+			/// <summary>
+			/// The word that was searched for.
+			/// </summary>
+			std::string word;
+
+			/// <summary>
+			/// The occurrence that was searched for.
+			/// </summary>
+			uint32_t occurrence;
+
+			/// <summary>
+			/// The word count returned by the search, 0 if not found.
+			/// </summary>
+			uint32_t result;
+
+			/// <summary>
+			/// The combined hash of `word` and `occurrence`.
+			/// </summary>
+			size_t key;
+
+			/// <summary>
+			/// True if the slot holds a result.
+			/// </summary>
+			bool valid;
+
+			/// <summary>
+			/// True if the slot has been used since the clock hand last
+			/// passed it.
+			/// </summary>
+			bool refbit;
+		};
+
+		/// <summary>
+		/// The fixed array of slots, whose size is the capacity of the cache.
+		/// </summary>
+		std::vector<Slot> slots;
+
+		/// <summary>
+		/// An index from the combined hash of a key to its slot.
+		/// </summary>
+		std::unordered_map<size_t, size_t> index;
+
+		/// <summary>
+		/// The position of the clock hand in `slots`.
+		/// </summary>
+		size_t hand;
+
+		/// <summary>
+		/// The number of lookups that found a cached result.
+		/// </summary>
+		uint64_t hits;
+
+		/// <summary>
+		/// The number of lookups that did not find a cached result.
+		/// </summary>
+		uint64_t misses;
+
+	private:
+		/// <summary>
+		/// Combines the hash of `word` with `occurrence`.
+		/// </summary>
+		///
+		/// <param name="word">The word to be hashed.</param>
+		/// <param name="occurrence">The occurrence of the word.</param>
+		/// <returns>The combined hash.</returns>
+		static size_t Hash(const std::string& word, uint32_t occurrence);
+
+	public:
+		/// <summary>
+		/// Initializes an empty cache with `capacity` slots.
+		/// </summary>
+		///
+		/// A capacity of 0 disables the cache, i.e. every lookup misses and
+		/// nothing is stored.
+		///
+		/// <param name="capacity">The maximum number of cached results.</param>
+		LocateCache(size_t capacity);
+
+	public:
+		/// <summary>
+		/// Looks up the result of a previous search.
+		/// </summary>
+		///
+		/// <param name="word">The word to be searched for.</param>
+		/// <param name="occurrence">The occurrence of the word.</param>
+		/// <param name="result">The cached word count if found.</param>
+		/// <returns>True if a cached result is found; false, otherwise.</returns>
+		bool Get(const std::string& word, uint32_t occurrence, uint32_t& result);
+
+		/// <summary>
+		/// Stores the result of a search, replacing an old one if full.
+		/// </summary>
+		///
+		/// <param name="word">The word that was searched for.</param>
+		/// <param name="occurrence">The occurrence of the word.</param>
+		/// <param name="result">The word count returned by the search.</param>
+		void Put(const std::string& word, uint32_t occurrence, uint32_t result);
+
+		/// <summary>
+		/// Drops all cached results but keeps the hit and miss counters.
+		/// </summary>
+		void Clear();
+
+		/// <summary>
+		/// Gets the number of lookups that found a cached result.
+		/// </summary>
+		///
+		/// <returns>`hits`</returns>
+		uint64_t GetHits() const;
+
+		/// <summary>
+		/// Gets the number of lookups that did not find a cached result.
+		/// </summary>
+		///
+		/// <returns>`misses`</returns>
+		uint64_t GetMisses() const;
+
+		/// <summary>
+		/// Gets the fraction of lookups that found a cached result.
+		/// </summary>
+		///
+		/// <returns>0 if nothing has been looked up; a value in [0, 1],
+		/// otherwise.</returns>
+		double GetHitRate() const;
+	};
+
+	/// <summary>
+	/// A trie-based data structure as a dictionary to load, parse, and store
 	/// texts (or words) read from a given file.
 	/// </summary>
 	/// 
@@ -333,6 +485,14 @@ namespace wl
 		/// </summary>
 		bool is_loadable;
 
+		/// <summary>
+		/// The cache of recent results of `wl::Dictionary::Locate()`.
+		/// </summary>
+		///
+		/// It is mutable because caching does not change the observable state
+		/// of the dictionary.
+		mutable LocateCache cache;
+
 	private:
 		/// <summary>
 		/// Parses a line of a text file into an array of valid words.
@@ -349,10 +509,13 @@ namespace wl
 
 	public:
 		/// <summary>
-		/// Initializes `word_list` as the root node and `is_loadable` to true so
-		/// that the first load command doesn't require a new command in prior.
+		/// Initializes `word_list` as the root node, `is_loadable` to true so
+		/// that the first load command doesn't require a new command in prior,
+		/// and an empty cache of locate results.
 		/// </summary>
-		Dictionary();
+		///
+		/// <param name="cache_capacity">The capacity of the cache, 0 for none.</param>
+		Dictionary(size_t cache_capacity = LOCATE_CACHE_SIZE);
 
 		/// <summary>
 		/// Clears the dynamically allocated memory.
@@ -376,6 +539,13 @@ namespace wl
 		/// <returns>0 if not found; any positive integer, otherwise.</returns>
 		uint32_t Locate(const std::string& word, uint32_t occurrence) const;
 
+		/// <summary>
+		/// Gets the cache of locate results, e.g. to read its hit counters.
+		/// </summary>
+		///
+		/// <returns>`cache`</returns>
+		const LocateCache& GetCache() const;
+
 	public:
 		/// <summary>
 		/// Sets `is_loadable` to the given state.
@@ -8,9 +8,8 @@
 
 #include "bufHashTbl.h"
 
-#include <functional>
+#include <cstdint>
 #include <iostream>
-#include <memory>
 
 #include "buffer.h"
 #include "exceptions/hash_already_present_exception.h"
@@ -19,74 +18,88 @@
 
 namespace badgerdb {
 
-int BufHashTbl::hash(const File& file, const PageId pageNo) {
-  auto hash =
-      std::hash<std::string>{}(file.filename()) ^ std::hash<PageId>{}(pageNo);
-  return hash % HTSIZE;
+std::uint32_t BufHashTbl::hash(const FileId fileId,
+                               const PageId pageNo) const {
+  // Fibonacci hashing: the high bits of the product depend on every bit of
+  // the key, so consecutive pages of a file spread over the whole table
+  std::uint64_t key = (static_cast<std::uint64_t>(fileId) << 32) | pageNo;
+  return static_cast<std::uint32_t>((key * 0x9e3779b97f4a7c15ULL) >> shift);
 }
 
-BufHashTbl::BufHashTbl(int htSize) : HTSIZE(htSize), ht(htSize) {
-  // allocate an array of pointers to hashBuckets
+std::uint32_t BufHashTbl::probe(const FileId fileId,
+                                const PageId pageNo) const {
+  std::uint32_t index = hash(fileId, pageNo);
+  while (ht[index].fileId != File::INVALID_ID &&
+         (ht[index].fileId != fileId || ht[index].pageNo != pageNo)) {
+    index = (index + 1) & mask;
+  }
+  return index;
+}
+
+BufHashTbl::BufHashTbl(int htSize) : HTSIZE(2), numEntries(0) {
+  // keep the load factor at or below one half
+  while (HTSIZE < 2 * static_cast<std::uint32_t>(htSize)) HTSIZE <<= 1;
+  mask = HTSIZE - 1;
+  shift = 64;
+  for (std::uint32_t size = HTSIZE; size > 1; size >>= 1) shift--;
+
+  hashBucket empty = {File::INVALID_ID, Page::INVALID_NUMBER, 0};
+  ht.assign(HTSIZE, empty);
 }
 
 void BufHashTbl::insert(const File& file, const PageId pageNo,
                         const FrameId frameNo) {
-  int index = hash(file, pageNo);
-
-  std::shared_ptr<hashBucket> tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-      throw HashAlreadyPresentException(tmpBuc->file.filename(), tmpBuc->pageNo,
-                                        tmpBuc->frameNo);
-    tmpBuc = tmpBuc->next;
-  }
+  std::uint32_t index = probe(file.id(), pageNo);
 
-  tmpBuc = std::make_shared<hashBucket>();
-  if (!tmpBuc) throw HashTableException();
+  if (ht[index].fileId != File::INVALID_ID)
+    throw HashAlreadyPresentException(file.filename(), pageNo,
+                                      ht[index].frameNo);
 
-  tmpBuc->file = file;
-  tmpBuc->pageNo = pageNo;
-  tmpBuc->frameNo = frameNo;
-  tmpBuc->next = ht[index];
-  ht[index] = tmpBuc;
+  // at least one bucket must stay empty to terminate every probe sequence
+  if (numEntries + 1 >= HTSIZE) throw HashTableException();
+
+  ht[index].fileId = file.id();
+  ht[index].pageNo = pageNo;
+  ht[index].frameNo = frameNo;
+  numEntries++;
 }
 
 void BufHashTbl::lookup(const File& file, const PageId pageNo,
-                        FrameId& frameNo) {
-  int index = hash(file, pageNo);
-  std::shared_ptr<hashBucket> tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo) {
-      frameNo = tmpBuc->frameNo;  // return frameNo by reference
-      return;
-    }
-    tmpBuc = tmpBuc->next;
+                        FrameId& frameNo) const {
+  if (!tryLookup(file, pageNo, frameNo)) {
+    throw HashNotFoundException(file.filename(), pageNo);
   }
+}
+
+bool BufHashTbl::tryLookup(const File& file, const PageId pageNo,
+                           FrameId& frameNo) const {
+  std::uint32_t index = probe(file.id(), pageNo);
+  if (ht[index].fileId == File::INVALID_ID) return false;
 
-  throw HashNotFoundException(file.filename(), pageNo);
+  frameNo = ht[index].frameNo;  // return frameNo by reference
+  return true;
 }
 
 void BufHashTbl::remove(const File& file, const PageId pageNo) {
-  int index = hash(file, pageNo);
-  std::shared_ptr<hashBucket> tmpBuc = ht[index];
-  std::shared_ptr<hashBucket> prevBuc;
-
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo) {
-      if (prevBuc)
-        prevBuc->next = tmpBuc->next;
-      else
-        ht[index] = tmpBuc->next;
-
-      tmpBuc.reset();
-      return;
-    } else {
-      prevBuc = tmpBuc;
-      tmpBuc = tmpBuc->next;
+  std::uint32_t hole = probe(file.id(), pageNo);
+  if (ht[hole].fileId == File::INVALID_ID)
+    throw HashNotFoundException(file.filename(), pageNo);
+
+  // Shift later members of the probe sequence back into the hole, so that
+  // every entry stays reachable from its home bucket without tombstones
+  std::uint32_t next = (hole + 1) & mask;
+  while (ht[next].fileId != File::INVALID_ID) {
+    std::uint32_t home = hash(ht[next].fileId, ht[next].pageNo);
+    // move the entry unless its home lies cyclically in (hole, next]
+    if (((next - home) & mask) >= ((next - hole) & mask)) {
+      ht[hole] = ht[next];
+      hole = next;
     }
+    next = (next + 1) & mask;
   }
 
-  throw HashNotFoundException(file.filename(), pageNo);
+  ht[hole].fileId = File::INVALID_ID;
+  numEntries--;
 }
 
 }  // namespace badgerdb
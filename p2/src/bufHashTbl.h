@@ -8,6 +8,7 @@
 
 #pragma once
 
+#include <cstdint>
 #include <vector>
 
 #include "file.h"
@@ -19,9 +20,9 @@ namespace badgerdb {
  */
 struct hashBucket {
   /**
-   * pointer a file object (more on this below)
+   * id of the file, File::INVALID_ID if the bucket is empty
    */
-  File file;
+  FileId fileId;
 
   /**
    * page number within a file
@@ -32,37 +33,64 @@ struct hashBucket {
    * frame number of page in the buffer pool
    */
   FrameId frameNo;
-
-  /**
-   * Next node in the hash table
-   */
-  std::shared_ptr<hashBucket> next;
 };
 
 /**
  * @brief Hash table class to keep track of pages in the buffer pool
  *
+ * Entries are keyed on the (FileId, PageId) pair, so hashing and comparing a
+ * key costs the same regardless of the file name. The table is a flat array of
+ * buckets using open addressing with linear probing; its size is the power of
+ * two at or above twice the requested number of entries, and removal shifts
+ * later entries of the probe sequence back instead of leaving tombstones.
+ *
  * @warning This class is not threadsafe.
  */
 class BufHashTbl {
  private:
   /**
-   *	Size of Hash Table
+   *	Size of Hash Table, always a power of two
+   */
+  std::uint32_t HTSIZE;
+
+  /**
+   * HTSIZE - 1, used to wrap bucket indexes
+   */
+  std::uint32_t mask;
+
+  /**
+   * 64 - log2(HTSIZE), selects the top bits of the hash product
+   */
+  std::uint32_t shift;
+
+  /**
+   * Number of buckets in use
    */
-  int HTSIZE;
+  std::uint32_t numEntries;
+
   /**
    * Actual Hash table object
    */
-  std::vector<std::shared_ptr<hashBucket>> ht;
+  std::vector<hashBucket> ht;
 
   /**
-   * returns hash value between 0 and HTSIZE-1 computed using file and pageNo
+   * returns hash value between 0 and HTSIZE-1 computed using fileId and pageNo
    *
-   * @param file   	File object
+   * @param fileId 	Id of the file
    * @param pageNo  Page number in the file
    * @return  			Hash value.
    */
-  int hash(const File& file, const PageId pageNo);
+  std::uint32_t hash(const FileId fileId, const PageId pageNo) const;
+
+  /**
+   * returns the bucket holding (fileId, pageNo), or the empty bucket ending
+   * its probe sequence if the entry is not in the table
+   *
+   * @param fileId 	Id of the file
+   * @param pageNo  Page number in the file
+   * @return  			Bucket index.
+   */
+  std::uint32_t probe(const FileId fileId, const PageId pageNo) const;
 
  public:
   /**
@@ -78,8 +106,7 @@ class BufHashTbl {
    * @param frameNo Frame number assigned to that page of the file
    * @throws  HashAlreadyPresentException	if the corresponding page
    * already exists in the hash table
-   * @throws  HashTableException (optional) if could not create a new bucket as
-   * running of memory
+   * @throws  HashTableException if the table is full
    */
   void insert(const File& file, const PageId pageNo, const FrameId frameNo);
 
@@ -93,7 +120,18 @@ class BufHashTbl {
    * @throws HashNotFoundException if the page entry is not found in the hash
    * table
    */
-  void lookup(const File& file, const PageId pageNo, FrameId& frameNo);
+  void lookup(const File& file, const PageId pageNo, FrameId& frameNo) const;
+
+  /**
+   * Check if (file, pageNo) is currently in the buffer pool without throwing
+   * when it is not, which is the common case on a buffer miss.
+   *
+   * @param file  	File object
+   * @param pageNo	Page number in the file
+   * @param frameNo Frame number reference, only set if the entry is found
+   * @return  True if the page entry is found in the hash table
+   */
+  bool tryLookup(const File& file, const PageId pageNo, FrameId& frameNo) const;
 
   /**
    * Delete entry (file,pageNo) from hash table.
@@ -29,21 +29,18 @@
 
 #include "exceptions/bad_buffer_exception.h"
 #include "exceptions/buffer_exceeded_exception.h"
-#include "exceptions/hash_not_found_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
 
 namespace badgerdb {
 
-constexpr int HASHTABLE_SZ(int bufs) { return ((int)(bufs * 1.2) & -2) + 1; }
-
 //----------------------------------------
 // Constructor of the class BufMgr
 //----------------------------------------
 
 BufMgr::BufMgr(std::uint32_t bufs)
     : numBufs(bufs),
-      hashTable(HASHTABLE_SZ(bufs)),
+      hashTable(bufs),
       bufDescTable(bufs),
       bufPool(bufs) {
   for (FrameId i = 0; i < bufs; i++) {
@@ -56,6 +53,24 @@ BufMgr::BufMgr(std::uint32_t bufs)
 
 void BufMgr::advanceClock() { clockHand = (clockHand + 1) % numBufs; }
 
+void BufMgr::assignFrame(FrameId frame, const File& file,
+                         const PageId pageNo) {
+  const FileId fileId = file.id();
+  if (fileId >= openFiles.size()) {
+    openFiles.resize(fileId + 1);
+    residentFrames.resize(fileId + 1, 0);
+  }
+  // keep one copy of the file while any of its pages is resident
+  if (residentFrames[fileId]++ == 0) openFiles[fileId].reset(new File(file));
+  bufDescTable[frame].Set(file, pageNo);
+}
+
+void BufMgr::releaseFrame(FrameId frame) {
+  const FileId fileId = bufDescTable[frame].fileId;
+  bufDescTable[frame].clear();
+  if (--residentFrames[fileId] == 0) openFiles[fileId].reset();
+}
+
 void BufMgr::allocBuf(FrameId& frame) {
   int loop = 0;
   advanceClock();
@@ -87,13 +102,13 @@ void BufMgr::allocBuf(FrameId& frame) {
       // bufPool is not modified here
       if (t_frame.dirty) {
         // Write modified page to disk
-        t_frame.file.writePage(bufPool[clockHand]);
+        openFiles[t_frame.fileId]->writePage(bufPool[clockHand]);
       }
 
       // Remove frame mapping from hashtable
-      hashTable.remove(t_frame.file, t_frame.pageNo);
+      hashTable.remove(*openFiles[t_frame.fileId], t_frame.pageNo);
       // Reset frame metadata
-      t_frame.clear();
+      releaseFrame(clockHand);
     }
 
     // Find an available frame
@@ -107,15 +122,14 @@ void BufMgr::allocBuf(FrameId& frame) {
 
 void BufMgr::readPage(File& file, const PageId pageNo, Page*& page) {
   FrameId fid;
-  try {
-    // Check if page in buffer
-    hashTable.lookup(file, pageNo, fid);
+  // Check if page in buffer
+  if (hashTable.tryLookup(file, pageNo, fid)) {
     // Frame in the buffer
     // Set refbit to true
     bufDescTable[fid].refbit = true;
     // Increment pinCnt
     bufDescTable[fid].pinCnt++;
-  } catch (const HashNotFoundException&) {
+  } else {
     // Frame not in the buffer
     // Allocate a new frame
     allocBuf(fid);
@@ -124,7 +138,7 @@ void BufMgr::readPage(File& file, const PageId pageNo, Page*& page) {
     // Insert page into hashtable
     hashTable.insert(file, pageNo, fid);
     // Set up frame metadata
-    bufDescTable[fid].Set(file, pageNo);
+    assignFrame(fid, file, pageNo);
   }
 
   // Fetch the frame containing the page
@@ -133,20 +147,18 @@ void BufMgr::readPage(File& file, const PageId pageNo, Page*& page) {
 
 void BufMgr::unPinPage(File& file, const PageId pageNo, const bool dirty) {
   FrameId fid;
-  try {
-    // check if the page exists in the buffer
-    hashTable.lookup(file, pageNo, fid);
-    if (bufDescTable[fid].pinCnt == 0) {
-      throw PageNotPinnedException(file.filename(), pageNo, fid);
-    } else {
-      // decrease pinCnt and set dirty bit
-      bufDescTable[fid].pinCnt--;
-      if (dirty) {
-        bufDescTable[fid].dirty = true;
-      }
+  // check if the page exists in the buffer
+  // do nothing when the page is not found
+  if (!hashTable.tryLookup(file, pageNo, fid)) return;
+
+  if (bufDescTable[fid].pinCnt == 0) {
+    throw PageNotPinnedException(file.filename(), pageNo, fid);
+  } else {
+    // decrease pinCnt and set dirty bit
+    bufDescTable[fid].pinCnt--;
+    if (dirty) {
+      bufDescTable[fid].dirty = true;
     }
-  } catch (const HashNotFoundException&) {
-    // do nothing when the page is not found
   }
 }
 
@@ -161,7 +173,7 @@ void BufMgr::allocPage(File& file, PageId& pageNo, Page*& page) {
   // insert the entry into the hash table
   hashTable.insert(file, pageNo, fid);
   // setup the frame properly
-  bufDescTable[fid].Set(file, pageNo);
+  assignFrame(fid, file, pageNo);
 
   page = &bufPool[fid];
 }
@@ -170,7 +182,7 @@ void BufMgr::flushFile(File& file) {
   // iterate over bufDescTable
   for (FrameId fid = 0; fid < numBufs; fid++) {
     BufDesc& bufDesc = bufDescTable[fid];
-    if (bufDesc.file == file) {
+    if (bufDesc.fileId == file.id()) {
       // Throws BadBufferException if an invalid page belonging to the file is
       // encountered.
       if (!bufDesc.valid) {
@@ -190,27 +202,23 @@ void BufMgr::flushFile(File& file) {
       // Remove the page from the hashtable.
       hashTable.remove(file, bufDesc.pageNo);
       // Clear the bufDesc.
-      bufDesc.clear();
+      releaseFrame(fid);
     }
   }
 }
 
 void BufMgr::disposePage(File& file, const PageId PageNo) {
   FrameId fid;
-  try {
-    // Check if page in buffer
-    hashTable.lookup(file, PageNo, fid);
+  // Check if page in buffer
+  if (hashTable.tryLookup(file, PageNo, fid)) {
     // Frame in the buffer
-    // Clear DescTable
-    bufDescTable[fid].clear();
     // remove page from hashTable
     hashTable.remove(file, PageNo);
-    // delete page from file
-    file.deletePage(PageNo);
-  } catch (const HashNotFoundException&) {
-    // Frame not in the buffer
-    file.deletePage(PageNo);
+    // Clear DescTable
+    releaseFrame(fid);
   }
+  // delete page from file
+  file.deletePage(PageNo);
 }
 
 void BufMgr::printSelf(void) {
@@ -218,7 +226,9 @@ void BufMgr::printSelf(void) {
 
   for (FrameId i = 0; i < numBufs; i++) {
     std::cout << "FrameNo:" << i << " ";
-    bufDescTable[i].Print();
+    const FileId fileId = bufDescTable[i].fileId;
+    bufDescTable[i].Print(fileId == File::INVALID_ID ? NULL
+                                                     : openFiles[fileId].get());
 
     if (bufDescTable[i].valid) validFrames++;
   }
@@ -9,6 +9,7 @@
 #pragma once
 
 #include <iostream>
+#include <memory>
 #include <vector>
 
 #include "bufHashTbl.h"
@@ -34,9 +35,9 @@ class BufDesc {
  private:
   friend class BufMgr;
   /**
-   * Pointer to file to which corresponding frame is assigned
+   * Id of file to which corresponding frame is assigned
    */
-  File file;
+  FileId fileId;
 
   /**
    * Page within file to which corresponding frame is assigned
@@ -73,7 +74,7 @@ class BufDesc {
    */
   void clear() {
     pinCnt = 0;
-    file = File();
+    fileId = File::INVALID_ID;
     pageNo = Page::INVALID_NUMBER;
     dirty = false;
     refbit = false;
@@ -85,11 +86,11 @@ class BufDesc {
    * page in the file. Called when a frame in buffer pool is allocated to any
    * page in the file through readPage() or allocPage()
    *
-   * @param filePtr	File object
+   * @param file	File object
    * @param pageNum	Page number in the file
    */
-  void Set(File& file, PageId pageNum) {
-    this->file = file;
+  void Set(const File& file, PageId pageNum) {
+    fileId = file.id();
     pageNo = pageNum;
     pinCnt = 1;
     dirty = false;
@@ -97,9 +98,14 @@ class BufDesc {
     refbit = true;
   }
 
-  void Print() {
-    if (file.isValid()) {
-      std::cout << "file:" << file.filename() << " ";
+  /**
+   * Print member variable values.
+   *
+   * @param file	File the frame is assigned to, NULL if none
+   */
+  void Print(const File* file) {
+    if (file != NULL) {
+      std::cout << "file:" << file->filename() << " ";
       std::cout << "pageNo:" << pageNo << " ";
     } else
       std::cout << "file:NULL ";
@@ -158,10 +164,22 @@ class BufMgr {
   std::uint32_t numBufs;
 
   /**
-   * Hash table mapping (File, page) to frame
+   * Hash table mapping (FileId, page) to frame
    */
   BufHashTbl hashTable;
 
+  /**
+   * Copy of the File object for every FileId with pages in the buffer pool,
+   * indexed by FileId, used to write pages back on eviction. Holding the copy
+   * also keeps the file open, so its id cannot be reused meanwhile.
+   */
+  std::vector<std::unique_ptr<File>> openFiles;
+
+  /**
+   * Number of frames assigned to each FileId, indexed by FileId
+   */
+  std::vector<std::uint32_t> residentFrames;
+
   /**
    * Array of BufDesc objects to hold information corresponding to every frame
    * allocation from 'bufPool' (the buffer pool)
@@ -188,6 +206,23 @@ class BufMgr {
    */
   void allocBuf(FrameId& frame);
 
+  /**
+   * Assign frame to page pageNo of file, taking a reference on the file.
+   *
+   * @param frame   	Frame being assigned
+   * @param file   	File object
+   * @param pageNo  Page number in the file
+   */
+  void assignFrame(FrameId frame, const File& file, const PageId pageNo);
+
+  /**
+   * Clear a frame, releasing its reference on its file. The hash table entry
+   * of the frame must already have been removed.
+   *
+   * @param frame   	Frame being released
+   */
+  void releaseFrame(FrameId frame);
+
  public:
   /**
    * Actual buffer pool from which frames are allocated
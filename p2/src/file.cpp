@@ -26,6 +26,9 @@ namespace badgerdb {
 
 File::StreamMap File::open_streams_;
 File::CountMap File::open_counts_;
+File::IdMap File::open_ids_;
+std::vector<FileId> File::free_ids_;
+FileId File::next_id_ = 0;
 
 File File::create(const std::string &filename) {
   return File(filename, true /* create_new */);
@@ -65,6 +68,7 @@ bool File::exists(const std::string &filename) {
 File::File(const File &other)
     : filename_(other.filename_),
       stream_(open_streams_[filename_]),
+      id_(other.id_),
       valid_(other.valid_) {
   ++open_counts_[filename_];
 }
@@ -220,7 +224,7 @@ FileIterator File::begin() {
 FileIterator File::end() { return FileIterator(this, Page::INVALID_NUMBER); }
 
 File::File(const std::string &name, const bool create_new)
-    : filename_(name), valid_(true) {
+    : filename_(name), id_(INVALID_ID), valid_(true) {
   openIfNeeded(create_new);
 
   if (create_new) {
@@ -236,6 +240,8 @@ void File::openIfNeeded(const bool create_new) {
       open_counts_.end()) {  // exists an entry already
     ++open_counts_[filename_];
     stream_ = open_streams_[filename_];
+    IdMap::const_iterator id = open_ids_.find(filename_);
+    id_ = id != open_ids_.end() ? id->second : INVALID_ID;
   } else {
     std::ios_base::openmode mode =
         std::fstream::in | std::fstream::out | std::fstream::binary;
@@ -257,6 +263,13 @@ void File::openIfNeeded(const bool create_new) {
     stream_.reset(new std::fstream(filename_, mode));
     open_streams_[filename_] = stream_;
     open_counts_[filename_] = 1;
+    if (free_ids_.empty()) {
+      id_ = next_id_++;
+    } else {
+      id_ = free_ids_.back();
+      free_ids_.pop_back();
+    }
+    open_ids_[filename_] = id_;
   }
 }
 
@@ -266,7 +279,13 @@ void File::close() {
   if (open_counts_[filename_] == 0) {
     open_streams_.erase(filename_);
     open_counts_.erase(filename_);
+    IdMap::iterator id = open_ids_.find(filename_);
+    if (id != open_ids_.end()) {
+      free_ids_.push_back(id->second);
+      open_ids_.erase(id);
+    }
   }
+  id_ = INVALID_ID;
 }
 
 void File::writePage(const PageId page_number, const Page &new_page) {
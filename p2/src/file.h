@@ -12,6 +12,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "page.h"
 
@@ -68,11 +69,19 @@ struct FileHeader {
  * File class detects this (by looking in the open_streams_ map) and just
  * returns a file object with the already created stream for the file without
  * actually opening the UNIX file again.
+ * Every open file is also assigned a small integer FileId which all File
+ * objects for that file share until it is closed, so that the buffer pool can
+ * identify files without hashing or comparing their names.
  *
  * @warning This class is not threadsafe.
  */
 class File {
  public:
+  /**
+   * FileId of a File object which does not refer to an open file.
+   */
+  static const FileId INVALID_ID = ~static_cast<FileId>(0);
+
   /**
    * Creates a new file.
    *
@@ -140,14 +149,14 @@ class File {
    * @param rhs File object to compare.
    * @return True if the two files are equal.
    */
-  bool operator==(const File &rhs) const { return filename_ == rhs.filename_; }
+  bool operator==(const File &rhs) const { return id_ == rhs.id_; }
 
   /**
    * Check if two files are not equal.
    * @param rhs File object to compare.
    * @return True if the two files are not equal.
    */
-  bool operator!=(const File &rhs) const { return filename_ != rhs.filename_; }
+  bool operator!=(const File &rhs) const { return id_ != rhs.id_; }
 
   /**
    * Destructor that automatically closes the underlying file if no other
@@ -195,6 +204,15 @@ class File {
    */
   const std::string &filename() const { return filename_; }
 
+  /**
+   * Returns the id of the open file this object represents. The id is shared
+   * by all File objects for the same file and may be reused for another file
+   * once every File object for this one has been destroyed.
+   *
+   * @return Id of file, or INVALID_ID if the object is not valid.
+   */
+  FileId id() const { return id_; }
+
   /**
    * Returns an iterator at the first page in the file.
    *
@@ -221,7 +239,7 @@ class File {
    * Creates an empty file
    * @return File object with valid_ bit set to false
    */
-  File() : valid_(false) {}
+  File() : id_(INVALID_ID), valid_(false) {}
 
  private:
   friend class BufMgr;
@@ -335,6 +353,7 @@ class File {
 
   typedef std::map<std::string, std::shared_ptr<std::fstream>> StreamMap;
   typedef std::map<std::string, int> CountMap;
+  typedef std::map<std::string, FileId> IdMap;
 
   /**
    * Streams for opened files.
@@ -346,6 +365,22 @@ class File {
    */
   static CountMap open_counts_;
 
+  /**
+   * Ids of opened files.
+   */
+  static IdMap open_ids_;
+
+  /**
+   * Ids released by closed files, reused before new ones are handed out so
+   * that ids stay dense.
+   */
+  static std::vector<FileId> free_ids_;
+
+  /**
+   * Next id that has never been handed out.
+   */
+  static FileId next_id_;
+
   /**
    * Name of the file this object represents.
    */
@@ -356,6 +391,11 @@ class File {
    */
   std::shared_ptr<std::fstream> stream_;
 
+  /**
+   * Id of the open file this object represents.
+   */
+  FileId id_;
+
   /**
    * Whether this file is valid.
    */
@@ -17,6 +17,11 @@ namespace badgerdb {
  */
 typedef std::uint32_t PageId;
 
+/**
+ * @brief Identifier for an open file, dense from 0 among the open files.
+ */
+typedef std::uint32_t FileId;
+
 /**
  * @brief Identifier for a slot in a page.
  */
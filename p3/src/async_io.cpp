@@ -0,0 +1,274 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "async_io.h"
+
+#include <errno.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+
+#include "exceptions/file_io_exception.h"
+
+namespace badgerdb {
+
+const unsigned AsyncIO::MAX_DEPTH;
+const unsigned ThreadPoolIO::NUM_WORKERS;
+
+namespace {
+
+/**
+ * Kind of engine local() hands out.
+ */
+std::atomic<int> selected_engine(ENGINE_DEFAULT);
+
+/**
+ * Runs one request synchronously.
+ */
+void runRequest(IORequest& request) {
+  do {
+    if (request.write) {
+      request.result = ::pwrite(request.fd, request.buffer, request.length,
+                                request.offset);
+    } else {
+      request.result = ::pread(request.fd, request.buffer, request.length,
+                               request.offset);
+    }
+  } while (request.result < 0 && errno == EINTR);
+  if (request.result < 0) {
+    request.result = -errno;
+  }
+}
+
+int uringSetup(const unsigned entries, io_uring_params* params) {
+  return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int uringEnter(const int fd, const unsigned to_submit,
+               const unsigned min_complete, const unsigned flags) {
+  return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit,
+                                    min_complete, flags, NULL, 0));
+}
+
+}
+
+bool AsyncIO::uringSupported() {
+  static const bool supported = [] {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    int fd = uringSetup(1, &params);
+    if (fd < 0) {
+      return false;
+    }
+    ::close(fd);
+    // IORING_OP_READ and IORING_OP_WRITE came with this feature
+    return (params.features & IORING_FEAT_RW_CUR_POS) != 0;
+  }();
+  return supported;
+}
+
+void AsyncIO::setEngine(const AsyncEngine engine) {
+  selected_engine = engine;
+}
+
+AsyncIO& AsyncIO::local() {
+  // one engine of each kind per thread, created on first use
+  static thread_local std::unique_ptr<AsyncIO> uring;
+  static thread_local std::unique_ptr<AsyncIO> threads;
+
+  AsyncEngine engine = static_cast<AsyncEngine>(selected_engine.load());
+  if (engine == ENGINE_DEFAULT) {
+    engine = uringSupported() ? ENGINE_URING : ENGINE_THREADS;
+  }
+  if (engine == ENGINE_URING && uringSupported()) {
+    if (!uring) {
+      uring.reset(new UringIO(MAX_DEPTH));
+    }
+    return *uring;
+  }
+  if (!threads) {
+    threads.reset(new ThreadPoolIO);
+  }
+  return *threads;
+}
+
+UringIO::UringIO(const unsigned entries)
+    : sq_ring_(MAP_FAILED), cq_ring_(MAP_FAILED), sqes_(MAP_FAILED) {
+  io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  ring_fd_ = uringSetup(entries, &params);
+  if (ring_fd_ < 0) {
+    throw FileIOException("io_uring", errno);
+  }
+  entries_ = params.sq_entries;
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+
+  sq_ring_ = ::mmap(NULL, sq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ring_ != MAP_FAILED) {
+    cq_ring_ = single_mmap ? sq_ring_ :
+        ::mmap(NULL, cq_ring_size_, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+  }
+  if (cq_ring_ != MAP_FAILED) {
+    sqes_ = ::mmap(NULL, sqes_size_, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  }
+  if (sqes_ == MAP_FAILED) {
+    int error = errno;
+    release();
+    throw FileIOException("io_uring", error);
+  }
+
+  char* sq = static_cast<char*>(sq_ring_);
+  sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+  char* cq = static_cast<char*>(cq_ring_);
+  cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  cqes_ = cq + params.cq_off.cqes;
+}
+
+UringIO::~UringIO() {
+  release();
+}
+
+void UringIO::release() {
+  if (sqes_ != MAP_FAILED) {
+    ::munmap(sqes_, sqes_size_);
+  }
+  if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+    ::munmap(cq_ring_, cq_ring_size_);
+  }
+  if (sq_ring_ != MAP_FAILED) {
+    ::munmap(sq_ring_, sq_ring_size_);
+  }
+  ::close(ring_fd_);
+}
+
+void UringIO::run(IORequest* requests, const std::size_t count) {
+  io_uring_sqe* sqes = static_cast<io_uring_sqe*>(sqes_);
+  io_uring_cqe* cqes = static_cast<io_uring_cqe*>(cqes_);
+  std::size_t next = 0;       // first request not queued yet
+  std::size_t completed = 0;
+  unsigned queued = 0;        // queued but not taken by the kernel yet
+  unsigned in_flight = 0;     // taken by the kernel but not completed
+
+  while (completed < count) {
+    // queue as many requests as there are free entries
+    unsigned tail = *sq_tail_;
+    while (next < count && in_flight + queued < entries_) {
+      IORequest& request = requests[next];
+      unsigned index = tail & *sq_mask_;
+      io_uring_sqe* sqe = &sqes[index];
+      std::memset(sqe, 0, sizeof(*sqe));
+      sqe->opcode = request.write ? IORING_OP_WRITE : IORING_OP_READ;
+      sqe->fd = request.fd;
+      sqe->addr = reinterpret_cast<std::uint64_t>(request.buffer);
+      sqe->len = static_cast<std::uint32_t>(request.length);
+      sqe->off = request.offset;
+      sqe->user_data = next;
+      sq_array_[index] = index;
+      tail++;
+      queued++;
+      next++;
+    }
+    __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+
+    // submit them and wait for at least one completion
+    int submitted = uringEnter(ring_fd_, queued, 1, IORING_ENTER_GETEVENTS);
+    if (submitted < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw FileIOException("io_uring", errno);
+    }
+    queued -= submitted;
+    in_flight += submitted;
+
+    // reap every completion there is
+    unsigned head = *cq_head_;
+    unsigned cq_tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    while (head != cq_tail) {
+      io_uring_cqe* cqe = &cqes[head & *cq_mask_];
+      requests[cqe->user_data].result = cqe->res;
+      head++;
+      in_flight--;
+      completed++;
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+  }
+}
+
+ThreadPoolIO::Pool& ThreadPoolIO::pool() {
+  // the workers are detached, so that no thread has to join them at exit
+  static Pool* pool = [] {
+    Pool* p = new Pool;
+    for (unsigned i = 0; i < NUM_WORKERS; i++) {
+      p->workers.push_back(std::thread(workerLoop, p));
+      p->workers.back().detach();
+    }
+    return p;
+  }();
+  return *pool;
+}
+
+void ThreadPoolIO::workerLoop(Pool* pool) {
+  std::unique_lock<std::mutex> lock(pool->latch);
+  while (true) {
+    while (pool->queue.empty()) {
+      pool->work.wait(lock);
+    }
+    IORequest* request = pool->queue.front().first;
+    Batch* batch = pool->queue.front().second;
+    pool->queue.pop_front();
+    lock.unlock();
+
+    runRequest(*request);
+
+    lock.lock();
+    if (--batch->remaining == 0) {
+      batch->done.notify_one();
+    }
+  }
+}
+
+void ThreadPoolIO::run(IORequest* requests, const std::size_t count) {
+  if (count == 1) {
+    // nothing to overlap
+    runRequest(requests[0]);
+    return;
+  }
+
+  Pool& p = pool();
+  Batch batch;
+  batch.remaining = count;
+  std::unique_lock<std::mutex> lock(p.latch);
+  for (std::size_t i = 0; i < count; i++) {
+    p.queue.push_back(std::make_pair(&requests[i], &batch));
+  }
+  p.work.notify_all();
+  while (batch.remaining > 0) {
+    batch.done.wait(lock);
+  }
+}
+
+}
@@ -0,0 +1,232 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <sys/types.h>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace badgerdb {
+
+/**
+ * @brief One positional read or write of a file descriptor.
+ */
+struct IORequest {
+  /**
+   * Descriptor to transfer from or to.
+   */
+  int fd;
+
+  /**
+   * True for a write, false for a read.
+   */
+  bool write;
+
+  /**
+   * Memory to transfer from or to.
+   */
+  char* buffer;
+
+  /**
+   * Number of bytes to transfer.
+   */
+  std::size_t length;
+
+  /**
+   * Offset in the file.
+   */
+  std::uint64_t offset;
+
+  /**
+   * Set on completion to the number of bytes transferred, or to -errno.
+   */
+  ssize_t result;
+};
+
+/**
+ * @brief Kinds of AsyncIO engine.
+ */
+enum AsyncEngine {
+  /**
+   * io_uring if the kernel supports it, otherwise ENGINE_THREADS.
+   */
+  ENGINE_DEFAULT,
+
+  /**
+   * io_uring, one ring per thread.
+   */
+  ENGINE_URING,
+
+  /**
+   * pread/pwrite on a shared pool of worker threads.
+   */
+  ENGINE_THREADS
+};
+
+/**
+ * @brief Runs batches of IORequests with many of them in flight at once.
+ *
+ * A caller hands run() all the requests it has; the engine submits them in
+ * batches of up to depth() requests and returns once every one completed.
+ * Requests are independent: they complete in any order, and a short transfer
+ * is reported as such rather than retried.
+ *
+ * Engines are not shared between threads; local() gives every thread its own.
+ */
+class AsyncIO {
+ public:
+  /**
+   * Most requests an engine keeps in flight.
+   */
+  static const unsigned MAX_DEPTH = 64;
+
+  /**
+   * Returns the engine of the calling thread, creating it on first use.
+   */
+  static AsyncIO& local();
+
+  /**
+   * Selects the kind of engine local() returns from now on, in every thread.
+   * Meant for benchmarks and tests.
+   */
+  static void setEngine(const AsyncEngine engine);
+
+  /**
+   * Returns true if io_uring is available.
+   */
+  static bool uringSupported();
+
+  virtual ~AsyncIO() {}
+
+  /**
+   * Runs count requests and waits for all of them.
+   *
+   * @param requests  Requests to run; each one's result is set.
+   * @param count     Number of requests.
+   */
+  virtual void run(IORequest* requests, const std::size_t count) = 0;
+
+  /**
+   * Returns the number of requests kept in flight.
+   */
+  virtual unsigned depth() const = 0;
+
+  /**
+   * Returns the kind of the engine, ENGINE_URING or ENGINE_THREADS.
+   */
+  virtual AsyncEngine kind() const = 0;
+};
+
+/**
+ * @brief AsyncIO on an io_uring, driven through the raw system calls.
+ */
+class UringIO : public AsyncIO {
+ public:
+  /**
+   * Sets up a ring.
+   *
+   * @param entries   Number of submission queue entries.
+   * @throws  FileIOException   If the kernel refuses to set up the ring.
+   */
+  explicit UringIO(const unsigned entries);
+  ~UringIO();
+
+  void run(IORequest* requests, const std::size_t count) override;
+  unsigned depth() const override { return entries_; }
+  AsyncEngine kind() const override { return ENGINE_URING; }
+
+ private:
+  /**
+   * Unmaps the rings and closes the ring descriptor.
+   */
+  void release();
+
+  /**
+   * Descriptor of the ring.
+   */
+  int ring_fd_;
+
+  /**
+   * Number of submission queue entries.
+   */
+  unsigned entries_;
+
+  /**
+   * Mappings of the submission ring, the completion ring and the submission
+   * queue entries, with their lengths.
+   */
+  void* sq_ring_;
+  std::size_t sq_ring_size_;
+  void* cq_ring_;
+  std::size_t cq_ring_size_;
+  void* sqes_;
+  std::size_t sqes_size_;
+
+  /**
+   * Fields of the rings shared with the kernel.
+   */
+  unsigned* sq_tail_;
+  unsigned* sq_mask_;
+  unsigned* sq_array_;
+  unsigned* cq_head_;
+  unsigned* cq_tail_;
+  unsigned* cq_mask_;
+  void* cqes_;
+};
+
+/**
+ * @brief AsyncIO running pread/pwrite on a pool of worker threads shared by
+ *        all engines of this kind.
+ */
+class ThreadPoolIO : public AsyncIO {
+ public:
+  /**
+   * Number of worker threads, which bounds the requests in flight.
+   */
+  static const unsigned NUM_WORKERS = 16;
+
+  void run(IORequest* requests, const std::size_t count) override;
+  unsigned depth() const override { return NUM_WORKERS; }
+  AsyncEngine kind() const override { return ENGINE_THREADS; }
+
+ private:
+  /**
+   * A run() call waiting for its requests.
+   */
+  struct Batch {
+    std::size_t remaining;
+    std::condition_variable done;
+  };
+
+  /**
+   * The worker pool, started on first use and never stopped.
+   */
+  struct Pool {
+    std::mutex latch;
+    std::condition_variable work;
+    std::deque<std::pair<IORequest*, Batch*> > queue;
+    std::vector<std::thread> workers;
+  };
+
+  /**
+   * Returns the pool, starting its workers if needed.
+   */
+  static Pool& pool();
+
+  /**
+   * Body of a worker thread.
+   */
+  static void workerLoop(Pool* pool);
+};
+
+}
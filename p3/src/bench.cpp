@@ -0,0 +1,1622 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/**
+ * Micro benchmarks for the buffer manager and its replacement policies.
+ *
+ * Usage: badgerdb_bench [name ...]
+ * Runs every benchmark when no name is given.  Build with
+ *   make bench CFLAGS="-std=c++0x -O2 -g"
+ * for representative numbers.  The mt_ benchmarks run from 1 up to twice as
+ * many threads as the machine has hardware threads.
+ */
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "async_io.h"
+#include "btree.h"
+#include "filescan.h"
+#include "buffer.h"
+#include "file.h"
+#include "page.h"
+#include "exceptions/end_of_file_exception.h"
+#include "exceptions/file_not_found_exception.h"
+#include "exceptions/index_scan_completed_exception.h"
+#include "exceptions/insufficient_space_exception.h"
+#include "exceptions/no_such_key_found_exception.h"
+
+using namespace badgerdb;
+
+// -----------------------------------------------------------------------------
+// Helpers
+// -----------------------------------------------------------------------------
+
+typedef std::chrono::steady_clock Clock;
+
+static double secondsSince(const Clock::time_point &start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static void removeIfExists(const std::string &name)
+{
+	try
+	{
+		File::remove(name);
+	}
+	catch(const FileNotFoundException &e)
+	{
+	}
+}
+
+// Creates a relation file with numPages used pages, each holding one record.
+static void createFile(const std::string &name, const PageId numPages)
+{
+	removeIfExists(name);
+	PageFile file = PageFile::create(name);
+	for (PageId i = 0; i < numPages; i++)
+	{
+		PageId pageNo;
+		Page page = file.allocatePage(pageNo);
+		page.insertRecord("bench record");
+		file.writePage(pageNo, page);
+	}
+}
+
+// Creates a blob file with numPages allocated pages.
+static void createBlobFile(const std::string &name, const PageId numPages)
+{
+	removeIfExists(name);
+	BlobFile file = BlobFile::create(name);
+	for (PageId i = 0; i < numPages; i++)
+	{
+		PageId pageNo;
+		file.allocatePage(pageNo);
+	}
+}
+
+// Evicts a file from the operating system's page cache, so that the next
+// reads of it go to the device.
+static void dropCache(const std::string &name)
+{
+	int fd = open(name.c_str(), O_RDONLY);
+	if (fd < 0)
+		return;
+	fdatasync(fd);
+	posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	close(fd);
+}
+
+// Resident set size of this process, in kilobytes.
+static long residentKB()
+{
+	std::ifstream status("/proc/self/status");
+	std::string line;
+	while (std::getline(status, line))
+		if (line.compare(0, 6, "VmRSS:") == 0)
+			return std::atol(line.c_str() + 6);
+	return -1;
+}
+
+// Number of pages of a file in the operating system's page cache, in
+// kilobytes.
+static long cachedKB(const std::string &name)
+{
+	int fd = open(name.c_str(), O_RDONLY);
+	if (fd < 0)
+		return -1;
+	struct stat st;
+	fstat(fd, &st);
+	long pageSize = sysconf(_SC_PAGESIZE);
+	std::size_t numPages = (st.st_size + pageSize - 1) / pageSize;
+	long cached = -1;
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (map != MAP_FAILED)
+	{
+		std::vector<unsigned char> resident(numPages);
+		if (mincore(map, st.st_size, &resident[0]) == 0)
+		{
+			cached = 0;
+			for (std::size_t i = 0; i < numPages; i++)
+				cached += resident[i] & 1;
+			cached = cached * pageSize / 1024;
+		}
+		munmap(map, st.st_size);
+	}
+	close(fd);
+	return cached;
+}
+
+// Number of write system calls this process made so far, including
+// pwrite and pwritev.
+static long writeSyscalls()
+{
+	std::ifstream io("/proc/self/io");
+	std::string line;
+	while (std::getline(io, line))
+		if (line.compare(0, 6, "syscw:") == 0)
+			return std::atol(line.c_str() + 6);
+	return -1;
+}
+
+static void report(const std::string &name, const std::string &what, double value, const std::string &unit)
+{
+	std::cout << name << ": " << what << " " << value << " " << unit << std::endl;
+}
+
+static const ReplacementPolicy allPolicies[NUM_POLICIES] = {
+	POLICY_CLOCK, POLICY_LRU2, POLICY_2Q, POLICY_ARC, POLICY_CLOCK_PRO
+};
+
+// Fraction of page requests, including allocations, served from the pool.
+static double hitRatio(BufMgr &bufMgr)
+{
+	const BufStats &stats = bufMgr.getBufStats();
+	return (double)stats.hits / (stats.hits + stats.diskreads);
+}
+
+// Page numbers (1-based) drawn from a Zipf distribution with the given skew.
+static std::vector<PageId> zipfTrace(const PageId numPages, const int length, const double skew)
+{
+	std::vector<double> cdf(numPages);
+	double sum = 0;
+	for (PageId i = 0; i < numPages; i++)
+	{
+		sum += 1.0 / std::pow(i + 1.0, skew);
+		cdf[i] = sum;
+	}
+
+	// scatter the popular pages over the file
+	std::vector<PageId> pageOf(numPages);
+	for (PageId i = 0; i < numPages; i++)
+		pageOf[i] = i + 1;
+	std::random_shuffle(pageOf.begin(), pageOf.end());
+
+	std::vector<PageId> trace(length);
+	for (int i = 0; i < length; i++)
+	{
+		double u = sum * random() / RAND_MAX;
+		std::size_t rank = std::lower_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+		trace[i] = pageOf[std::min<std::size_t>(rank, numPages - 1)];
+	}
+	return trace;
+}
+
+// Replays a trace of page numbers of one blob file through a pool of numBufs
+// frames under every policy.
+static void runTrace(const std::string &benchName, const std::vector<PageId> &trace,
+										 const PageId numPages, const std::uint32_t numBufs)
+{
+	const std::string name = "bench." + benchName;
+	createBlobFile(name, numPages);
+
+	for (int p = 0; p < NUM_POLICIES; p++)
+	{
+		BufMgr bufMgr(numBufs, allPolicies[p]);
+		BlobFile file = BlobFile::open(name);
+		Page *page;
+
+		Clock::time_point start = Clock::now();
+		for (std::size_t i = 0; i < trace.size(); i++)
+		{
+			bufMgr.readPage(&file, trace[i], page);
+			bufMgr.unPinPage(&file, trace[i], false);
+		}
+		double secs = secondsSince(start);
+
+		std::string label = benchName + "." + policyName(allPolicies[p]);
+		report(label, "hit ratio", hitRatio(bufMgr), "");
+		report(label, "throughput", trace.size() / secs, "refs/s");
+		bufMgr.flushFile(&file);
+	}
+
+	removeIfExists(name);
+}
+
+// Tuple layout of the relations indexed by the p3 tests.
+struct BenchRecord
+{
+	int i;
+	double d;
+	char s[64];
+};
+
+// Creates a relation of relationSize BenchRecords with keys 0 to
+// relationSize - 1 in random order.
+static void createRelation(const std::string &relationName, const int relationSize,
+													 const FileBackend backend = BACKEND_PREAD)
+{
+	removeIfExists(relationName);
+	PageFile file = PageFile::create(relationName, backend);
+	std::vector<int> keys(relationSize);
+	for (int i = 0; i < relationSize; i++)
+		keys[i] = i;
+	srandom(42);
+	std::random_shuffle(keys.begin(), keys.end());
+
+	BenchRecord record;
+	memset(&record, ' ', sizeof(record));
+	PageId pageNo;
+	Page page = file.allocatePage(pageNo);
+	for (int i = 0; i < relationSize; i++)
+	{
+		record.i = keys[i];
+		record.d = keys[i];
+		snprintf(record.s, sizeof(record.s), "%05d string record", keys[i]);
+		std::string data(reinterpret_cast<char*>(&record), sizeof(record));
+		try
+		{
+			page.insertRecord(data);
+		}
+		catch (const InsufficientSpaceException &e)
+		{
+			file.writePage(pageNo, page);
+			page = file.allocatePage(pageNo);
+			page.insertRecord(data);
+		}
+	}
+	file.writePage(pageNo, page);
+}
+
+// Runs readPage + unPinPage of random pages of one blob file from 1, 2, 4, ...
+// threads sharing a pool of numBufs frames, and reports the total throughput.
+static void runConcurrent(const std::string &benchName, const PageId numPages,
+													const std::uint32_t numBufs, const int opsPerThread)
+{
+	const std::string name = "bench.mt";
+	createBlobFile(name, numPages);
+
+	int maxThreads = 2 * std::max(2u, std::thread::hardware_concurrency());
+	for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+	{
+		BufMgr bufMgr(numBufs);
+		BlobFile file = BlobFile::open(name);
+
+		Clock::time_point start = Clock::now();
+		std::vector<std::thread> threads;
+		for (int t = 0; t < numThreads; t++)
+		{
+			threads.push_back(std::thread([&bufMgr, &file, numPages, opsPerThread, t]()
+			{
+				unsigned int seed = t + 1;
+				Page *page;
+				for (int i = 0; i < opsPerThread; i++)
+				{
+					PageId pageNo = 1 + rand_r(&seed) % numPages;
+					bufMgr.readPage(&file, pageNo, page);
+					bufMgr.unPinPage(&file, pageNo, false);
+				}
+			}));
+		}
+		for (int t = 0; t < numThreads; t++)
+			threads[t].join();
+		double secs = secondsSince(start);
+
+		report(benchName, std::to_string(numThreads) + " threads throughput",
+					 numThreads * opsPerThread / secs, "ops/s");
+		bufMgr.flushFile(&file);
+	}
+
+	removeIfExists(name);
+}
+
+// -----------------------------------------------------------------------------
+// Benchmarks
+// -----------------------------------------------------------------------------
+
+// Latency of readPage + unPinPage when the page is already in the pool.
+// Pages of several files share the pool, as they do for a relation and its
+// index.
+void benchReadPageHit()
+{
+	const int numFiles = 8;
+	const PageId numPages = 2000;
+	const int numOps = 4000000;
+	std::vector<std::string> names;
+	for (int f = 0; f < numFiles; f++)
+	{
+		names.push_back("bench.hit." + std::to_string(f));
+		createBlobFile(names[f], numPages);
+	}
+
+	{
+		BufMgr bufMgr(numFiles * numPages + 100);
+		std::vector<BlobFile*> files;
+		for (int f = 0; f < numFiles; f++)
+			files.push_back(new BlobFile(names[f], false));
+		Page *page;
+
+		// Fault every page in once
+		for (int f = 0; f < numFiles; f++)
+		{
+			for (PageId i = 1; i <= numPages; i++)
+			{
+				bufMgr.readPage(files[f], i, page);
+				bufMgr.unPinPage(files[f], i, false);
+			}
+		}
+
+		std::vector<BlobFile*> fileOrder(numOps);
+		std::vector<PageId> pageOrder(numOps);
+		srandom(42);
+		for (int i = 0; i < numOps; i++)
+		{
+			fileOrder[i] = files[random() % numFiles];
+			pageOrder[i] = 1 + random() % numPages;
+		}
+
+		Clock::time_point start = Clock::now();
+		for (int i = 0; i < numOps; i++)
+		{
+			bufMgr.readPage(fileOrder[i], pageOrder[i], page);
+			bufMgr.unPinPage(fileOrder[i], pageOrder[i], false);
+		}
+		double secs = secondsSince(start);
+		report("readpage_hit", "latency", secs * 1e9 / numOps, "ns/op");
+
+		// The same with a PageGuard, which unpins without a hash lookup
+		start = Clock::now();
+		for (int i = 0; i < numOps; i++)
+		{
+			PageGuard guard = bufMgr.readPage(fileOrder[i], pageOrder[i]);
+		}
+		secs = secondsSince(start);
+		report("readpage_hit", "guard latency", secs * 1e9 / numOps, "ns/op");
+
+		for (int f = 0; f < numFiles; f++)
+		{
+			bufMgr.flushFile(files[f]);
+			delete files[f];
+		}
+	}
+
+	for (int f = 0; f < numFiles; f++)
+		removeIfExists(names[f]);
+}
+
+// Throughput of readPage + unPinPage when every read misses: a cold
+// sequential scan of a file much larger than the pool.
+void benchReadPageMiss()
+{
+	const std::string name = "bench.miss";
+	const PageId numPages = 20000;
+	const int numPasses = 5;
+	createBlobFile(name, numPages);
+
+	{
+		BufMgr bufMgr(100);
+		BlobFile file = BlobFile::open(name);
+		Page *page;
+
+		Clock::time_point start = Clock::now();
+		for (int pass = 0; pass < numPasses; pass++)
+		{
+			for (PageId i = 1; i <= numPages; i++)
+			{
+				bufMgr.readPage(&file, i, page);
+				bufMgr.unPinPage(&file, i, false);
+			}
+		}
+		double secs = secondsSince(start);
+		report("readpage_miss", "throughput", numPasses * numPages / secs, "pages/s");
+
+		bufMgr.flushFile(&file);
+	}
+
+	removeIfExists(name);
+}
+
+// Cost of reading a page of a file in the page cache into a frame: by value,
+// as a Page returned and then assigned, and straight into the frame with
+// readPageInto(), which leaves the kernel's copy as the only one.
+void benchReadInto()
+{
+	const std::string name = "bench.into";
+	const PageId numPages = 2000;
+	const int numPasses = 20;
+	createBlobFile(name, numPages);
+
+	{
+		BlobFile file = BlobFile::open(name);
+		std::vector<Page> frames(64);
+		for (int way = 0; way < 2; way++)
+		{
+			Clock::time_point start = Clock::now();
+			for (int pass = 0; pass < numPasses; pass++)
+			{
+				for (PageId i = 1; i <= numPages; i++)
+				{
+					Page &frame = frames[i % frames.size()];
+					if (way == 0)
+						frame = file.readPage(i);
+					else
+						file.readPageInto(i, &frame);
+				}
+			}
+			double secs = secondsSince(start);
+			report("read_into", way == 0 ? "by value" : "into frame",
+						 secs * 1e9 / (numPasses * numPages), "ns/page");
+		}
+	}
+
+	removeIfExists(name);
+}
+
+// Concurrent hits: every page of the file fits in the pool.
+void benchConcurrentHit()
+{
+	runConcurrent("mt_hit", 4000, 4100, 1000000);
+}
+
+// Concurrent misses and replacement: the file is four times the pool.
+void benchConcurrentMiss()
+{
+	runConcurrent("mt_miss", 4000, 1000, 200000);
+}
+
+// Skewed point accesses: Zipf(0.9) over 10000 pages with a 500 frame pool.
+void benchPolicyZipf()
+{
+	srandom(42);
+	runTrace("policy_zipf", zipfTrace(10000, 400000, 0.9), 10000, 500);
+}
+
+// A hot set of 300 pages taking 3 of every 4 references, interleaved with
+// sequential scans of a 20000 page file, with a 500 frame pool.
+void benchPolicyScan()
+{
+	const PageId numPages = 20000;
+	const PageId hotPages = 300;
+	srandom(42);
+	std::vector<PageId> trace;
+	PageId scanPos = 0;
+	for (int i = 0; i < 400000; i++)
+	{
+		if (random() % 4 != 0)
+			trace.push_back(numPages - hotPages + 1 + random() % hotPages);
+		else
+		{
+			trace.push_back(1 + scanPos);
+			scanPos = (scanPos + 1) % (numPages - hotPages);
+		}
+	}
+	runTrace("policy_scan", trace, numPages, 500);
+}
+
+// A loop over 600 pages with a 500 frame pool, the worst case for LRU.
+void benchPolicyLoop()
+{
+	std::vector<PageId> trace;
+	for (int i = 0; i < 400000; i++)
+		trace.push_back(1 + i % 600);
+	runTrace("policy_loop", trace, 600, 500);
+}
+
+// The workload of the p3 index tests at a larger scale: a B+ tree is built on
+// the integer field of a relation inserted in random order, then probed with
+// range scans which read each matching record, through a 100 frame pool.
+void benchPolicyIndex()
+{
+	const std::string relationName = "bench.rel";
+	const int relationSize = 50000;
+	const int numScans = 300;
+	const int scanWidth = 300;
+
+	createRelation(relationName, relationSize);
+
+	for (int p = 0; p < NUM_POLICIES; p++)
+	{
+		std::string label = std::string("policy_index.") + policyName(allPolicies[p]);
+		std::string indexName;
+		BufMgr bufMgr(100, allPolicies[p]);
+		PageFile relation = PageFile::open(relationName);
+
+		Clock::time_point start = Clock::now();
+		{
+			BTreeIndex index(relationName, indexName, &bufMgr, offsetof(BenchRecord, i), INTEGER);
+			double buildSecs = secondsSince(start);
+
+			srandom(7);
+			Clock::time_point scanStart = Clock::now();
+			int numResults = 0;
+			for (int s = 0; s < numScans; s++)
+			{
+				int low = random() % (relationSize - scanWidth);
+				int high = low + scanWidth;
+				try
+				{
+					index.startScan(&low, GTE, &high, LT);
+				}
+				catch (const NoSuchKeyFoundException &e)
+				{
+					continue;
+				}
+				try
+				{
+					while (true)
+					{
+						RecordId rid;
+						Page *page;
+						index.scanNext(rid);
+						bufMgr.readPage(&relation, rid.page_number, page);
+						bufMgr.unPinPage(&relation, rid.page_number, false);
+						numResults++;
+					}
+				}
+				catch (const IndexScanCompletedException &e)
+				{
+				}
+				index.endScan();
+			}
+			double scanSecs = secondsSince(scanStart);
+
+			report(label, "build", buildSecs, "s");
+			report(label, "scans", numResults / scanSecs, "records/s");
+		}
+		report(label, "hit ratio", hitRatio(bufMgr), "");
+
+		bufMgr.flushFile(&relation);
+		removeIfExists(indexName);
+	}
+
+	removeIfExists(relationName);
+}
+
+// Wall time of a full FileScan of a large relation without and with read
+// ahead, and of a full range scan of an index on it, with the files in the
+// operating system's page cache (warm) and evicted from it before every scan
+// (cold).
+void benchScanReadAhead()
+{
+	const std::string relationName = "bench.rel";
+	const int relationSize = 300000;
+	const int numPasses = 3;
+	createRelation(relationName, relationSize);
+
+	const int readAheads[] = {0, 8};
+	for (int cold = 0; cold < 2; cold++)
+	{
+		std::string cache = cold ? "cold" : "warm";
+		for (int r = 0; r < 2; r++)
+		{
+			BufMgr bufMgr(100);
+			double secs = 0;
+			for (int pass = 0; pass < numPasses; pass++)
+			{
+				if (cold)
+					dropCache(relationName);
+				Clock::time_point start = Clock::now();
+				FileScan scan(relationName, &bufMgr, readAheads[r]);
+				try
+				{
+					while (true)
+					{
+						RecordId rid;
+						scan.scanNext(rid);
+						scan.getRecord();
+					}
+				}
+				catch (const EndOfFileException &e)
+				{
+				}
+				secs += secondsSince(start);
+			}
+			report("scan_readahead", cache + " filescan, read ahead " + std::to_string(readAheads[r]),
+						 secs / numPasses, "s/scan");
+		}
+	}
+
+	std::string indexName;
+	{
+		BufMgr bufMgr(100);
+		BTreeIndex index(relationName, indexName, &bufMgr, offsetof(BenchRecord, i), INTEGER);
+		for (int cold = 0; cold < 2; cold++)
+		{
+			int low = 0;
+			int high = relationSize;
+			double secs = 0;
+			for (int pass = 0; pass < numPasses; pass++)
+			{
+				if (cold)
+					dropCache(indexName);
+				Clock::time_point start = Clock::now();
+				index.startScan(&low, GTE, &high, LT);
+				try
+				{
+					while (true)
+					{
+						RecordId rid;
+						index.scanNext(rid);
+					}
+				}
+				catch (const IndexScanCompletedException &e)
+				{
+				}
+				index.endScan();
+				secs += secondsSince(start);
+			}
+			report("scan_readahead", std::string(cold ? "cold" : "warm") + " index range scan",
+						 secs / numPasses, "s/scan");
+		}
+	}
+
+	removeIfExists(indexName);
+	removeIfExists(relationName);
+}
+
+// -----------------------------------------------------------------------------
+// Driver
+// -----------------------------------------------------------------------------
+
+// Opening, touching and closing many small files against a large pool: every
+// close flushes the file, which should cost as much as the file's pages in the
+// pool rather than the pool size.
+void benchFlushFile()
+{
+	const std::string name = "bench.flush";
+	const std::uint32_t poolSizes[] = {1000, 10000, 50000};
+	const PageId numPages = 4;
+	const int numCloses = 2000;
+	createBlobFile(name, numPages + 2);
+
+	for (std::size_t p = 0; p < sizeof(poolSizes) / sizeof(poolSizes[0]); p++)
+	{
+		BufMgr bufMgr(poolSizes[p], POLICY_CLOCK, false);
+		BlobFile file = BlobFile::open(name);
+		Page *page;
+
+		Clock::time_point start = Clock::now();
+		for (int n = 0; n < numCloses; n++)
+		{
+			for (PageId i = 2; i < numPages + 2; i++)
+			{
+				bufMgr.readPage(&file, i, page);
+				bufMgr.unPinPage(&file, i, n % 2 == 0);
+			}
+			bufMgr.flushFile(&file);
+		}
+		double secs = secondsSince(start);
+		report("flushfile", std::to_string(poolSizes[p]) + " frames, read " + std::to_string(numPages) +
+					 " pages and flush", secs / numCloses * 1e6, "us");
+	}
+
+	removeIfExists(name);
+}
+
+// Reads and writes through each file backend, starting from a cold OS cache:
+// a sequential pass, random reads and random updates over a file ten times
+// the pool.  Reports the process's resident set and how much of the file the
+// OS page cache holds on top of the pool afterwards.
+void benchFileBackend()
+{
+	const std::string name = "bench.io";
+	const PageId numPages = 10000;
+	const std::uint32_t numBufs = 1000;
+	const int numOps = 20000;
+	const FileBackend backends[] = {BACKEND_STREAM, BACKEND_PREAD, BACKEND_DIRECT};
+	const char *backendNames[] = {"fstream", "pread", "O_DIRECT"};
+	createBlobFile(name, numPages + 1);
+
+	for (int b = 0; b < 3; b++)
+	{
+		std::string prefix = backendNames[b];
+		dropCache(name);
+		BufMgr bufMgr(numBufs, POLICY_CLOCK, false);
+		BlobFile file = BlobFile::open(name, backends[b]);
+		Page *page;
+
+		Clock::time_point start = Clock::now();
+		for (PageId i = 2; i <= numPages; i++)
+		{
+			bufMgr.readPage(&file, i, page);
+			bufMgr.unPinPage(&file, i, false);
+		}
+		double secs = secondsSince(start);
+		report("backend", prefix + " sequential read", (numPages - 1) / secs, "pages/s");
+
+		unsigned int seed = 1;
+		start = Clock::now();
+		for (int op = 0; op < numOps; op++)
+		{
+			PageId pageNo = 2 + rand_r(&seed) % (numPages - 1);
+			bufMgr.readPage(&file, pageNo, page);
+			bufMgr.unPinPage(&file, pageNo, false);
+		}
+		secs = secondsSince(start);
+		report("backend", prefix + " random read", numOps / secs, "pages/s");
+
+		start = Clock::now();
+		for (int op = 0; op < numOps; op++)
+		{
+			PageId pageNo = 2 + rand_r(&seed) % (numPages - 1);
+			bufMgr.readPage(&file, pageNo, page);
+			bufMgr.unPinPage(&file, pageNo, true);
+		}
+		bufMgr.flushFile(&file);
+		secs = secondsSince(start);
+		report("backend", prefix + " random update", numOps / secs, "pages/s");
+
+		report("backend", prefix + " resident set", residentKB(), "KB");
+		report("backend", prefix + " file in OS cache", cachedKB(name), "KB");
+	}
+
+	removeIfExists(name);
+}
+
+// Random page reads from a file opened with O_DIRECT, so that every read goes
+// to the device, issued in batches of 1 to 64 pages through each asynchronous
+// I/O engine.
+void benchQueueDepth()
+{
+	const std::string name = "bench.qd";
+	const PageId numPages = 20000;
+	const int numReads = 4096;
+	const AsyncEngine engines[] = {ENGINE_URING, ENGINE_THREADS};
+	const char *engineNames[] = {"io_uring", "thread pool"};
+	createBlobFile(name, numPages + 1);
+
+	std::vector<Page> pages(AsyncIO::MAX_DEPTH);
+	std::vector<Page*> into;
+	for (std::size_t i = 0; i < pages.size(); i++)
+		into.push_back(&pages[i]);
+
+	for (int e = 0; e < 2; e++)
+	{
+		if (engines[e] == ENGINE_URING && !AsyncIO::uringSupported())
+			continue;
+		AsyncIO::setEngine(engines[e]);
+		BlobFile file = BlobFile::open(name, BACKEND_DIRECT);
+		unsigned int seed = 1;
+
+		for (unsigned depth = 1; depth <= AsyncIO::MAX_DEPTH; depth *= 2)
+		{
+			std::vector<PageId> pageNos(depth);
+			Clock::time_point start = Clock::now();
+			for (int done = 0; done < numReads; done += depth)
+			{
+				for (unsigned i = 0; i < depth; i++)
+					pageNos[i] = 2 + rand_r(&seed) % (numPages - 1);
+				file.readPages(&pageNos[0], &into[0], depth);
+			}
+			double secs = secondsSince(start);
+			report("queue_depth", std::string(engineNames[e]) + " depth " + std::to_string(depth),
+						 numReads / secs, "reads/s");
+		}
+	}
+
+	AsyncIO::setEngine(ENGINE_DEFAULT);
+	removeIfExists(name);
+}
+
+// Random reads and updates over a file four times the size of the pool, with
+// and without the background writer.  Each request does a little work on the
+// page, which leaves the writer time to clean frames ahead of the clock hand.
+void benchBackgroundWriter()
+{
+	const std::string name = "bench.bgw";
+	const PageId numPages = 4000;
+	const std::uint32_t numBufs = 1000;
+	const int numOps = 100000;
+	createBlobFile(name, numPages + 1);
+
+	for (int on = 0; on < 2; on++)
+	{
+		BufMgr bufMgr(numBufs, POLICY_CLOCK, on);
+		BlobFile file = BlobFile::open(name);
+		unsigned int seed = 1;
+		Page *page;
+		volatile std::uint32_t sink = 0;
+
+		Clock::time_point start = Clock::now();
+		for (int op = 0; op < numOps; op++)
+		{
+			PageId pageNo = 2 + rand_r(&seed) % (numPages - 1);
+			bool dirty = rand_r(&seed) % 2 == 0;
+			bufMgr.readPage(&file, pageNo, page);
+			const char *bytes = reinterpret_cast<const char *>(page);
+			for (std::size_t i = 0; i < 2048; i += 8)
+				sink += bytes[i];
+			bufMgr.unPinPage(&file, pageNo, dirty);
+		}
+		double secs = secondsSince(start);
+
+		const BufStats &stats = bufMgr.getBufStats();
+		std::string config = on ? "writer on" : "writer off";
+		report("bgwriter", config + " throughput", numOps / secs, "ops/s");
+		report("bgwriter", config + " foreground writes", stats.fgwrites, "pages");
+		report("bgwriter", config + " background writes", stats.bgwrites, "pages");
+
+		bufMgr.flushFile(&file);
+	}
+
+	removeIfExists(name);
+}
+
+// Bulk build of an index on a relation, through a pool much smaller than the
+// index without and with the background writer, and through one that holds
+// all of it, which writes it all back when the index goes away.  Reports the
+// write system calls made for the build, including that final writeback, and
+// its wall time.  Batches run on the thread pool engine so that every write
+// is a system call of this process.
+void benchWriteback()
+{
+	const std::string relationName = "bench.wb";
+	const int relationSize = 100000;
+	const std::uint32_t poolSizes[] = {100, 100, 10000};
+	const bool writerOn[] = {false, true, false};
+	createRelation(relationName, relationSize);
+	AsyncIO::setEngine(ENGINE_THREADS);
+
+	for (int c = 0; c < 3; c++)
+	{
+		std::string config = std::to_string(poolSizes[c]) + " frames, writer " + (writerOn[c] ? "on" : "off");
+		std::string indexName;
+		long syscalls = writeSyscalls();
+		int diskwrites;
+
+		Clock::time_point start = Clock::now();
+		{
+			BufMgr bufMgr(poolSizes[c], POLICY_CLOCK, writerOn[c]);
+			{
+				BTreeIndex index(relationName, indexName, &bufMgr, offsetof(BenchRecord, i), INTEGER);
+			}
+			diskwrites = bufMgr.getBufStats().diskwrites;
+		}
+		double secs = secondsSince(start);
+
+		report("writeback", config + " index build", secs, "s");
+		report("writeback", config + " write syscalls", writeSyscalls() - syscalls, "");
+		report("writeback", config + " pages written", diskwrites, "pages");
+		removeIfExists(indexName);
+	}
+
+	AsyncIO::setEngine(ENGINE_DEFAULT);
+	removeIfExists(relationName);
+}
+
+// Writes a relation through the fstream and pread backends, and builds an
+// index on it, under each durability policy.  The relation syncs when it is
+// closed, the index when the buffer manager flushes it and when it is closed.
+// Reports wall time and write system calls.
+void benchDurability()
+{
+	const std::string relationName = "bench.dur";
+	const int relationSize = 100000;
+	const Durability policies[] = {DURABILITY_NONE, DURABILITY_FLUSH, DURABILITY_SYNC};
+	const char *policyNames[] = {"none", "flush", "sync"};
+	const FileBackend backends[] = {BACKEND_STREAM, BACKEND_PREAD};
+	const char *backendNames[] = {"fstream", "pread"};
+
+	for (int p = 0; p < 3; p++)
+	{
+		File::setDefaultDurability(policies[p]);
+		std::string label = std::string("durability.") + policyNames[p];
+
+		for (int b = 0; b < 2; b++)
+		{
+			long syscalls = writeSyscalls();
+			Clock::time_point start = Clock::now();
+			createRelation(relationName, relationSize, backends[b]);
+			double secs = secondsSince(start);
+			report(label, std::string(backendNames[b]) + " relation build", secs, "s");
+			report(label, std::string(backendNames[b]) + " relation write syscalls", writeSyscalls() - syscalls, "");
+		}
+
+		std::string indexName;
+		long syscalls = writeSyscalls();
+		Clock::time_point start = Clock::now();
+		{
+			BufMgr bufMgr(1000, POLICY_CLOCK, false);
+			BTreeIndex index(relationName, indexName, &bufMgr, offsetof(BenchRecord, i), INTEGER);
+		}
+		double secs = secondsSince(start);
+		report(label, "index build", secs, "s");
+		report(label, "index write syscalls", writeSyscalls() - syscalls, "");
+		removeIfExists(indexName);
+	}
+
+	File::setDefaultDurability(DURABILITY_FLUSH);
+	removeIfExists(relationName);
+}
+
+// Key lookups in an index on a relation, interleaved with full scans of the
+// relation, through a 300 frame pool that holds the index but not the
+// relation.  Reports the hit ratio and throughput of the lookups, and the
+// scan time, with the scans reading through the pool (normal) and through a
+// ring of frames (sequential).
+void benchMixed()
+{
+	const std::string relationName = "bench.mix";
+	const int relationSize = 100000;
+	const int numRounds = 20;
+	const int lookupsPerRound = 1000;
+	const AccessStrategy strategies[] = {ACCESS_NORMAL, ACCESS_SEQUENTIAL};
+	const char *strategyNames[] = {"normal", "sequential"};
+
+	createRelation(relationName, relationSize);
+	std::string indexName;
+	{
+		BufMgr bufMgr(1000);
+		BTreeIndex index(relationName, indexName, &bufMgr, offsetof(BenchRecord, i), INTEGER);
+	}
+
+	for (int s = 0; s < 2; s++)
+	{
+		std::string label = std::string("mixed.") + strategyNames[s];
+		BufMgr bufMgr(300);
+		PageFile relation = PageFile::open(relationName);
+		double lookupSecs = 0;
+		double scanSecs = 0;
+		std::uint64_t indexHits = 0;
+		std::uint64_t indexMisses = 0;
+		srandom(7);
+		{
+			BTreeIndex index(relationName, indexName, &bufMgr, offsetof(BenchRecord, i), INTEGER);
+			for (int r = 0; r < numRounds; r++)
+			{
+				bufMgr.clearBufStats();
+				Clock::time_point start = Clock::now();
+				for (int l = 0; l < lookupsPerRound; l++)
+				{
+					int key = random() % relationSize;
+					RecordId rid;
+					index.startScan(&key, GTE, &key, LTE);
+					index.scanNext(rid);
+					index.endScan();
+				}
+				lookupSecs += secondsSince(start);
+				std::map<std::string, FileStats> files = bufMgr.getFileStats();
+				indexHits += files[indexName].hits;
+				indexMisses += files[indexName].misses;
+
+				start = Clock::now();
+				{
+					FileScan scan(relationName, &bufMgr, FileScan::READ_AHEAD, strategies[s]);
+					try
+					{
+						RecordId rid;
+						while (true)
+							scan.scanNext(rid);
+					}
+					catch (const EndOfFileException &e)
+					{
+					}
+				}
+				scanSecs += secondsSince(start);
+			}
+		}
+
+		report(label, "index hit ratio", double(indexHits) / (indexHits + indexMisses), "");
+		report(label, "lookups", numRounds * lookupsPerRound / lookupSecs, "lookups/s");
+		report(label, "scan", scanSecs / numRounds, "s");
+		bufMgr.flushFile(&relation);
+	}
+
+	removeIfExists(indexName);
+	removeIfExists(relationName);
+}
+
+// Throughput of BTreeIndex inserts, as the index is built over a relation of
+// keys in random order, with a pool that holds the whole tree and with one
+// that holds a few levels of it.  Every insert pins and unpins each node on
+// its path through PageGuards.
+void benchInsert()
+{
+	const std::string relationName = "bench.ins";
+	const int relationSize = 200000;
+	const std::uint32_t poolSizes[] = {5000, 100};
+	const char *poolNames[] = {"fits", "small"};
+
+	createRelation(relationName, relationSize);
+	for (int p = 0; p < 2; p++)
+	{
+		std::string label = std::string("insert.") + poolNames[p];
+		std::string indexName;
+		BufMgr bufMgr(poolSizes[p]);
+		Clock::time_point start = Clock::now();
+		{
+			BTreeIndex index(relationName, indexName, &bufMgr, offsetof(BenchRecord, i), INTEGER);
+		}
+		double secs = secondsSince(start);
+		report(label, "throughput", relationSize / secs, "inserts/s");
+		removeIfExists(indexName);
+	}
+
+	removeIfExists(relationName);
+}
+
+// The policy_zipf workload under the clock with the statistics reporter
+// running, followed by the final statistics as JSON.  Compare the throughput
+// with policy_zipf.clock for the cost of the bookkeeping.
+void benchStats()
+{
+	const std::string name = "bench.stats";
+	srandom(42);
+	std::vector<PageId> trace = zipfTrace(10000, 400000, 0.9);
+	createBlobFile(name, 10000);
+
+	{
+		BufMgr bufMgr(500, POLICY_CLOCK);
+		BlobFile file = BlobFile::open(name);
+		Page *page;
+
+		std::ostringstream reports;
+		bufMgr.startStatsReporter(reports, 100);
+		Clock::time_point start = Clock::now();
+		for (std::size_t i = 0; i < trace.size(); i++)
+		{
+			bufMgr.readPage(&file, trace[i], page);
+			bufMgr.unPinPage(&file, trace[i], false);
+		}
+		double secs = secondsSince(start);
+		bufMgr.stopStatsReporter();
+
+		report("stats", "throughput", trace.size() / secs, "refs/s");
+		std::string lines = reports.str();
+		report("stats", "reports", std::count(lines.begin(), lines.end(), '\n'), "");
+		bufMgr.dumpStats(std::cout);
+		bufMgr.flushFile(&file);
+	}
+
+	removeIfExists(name);
+}
+
+// Hit ratio after a restart of a pool of 1000 frames over a zipf workload,
+// cold and prewarmed from the snapshot written when the previous pool shut
+// down, with the file evicted from the operating system's page cache.
+// Reports the time and references until the hit ratio of a window of 1000
+// references first reaches 95% of the steady state one.
+void benchWarmRestart()
+{
+	const std::string name = "bench.warm";
+	const std::string snapshotName = name + ".snapshot";
+	const PageId numPages = 20000;
+	const std::uint32_t numBufs = 1000;
+	const int window = 1000;
+	srandom(42);
+	std::vector<PageId> trace = zipfTrace(numPages, 200000, 0.9);
+	createBlobFile(name, numPages);
+	removeIfExists(snapshotName);
+
+	double steady;
+	{
+		BlobFile file = BlobFile::open(name);
+		BufMgr bufMgr(numBufs, POLICY_CLOCK);
+		bufMgr.enableSnapshot(snapshotName);
+		Page *page;
+		for (std::size_t i = 0; i < trace.size(); i++)
+		{
+			if (i == trace.size() / 2)
+				bufMgr.clearBufStats();
+			bufMgr.readPage(&file, trace[i], page);
+			bufMgr.unPinPage(&file, trace[i], false);
+		}
+		steady = hitRatio(bufMgr);
+	}
+	report("warm_restart", "steady hit ratio", steady, "");
+
+	const char *modeNames[] = {"cold", "warm"};
+	for (int warm = 0; warm < 2; warm++)
+	{
+		std::string label = std::string("warm_restart.") + modeNames[warm];
+		dropCache(name);
+		BlobFile file = BlobFile::open(name);
+		BufMgr bufMgr(numBufs, POLICY_CLOCK);
+		Page *page;
+
+		Clock::time_point start = Clock::now();
+		if (warm)
+		{
+			bufMgr.enableSnapshot(snapshotName);
+			report(label, "prewarmed", bufMgr.prewarm(&file), "pages");
+			report(label, "prewarm", secondsSince(start), "s");
+		}
+		bufMgr.clearBufStats();
+
+		double firstWindow = -1;
+		double steadySecs = -1;
+		std::size_t steadyRefs = 0;
+		for (std::size_t i = 0; i < trace.size() && steadySecs < 0; i++)
+		{
+			bufMgr.readPage(&file, trace[i], page);
+			bufMgr.unPinPage(&file, trace[i], false);
+			if ((i + 1) % window != 0)
+				continue;
+			double ratio = hitRatio(bufMgr);
+			bufMgr.clearBufStats();
+			if (firstWindow < 0)
+				firstWindow = ratio;
+			if (ratio >= 0.95 * steady)
+			{
+				steadySecs = secondsSince(start);
+				steadyRefs = i + 1;
+			}
+		}
+
+		report(label, "first window hit ratio", firstWindow, "");
+		report(label, "time to steady state", steadySecs, "s");
+		report(label, "refs to steady state", steadyRefs, "");
+		bufMgr.flushFile(&file);
+	}
+
+	removeIfExists(snapshotName);
+	removeIfExists(name);
+}
+
+// The policy_zipf workload under the clock without and with a trace being
+// recorded, for the cost of recording, and the requests dropped from the
+// trace.  Replay bench.trace with badgerdb_sim for the miss ratio curves.
+void benchTrace()
+{
+	const std::string name = "bench.traced";
+	const std::string traceName = "bench.trace";
+	srandom(42);
+	std::vector<PageId> trace = zipfTrace(10000, 400000, 0.9);
+	createBlobFile(name, 10000);
+
+	for (int traced = 0; traced < 2; traced++)
+	{
+		std::string label = traced ? "trace.on" : "trace.off";
+		BufMgr bufMgr(500, POLICY_CLOCK);
+		BlobFile file = BlobFile::open(name);
+		Page *page;
+
+		if (traced)
+			bufMgr.startTrace(traceName);
+		Clock::time_point start = Clock::now();
+		for (std::size_t i = 0; i < trace.size(); i++)
+		{
+			bufMgr.readPage(&file, trace[i], page);
+			bufMgr.unPinPage(&file, trace[i], false);
+		}
+		double secs = secondsSince(start);
+
+		report(label, "throughput", trace.size() / secs, "refs/s");
+		if (traced)
+			report(label, "dropped", bufMgr.stopTrace(), "requests");
+		bufMgr.flushFile(&file);
+	}
+
+	removeIfExists(name);
+}
+
+// The policy_index scans through a pool of 100 frames, without and with a
+// compressed tier of 1 MB, the size of 128 frames, with the relation read
+// through O_DIRECT so that its misses go to the device.  Reports the pages
+// the tier holds on top of the frames, and the latency of a page from the
+// tier next to that of a read from disk.
+void benchTier()
+{
+	const std::string relationName = "bench.rel";
+	const int relationSize = 50000;
+	const int numScans = 300;
+	const int scanWidth = 300;
+	const std::size_t budget = 1 << 20;
+
+	createRelation(relationName, relationSize, BACKEND_DIRECT);
+
+	for (int withTier = 0; withTier < 2; withTier++)
+	{
+		std::string label = withTier ? "tier.on" : "tier.off";
+		std::string indexName;
+		BufMgr bufMgr(100, POLICY_CLOCK);
+		if (withTier)
+			bufMgr.enableCompressedTier(budget);
+		PageFile relation = PageFile::open(relationName, BACKEND_DIRECT);
+		{
+			BTreeIndex index(relationName, indexName, &bufMgr, offsetof(BenchRecord, i), INTEGER);
+			bufMgr.clearBufStats();
+
+			srandom(7);
+			Clock::time_point start = Clock::now();
+			int numResults = 0;
+			for (int s = 0; s < numScans; s++)
+			{
+				int low = random() % (relationSize - scanWidth);
+				int high = low + scanWidth;
+				try
+				{
+					index.startScan(&low, GTE, &high, LT);
+				}
+				catch (const NoSuchKeyFoundException &e)
+				{
+					continue;
+				}
+				try
+				{
+					while (true)
+					{
+						RecordId rid;
+						Page *page;
+						index.scanNext(rid);
+						bufMgr.readPage(&relation, rid.page_number, page);
+						bufMgr.unPinPage(&relation, rid.page_number, false);
+						numResults++;
+					}
+				}
+				catch (const IndexScanCompletedException &e)
+				{
+				}
+				index.endScan();
+			}
+			double secs = secondsSince(start);
+
+			const BufStats &stats = bufMgr.getBufStats();
+			TierStats tierStats = bufMgr.getTierStats();
+			report(label, "scans", numResults / secs, "records/s");
+			report(label, "pool hit ratio", (double)stats.hits / (stats.hits + stats.misses), "");
+			report(label, "disk reads", stats.diskreads, "pages");
+			report(label, "tier hits", stats.tierHits, "pages");
+			report(label, "capacity", 100 + tierStats.pages, "pages");
+			if (tierStats.pages > 0)
+				report(label, "tier bytes per page", double(tierStats.bytes) / tierStats.pages, "B");
+			report(label, "disk read p50", stats.readLatency.percentile(0.5), "ns");
+			if (withTier)
+				report(label, "tier read p50", stats.tierLatency.percentile(0.5), "ns");
+		}
+		bufMgr.flushFile(&relation);
+		removeIfExists(indexName);
+	}
+
+	removeIfExists(relationName);
+}
+
+// Batches of 64 pages of a file opened with O_DIRECT, read one readPage() at
+// a time and with one readPages(): scattered at random, and in 8 runs of 8
+// adjacent pages, which readPages() reads with one request per run.
+void benchReadPages()
+{
+	const std::string name = "bench.batch";
+	const PageId numPages = 20000;
+	const int batchSize = 64;
+	const int runLength = 8;
+	const int numBatches = 300;
+	createBlobFile(name, numPages);
+
+	for (int clustered = 0; clustered < 2; clustered++)
+	{
+		// the same batches for both ways of reading them
+		std::vector<PageId> pageNos;
+		unsigned int seed = 1;
+		for (int i = 0; i < numBatches * batchSize; i++)
+		{
+			if (!clustered)
+				pageNos.push_back(1 + rand_r(&seed) % numPages);
+			else if (i % runLength == 0)
+				pageNos.push_back(1 + rand_r(&seed) % (numPages - runLength));
+			else
+				pageNos.push_back(pageNos.back() + 1);
+		}
+
+		double rates[2];
+		for (int batched = 0; batched < 2; batched++)
+		{
+			std::string label = std::string(clustered ? "clustered" : "random") + (batched ? " batch" : " single");
+			BufMgr bufMgr(1000, POLICY_CLOCK, false);
+			BlobFile file = BlobFile::open(name, BACKEND_DIRECT);
+			std::vector<Page*> pages(batchSize);
+
+			Clock::time_point start = Clock::now();
+			for (int b = 0; b < numBatches; b++)
+			{
+				const PageId *batch = &pageNos[b * batchSize];
+				if (batched)
+					bufMgr.readPages(&file, batch, &pages[0], batchSize);
+				else
+				{
+					for (int i = 0; i < batchSize; i++)
+						bufMgr.readPage(&file, batch[i], pages[i]);
+				}
+				for (int i = 0; i < batchSize; i++)
+					bufMgr.unPinPage(&file, batch[i], false);
+			}
+			double secs = secondsSince(start);
+			rates[batched] = pageNos.size() / secs;
+			report("read_pages", label, rates[batched], "pages/s");
+			report("read_pages", label + " hit ratio", hitRatio(bufMgr), "");
+			bufMgr.flushFile(&file);
+		}
+		report("read_pages", std::string(clustered ? "clustered" : "random") + " speedup", rates[1] / rates[0], "x");
+	}
+
+	removeIfExists(name);
+}
+
+// Threads reading and updating a record on one or a few hot pages, through
+// PageGuards that latch them shared or optimistically for reading and
+// exclusively for writing; an optimistic reader that finds the page changed
+// reads it again, and an optimistic writer upgrades its latch. Updates keep
+// the record the same length, so an optimistic read of a page being written
+// sees torn bytes at worst. Reports the throughput and how often a guard had
+// to wait or start over.
+void benchLatch()
+{
+	const std::string name = "bench.latch";
+	const int opsPerThread = 100000;
+	const PageId hotPages[] = {1, 8};
+	const int writePercents[] = {0, 10};
+	const LatchMode readModes[] = {LATCH_SHARED, LATCH_OPTIMISTIC};
+	const int maxThreads = 2 * std::max(2u, std::thread::hardware_concurrency());
+
+	for (int h = 0; h < 2; h++)
+	{
+		const PageId numPages = hotPages[h];
+		createFile(name, numPages);
+		for (int w = 0; w < 2; w++)
+		{
+			const int writePercent = writePercents[w];
+			for (int m = 0; m < 2; m++)
+			{
+				const LatchMode readMode = readModes[m];
+				for (int numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+				{
+					BufMgr bufMgr(100);
+					PageFile file = PageFile::open(name);
+					Clock::time_point start = Clock::now();
+					std::vector<std::thread> threads;
+					for (int t = 0; t < numThreads; t++)
+					{
+						threads.push_back(std::thread([&bufMgr, &file, numPages, writePercent, readMode, opsPerThread, t]()
+						{
+							unsigned int seed = t + 1;
+							for (int i = 0; i < opsPerThread; i++)
+							{
+								PageId pageNo = 1 + rand_r(&seed) % numPages;
+								bool write = int(rand_r(&seed) % 100) < writePercent;
+								PageGuard guard = bufMgr.readPage(&file, pageNo);
+								if (readMode == LATCH_SHARED)
+								{
+									guard.latch(write ? LATCH_EXCLUSIVE : LATCH_SHARED);
+								}
+								else
+								{
+									// read until the read is consistent, or the latch upgraded
+									while (true)
+									{
+										guard.latch(LATCH_OPTIMISTIC);
+										std::string record = guard->getRecord(RecordId{pageNo, 1});
+										if (write ? guard.upgrade() : guard.validate())
+											break;
+									}
+								}
+								if (write)
+								{
+									guard->updateRecord(RecordId{pageNo, 1}, "bench update");
+									guard.markDirty();
+								}
+								else if (readMode == LATCH_SHARED)
+								{
+									guard->getRecord(RecordId{pageNo, 1});
+								}
+							}
+						}));
+					}
+					for (int t = 0; t < numThreads; t++)
+						threads[t].join();
+					double secs = secondsSince(start);
+
+					const BufStats &stats = bufMgr.getBufStats();
+					std::string label = std::to_string(numPages) + (numPages == 1 ? " page, " : " pages, ") +
+															std::to_string(writePercent) + "% writes, " +
+															(readMode == LATCH_SHARED ? "shared, " : "optimistic, ") +
+															std::to_string(numThreads) + " threads";
+					double ops = double(numThreads) * opsPerThread;
+					report("latch", label + " throughput", ops / secs, "ops/s");
+					report("latch", label + " waits", stats.latchWaits / ops, "per op");
+					if (readMode == LATCH_OPTIMISTIC)
+						report("latch", label + " restarts", stats.latchRestarts / ops, "per op");
+					bufMgr.flushFile(&file);
+				}
+			}
+		}
+	}
+
+	removeIfExists(name);
+}
+
+// Full scans of a large relation, and random range scans of an index on it
+// fetching the records they find, through a small pool and with the files
+// opened with BACKEND_MMAP, whose pages are read in place. Scans run with the
+// files in the operating system's page cache (warm) and evicted from it
+// before every scan (cold).
+void benchMmap()
+{
+	const std::string relationName = "bench.rel";
+	const int relationSize = 300000;
+	const int numPasses = 3;
+	const int numScans = 300;
+	const int scanWidth = 300;
+	const FileBackend backends[] = {BACKEND_PREAD, BACKEND_MMAP};
+	const char *backendNames[] = {"buffered", "mmap"};
+	createRelation(relationName, relationSize);
+
+	for (int cold = 0; cold < 2; cold++)
+	{
+		std::string cache = cold ? "cold" : "warm";
+		for (int b = 0; b < 2; b++)
+		{
+			BufMgr bufMgr(100);
+			double secs = 0;
+			int records = 0;
+			for (int pass = 0; pass < numPasses; pass++)
+			{
+				if (cold)
+					dropCache(relationName);
+				Clock::time_point start = Clock::now();
+				FileScan scan(relationName, &bufMgr, FileScan::READ_AHEAD, ACCESS_SEQUENTIAL, backends[b]);
+				try
+				{
+					while (true)
+					{
+						RecordId rid;
+						scan.scanNext(rid);
+						scan.getRecord();
+						records++;
+					}
+				}
+				catch (const EndOfFileException &e)
+				{
+				}
+				secs += secondsSince(start);
+			}
+			report("mmap", cache + " filescan " + backendNames[b], records / secs, "records/s");
+		}
+	}
+
+	std::string indexName;
+	{
+		BufMgr bufMgr(100);
+		BTreeIndex index(relationName, indexName, &bufMgr, offsetof(BenchRecord, i), INTEGER);
+	}
+	for (int b = 0; b < 2; b++)
+	{
+		BufMgr bufMgr(100);
+		PageFile relation = PageFile::open(relationName, backends[b]);
+		BTreeIndex index(relationName, indexName, &bufMgr, offsetof(BenchRecord, i), INTEGER, backends[b]);
+
+		srandom(7);
+		Clock::time_point start = Clock::now();
+		int numResults = 0;
+		for (int s = 0; s < numScans; s++)
+		{
+			int low = random() % (relationSize - scanWidth);
+			int high = low + scanWidth;
+			index.startScan(&low, GTE, &high, LT);
+			try
+			{
+				while (true)
+				{
+					RecordId rid;
+					Page *page;
+					index.scanNext(rid);
+					bufMgr.readPage(&relation, rid.page_number, page);
+					page->getRecord(rid);
+					bufMgr.unPinPage(&relation, rid.page_number, false);
+					numResults++;
+				}
+			}
+			catch (const IndexScanCompletedException &e)
+			{
+			}
+			index.endScan();
+		}
+		report("mmap", std::string("index scans ") + backendNames[b], numResults / secondsSince(start), "records/s");
+		bufMgr.flushFile(&relation);
+	}
+
+	removeIfExists(indexName);
+	removeIfExists(relationName);
+}
+
+// Build of an index on a relation in random key order, which dirties leaves
+// all over the index, through a pool much smaller than the index with the
+// background writer on, replacing the first page the policy offers and
+// passing over up to 8 and 32 dirty pages for a clean one.  Reports the build
+// time and the writes that stalled the inserting thread.
+void benchCleanVictims()
+{
+	const std::string relationName = "bench.cv";
+	const int relationSize = 200000;
+	const std::uint32_t numBufs = 100;
+	const std::uint32_t lookaheads[] = {0, 8, 32};
+	createRelation(relationName, relationSize);
+
+	for (int l = 0; l < 3; l++)
+	{
+		std::string config = "lookahead " + std::to_string(lookaheads[l]);
+		std::string indexName;
+		BufMgr bufMgr(numBufs);
+		bufMgr.setCleanLookahead(lookaheads[l]);
+
+		Clock::time_point start = Clock::now();
+		{
+			BTreeIndex index(relationName, indexName, &bufMgr, offsetof(BenchRecord, i), INTEGER);
+		}
+		double secs = secondsSince(start);
+
+		const BufStats &stats = bufMgr.getBufStats();
+		report("clean_victims", config + " index build", secs, "s");
+		report("clean_victims", config + " write stalls", stats.writeStall.count(), "");
+		report("clean_victims", config + " stalled", stats.writeStall.sum() / 1e9, "s");
+		report("clean_victims", config + " stall p99", stats.writeStall.percentile(0.99), "ns");
+		report("clean_victims", config + " foreground writes", stats.fgwrites, "pages");
+		report("clean_victims", config + " background writes", stats.bgwrites, "pages");
+		report("clean_victims", config + " dirty pages passed over", stats.dirtySkips, "");
+		removeIfExists(indexName);
+	}
+
+	removeIfExists(relationName);
+}
+
+struct Benchmark
+{
+	const char *name;
+	void (*run)();
+};
+
+static const Benchmark benchmarks[] = {
+	{"readpage_hit", benchReadPageHit},
+	{"readpage_miss", benchReadPageMiss},
+	{"read_into", benchReadInto},
+	{"policy_zipf", benchPolicyZipf},
+	{"policy_scan", benchPolicyScan},
+	{"policy_loop", benchPolicyLoop},
+	{"policy_index", benchPolicyIndex},
+	{"mt_hit", benchConcurrentHit},
+	{"mt_miss", benchConcurrentMiss},
+	{"scan_readahead", benchScanReadAhead},
+	{"bgwriter", benchBackgroundWriter},
+	{"flushfile", benchFlushFile},
+	{"backend", benchFileBackend},
+	{"queue_depth", benchQueueDepth},
+	{"writeback", benchWriteback},
+	{"durability", benchDurability},
+	{"stats", benchStats},
+	{"mixed", benchMixed},
+	{"insert", benchInsert},
+	{"warm_restart", benchWarmRestart},
+	{"trace", benchTrace},
+	{"tier", benchTier},
+	{"read_pages", benchReadPages},
+	{"latch", benchLatch},
+	{"mmap", benchMmap},
+	{"clean_victims", benchCleanVictims},
+};
+
+int main(int argc, char **argv)
+{
+	const int numBenchmarks = sizeof(benchmarks) / sizeof(benchmarks[0]);
+	for (int i = 0; i < numBenchmarks; i++)
+	{
+		bool selected = argc <= 1;
+		for (int j = 1; j < argc; j++)
+		{
+			if (std::strcmp(argv[j], benchmarks[i].name) == 0)
+				selected = true;
+		}
+
+		if (selected)
+			benchmarks[i].run();
+	}
+
+	return 0;
+}
@@ -21,6 +21,7 @@
  *
  */
 
+#include <errno.h>
 #include "btree.h"
 #include "filescan.h"
 #include "exceptions/bad_index_info_exception.h"
@@ -31,6 +32,7 @@
 #include "exceptions/index_scan_completed_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/end_of_file_exception.h"
+#include "exceptions/file_io_exception.h"
 #include "limits.h" // header for INT_MAX
 
 //#define DEBUG
@@ -46,7 +48,8 @@ namespace badgerdb
                          std::string &outIndexName,
                          BufMgr *bufMgrIn,
                          const int attrByteOffset,
-                         const Datatype attrType)
+                         const Datatype attrType,
+                         const FileBackend backend)
   {
     // init bTree private data members
     this->bufMgr = bufMgrIn;
@@ -69,15 +72,16 @@ namespace badgerdb
     if (fileTest)
     { // file already existed
       fileTest.close();
-      this->file = new BlobFile(outIndexName, false);
+      this->file = new BlobFile(outIndexName, false, backend);
       // First page is #1
       this->headerPageNum = this->file->getFirstPageNo();
 
-      Page *metaPage;
-      bufMgr->readPage(file, headerPageNum, metaPage);
-      IndexMetaInfo *metaInfo = reinterpret_cast<IndexMetaInfo *>(metaPage);
+      // bring back the pages the index had in the pool before a restart
+      bufMgr->prewarm(file);
+
+      PageGuard metaPage = bufMgr->readPage(file, headerPageNum);
+      IndexMetaInfo *metaInfo = reinterpret_cast<IndexMetaInfo *>(metaPage.page());
       this->rootPageNum = metaInfo->rootPageNo;
-      bufMgr->unPinPage(file, headerPageNum, false);
     }
     else
     { // file not existed
@@ -85,33 +89,30 @@ namespace badgerdb
       this->file = new BlobFile(outIndexName, true);
 
       // create MetaPage @388
-      Page *metaPage;
-      PageId metaPageId;
-      bufMgr->allocPage(file, metaPageId, metaPage);
-      this->headerPageNum = metaPageId;
+      PageGuard metaPage = bufMgr->allocPage(file);
+      this->headerPageNum = metaPage.pageNo();
 
-      IndexMetaInfo *metaInfo = reinterpret_cast<IndexMetaInfo *>(metaPage);
+      IndexMetaInfo *metaInfo = reinterpret_cast<IndexMetaInfo *>(metaPage.page());
       relationName.copy(metaInfo->relationName, 20);
       metaInfo->attrByteOffset = attrByteOffset;
       metaInfo->attrType = attrType;
 
       // create RootPage @393
-      Page *rootPage;
-      PageId rootPageId;
-      bufMgr->allocPage(file, rootPageId, rootPage);
-      metaInfo->rootPageNo = rootPageId;
-      this->rootPageNum = rootPageId;
+      PageGuard rootPage = bufMgr->allocPage(file);
+      metaInfo->rootPageNo = rootPage.pageNo();
+      this->rootPageNum = rootPage.pageNo();
 
       // key1 <= entry < key2.
       metaInfo->height = 1;
       // Initialization of rootnode
-      LeafNodeInt *rootNode = reinterpret_cast<LeafNodeInt *>(rootPage);
+      LeafNodeInt *rootNode = reinterpret_cast<LeafNodeInt *>(rootPage.page());
       rootNode->rightSibPageNo = Page::INVALID_NUMBER;
       rootNode->keyArray[0] = INT_MAX;
       rootNode->ridArray[0].page_number = Page::INVALID_NUMBER;
 
-      // insert entries
-      FileScan fscan(relationName, this->bufMgr);
+      // insert entries; the scan of the relation recycles a ring of frames,
+      // so it does not push the pages of the tree out of the pool
+      FileScan fscan(relationName, this->bufMgr, FileScan::READ_AHEAD, ACCESS_SEQUENTIAL, backend);
       try
       {
         RecordId scanRid;
@@ -130,9 +131,18 @@ namespace badgerdb
       }
 
       // closing
-      this->bufMgr->unPinPage(this->file, metaPageId, true);
-      this->bufMgr->unPinPage(this->file, rootPageId, true);
+      metaPage.markDirty();
+      metaPage.release();
+      rootPage.markDirty();
+      rootPage.release();
       this->bufMgr->flushFile(this->file);
+
+      // a mapped index can only be read
+      if (backend == BACKEND_MMAP)
+      {
+        delete this->file;
+        this->file = new BlobFile(outIndexName, false, backend);
+      }
     }
   }
 
@@ -142,6 +152,8 @@ namespace badgerdb
 
   BTreeIndex::~BTreeIndex()
   {
+    // drop the leaf of an unfinished scan
+    this->currentPage.release();
     this->bufMgr->flushFile(this->file);
     delete this->file;
     this->file = NULL;
@@ -154,12 +166,11 @@ namespace badgerdb
 
   void BTreeIndex::insertUnderNode(RIDKeyPair<int> *entry, PageId curPageId, bool isLeaf, PageKeyPair<int> *newChild)
   {
-    Page *curPage;
-    bufMgr->readPage(this->file, curPageId, curPage);
+    PageGuard curPage = bufMgr->readPage(this->file, curPageId);
 
     if (isLeaf)
     {
-      LeafNodeInt *curNode = reinterpret_cast<LeafNodeInt *>(curPage);
+      LeafNodeInt *curNode = reinterpret_cast<LeafNodeInt *>(curPage.page());
       /// find the number of slots in this node
       int entryNum = 0;
       for (; entryNum <= this->leafOccupancy; entryNum++)
@@ -196,10 +207,9 @@ namespace badgerdb
       if (entryNum == this->leafOccupancy)
       {
         /// We split it half-half. For odd lengths, we allocate the left leaf one more record.
-        Page *newPage;
-        PageId newPageId;
-        this->bufMgr->allocPage(this->file, newPageId, newPage);
-        LeafNodeInt *newRightSibling = reinterpret_cast<LeafNodeInt *>(newPage);
+        PageGuard newPage = this->bufMgr->allocPage(this->file);
+        PageId newPageId = newPage.pageNo();
+        LeafNodeInt *newRightSibling = reinterpret_cast<LeafNodeInt *>(newPage.page());
         /// I am not very sure about the copy index here
         copyArray<int>(curNode->keyArray + this->leafOccupancy / 2 + 1, newRightSibling->keyArray, (this->leafOccupancy + 1) / 2);
         copyArray<RecordId>(curNode->ridArray + this->leafOccupancy / 2 + 1, newRightSibling->ridArray, (this->leafOccupancy + 1) / 2);
@@ -213,7 +223,7 @@ namespace badgerdb
         newRightSibling->ridArray[(this->leafOccupancy + 1) / 2].page_number = Page::INVALID_NUMBER;
         newRightSibling->keyArray[(this->leafOccupancy + 1) / 2] = INT_MAX;
 
-        bufMgr->unPinPage(this->file, newPageId, true);
+        newPage.markDirty();
         /// return the new right sibling page for an insertion in the parent node
         newChild->set(newPageId, newRightSibling->keyArray[0]);
       }
@@ -228,7 +238,7 @@ namespace badgerdb
     else
     {
       /// Nonleaf could be empty
-      NonLeafNodeInt *curNode = reinterpret_cast<NonLeafNodeInt *>(curPage);
+      NonLeafNodeInt *curNode = reinterpret_cast<NonLeafNodeInt *>(curPage.page());
       /// find the position of PageNo to go down the tree
       /// We use >= for lower keys and < for higher keys
       /// logic: pageNoArray[0] store the records that have the keys less than keyArray[0]
@@ -247,7 +257,6 @@ namespace badgerdb
 
       if (newChild->pageNo == Page::INVALID_NUMBER)
       {
-        bufMgr->unPinPage(this->file, curPageId, false);
         return;
       }
 
@@ -274,10 +283,9 @@ namespace badgerdb
       if (entryNum == this->nodeOccupancy + 1)
       {
         /// We split it half-half. For odd lengths, we allocate the left leaf one more record.
-        Page *newPage;
-        PageId newPageId;
-        this->bufMgr->allocPage(this->file, newPageId, newPage);
-        NonLeafNodeInt *newRightSibling = reinterpret_cast<NonLeafNodeInt *>(newPage);
+        PageGuard newPage = this->bufMgr->allocPage(this->file);
+        PageId newPageId = newPage.pageNo();
+        NonLeafNodeInt *newRightSibling = reinterpret_cast<NonLeafNodeInt *>(newPage.page());
         int newSlotKey = curNode->keyArray[(this->nodeOccupancy + 1) / 2];
 
         copyArray<int>(curNode->keyArray + (this->nodeOccupancy + 1) / 2 + 1, newRightSibling->keyArray, this->nodeOccupancy / 2);
@@ -290,7 +298,7 @@ namespace badgerdb
         newRightSibling->pageNoArray[this->nodeOccupancy / 2 + 1] = Page::INVALID_NUMBER;
         newRightSibling->keyArray[this->nodeOccupancy / 2] = INT_MAX;
 
-        bufMgr->unPinPage(this->file, newPageId, true);
+        newPage.markDirty();
         newChild->set(newPageId, newSlotKey);
       }
       else
@@ -302,14 +310,15 @@ namespace badgerdb
       }
     }
 
-    bufMgr->unPinPage(this->file, curPageId, true);
+    curPage.markDirty();
   }
 
   void BTreeIndex::insertEntry(const void *key, const RecordId rid)
   {
-    Page *metaPage;
-    bufMgr->readPage(file, headerPageNum, metaPage);
-    IndexMetaInfo *metaInfo = reinterpret_cast<IndexMetaInfo *>(metaPage);
+    if (file->mapped())
+      throw FileIOException(file->filename(), EROFS);
+    PageGuard metaPage = bufMgr->readPage(file, headerPageNum);
+    IndexMetaInfo *metaInfo = reinterpret_cast<IndexMetaInfo *>(metaPage.page());
     bool isLeaf = metaInfo->height == 1;
 
     RIDKeyPair<int> insertEntry;
@@ -319,14 +328,12 @@ namespace badgerdb
     insertUnderNode(&insertEntry, rootPageNum, isLeaf, &newChild);
     if (newChild.pageNo == Page::INVALID_NUMBER)
     {
-      bufMgr->unPinPage(file, headerPageNum, false);
       return;
     }
 
-    Page *newRootPage;
-    PageId newRootPageId;
-    bufMgr->allocPage(file, newRootPageId, newRootPage);
-    NonLeafNodeInt *newRootNode = reinterpret_cast<NonLeafNodeInt *>(newRootPage);
+    PageGuard newRootPage = bufMgr->allocPage(file);
+    PageId newRootPageId = newRootPage.pageNo();
+    NonLeafNodeInt *newRootNode = reinterpret_cast<NonLeafNodeInt *>(newRootPage.page());
     newRootNode->pageNoArray[0] = rootPageNum;
     newRootNode->keyArray[0] = newChild.key;
     newRootNode->pageNoArray[1] = newChild.pageNo;
@@ -334,8 +341,8 @@ namespace badgerdb
     this->rootPageNum = newRootPageId;
     metaInfo->height++;
     metaInfo->rootPageNo = newRootPageId;
-    bufMgr->unPinPage(file, headerPageNum, true);
-    bufMgr->unPinPage(file, rootPageNum, true);
+    metaPage.markDirty();
+    newRootPage.markDirty();
     return;
   }
 
@@ -372,24 +379,24 @@ namespace badgerdb
     scanExecuting = true;
 
     // Check if the root is a leaf
-    currentPageNum = headerPageNum;
-    bufMgr->readPage(file, currentPageNum, currentPageData);
-    IndexMetaInfo *metaInfo = reinterpret_cast<IndexMetaInfo *>(currentPageData);
-    bool isRootLeaf = metaInfo->height == 1;
-    bufMgr->unPinPage(file, currentPageNum, false);
+    bool isRootLeaf;
+    {
+      PageGuard metaPage = bufMgr->readPage(file, headerPageNum);
+      IndexMetaInfo *metaInfo = reinterpret_cast<IndexMetaInfo *>(metaPage.page());
+      isRootLeaf = metaInfo->height == 1;
+    }
 
     // Set up initial scan parameters
-    currentPageNum = rootPageNum;
-    bufMgr->readPage(file, currentPageNum, currentPageData);
+    currentPage = bufMgr->readPage(file, rootPageNum);
     LeafNodeInt *leaf = NULL;
     NonLeafNodeInt *currNonLeafNode = NULL;
     if (isRootLeaf)
     {
-      leaf = reinterpret_cast<LeafNodeInt *>(currentPageData);
+      leaf = reinterpret_cast<LeafNodeInt *>(currentPage.page());
     }
     else
     {
-      currNonLeafNode = reinterpret_cast<NonLeafNodeInt *>(currentPageData);
+      currNonLeafNode = reinterpret_cast<NonLeafNodeInt *>(currentPage.page());
     }
 
     // Loop until a leaf node is found or throw exception if no such key
@@ -419,22 +426,25 @@ namespace badgerdb
           }
 
           // Found a valid child node
+          // Read the level before unpinning: reading the child may reuse
+          // this node's frame
+          bool isChildLeaf = currNonLeafNode->level == 1;
+
           // Set up the child node page paramters
-          bufMgr->unPinPage(file, currentPageNum, false);
-          currentPageNum = childPageNum;
-          bufMgr->readPage(file, currentPageNum, currentPageData);
+          currentPage.release();
+          currentPage = bufMgr->readPage(file, childPageNum);
 
           // Found the leaf node
-          if (currNonLeafNode->level == 1)
+          if (isChildLeaf)
           {
-            leaf = reinterpret_cast<LeafNodeInt *>(currentPageData);
+            leaf = reinterpret_cast<LeafNodeInt *>(currentPage.page());
             currNonLeafNode = NULL;
           }
           // Found the next non-leaf node
           else
           {
             currNonLeafNode =
-                reinterpret_cast<NonLeafNodeInt *>(currentPageData);
+                reinterpret_cast<NonLeafNodeInt *>(currentPage.page());
           }
 
           // Loop a new node
@@ -475,6 +485,7 @@ namespace badgerdb
     // Found the wanted entry in the current leaf
     if (nextEntry != -1)
     {
+      prefetchRightSibling(leaf);
       return;
     }
 
@@ -487,12 +498,26 @@ namespace badgerdb
 
     // Set up the sibling page parameters and set the next entry to be the
     // first entry of the sibling page/node, i.e., 0
-    bufMgr->unPinPage(file, currentPageNum, false);
-    this->currentPageNum = leaf->rightSibPageNo;
-    bufMgr->readPage(file, currentPageNum, currentPageData);
+    // Read the sibling number before unpinning: the frame may be reused
+    PageId siblingPageNum = leaf->rightSibPageNo;
+    currentPage.release();
+    this->currentPage = bufMgr->readPage(file, siblingPageNum);
+    prefetchRightSibling(reinterpret_cast<LeafNodeInt *>(currentPage.page()));
     this->nextEntry = 0;
   }
 
+  // -----------------------------------------------------------------------------
+  // BTreeIndex::prefetchRightSibling
+  // -----------------------------------------------------------------------------
+
+  void BTreeIndex::prefetchRightSibling(const LeafNodeInt *leaf)
+  {
+    if (leaf->rightSibPageNo != Page::INVALID_NUMBER)
+    {
+      bufMgr->prefetch(file, std::vector<PageId>(1, leaf->rightSibPageNo));
+    }
+  }
+
   // -----------------------------------------------------------------------------
   // BTreeIndex::scanNext
   // -----------------------------------------------------------------------------
@@ -508,7 +533,7 @@ namespace badgerdb
       throw IndexScanCompletedException();
     }
 
-    LeafNodeInt *leaf = reinterpret_cast<LeafNodeInt *>(currentPageData);
+    LeafNodeInt *leaf = reinterpret_cast<LeafNodeInt *>(currentPage.page());
     outRid = leaf->ridArray[nextEntry];
 
     // The next entry is an invalid entry for the current leaf.
@@ -524,15 +549,17 @@ namespace badgerdb
 
       // Found a sibling node
       // Set up the sibling page parameters
-      bufMgr->unPinPage(file, currentPageNum, false);
-      this->currentPageNum = leaf->rightSibPageNo;
-      bufMgr->readPage(file, currentPageNum, currentPageData);
-      leaf = reinterpret_cast<LeafNodeInt *>(currentPageData);
+      // Read the sibling number before unpinning: the frame may be reused
+      PageId siblingPageNum = leaf->rightSibPageNo;
+      currentPage.release();
+      this->currentPage = bufMgr->readPage(file, siblingPageNum);
+      leaf = reinterpret_cast<LeafNodeInt *>(currentPage.page());
       int nextKey = leaf->keyArray[0];
 
       // Next key still within the boundary
       if (nextKey < highValInt || (nextKey == highValInt && highOp == LTE))
       {
+        prefetchRightSibling(leaf);
         this->nextEntry = 0;
         return;
       }
@@ -566,7 +593,7 @@ namespace badgerdb
     }
 
     this->scanExecuting = false;
-    bufMgr->unPinPage(file, currentPageNum, false);
+    currentPage.release();
   }
 
 }
@@ -247,14 +247,9 @@ class BTreeIndex {
 	int			nextEntry;
 
   /**
-   * Page number of current page being scanned.
+   * Current Page being scanned, pinned until the scan moves on or ends.
    */
-	PageId	currentPageNum;
-
-  /**
-   * Current Page being scanned.
-   */
-	Page		*currentPageData;
+	PageGuard	currentPage;
 
   /**
    * Low INTEGER value for scan.
@@ -301,11 +296,17 @@ class BTreeIndex {
     * insert entrys into leafnode under node n
 	*/
 	void insertUnderNode(RIDKeyPair<int>* entry, PageId curPageId, bool isLeaf, PageKeyPair<int>* newChild);
+
+   /**
+    * ask the buffer manager to read the right sibling of a leaf ahead of the scan
+	*/
+	void prefetchRightSibling(const LeafNodeInt* leaf);
  public:
 
   /**
    * BTreeIndex Constructor. 
-	 * Check to see if the corresponding index file exists. If so, open the file.
+	 * Check to see if the corresponding index file exists. If so, open the file, and read back the pages
+	 * of it that a snapshot of the buffer pool lists, see BufMgr::prewarm().
 	 * If not, create it and insert entries for every tuple in the base relation using FileScan class.
    *
    * @param relationName        Name of file.
@@ -313,9 +314,13 @@ class BTreeIndex {
    * @param bufMgrIn						Buffer Manager Instance
    * @param attrByteOffset			Offset of attribute, over which index is to be built, in the record
    * @param attrType						Datatype of attribute over which index is built
+   * @param backend						How to open the index file, and the relation to build it from.
+   *													With BACKEND_MMAP, an index built now is reopened mapped once written,
+   *													its pages are read straight from the mapping, and insertEntry() throws.
    */
 	BTreeIndex(const std::string & relationName, std::string & outIndexName,
-						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType);
+						BufMgr *bufMgrIn,	const int attrByteOffset,	const Datatype attrType,
+						const FileBackend backend = BACKEND_PREAD);
 	
 
   /**
@@ -5,7 +5,10 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <algorithm>
+#include <cstdint>
 #include <memory>
+#include <new>
 #include <iostream>
 #include "buffer.h"
 #include "bufHashTbl.h"
@@ -15,100 +18,226 @@
 
 namespace badgerdb {
 
-int BufHashTbl::hash(const File* file, const PageId pageNo)
+const FrameId BufHashTbl::NO_FRAME;
+
+std::uint64_t BufHashTbl::hash(const File* file, const PageId pageNo)
 {
-  int tmp, value;
-  tmp = (long)file;  // cast of pointer to the file object to an integer
-  value = (tmp + pageNo) % HTSIZE;
-  return value;
+  // Fibonacci hashing of the pointer combined with the page number; the high
+  // bits of the product depend on all bits of the key, so neighbouring pages
+  // of neighbouring File objects do not cluster the way (long)file + pageNo
+  // truncated to an int does
+  std::uint64_t key = (reinterpret_cast<std::uintptr_t>(file) << 16) ^ pageNo;
+  return key * 0x9e3779b97f4a7c15ULL;
 }
 
-BufHashTbl::BufHashTbl(int htSize)
-	: HTSIZE(htSize)
+BufHashTbl::Shard& BufHashTbl::shardOf(const File* file, const PageId pageNo)
 {
-  // allocate an array of pointers to hashBuckets
-  ht = new hashBucket* [htSize];
-  for(int i=0; i < HTSIZE; i++)
-    ht[i] = NULL;
+  return shards[hash(file, pageNo) >> (64 - SHARD_BITS)];
 }
 
-BufHashTbl::~BufHashTbl()
+const BufHashTbl::Shard& BufHashTbl::shardOf(const File* file, const PageId pageNo) const
+{
+  return shards[hash(file, pageNo) >> (64 - SHARD_BITS)];
+}
+
+std::uint32_t BufHashTbl::home(const Shard& shard, const File* file, const PageId pageNo)
 {
-  for(int i = 0; i < HTSIZE; i++) {
-    hashBucket* tmpBuf = ht[i];
-    while (ht[i]) {
-      tmpBuf = ht[i];
-      ht[i] = ht[i]->next;
-      delete tmpBuf;
+  // the bits below the shard selector pick the bucket
+  return static_cast<std::uint32_t>(
+      (hash(file, pageNo) << SHARD_BITS) >> (64 - shard.sizeBits));
+}
+
+std::uint32_t BufHashTbl::probe(const Shard& shard, const File* file, const PageId pageNo)
+{
+  std::uint32_t mask = shard.size - 1;
+  std::uint32_t index = home(shard, file, pageNo);
+  while (shard.ht[index].file != NULL &&
+         (shard.ht[index].file != file || shard.ht[index].pageNo != pageNo))
+  {
+    index = (index + 1) & mask;
+  }
+  return index;
+}
+
+void BufHashTbl::grow(Shard& shard)
+{
+  hashBucket* old = shard.ht;
+  std::uint32_t oldSize = shard.size;
+
+  hashBucket* ht = new (std::nothrow) hashBucket[2 * oldSize];
+  if (ht == NULL)
+    throw HashTableException();
+
+  shard.ht = ht;
+  shard.size = 2 * oldSize;
+  shard.sizeBits++;
+  for (std::uint32_t i = 0; i < shard.size; i++)
+    shard.ht[i].file = NULL;
+
+  for (std::uint32_t i = 0; i < oldSize; i++)
+  {
+    if (old[i].file != NULL)
+      shard.ht[probe(shard, old[i].file, old[i].pageNo)] = old[i];
+  }
+  delete [] old;
+}
+
+BufHashTbl::BufHashTbl(int htSize)
+  : numLinks(htSize)
+{
+  // size every shard for its share of the frames at a load factor of at most
+  // one half; an unlucky shard grows on demand
+  std::uint32_t perShard = 2 * static_cast<std::uint32_t>(htSize) / NUM_SHARDS;
+  for (std::uint32_t s = 0; s < NUM_SHARDS; s++)
+  {
+    Shard& shard = shards[s];
+    shard.size = 4;
+    shard.sizeBits = 2;
+    while (shard.size < perShard)
+    {
+      shard.size <<= 1;
+      shard.sizeBits++;
     }
+    shard.numEntries = 0;
+
+    shard.ht = new hashBucket[shard.size];
+    for(std::uint32_t i = 0; i < shard.size; i++)
+      shard.ht[i].file = NULL;
   }
-  delete [] ht;
+
+  links = new FrameLink[htSize];
+}
+
+BufHashTbl::~BufHashTbl()
+{
+  for (std::uint32_t s = 0; s < NUM_SHARDS; s++)
+    delete [] shards[s].ht;
+  delete [] links;
+}
+
+std::mutex& BufHashTbl::latch(const File* file, const PageId pageNo)
+{
+  return shardOf(file, pageNo).latch;
 }
 
 void BufHashTbl::insert(const File* file, const PageId pageNo, const FrameId frameNo)
 {
-  int index = hash(file, pageNo);
+  Shard& shard = shardOf(file, pageNo);
+  std::uint32_t index = probe(shard, file, pageNo);
 
-  hashBucket* tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-  		throw HashAlreadyPresentException(tmpBuc->file->filename(), tmpBuc->pageNo, tmpBuc->frameNo);
-    tmpBuc = tmpBuc->next;
-  }
+  if (shard.ht[index].file != NULL)
+  	throw HashAlreadyPresentException(file->filename(), pageNo, shard.ht[index].frameNo);
 
-  tmpBuc = new hashBucket;
-  if (!tmpBuc)
-  	throw HashTableException();
+  if (2 * (shard.numEntries + 1) > shard.size)
+  {
+    grow(shard);
+    index = probe(shard, file, pageNo);
+  }
 
-  tmpBuc->file = (File*) file;
-  tmpBuc->pageNo = pageNo;
-  tmpBuc->frameNo = frameNo;
-  tmpBuc->next = ht[index];
-  ht[index] = tmpBuc;
+  shard.ht[index].file = file;
+  shard.ht[index].pageNo = pageNo;
+  shard.ht[index].frameNo = frameNo;
+  shard.numEntries++;
+
+  // push the frame on the front of the file's list
+  std::pair<std::unordered_map<const File*, FrameId>::iterator, bool> head =
+      shard.fileHeads.insert(std::make_pair(file, NO_FRAME));
+  links[frameNo].prev = NO_FRAME;
+  links[frameNo].next = head.first->second;
+  links[frameNo].pageNo = pageNo;
+  if (head.first->second != NO_FRAME)
+    links[head.first->second].prev = frameNo;
+  head.first->second = frameNo;
 }
 
 void BufHashTbl::lookup(const File* file, const PageId pageNo, FrameId &frameNo) 
 {
-  int index = hash(file, pageNo);
-  hashBucket* tmpBuc = ht[index];
-  while (tmpBuc) {
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-    {
-      frameNo = tmpBuc->frameNo; // return frameNo by reference
-      return;
-    }
-    tmpBuc = tmpBuc->next;
-  }
+  if (!tryLookup(file, pageNo, frameNo))
+    throw HashNotFoundException(file->filename(), pageNo);
+}
 
-  throw HashNotFoundException(file->filename(), pageNo);
+bool BufHashTbl::tryLookup(const File* file, const PageId pageNo, FrameId &frameNo) const
+{
+  const Shard& shard = shardOf(file, pageNo);
+  std::uint32_t index = probe(shard, file, pageNo);
+  if (shard.ht[index].file == NULL)
+    return false;
+
+  frameNo = shard.ht[index].frameNo; // return frameNo by reference
+  return true;
 }
 
 void BufHashTbl::remove(const File* file, const PageId pageNo) {
 
-  int index = hash(file, pageNo);
-  hashBucket* tmpBuc = ht[index];
-  hashBucket* prevBuc = NULL;
-
-  while (tmpBuc)
-	{
-    if (tmpBuc->file == file && tmpBuc->pageNo == pageNo)
-		{
-      if(prevBuc) 
-				prevBuc->next = tmpBuc->next;
-      else
-				ht[index] = tmpBuc->next;
-
-      delete tmpBuc;
-      return;
-    }
-		else
-		{
-      prevBuc = tmpBuc;
-      tmpBuc = tmpBuc->next;
+  Shard& shard = shardOf(file, pageNo);
+  hashBucket* ht = shard.ht;
+  std::uint32_t mask = shard.size - 1;
+  std::uint32_t hole = probe(shard, file, pageNo);
+  if (ht[hole].file == NULL)
+    throw HashNotFoundException(file->filename(), pageNo);
+
+  // unlink the frame from the file's list
+  FrameLink& link = links[ht[hole].frameNo];
+  if (link.next != NO_FRAME)
+    links[link.next].prev = link.prev;
+  if (link.prev != NO_FRAME)
+    links[link.prev].next = link.next;
+  else if (link.next != NO_FRAME)
+    shard.fileHeads[file] = link.next;
+  else
+    shard.fileHeads.erase(file);
+
+  // Shift later members of the probe sequence back into the hole, so that
+  // every entry stays reachable from its home bucket without tombstones
+  std::uint32_t next = (hole + 1) & mask;
+  while (ht[next].file != NULL)
+  {
+    std::uint32_t start = home(shard, ht[next].file, ht[next].pageNo);
+    // move the entry unless its home lies cyclically in (hole, next]
+    if (((next - start) & mask) >= ((next - hole) & mask))
+    {
+      ht[hole] = ht[next];
+      hole = next;
     }
+    next = (next + 1) & mask;
   }
 
-  throw HashNotFoundException(file->filename(), pageNo);
+  ht[hole].file = NULL;
+  shard.numEntries--;
+}
+
+void BufHashTbl::resize(const std::uint32_t htSize)
+{
+  FrameLink* resized = new (std::nothrow) FrameLink[htSize];
+  if (resized == NULL)
+    throw HashTableException();
+  std::copy(links, links + std::min(numLinks, htSize), resized);
+  delete [] links;
+  links = resized;
+  numLinks = htSize;
+
+  // the same share of the frames per shard as the constructor gives
+  std::uint32_t perShard = 2 * htSize / NUM_SHARDS;
+  for (std::uint32_t s = 0; s < NUM_SHARDS; s++)
+  {
+    while (shards[s].size < perShard)
+      grow(shards[s]);
+  }
+}
+
+void BufHashTbl::filePages(const File* file, std::vector<std::pair<PageId, FrameId> >& pages)
+{
+  pages.clear();
+  for (std::uint32_t s = 0; s < NUM_SHARDS; s++)
+  {
+    Shard& shard = shards[s];
+    std::lock_guard<std::mutex> guard(shard.latch);
+    std::unordered_map<const File*, FrameId>::const_iterator head = shard.fileHeads.find(file);
+    if (head == shard.fileHeads.end())
+      continue;
+    for (FrameId frame = head->second; frame != NO_FRAME; frame = links[frame].next)
+      pages.push_back(std::make_pair(links[frame].pageNo, frame));
+  }
 }
 
 }
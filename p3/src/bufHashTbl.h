@@ -7,6 +7,11 @@
 
 #pragma once
 
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include "file.h"
 
 namespace badgerdb {
@@ -16,9 +21,9 @@ namespace badgerdb {
 */
 struct hashBucket {
 	/**
-	 * pointer a file object (more on this below)
+	 * pointer a file object (more on this below), NULL if the bucket is empty
 	 */
-	File *file;
+	const File *file;
 
 	/**
 	 * page number within a file
@@ -29,43 +34,151 @@ struct hashBucket {
 	 * frame number of page in the buffer pool
 	 */
 	FrameId frameNo;
-
-	/**
-	 * Next node in the hash table
-	 */
-	hashBucket*   next;
 };
 
 
 /**
 * @brief Hash table class to keep track of pages in the buffer pool
 *
-* @warning This class is not threadsafe.
+* The table is split into NUM_SHARDS shards, each protected by its own latch,
+* so that threads looking up different pages rarely contend. A shard is a flat
+* array of buckets using open addressing with linear probing; it doubles in
+* size whenever it would become more than half full, and removal shifts the
+* following entries of the probe sequence back instead of leaving tombstones.
+*
+* Each shard also threads its entries onto one doubly linked list per file,
+* whose links are kept per frame, so that the pages of a file in the pool can be
+* listed without looking at the rest of the pool.
+*
+* insert, lookup, tryLookup and remove must be called with the latch of the
+* shard holding the entry, as returned by latch(), held by the caller. This
+* lets the buffer manager pin or unmap a frame atomically with its lookup.
 */
 class BufHashTbl
 {
+ public:
+	/**
+	 * Number of shards, a power of two
+	 */
+	static const std::uint32_t NUM_SHARDS = 16;
+
  private:
 	/**
-	 *	Size of Hash Table
+	 * One independently latched part of the table
+	 */
+	struct Shard
+	{
+		/**
+		 * Latch protecting the buckets of the shard
+		 */
+		std::mutex latch;
+
+		/**
+		 * Number of buckets, always a power of two
+		 */
+		std::uint32_t size;
+
+		/**
+		 * log2(size)
+		 */
+		std::uint32_t sizeBits;
+
+		/**
+		 * Number of buckets in use
+		 */
+		std::uint32_t numEntries;
+
+		/**
+		 * Buckets of the shard
+		 */
+		hashBucket* ht;
+
+		/**
+		 * First frame of the list of each file with entries in the shard
+		 */
+		std::unordered_map<const File*, FrameId> fileHeads;
+	};
+
+	/**
+	 * Links of a frame in the list of its file, and the page it holds
 	 */
-  int HTSIZE;
+	struct FrameLink
+	{
+		FrameId prev;
+		FrameId next;
+		PageId pageNo;
+	};
+
 	/**
-	 * Actual Hash table object
+	 * Marks the end of a file's list
 	 */
-  hashBucket**  ht;
+	static const FrameId NO_FRAME = static_cast<FrameId>(-1);
 
 	/**
-	 * returns hash value between 0 and HTSIZE-1 computed using file and pageNo
+	 * log2(NUM_SHARDS)
+	 */
+	static const std::uint32_t SHARD_BITS = 4;
+
+	/**
+	 * Shards of the table
+	 */
+	Shard shards[NUM_SHARDS];
+
+	/**
+	 * List links of every frame, indexed by frame number
+	 */
+	FrameLink* links;
+
+	/**
+	 * Number of frames links has room for
+	 */
+	std::uint32_t numLinks;
+
+	/**
+	 * returns the 64 bit hash of (file, pageNo); its top SHARD_BITS bits select
+	 * the shard and the bits below them the bucket within the shard
 	 *
 	 * @param file   	File object
 	 * @param pageNo  Page number in the file
 	 * @return  			Hash value.
 	 */
-  int	 hash(const File* file, const PageId pageNo);
+	static std::uint64_t hash(const File* file, const PageId pageNo);
+
+	/**
+	 * Returns the shard holding (file, pageNo).
+	 */
+	Shard& shardOf(const File* file, const PageId pageNo);
+	const Shard& shardOf(const File* file, const PageId pageNo) const;
+
+	/**
+	 * Returns the index of the first bucket of the probe sequence of
+	 * (file, pageNo) in a shard.
+	 */
+	static std::uint32_t home(const Shard& shard, const File* file, const PageId pageNo);
+
+	/**
+	 * Returns the index of the bucket of shard holding (file, pageNo), or of the
+	 * empty bucket that ends its probe sequence if it is not present.
+	 *
+	 * @param shard  	Shard holding the entry
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @return  			Bucket index.
+	 */
+	static std::uint32_t probe(const Shard& shard, const File* file, const PageId pageNo);
+
+	/**
+	 * Doubles the number of buckets of a shard.
+	 *
+	 * @throws  HashTableException if the buckets cannot be allocated
+	 */
+	static void grow(Shard& shard);
 
  public:
 	/**
    * Constructor of BufHashTbl class
+	 *
+	 * @param htSize  Expected maximum number of entries, i.e. the number of frames
 	 */
 	BufHashTbl(const int htSize);  // constructor
 
@@ -73,6 +186,15 @@ class BufHashTbl
    * Destructor of BufHashTbl class
 	 */
   ~BufHashTbl(); // destructor
+
+	/**
+	 * Returns the latch of the shard holding (file, pageNo).
+	 *
+	 * @param file   	File object
+	 * @param pageNo 	Page number in the file
+	 * @return  			Latch to hold while operating on the entry
+	 */
+	std::mutex& latch(const File* file, const PageId pageNo);
 	
 	/**
    * Insert entry into hash table mapping (file, pageNo) to frameNo.
@@ -81,7 +203,7 @@ class BufHashTbl
 	 * @param pageNo 	Page number in the file
 	 * @param frameNo Frame number assigned to that page of the file
    * @throws  HashAlreadyPresentException	if the corresponding page already exists in the hash table
-   * @throws  HashTableException (optional) if could not create a new bucket as running of memory
+   * @throws  HashTableException if the shard could not grow as running out of memory
 	 */
   void insert(const File* file, const PageId pageNo, const FrameId frameNo);
 
@@ -96,6 +218,17 @@ class BufHashTbl
 	 */
   void lookup(const File* file, const PageId pageNo, FrameId &frameNo);
 
+	/**
+   * Check if (file, pageNo) is currently in the buffer pool without throwing
+   * when it is not, which is the common case on a buffer miss.
+	 *
+	 * @param file  	File object
+	 * @param pageNo	Page number in the file
+	 * @param frameNo Frame number reference, only set if the entry is found
+	 * @return  			True if the page entry is found in the hash table
+	 */
+  bool tryLookup(const File* file, const PageId pageNo, FrameId &frameNo) const;
+
 	/**
    * Delete entry (file,pageNo) from hash table.
 	 *
@@ -104,6 +237,27 @@ class BufHashTbl
    * @throws HashNotFoundException if the page entry is not found in the hash table 
 	 */
   void remove(const File* file, const PageId pageNo);  
+
+	/**
+	 * Lists the pages of a file that are in the hash table, with their frames,
+	 * in no particular order. Takes the shard latches itself, one at a time, so
+	 * the caller must hold none; pages may come and go while it runs.
+	 *
+	 * @param file   	File object
+	 * @param pages  	Set to the (page number, frame number) pairs of the file
+	 */
+  void filePages(const File* file, std::vector<std::pair<PageId, FrameId> >& pages);
+
+	/**
+	 * Makes room for the frames of a buffer pool that has changed size, and
+	 * grows the shards to their share of them; shards do not shrink. Every
+	 * entry must be for a frame below the new number of frames, and no other
+	 * thread may use the table meanwhile.
+	 *
+	 * @param htSize  New number of frames
+   * @throws  HashTableException if the table cannot grow as running out of memory
+	 */
+  void resize(const std::uint32_t htSize);
 };
 
 }
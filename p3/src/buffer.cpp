@@ -5,237 +5,1734 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <errno.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
 #include <memory>
+#include <new>
 #include <iostream>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <thread>
 #include "buffer.h"
 #include "exceptions/buffer_exceeded_exception.h"
 #include "exceptions/page_not_pinned_exception.h"
 #include "exceptions/page_pinned_exception.h"
-#include "exceptions/bad_buffer_exception.h"
 #include "exceptions/hash_not_found_exception.h"
+#include "exceptions/file_io_exception.h"
 
 namespace badgerdb { 
 
+const std::uint32_t BufMgr::MAX_FRAMES;
+const std::uint32_t BufMgr::DEFAULT_GROWTH;
+const char* const BufMgr::SNAPSHOT_HEADER = "badgerdb pool snapshot 1";
+
+namespace {
+
+/**
+ * Returns the nanoseconds elapsed since start.
+ */
+std::uint64_t nanosSince(const std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Writes a string as a JSON string literal.
+ */
+void writeJsonString(std::ostream& out, const std::string& text)
+{
+  out << '"';
+  for (std::size_t i = 0; i < text.size(); i++)
+  {
+    unsigned char c = text[i];
+    if (c == '"' || c == '\\')
+      out << '\\' << c;
+    else if (c < 0x20)
+    {
+      char escaped[8];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      out << escaped;
+    }
+    else
+      out << c;
+  }
+  out << '"';
+}
+
+/**
+ * Rounds a number of bytes up to whole pages of memory.
+ */
+std::size_t roundToPages(const std::size_t bytes)
+{
+  static const std::size_t pageSize = sysconf(_SC_PAGESIZE);
+  return (bytes + pageSize - 1) / pageSize * pageSize;
+}
+
+/**
+ * Reserves address space without backing it with memory yet.
+ */
+void* reserveMemory(const std::size_t bytes)
+{
+  void* base = mmap(NULL, roundToPages(bytes), PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (base == MAP_FAILED)
+    throw std::bad_alloc();
+  return base;
+}
+
+/**
+ * Makes the first bytes of reserved address space usable, growing the part
+ * made usable so far, oldBytes, to newBytes.
+ */
+void commitMemory(void* base, const std::size_t oldBytes, const std::size_t newBytes)
+{
+  std::size_t start = roundToPages(oldBytes);
+  std::size_t end = roundToPages(newBytes);
+  if (end > start && mprotect(static_cast<char*>(base) + start, end - start, PROT_READ | PROT_WRITE) != 0)
+    throw std::bad_alloc();
+}
+
+/**
+ * Gives back to the system the memory of the usable part of reserved address
+ * space beyond its first newBytes, of oldBytes.
+ */
+void decommitMemory(void* base, const std::size_t newBytes, const std::size_t oldBytes)
+{
+  std::size_t start = roundToPages(newBytes);
+  std::size_t end = roundToPages(oldBytes);
+  if (end > start)
+  {
+    madvise(static_cast<char*>(base) + start, end - start, MADV_DONTNEED);
+    mprotect(static_cast<char*>(base) + start, end - start, PROT_NONE);
+  }
+}
+
+/**
+ * Number of frames to reserve address space for, for a pool of bufs frames
+ * that may grow to maxBufs, see the BufMgr constructor.
+ */
+std::uint32_t framesToReserve(const std::uint32_t bufs, const std::uint32_t maxBufs)
+{
+  std::uint64_t frames = maxBufs > 0 ? maxBufs : std::uint64_t(bufs) * BufMgr::DEFAULT_GROWTH;
+  frames = std::min<std::uint64_t>(frames, BufMgr::MAX_FRAMES);
+  return std::max<std::uint64_t>(frames, bufs);
+}
+
+/**
+ * Slot of the BufMgr gate the calling thread enters through; threads are
+ * spread over the slots in the order they first use one
+ */
+std::atomic<unsigned> nextGateSlot(0);
+
+unsigned gateSlot()
+{
+  static thread_local unsigned slot = nextGateSlot++;
+  return slot;
+}
+
+}
+
 //----------------------------------------
 // Constructor of the class BufMgr
 //----------------------------------------
 
-BufMgr::BufMgr(std::uint32_t bufs)
-	: numBufs(bufs) {
-	bufDescTable = new BufDesc[bufs];
+BufMgr::BufMgr(std::uint32_t bufs, ReplacementPolicy policy, bool backgroundWriter, std::uint32_t maxBufs)
+	: numBufs(bufs), numFrames(bufs), maxFrames(framesToReserve(bufs, maxBufs)),
+	  prefetchStop(false), clusterWrites(0), writerStop(false), cleanLookahead(0), resizing(false),
+	  reporterOut(NULL), reporterPeriodMs(0), reporterStop(false), tracer(NULL), tier(NULL) {
+  for (int i = 0; i < GATE_SLOTS; i++)
+    gate[i].count = 0;
+
+  // reserve room for the largest pool resize() may make, so that neither
+  // the descriptors nor the frames ever move; mmap aligns the frames to a
+  // memory page, so O_DIRECT transfers of whole pages need no bounce buffer
+  bufDescTable = static_cast<BufDesc*>(reserveMemory(std::size_t(maxFrames) * sizeof(BufDesc)));
+  bufPool = static_cast<Page*>(reserveMemory(std::size_t(maxFrames) * sizeof(Page)));
+  commitMemory(bufDescTable, 0, std::size_t(bufs) * sizeof(BufDesc));
+  commitMemory(bufPool, 0, std::size_t(bufs) * sizeof(Page));
 
   for (FrameId i = 0; i < bufs; i++) 
   {
+    new (&bufDescTable[i]) BufDesc();
   	bufDescTable[i].frameNo = i;
   	bufDescTable[i].valid = false;
+    new (&bufPool[i]) Page();
   }
 
-  bufPool = new Page[bufs];
+  hashTable = new BufHashTbl (bufs);  // allocate the buffer hash table
 
-  int htsize = ((((int) (bufs * 1.2))*2)/2)+1;
-  hashTable = new BufHashTbl (htsize);  // allocate the buffer hash table
+  replacer = Replacer::create(policy, bufs, bufDescTable, bufStats);
 
-  clockHand = bufs - 1;
+  if (backgroundWriter)
+    writerThread = std::thread(&BufMgr::writerLoop, this);
 }
 
 
 BufMgr::~BufMgr() {
-  //Flush out all unwritten pages
-  for (std::uint32_t i = 0; i < numBufs; i++) 
+  stopStatsReporter();
+  stopTrace();
+
+  // stop the prefetch threads
+  {
+    std::lock_guard<std::mutex> guard(prefetchLatch);
+    prefetchStop = true;
+    prefetchQueue.clear();
+  }
+  prefetchWork.notify_all();
+  for (std::size_t i = 0; i < prefetchThreads.size(); i++)
+    prefetchThreads[i].join();
+
+  // stop the background writer
+  {
+    std::lock_guard<std::mutex> guard(writerLatch);
+    writerStop = true;
+  }
+  writerWake.notify_all();
+  if (writerThread.joinable())
+    writerThread.join();
+
+  //Flush out all unwritten pages, adjacent ones together
+  std::vector<FrameId> dirty;
+  for (std::uint32_t i = 0; i < numFrames; i++) 
   {
   	BufDesc* tmpbuf = &(bufDescTable[i]);
   	if (tmpbuf->valid == true && tmpbuf->dirty == true)
 		{
-			tmpbuf->file->writePage(tmpbuf->pageNo, bufPool[i]);
+			dirty.push_back(i);
   	}
   }
+  writeFrames(dirty);
+
+  if (!snapshotPath.empty())
+    writeSnapshot();
+
+	for (std::map<std::pair<const File*, AccessStrategy>, Ring*>::iterator it = rings.begin(); it != rings.end(); ++it)
+		delete it->second;
+	delete replacer;
+	delete hashTable;
+	delete tier;
+	for (std::unordered_map<const File*, FileCounters*>::iterator it = fileStats.begin(); it != fileStats.end(); ++it)
+		delete it->second;
+  for (std::uint32_t i = 0; i < numFrames; i++)
+  {
+    if (!bufDescTable[i].retired)
+      bufPool[i].~Page();
+    bufDescTable[i].~BufDesc();
+  }
+  munmap(bufPool, roundToPages(std::size_t(maxFrames) * sizeof(Page)));
+  munmap(bufDescTable, roundToPages(std::size_t(maxFrames) * sizeof(BufDesc)));
+}
+
+void BufMgr::allocBuf(const File* file, const PageId pageNo, FrameId & frame, const AccessStrategy strategy,
+                      const bool ringOnly) 
+{
+  // requests with a strategy reuse the oldest frame of their ring; frames
+  // still pinned, by the caller or by a batch of reads ahead of it, are
+  // passed over for the next ones, so that the pool is only asked for a
+  // frame when the ring is not full yet or none of its frames is free
+  Ring* ring = NULL;
+  std::size_t slot = 0;
+  if (strategy != ACCESS_NORMAL)
+  {
+    ring = ringOf(file, strategy);
+    bool full = true;
+    for (std::size_t tries = 0; tries < ring->frames.size(); tries++)
+    {
+      FrameId oldest;
+      {
+        std::lock_guard<std::mutex> guard(ring->latch);
+        slot = ring->next;
+        ring->next = (ring->next + 1) % ring->frames.size();
+        oldest = ring->frames[slot];
+      }
+      if (oldest >= numFrames)
+      {
+        full = false;
+        break;
+      }
+      if (recycleRingFrame(file, oldest))
+      {
+        frame = oldest;
+        return;
+      }
+    }
+    if (full && ringOnly)
+      throw BufferExceededException();
+  }
+
+  // dirty pages the policy passed over for a clean one, left where they are
+  std::uint32_t lookahead = cleanLookahead;
+  std::vector<FrameId> skipped;
+  while (true)
+  {
+    // ask the replacement policy for a free or unpinned frame, which it
+    // hands over claimed
+    if (!replacer->victim(file, pageNo, frame, lookahead, skipped))
+    {
+      // the background writer or other evictions may be holding the only
+      // unpinned frames; let them finish before giving up
+      std::lock_guard<std::mutex> round(writerRound);
+      while (clusterWrites > 0)
+        std::this_thread::yield();
+      if (!replacer->victim(file, pageNo, frame, 0, skipped))
+        throw BufferExceededException();
+    }
+    skipped.erase(std::remove(skipped.begin(), skipped.end(), frame), skipped.end());
+
+    BufDesc* victim = &bufDescTable[frame];
+    if (!victim->valid)
+    {
+      victim->Reset();
+      break;
+    }
+    if (evictFrame(frame, true))
+      break;
+  }
+  deferWriteback(skipped);
+
+  // the frame takes the place of the one left to the pool
+  if (ring != NULL)
+  {
+    std::lock_guard<std::mutex> guard(ring->latch);
+    ring->frames[slot] = frame;
+  }
+} // end allocBuf
+
+void BufMgr::deferWriteback(const std::vector<FrameId>& frames)
+{
+  if (frames.empty())
+    return;
+  bufStats.dirtySkips += frames.size();
+
+  // without a background writer the pages are written when they are replaced
+  if (!writerThread.joinable())
+    return;
+  {
+    std::lock_guard<std::mutex> guard(writerLatch);
+    writebackQueue.insert(writebackQueue.end(), frames.begin(), frames.end());
+  }
+  writerWake.notify_one();
+}
+
+bool BufMgr::evictFrame(const FrameId frame, const bool keep)
+{
+  BufDesc* victim = &bufDescTable[frame];
+  File* victimFile = victim->file;
+  PageId victimPageNo = victim->pageNo;
+
+  // flush any existing changes to disk if necessary; the page stays in the
+  // hash table meanwhile, so a thread reading it finds it here rather than
+  // reading the stale copy on disk
+  bool written = false;
+  if (victim->dirty.exchange(false))
+  {
+    written = true;
+    // take the dirty pages next to it along, so that they go out in the
+    // same write rather than one by one as they are evicted
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::vector<FrameId> frames(1, frame);
+    clusterWrites++;
+    claimDirtyNeighbours(victimFile, victimPageNo, frames);
+    try
+    {
+      writeFrames(frames);
+    }
+    catch (...)
+    {
+      for (std::size_t i = 1; i < frames.size(); i++)
+        bufDescTable[frames[i]].pinCnt -= BufDesc::CLAIMED;
+      clusterWrites--;
+      replacer->insert(frame, victimFile, victimPageNo);
+      victim->pinCnt -= BufDesc::CLAIMED;
+      throw;
+    }
+    for (std::size_t i = 1; i < frames.size(); i++)
+      bufDescTable[frames[i]].pinCnt -= BufDesc::CLAIMED;
+    clusterWrites--;
+    bufStats.fgwrites += frames.size();
+    bufStats.writeStall.record(nanosSince(start));
+
+    // the background writer is falling behind
+    writerWake.notify_one();
+  }
+
+  // the page now matches the one on disk; a thread that misses it in the
+  // hash table from here on finds the copy in the tier
+  bool kept = false;
+  if (tier != NULL)
+  {
+    if (keep)
+      kept = tier->put(victimFile, victimPageNo, &bufPool[frame]);
+    else
+      tier->remove(victimFile, victimPageNo);
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(hashTable->latch(victimFile, victimPageNo));
+    if (victim->pinCnt == BufDesc::CLAIMED && !victim->dirty)
+    {
+      // remove previous entry from hash table
+      hashTable->remove(victimFile, victimPageNo);
+
+      //Reset all the BufDesc entry for the frame before returning the frame
+      victim->Reset();
+      if (written)
+        bufStats.dirtyEvictions++;
+      else
+        bufStats.cleanEvictions++;
+      return true;
+    }
+  }
+
+  // pinned while being written out: keep the page, and only the page
+  if (kept)
+    tier->remove(victimFile, victimPageNo);
+  replacer->insert(frame, victimFile, victimPageNo);
+  victim->pinCnt -= BufDesc::CLAIMED;
+  return false;
+}
+
+bool BufMgr::recycleRingFrame(const File* file, const FrameId frame)
+{
+  // a frame another request used, or that was replaced meanwhile, stays
+  // with the pool
+  BufDesc* desc = &bufDescTable[frame];
+  if (desc->file != file || desc->refbit || !replacer->claim(frame))
+    return false;
+  if (desc->file != file || desc->refbit)
+  {
+    replacer->insert(frame, desc->file, desc->pageNo);
+    desc->pinCnt -= BufDesc::CLAIMED;
+    return false;
+  }
+  return evictFrame(frame, false);
+}
+
+BufMgr::Ring* BufMgr::ringOf(const File* file, const AccessStrategy strategy)
+{
+  std::lock_guard<std::mutex> guard(ringsLatch);
+  Ring*& ring = rings[std::make_pair(file, strategy)];
+  if (ring == NULL)
+  {
+    // small pools keep most of their frames for everyone else
+    std::size_t size = strategy == ACCESS_BULK_WRITE ? std::size_t(BULK_WRITE_RING) : std::size_t(SEQUENTIAL_RING);
+    ring = new Ring;
+    ring->frames.assign(std::min<std::size_t>(size, std::max<std::uint32_t>(1, numBufs / 4)), numFrames);
+    ring->next = 0;
+  }
+  return ring;
+}
+
+void BufMgr::dropRings(const File* file)
+{
+  std::lock_guard<std::mutex> guard(ringsLatch);
+  std::map<std::pair<const File*, AccessStrategy>, Ring*>::iterator it =
+    rings.lower_bound(std::make_pair(file, ACCESS_NORMAL));
+  while (it != rings.end() && it->first.first == file)
+  {
+    delete it->second;
+    rings.erase(it++);
+  }
+}
+
+bool BufMgr::pinResident(File* file, const PageId pageNo, FrameId & frame, const bool reference)
+{
+  while (true)
+  {
+    {
+      std::lock_guard<std::mutex> guard(hashTable->latch(file, pageNo));
+      if (!hashTable->tryLookup(file, pageNo, frame))
+        return false;
+      bufDescTable[frame].pinCnt++;
+    }
+
+    // set the referenced bit
+    BufDesc* desc = &bufDescTable[frame];
+    if (reference)
+      desc->refbit = true;
+
+    // another thread may still be reading the page in, or writing it out
+    // before it notices the pin and keeps the page
+    if (desc->loading || desc->pinCnt >= BufDesc::CLAIMED)
+    {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      while (desc->loading)
+        std::this_thread::yield();
+      waitUnclaimed(frame);
+      bufStats.pinWait.record(nanosSince(start));
+    }
+
+    if (desc->valid)
+      return true;
+
+    // the read failed, look again
+    unpinFrame(frame);
+  }
+}
+
+bool BufMgr::peekNextPage(File* file, const PageId pageNo, PageId& nextPageNo)
+{
+  FrameId frame;
+  {
+    std::lock_guard<std::mutex> guard(hashTable->latch(file, pageNo));
+    if (!hashTable->tryLookup(file, pageNo, frame))
+      return false;
+    bufDescTable[frame].pinCnt++;
+  }
+
+  // the pin keeps the page in the frame while its header is read
+  BufDesc* desc = &bufDescTable[frame];
+  bool ready = !desc->loading && desc->pinCnt < BufDesc::CLAIMED && desc->valid;
+  if (ready)
+    nextPageNo = bufPool[frame].next_page_number();
+  unpinFrame(frame);
+  return ready;
+}
+
+bool BufMgr::unpinFrame(const FrameId frame)
+{
+  std::atomic<int>& pinCnt = bufDescTable[frame].pinCnt;
+  int pins = pinCnt;
+  while (pins % BufDesc::CLAIMED != 0)
+  {
+    if (pinCnt.compare_exchange_weak(pins, pins - 1))
+      return true;
+  }
+  return false;
+}
+
+void BufMgr::unpinGuarded(const FrameId frame, const bool dirty)
+{
+  // the pin keeps the page in the frame, so there is nothing to look up;
+  // nor does resize() retire or move a pinned frame, so the gate is not needed
+  if (dirty)
+    bufDescTable[frame].dirty = true;
+  unpinFrame(frame);
+}
+
+void BufMgr::latchGuarded(const FrameId frame, const LatchMode mode, std::uint64_t & version)
+{
+  FrameLatch& latch = bufDescTable[frame].latch;
+  bool waited = false;
+  if (mode == LATCH_SHARED)
+    waited = latch.lockShared();
+  else if (mode == LATCH_EXCLUSIVE)
+    waited = latch.lockExclusive();
+  else if (mode == LATCH_OPTIMISTIC)
+    version = latch.readVersion(waited);
+  if (waited)
+    bufStats.latchWaits++;
+}
+
+void BufMgr::unlatchGuarded(const FrameId frame, const LatchMode mode)
+{
+  if (mode == LATCH_SHARED)
+    bufDescTable[frame].latch.unlockShared();
+  else if (mode == LATCH_EXCLUSIVE)
+    bufDescTable[frame].latch.unlockExclusive();
+}
+
+bool BufMgr::checkGuarded(const FrameId frame, const std::uint64_t version, const bool upgrade)
+{
+  FrameLatch& latch = bufDescTable[frame].latch;
+  if (upgrade ? latch.tryUpgrade(version) : latch.validate(version))
+    return true;
+  bufStats.latchRestarts++;
+  return false;
+}
+
+void BufMgr::waitUnclaimed(const FrameId frame)
+{
+  while (bufDescTable[frame].pinCnt >= BufDesc::CLAIMED)
+    std::this_thread::yield();
+}
+
+void BufMgr::releaseBuf(const FrameId frame)
+{
+  bufDescTable[frame].Clear();
+  replacer->remove(frame);
+}
+
+	
+bool BufMgr::beginLoad(File* file, const PageId pageNo, FrameId & frameNo, const AccessStrategy strategy,
+                       const bool ringOnly)
+{
+  // not in the buffer pool, must allocate a new page
+  // alloc a new frame
+  allocBuf(file, pageNo, frameNo, strategy, ringOnly);
+
+  // publish the frame before reading, so that other threads asking for
+  // the page wait for this read instead of starting their own
+  BufDesc* desc = &bufDescTable[frameNo];
+  desc->loading = true;
+  desc->Set(file, pageNo);
+  desc->counters = fileCounters(file);
+  desc->refbit = strategy == ACCESS_NORMAL;
+  {
+    std::lock_guard<std::mutex> guard(hashTable->latch(file, pageNo));
+    FrameId other;
+    if (!hashTable->tryLookup(file, pageNo, other))
+      hashTable->insert(file, pageNo, frameNo);
+    else
+      desc->valid = false;
+  }
+  if (!desc->valid)
+  {
+    // another thread read the page in first
+    releaseBuf(frameNo);
+    return false;
+  }
+  return true;
+}
+
+void BufMgr::finishLoad(File* file, const PageId pageNo, const FrameId frameNo, const bool read)
+{
+  BufDesc* desc = &bufDescTable[frameNo];
+  if (!read)
+  {
+    {
+      std::lock_guard<std::mutex> guard(hashTable->latch(file, pageNo));
+      hashTable->remove(file, pageNo);
+    }
+    desc->valid = false;
+    desc->loading = false;
+
+    // wait for threads that found the frame to let go of it
+    while (desc->pinCnt != 1)
+      std::this_thread::yield();
+    releaseBuf(frameNo);
+    return;
+  }
+
+  // set up the entry properly
+  replacer->insert(frameNo, file, pageNo);
+  desc->loading = false;
+}
+
+bool BufMgr::loadPage(File* file, const PageId pageNo, FrameId & frameNo, const AccessStrategy strategy)
+{
+  if (!beginLoad(file, pageNo, frameNo, strategy))
+    return false;
+  if (loadFromTier(file, pageNo, frameNo))
+    return true;
+
+  // read the page into the new frame
+  bufStats.diskreads++;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  try
+  {
+    file->readPageInto(pageNo, &bufPool[frameNo]);
+  }
+  catch (...)
+  {
+    finishLoad(file, pageNo, frameNo, false);
+    throw;
+  }
+  bufStats.readLatency.record(nanosSince(start));
+  finishLoad(file, pageNo, frameNo, true);
+  return true;
+}
+
+bool BufMgr::loadFromTier(File* file, const PageId pageNo, const FrameId frame)
+{
+  if (tier == NULL)
+    return false;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  if (!tier->take(file, pageNo, &bufPool[frame]))
+    return false;
+  bufStats.tierHits++;
+  bufStats.tierLatency.record(nanosSince(start));
+  finishLoad(file, pageNo, frame, true);
+  return true;
+}
+
+void BufMgr::loadPages(File* file, const std::vector<PageId>& pageNos, std::vector<FrameId>& frames,
+                       const AccessStrategy strategy)
+{
+  frames.clear();
+  std::vector<FrameId> fromTier;
+  std::vector<PageId> loading;
+  std::vector<Page*> pages;
+  for (std::size_t i = 0; i < pageNos.size(); i++)
+  {
+    {
+      std::lock_guard<std::mutex> guard(hashTable->latch(file, pageNos[i]));
+      FrameId frameNo;
+      if (hashTable->tryLookup(file, pageNos[i], frameNo))
+        continue;
+    }
+
+    FrameId frameNo;
+    try
+    {
+      if (!beginLoad(file, pageNos[i], frameNo, strategy, true))
+        continue;
+    }
+    catch (const BufferExceededException &e)
+    {
+      // read what already has a frame
+      if (loading.empty() && fromTier.empty())
+        throw;
+      break;
+    }
+    if (loadFromTier(file, pageNos[i], frameNo))
+    {
+      fromTier.push_back(frameNo);
+      continue;
+    }
+    loading.push_back(pageNos[i]);
+    frames.push_back(frameNo);
+    pages.push_back(&bufPool[frameNo]);
+  }
+  if (loading.empty())
+  {
+    frames.swap(fromTier);
+    return;
+  }
+
+  // read all pages at once, straight into their frames
+  bufStats.diskreads += loading.size();
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  try
+  {
+    file->readPages(&loading[0], &pages[0], loading.size());
+  }
+  catch (...)
+  {
+    for (std::size_t i = 0; i < loading.size(); i++)
+      finishLoad(file, loading[i], frames[i], false);
+    for (std::size_t i = 0; i < fromTier.size(); i++)
+      unpinFrame(fromTier[i]);
+    frames.clear();
+    throw;
+  }
+  bufStats.readLatency.record(nanosSince(start));
+  for (std::size_t i = 0; i < loading.size(); i++)
+    finishLoad(file, loading[i], frames[i], true);
+  frames.insert(frames.end(), fromTier.begin(), fromTier.end());
+}
+
+void BufMgr::claimDirtyNeighbours(File* file, const PageId pageNo, std::vector<FrameId>& frames)
+{
+  const std::size_t limit = std::min(std::size_t(WRITEBACK_CLUSTER), std::max<std::size_t>(1, numBufs / 4));
+  for (int step = 1; step >= -1; step -= 2)
+  {
+    PageId neighbour = pageNo;
+    while (frames.size() < limit)
+    {
+      neighbour += step;
+      if (neighbour == Page::INVALID_NUMBER)
+        break;
+
+      // the page cannot change frames while its shard is latched
+      std::lock_guard<std::mutex> guard(hashTable->latch(file, neighbour));
+      FrameId frameNo;
+      if (!hashTable->tryLookup(file, neighbour, frameNo))
+        break;
+      BufDesc* desc = &bufDescTable[frameNo];
+      if (desc->refbit || !desc->dirty)
+        break;
+      int unpinned = 0;
+      if (!desc->pinCnt.compare_exchange_strong(unpinned, BufDesc::CLAIMED))
+        break;
+      if (!desc->dirty.exchange(false))
+      {
+        desc->pinCnt -= BufDesc::CLAIMED;
+        break;
+      }
+      frames.push_back(frameNo);
+    }
+  }
+}
+
+void BufMgr::writeFrames(std::vector<FrameId>& frames)
+{
+  // sort the pages by file, then by page number
+  std::vector<std::pair<std::pair<File*, PageId>, FrameId> > order;
+  for (std::size_t i = 0; i < frames.size(); i++)
+  {
+    BufDesc* desc = &bufDescTable[frames[i]];
+    order.push_back(std::make_pair(std::make_pair(desc->file.load(), desc->pageNo.load()), frames[i]));
+  }
+  std::sort(order.begin(), order.end());
+
+  std::exception_ptr failure;
+  std::size_t first = 0;
+  while (first < order.size())
+  {
+    File* file = order[first].first.first;
+    std::size_t last = first;
+    std::vector<PageId> pageNos;
+    std::vector<const Page*> pages;
+    while (last < order.size() && order[last].first.first == file)
+    {
+      pageNos.push_back(order[last].first.second);
+      pages.push_back(&bufPool[order[last].second]);
+      last++;
+    }
+
+    try
+    {
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      file->writePages(&pageNos[0], &pages[0], pageNos.size());
+      bufStats.writeLatency.record(nanosSince(start));
+      bufStats.diskwrites += pageNos.size();
+    }
+    catch (...)
+    {
+      for (std::size_t i = first; i < last; i++)
+        bufDescTable[order[i].second].dirty = true;
+      if (!failure)
+        failure = std::current_exception();
+    }
+    first = last;
+  }
+
+  if (failure)
+    std::rethrow_exception(failure);
+}
+
+FrameId BufMgr::pinPage(File* file, const PageId pageNo, const AccessStrategy strategy)
+{
+  // check to see if it is already in the buffer pool
+  bufStats.accesses++;
+  FrameId frameNo = 0;
+  const bool reference = strategy == ACCESS_NORMAL;
+  while (!pinResident(file, pageNo, frameNo, reference))
+  {
+    if (loadPage(file, pageNo, frameNo, strategy))
+    {
+      bufStats.misses++;
+      countRequest(frameNo, false);
+      traceRequest(file, pageNo, TRACE_READ, false);
+      return frameNo;
+    }
+  }
+
+  bufStats.hits++;
+  countRequest(frameNo, true);
+  traceRequest(file, pageNo, TRACE_READ, true);
+  if (reference)
+    replacer->access(frameNo);
+  return frameNo;
+}
+
+void BufMgr::readPage(File* file, const PageId pageNo, Page*& page, const AccessStrategy strategy)
+{
+  // std::cout << "readPage called on file.page " << file << "." << pageNo << endl;
+  if (file->mapped())
+  {
+    page = file->mappedPage(pageNo);
+    bufStats.mappedReads++;
+    return;
+  }
+  GateGuard entry(this);
+  page = &bufPool[pinPage(file, pageNo, strategy)];
+}
+
+void BufMgr::readPages(File* file, const PageId* pageNos, Page** pages, const std::size_t count,
+                       const AccessStrategy strategy)
+{
+  if (file->mapped())
+  {
+    for (std::size_t i = 0; i < count; i++)
+      pages[i] = file->mappedPage(pageNos[i]);
+    bufStats.mappedReads += count;
+    return;
+  }
+  GateGuard entry(this);
+  const bool reference = strategy == ACCESS_NORMAL;
+  std::vector<FrameId> pinned;
+  try
+  {
+    // pin the pages already in the pool right away
+    std::vector<std::pair<PageId, std::size_t> > missing;
+    for (std::size_t i = 0; i < count; i++)
+    {
+      FrameId frameNo;
+      if (!pinResident(file, pageNos[i], frameNo, reference))
+      {
+        missing.push_back(std::make_pair(pageNos[i], i));
+        continue;
+      }
+      pinned.push_back(frameNo);
+      bufStats.accesses++;
+      bufStats.hits++;
+      countRequest(frameNo, true);
+      traceRequest(file, pageNos[i], TRACE_READ, true);
+      if (reference)
+        replacer->access(frameNo);
+      pages[i] = &bufPool[frameNo];
+    }
+    if (missing.empty())
+      return;
+
+    // read the others all at once, in page order so that the file reads
+    // each run of adjacent pages with a single read
+    std::sort(missing.begin(), missing.end());
+    std::vector<PageId> loading;
+    for (std::size_t i = 0; i < missing.size(); i++)
+    {
+      if (loading.empty() || loading.back() != missing[i].first)
+        loading.push_back(missing[i].first);
+    }
+    std::vector<FrameId> frames;
+    loadPages(file, loading, frames, strategy);
+    pinned.insert(pinned.end(), frames.begin(), frames.end());
+    std::map<PageId, FrameId> loaded;
+    for (std::size_t i = 0; i < frames.size(); i++)
+      loaded[bufDescTable[frames[i]].pageNo] = frames[i];
+
+    // the pin of a page read in goes to its first request; later requests
+    // for it, and pages loadPages() left out, are read one by one
+    for (std::size_t i = 0; i < missing.size(); i++)
+    {
+      const PageId pageNo = missing[i].first;
+      std::map<PageId, FrameId>::iterator it = loaded.find(pageNo);
+      FrameId frameNo;
+      if (it != loaded.end())
+      {
+        frameNo = it->second;
+        loaded.erase(it);
+        bufStats.accesses++;
+        bufStats.misses++;
+        countRequest(frameNo, false);
+        traceRequest(file, pageNo, TRACE_READ, false);
+      }
+      else
+      {
+        frameNo = pinPage(file, pageNo, strategy);
+        pinned.push_back(frameNo);
+      }
+      pages[missing[i].second] = &bufPool[frameNo];
+    }
+  }
+  catch (...)
+  {
+    for (std::size_t i = 0; i < pinned.size(); i++)
+      unpinFrame(pinned[i]);
+    throw;
+  }
+}
+
+PageGuard BufMgr::readPage(File* file, const PageId pageNo, const AccessStrategy strategy)
+{
+  Page* page;
+  readPage(file, pageNo, page, strategy);
+  // a page of a mapped file is not pinned, so the guard has nothing to drop
+  if (file->mapped())
+    return PageGuard(NULL, pageNo, 0, page);
+  return PageGuard(this, pageNo, FrameId(page - bufPool), page);
+}
+
+void BufMgr::writerLoop()
+{
+  std::unique_lock<std::mutex> lock(writerLatch);
+  while (!writerStop)
+  {
+    writerWake.wait_for(lock, std::chrono::milliseconds(int(BGWRITER_DELAY_MS)));
+    if (writerStop)
+      break;
+
+    // the pages replacement passed over first, as they are needed soonest
+    std::vector<FrameId> queued;
+    queued.swap(writebackQueue);
+    lock.unlock();
+    {
+      GateGuard entry(this);
+      std::lock_guard<std::mutex> round(writerRound);
+      cleanFrames(queued, queued.size());
+      cleanAhead();
+    }
+    lock.lock();
+  }
+}
+
+void BufMgr::cleanAhead()
+{
+  std::vector<FrameId> frames;
+  replacer->upcoming(std::max<std::uint32_t>(1, numBufs / 4), frames);
+  cleanFrames(frames, BGWRITER_MAX_PAGES);
+}
+
+void BufMgr::cleanFrames(const std::vector<FrameId>& frames, const std::size_t limit)
+{
+  std::vector<FrameId> claimed;
+  std::vector<FrameId> dirty;
+  for (std::size_t i = 0; i < frames.size() && dirty.size() < limit; i++)
+  {
+    // a queued frame may have been retired by a resize() since
+    if (frames[i] >= numFrames)
+      continue;
+    BufDesc* desc = &bufDescTable[frames[i]];
+    if (!desc->dirty || desc->pinCnt != 0)
+      continue;
+
+    // claim the frame so that it is neither replaced nor pinned while it is
+    // being written
+    int unpinned = 0;
+    if (!desc->pinCnt.compare_exchange_strong(unpinned, BufDesc::CLAIMED))
+      continue;
+    claimed.push_back(frames[i]);
+
+    if (desc->valid && desc->dirty.exchange(false))
+      dirty.push_back(frames[i]);
+  }
+
+  // write them all at once; pages that fail are left dirty for the thread
+  // that replaces them
+  try
+  {
+    writeFrames(dirty);
+    bufStats.bgwrites += dirty.size();
+  }
+  catch (...)
+  {
+  }
+
+  for (std::size_t i = 0; i < claimed.size(); i++)
+    bufDescTable[claimed[i]].pinCnt -= BufDesc::CLAIMED;
+}
+
+void BufMgr::prefetch(File* file, const std::vector<PageId>& pageNos, const AccessStrategy strategy)
+{
+  // the operating system reads ahead the pages of a mapped file
+  if (file->mapped())
+  {
+    if (!pageNos.empty())
+      file->adviseWillNeed(&pageNos[0], pageNos.size());
+    return;
+  }
+  std::vector<PrefetchRequest> requests;
+  for (std::size_t i = 0; i < pageNos.size(); i++)
+  {
+    PrefetchRequest request = {file, pageNos[i], strategy, true, 0};
+    requests.push_back(request);
+  }
+  queuePrefetch(requests);
+}
+
+void BufMgr::prefetchFollowing(File* file, PageId pageNo, std::uint32_t count,
+                               const AccessStrategy strategy)
+{
+  // the operating system reads ahead the pages of a mapped file
+  if (file->mapped() || count == 0)
+    return;
+
+  // walk past the pages already in the pool; the first one that is not is
+  // read with a request that goes on with the pages after it
+  {
+    GateGuard entry(this);
+    PageId nextPageNo;
+    while (count > 0 && peekNextPage(file, pageNo, nextPageNo))
+    {
+      if (nextPageNo == Page::INVALID_NUMBER)
+        return;
+      pageNo = nextPageNo;
+      count--;
+    }
+  }
+  PrefetchRequest request = {file, pageNo, strategy, true, count};
+  queuePrefetch(std::vector<PrefetchRequest>(1, request));
+}
+
+void BufMgr::queuePrefetch(const std::vector<PrefetchRequest>& requests)
+{
+  // only wake the prefetch threads for pages that are not in the pool
+  GateGuard entry(this);
+  std::vector<PrefetchRequest> missing;
+  for (std::size_t i = 0; i < requests.size(); i++)
+  {
+    std::lock_guard<std::mutex> guard(hashTable->latch(requests[i].file, requests[i].pageNo));
+    FrameId frameNo;
+    if (!hashTable->tryLookup(requests[i].file, requests[i].pageNo, frameNo))
+      missing.push_back(requests[i]);
+  }
+  if (missing.empty())
+    return;
 
-	delete hashTable;
-  delete [] bufDescTable;
-  delete [] bufPool;
+  {
+    std::lock_guard<std::mutex> guard(prefetchLatch);
+    if (prefetchThreads.empty())
+    {
+      prefetchActive.assign(PREFETCH_THREADS, NULL);
+      for (int i = 0; i < PREFETCH_THREADS; i++)
+        prefetchThreads.push_back(std::thread(&BufMgr::prefetchLoop, this, i));
+    }
+
+    // reading ahead more pages than the pool holds would only evict the
+    // first ones before they are used
+    for (std::size_t i = 0; i < missing.size() && prefetchQueue.size() < numBufs; i++)
+      prefetchQueue.push_back(missing[i]);
+  }
+  prefetchWork.notify_all();
 }
 
-void BufMgr::allocBuf(FrameId & frame) 
+void BufMgr::prefetchLoop(const int id)
 {
-  // perform first part of clock algorithm to search for 
-  // open buffer frame
-  // Assumes non-concurrent access to buffer manager
-  std::uint32_t numScanned = 0;
-  bool found = 0;
-
-  while (numScanned < 2*numBufs)	//Need to scn twice
+  std::unique_lock<std::mutex> lock(prefetchLatch);
+  while (true)
   {
-    // advance the clock
-    advanceClock();
-    numScanned++;
+    while (!prefetchStop && prefetchQueue.empty())
+      prefetchWork.wait(lock);
+    if (prefetchStop)
+      return;
+
+    // keep resize() out until the pages are read; the gate is not waited for
+    // with the latch held, which calls inside it may need
+    lock.unlock();
+    GateGuard entry(this);
+    lock.lock();
+    if (prefetchStop)
+      return;
+    if (prefetchQueue.empty())
+      continue;
 
-    // if invalid, use frame
-    if (! bufDescTable[clockHand].valid)
+    // take the next pages of the same file, to read them all at once
+    File* file = prefetchQueue.front().file;
+    AccessStrategy strategy = prefetchQueue.front().strategy;
+    std::vector<PageId> pageNos;
+    std::vector<PageId> unreferenced;
+    std::vector<PrefetchRequest> chains;
+    while (!prefetchQueue.empty() && prefetchQueue.front().file == file &&
+           prefetchQueue.front().strategy == strategy && pageNos.size() < PREFETCH_BATCH)
     {
-      break;
+      pageNos.push_back(prefetchQueue.front().pageNo);
+      if (!prefetchQueue.front().reference)
+        unreferenced.push_back(prefetchQueue.front().pageNo);
+      if (prefetchQueue.front().follow > 0)
+        chains.push_back(prefetchQueue.front());
+      prefetchQueue.pop_front();
     }
+    prefetchActive[id] = file;
+    lock.unlock();
 
-    // is valid, check referenced bit
-    if (! bufDescTable[clockHand].refbit)
+    std::vector<FrameId> frames;
+    try
+    {
+      loadPages(file, pageNos, frames, strategy);
+    }
+    catch (...)
     {
-      // check to see if someone has it pinned
-      if (bufDescTable[clockHand].pinCnt == 0)
+      // read the pages one by one, so that the one that failed does not
+      // keep the others out; a failed prefetch is noticed by the readPage()
+      // that needs the page
+      frames.clear();
+      for (std::size_t i = 0; i < pageNos.size(); i++)
       {
-        // hasn't been referenced and is not pinned, use it
-        // remove previous entry from hash table
-        hashTable->remove(bufDescTable[clockHand].file, bufDescTable[clockHand].pageNo);
-        found = true;
-        break;
+        try
+        {
+          std::vector<PageId> one(1, pageNos[i]);
+          std::vector<FrameId> loaded;
+          loadPages(file, one, loaded, strategy);
+          frames.insert(frames.end(), loaded.begin(), loaded.end());
+        }
+        catch (...)
+        {
+        }
       }
     }
-    else
+    bufStats.prefetches += frames.size();
+    std::vector<PrefetchRequest> next;
+    for (std::size_t i = 0; i < frames.size(); i++)
     {
-      // has been referenced, clear the bit
-      bufStats.accesses++;
-      bufDescTable[clockHand].refbit = false;
+      if (!unreferenced.empty() &&
+          std::find(unreferenced.begin(), unreferenced.end(), bufDescTable[frames[i]].pageNo) != unreferenced.end())
+        bufDescTable[frames[i]].refbit = false;
+
+      // a chain goes on with the page the header of the page read names
+      for (std::size_t j = 0; j < chains.size(); j++)
+      {
+        if (chains[j].pageNo != bufDescTable[frames[i]].pageNo)
+          continue;
+        PrefetchRequest request = chains[j];
+        request.pageNo = bufPool[frames[i]].next_page_number();
+        request.follow--;
+        if (request.pageNo != Page::INVALID_NUMBER)
+          next.push_back(request);
+      }
+      unpinFrame(frames[i]);
     }
+    for (std::size_t i = 0; i < next.size(); )
+    {
+      std::lock_guard<std::mutex> guard(hashTable->latch(file, next[i].pageNo));
+      FrameId frameNo;
+      if (hashTable->tryLookup(file, next[i].pageNo, frameNo))
+        next.erase(next.begin() + i);
+      else
+        i++;
+    }
+
+    lock.lock();
+    prefetchQueue.insert(prefetchQueue.end(), next.begin(), next.end());
+    prefetchActive[id] = NULL;
+    prefetchDone.notify_all();
   }
-  
-  // check for full buffer pool
-  if (!found && numScanned >= 2*numBufs)
-  {
-    throw BufferExceededException();
-  }
-  
-  // flush any existing changes to disk if necessary
-  if (bufDescTable[clockHand].dirty)
+}
+
+void BufMgr::cancelPrefetch(const File* file)
+{
+  // a thread reading pages of the file may queue the pages after them
+  // before it finishes, so the queue is swept again after each wait
+  std::unique_lock<std::mutex> lock(prefetchLatch);
+  while (true)
   {
-    bufStats.diskwrites++;
-    //status = bufDescTable[clockHand].file->writePage(bufDescTable[clockHand].pageNo,
-    bufDescTable[clockHand].file->writePage(bufDescTable[clockHand].pageNo, bufPool[clockHand]);
+    std::deque<PrefetchRequest>::iterator it = prefetchQueue.begin();
+    while (it != prefetchQueue.end())
+    {
+      if (it->file == file)
+        it = prefetchQueue.erase(it);
+      else
+        ++it;
+    }
+    if (std::find(prefetchActive.begin(), prefetchActive.end(), file) == prefetchActive.end())
+      return;
+    prefetchDone.wait(lock);
   }
+}
 
-	//Reset all the BufDesc entry for the frame before returning the frame
-  bufDescTable[clockHand].Clear();
 
-  // return new frame number
-  frame = clockHand;
-} // end allocBuf
+void BufMgr::waitPrefetch(const File* file)
+{
+  std::unique_lock<std::mutex> lock(prefetchLatch);
+  while (true)
+  {
+    bool queued = std::find(prefetchActive.begin(), prefetchActive.end(), file) != prefetchActive.end();
+    for (std::deque<PrefetchRequest>::iterator it = prefetchQueue.begin(); !queued && it != prefetchQueue.end(); ++it)
+      queued = it->file == file;
+    if (!queued)
+      return;
+    prefetchDone.wait(lock);
+  }
+}
 
-	
-void BufMgr::readPage(File* file, const PageId pageNo, Page*& page)
+void BufMgr::enableSnapshot(const std::string& path)
 {
-  // check to see if it is already in the buffer pool
-  // std::cout << "readPage called on file.page " << file << "." << pageNo << endl;
-  FrameId frameNo = 0;
-	try
-	{
-  	hashTable->lookup(file, pageNo, frameNo);
+  std::lock_guard<std::mutex> guard(snapshotLatch);
+  snapshotPath = path;
+  snapshotPages.clear();
 
-    // set the referenced bit
-    bufDescTable[frameNo].refbit = true;
-    bufDescTable[frameNo].pinCnt++;
-    page = &bufPool[frameNo];
-  }
-  catch(const HashNotFoundException &e) //not in the buffer pool, must allocate a new page
+  // each line holds the reference bit, the page number and the file name
+  std::ifstream in(path.c_str());
+  std::string line;
+  if (!std::getline(in, line) || line != SNAPSHOT_HEADER)
+    return;
+  while (std::getline(in, line))
   {
-    // alloc a new frame
-    allocBuf(frameNo);
+    std::istringstream fields(line);
+    bool refbit;
+    PageId pageNo;
+    std::string fileName;
+    if (!(fields >> refbit >> pageNo) || fields.get() != ' ' || !std::getline(fields, fileName) || fileName.empty())
+      continue;
+    snapshotPages[fileName].push_back(std::make_pair(refbit, pageNo));
+  }
+}
 
-    // read the page into the new frame
-    bufStats.diskreads++;
-    //status = file->readPage(pageNo, &bufPool[frameNo]);
-    bufPool[frameNo] = file->readPage(pageNo);
+std::size_t BufMgr::prewarm(File* file)
+{
+  std::vector<std::pair<bool, PageId> > pages;
+  {
+    std::lock_guard<std::mutex> guard(snapshotLatch);
+    std::map<std::string, std::vector<std::pair<bool, PageId> > >::iterator it = snapshotPages.find(file->filename());
+    if (it == snapshotPages.end())
+      return 0;
+    pages.swap(it->second);
+    snapshotPages.erase(it);
+  }
+  // pages of a mapped file never enter the pool
+  if (file->mapped())
+    return 0;
 
-    // set up the entry properly
-    bufDescTable[frameNo].Set(file, pageNo);
-    page = &bufPool[frameNo];
+  // the pages that were not referenced first, in page order; those are the
+  // ones left out if the pool has shrunk since
+  std::sort(pages.begin(), pages.end());
+  if (pages.size() > numBufs)
+    pages.erase(pages.begin(), pages.end() - numBufs);
 
-    // insert in the hash table
-    hashTable->insert(file, pageNo, frameNo);
+  std::vector<PrefetchRequest> requests;
+  for (std::size_t i = 0; i < pages.size(); i++)
+  {
+    PrefetchRequest request = {file, pages[i].second, ACCESS_NORMAL, pages[i].first, 0};
+    requests.push_back(request);
   }
+  queuePrefetch(requests);
+  waitPrefetch(file);
+  return pages.size();
 }
 
+void BufMgr::writeSnapshot()
+{
+  // the pages in the pool, then the ones flushed lately, newest first; the
+  // referenced ones make the cut if there are more than the pool holds
+  std::vector<SnapshotEntry> entries;
+  for (std::uint32_t i = 0; i < numFrames; i++)
+  {
+    BufDesc* desc = &bufDescTable[i];
+    if (desc->valid)
+    {
+      SnapshotEntry entry = {desc->file.load()->filename(), desc->pageNo, desc->refbit};
+      entries.push_back(entry);
+    }
+  }
+  entries.insert(entries.end(), flushedPages.rbegin(), flushedPages.rend());
+  std::vector<SnapshotEntry> listed;
+  std::set<std::pair<std::string, PageId> > seen;
+  for (int refbit = 1; refbit >= 0; refbit--)
+  {
+    for (std::size_t i = 0; i < entries.size() && listed.size() < numBufs; i++)
+    {
+      if (entries[i].refbit == (refbit == 1) && seen.insert(std::make_pair(entries[i].fileName, entries[i].pageNo)).second)
+        listed.push_back(entries[i]);
+    }
+  }
+
+  // replace the old snapshot only once the new one is complete
+  std::string tmpPath = snapshotPath + ".tmp";
+  {
+    std::ofstream out(tmpPath.c_str(), std::ios::trunc);
+    out << SNAPSHOT_HEADER << "\n";
+    for (std::size_t i = 0; i < listed.size(); i++)
+      out << listed[i].refbit << " " << listed[i].pageNo << " " << listed[i].fileName << "\n";
+    out.close();
+    if (!out)
+    {
+      std::remove(tmpPath.c_str());
+      return;
+    }
+  }
+  std::rename(tmpPath.c_str(), snapshotPath.c_str());
+}
 
 void BufMgr::unPinPage(File* file, const PageId pageNo, const bool dirty) 
 {
+  // pages of a mapped file are not pinned, nor may they change
+  if (file->mapped())
+  {
+    if (dirty)
+      throw FileIOException(file->filename(), EROFS);
+    return;
+  }
+
   // lookup in hashtable
+  GateGuard entry(this);
   FrameId frameNo = 0;
-  hashTable->lookup(file, pageNo, frameNo);
+  std::lock_guard<std::mutex> guard(hashTable->latch(file, pageNo));
+  if (!hashTable->tryLookup(file, pageNo, frameNo))
+  {
+    throw HashNotFoundException(file->filename(), pageNo);
+  }
 
   if (dirty == true) bufDescTable[frameNo].dirty = dirty;
 
   // make sure the page is actually pinned
-  if (bufDescTable[frameNo].pinCnt == 0)
+  if (!unpinFrame(frameNo))
   {
   	throw PageNotPinnedException(file->filename(), pageNo, frameNo);
   }
-  else bufDescTable[frameNo].pinCnt--;
 }
 
-void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page) 
+void BufMgr::allocPage(File* file, PageId &pageNo, Page*& page, const AccessStrategy strategy) 
 {
+  if (file->mapped())
+    throw FileIOException(file->filename(), EROFS);
+  GateGuard entry(this);
   FrameId frameNo;
+  bufStats.accesses++;
 
   // alloc a new frame
-  allocBuf(frameNo);
+  allocBuf(file, Page::INVALID_NUMBER, frameNo, strategy);
 
   // allocate a new page in the file
 	//std::cerr << "buffer data size:" << bufPool[frameNo].data_.length() << "\n";
-  bufPool[frameNo] = file->allocatePage(pageNo);
+  try
+  {
+    file->allocatePageInto(pageNo, &bufPool[frameNo]);
+  }
+  catch (...)
+  {
+    releaseBuf(frameNo);
+    throw;
+  }
   page = &bufPool[frameNo];
 
   // set up the entry properly
   bufDescTable[frameNo].Set(file, pageNo);
+  bufDescTable[frameNo].counters = fileCounters(file);
+  bufDescTable[frameNo].refbit = strategy == ACCESS_NORMAL;
 
   // insert in the hash table
-  hashTable->insert(file, pageNo, frameNo);
+  {
+    std::lock_guard<std::mutex> guard(hashTable->latch(file, pageNo));
+    hashTable->insert(file, pageNo, frameNo);
+  }
+  replacer->insert(frameNo, file, pageNo);
+  traceRequest(file, pageNo, TRACE_ALLOC, false);
+}
+
+PageGuard BufMgr::allocPage(File* file, const AccessStrategy strategy)
+{
+  PageId pageNo;
+  Page* page;
+  allocPage(file, pageNo, page, strategy);
+  return PageGuard(this, pageNo, FrameId(page - bufPool), page);
 }
 
 void BufMgr::flushFile(const File* file) 
 {
-  for (std::uint32_t i = 0; i < numBufs; i++)
+  GateGuard entry(this);
+  cancelPrefetch(file);
+  bool snapshot;
+  {
+    std::lock_guard<std::mutex> guard(snapshotLatch);
+    snapshot = !snapshotPath.empty();
+  }
+
+  // visit only the frames holding pages of the file, in page order so that
+  // the dirty ones are written sequentially
+  std::vector<std::pair<PageId, FrameId> > pages;
+  hashTable->filePages(file, pages);
+  std::sort(pages.begin(), pages.end());
+  File* f = const_cast<File*>(file);
+
+  // pin the frames so that they cannot be replaced under us
+  std::vector<std::pair<PageId, FrameId> > pinned;
+  for (std::size_t n = 0; n < pages.size(); n++)
+	{
+		PageId pageNo = pages[n].first;
+		FrameId i = pages[n].second;
+		{
+			std::lock_guard<std::mutex> guard(hashTable->latch(f, pageNo));
+			FrameId frameNo;
+			if (!hashTable->tryLookup(f, pageNo, frameNo) || frameNo != i)
+				continue;
+			bufDescTable[i].pinCnt++;
+		}
+		waitUnclaimed(i);
+		pinned.push_back(pages[n]);
+
+    if (bufDescTable[i].pinCnt > 1)
+		{
+			for (std::size_t k = 0; k < pinned.size(); k++)
+				unpinFrame(pinned[k].second);
+			throw PagePinnedException(file->filename(), pageNo, i);
+		}
+	}
+
+	// write the dirty pages all at once
+	std::vector<FrameId> dirty;
+	for (std::size_t n = 0; n < pinned.size(); n++)
+		if (bufDescTable[pinned[n].second].dirty.exchange(false))
+			dirty.push_back(pinned[n].second);
+	try
+	{
+		writeFrames(dirty);
+	}
+	catch (...)
 	{
+		for (std::size_t k = 0; k < pinned.size(); k++)
+			unpinFrame(pinned[k].second);
+		throw;
+	}
+
+	// drop the pages; one that was pinned or changed meanwhile is dealt with
+	// on its own
+  for (std::size_t n = 0; n < pinned.size(); n++)
+	{
+		PageId pageNo = pinned[n].first;
+		FrameId i = pinned[n].second;
   	BufDesc* tmpbuf = &(bufDescTable[i]);
-  	if(tmpbuf->file && tmpbuf->valid == true && tmpbuf->file == file)
+
+		while (true)
 		{
-	    if (tmpbuf->pinCnt > 0)
-  			throw PagePinnedException(file->filename(), tmpbuf->pageNo, tmpbuf->frameNo);
+	    if (tmpbuf->pinCnt > 1)
+			{
+				for (std::size_t k = n; k < pinned.size(); k++)
+					unpinFrame(pinned[k].second);
+				throw PagePinnedException(file->filename(), pageNo, tmpbuf->frameNo);
+			}
 
-	    if (tmpbuf->dirty == true)
+	    if (tmpbuf->dirty.exchange(false))
 			{
-				//if ((status = tmpbuf->file->writePage(tmpbuf->pageNo, &(bufPool[i]))) != OK)
-				tmpbuf->file->writePage(tmpbuf->pageNo, bufPool[i]);
-				tmpbuf->dirty = false;
-    	}
+				try
+				{
+					std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+					f->writePage(pageNo, bufPool[i]);
+					bufStats.writeLatency.record(nanosSince(start));
+				}
+				catch (...)
+				{
+					tmpbuf->dirty = true;
+					for (std::size_t k = n; k < pinned.size(); k++)
+						unpinFrame(pinned[k].second);
+					throw;
+				}
+				bufStats.diskwrites++;
+  		}
 
-    	hashTable->remove(file,tmpbuf->pageNo);
-    	tmpbuf->Clear();
-  	}
-		else if (tmpbuf->valid == false && tmpbuf->file == file)
-  		throw BadBufferException(tmpbuf->frameNo, tmpbuf->dirty, tmpbuf->valid, tmpbuf->refbit);
+			std::lock_guard<std::mutex> guard(hashTable->latch(f, pageNo));
+			if (tmpbuf->pinCnt == 1 && !tmpbuf->dirty)
+			{
+  			hashTable->remove(f, pageNo);
+				break;
+			}
+		}
+
+		// the page still counts as part of the pool for the snapshot
+		if (snapshot)
+		{
+			SnapshotEntry dropped = {file->filename(), pageNo, tmpbuf->refbit};
+			std::lock_guard<std::mutex> guard(snapshotLatch);
+			flushedPages.push_back(dropped);
+			if (flushedPages.size() > numBufs)
+				flushedPages.pop_front();
+		}
+  	releaseBuf(i);
   }
+  retireFileStats(file);
+  replacer->forgetFile(file);
+  if (tier != NULL)
+    tier->removeFile(file);
+  traceRequest(file, Page::INVALID_NUMBER, TRACE_FLUSH, false);
+  dropRings(file);
+
+  // a sync point of the file's durability policy
+  if (f->durability() != DURABILITY_NONE)
+    f->sync();
 }
 
 void BufMgr::disposePage(File* file, const PageId pageNo)
 {
+  if (file->mapped())
+    throw FileIOException(file->filename(), EROFS);
 	//Deallocate from file altogether
   //See if it is in the buffer pool
+  GateGuard entry(this);
   FrameId frameNo = 0;
-  hashTable->lookup(file, pageNo, frameNo);
+  bool resident = false;
+  {
+    std::lock_guard<std::mutex> guard(hashTable->latch(file, pageNo));
+    if (hashTable->tryLookup(file, pageNo, frameNo))
+    {
+      resident = true;
+      bufDescTable[frameNo].pinCnt++;
+      hashTable->remove(file, pageNo);
+    }
+  }
 
-	// clear the page
-	bufDescTable[frameNo].Clear();
+  if (resident)
+  {
+    // clear the page
+    while (bufDescTable[frameNo].loading)
+      std::this_thread::yield();
+    waitUnclaimed(frameNo);
+    releaseBuf(frameNo);
+  }
 
-	hashTable->remove(file, pageNo);
+  if (tier != NULL)
+    tier->remove(file, pageNo);
 
   // deallocate it in the file	
   file->deletePage(pageNo);
+  traceRequest(file, pageNo, TRACE_DISPOSE, resident);
+}
+
+void BufMgr::resize(const std::uint32_t newBufs)
+{
+  if (newBufs == 0 || newBufs > maxFrames)
+    throw BufferExceededException();
+
+  std::lock_guard<std::mutex> serial(resizeLatch);
+  closeGate();
+
+  try
+  {
+    if (newBufs < numBufs)
+      shrink(newBufs);
+    else if (newBufs > numBufs)
+      grow(newBufs);
+  }
+  catch (...)
+  {
+    resizing = false;
+    throw;
+  }
+
+  // the rings hold frame numbers, and are sized, for the old pool
+  {
+    std::lock_guard<std::mutex> guard(ringsLatch);
+    for (std::map<std::pair<const File*, AccessStrategy>, Ring*>::iterator it = rings.begin(); it != rings.end(); ++it)
+      delete it->second;
+    rings.clear();
+  }
+  resizing = false;
+}
+
+void BufMgr::closeGate()
+{
+  resizing = true;
+  for (int i = 0; i < GATE_SLOTS; i++)
+  {
+    while (gate[i].count != 0)
+      std::this_thread::yield();
+  }
+}
+
+void BufMgr::shrink(const std::uint32_t newBufs)
+{
+  // no other thread uses the pool, so pin counts stay as they are; pick the
+  // unpinned frames from the highest down
+  std::vector<FrameId> retiring;
+  for (std::uint32_t i = numFrames; i > 0 && retiring.size() < numBufs - newBufs; i--)
+  {
+    BufDesc* desc = &bufDescTable[i - 1];
+    if (!desc->retired && desc->pinCnt == 0)
+      retiring.push_back(i - 1);
+  }
+  if (retiring.size() < numBufs - newBufs)
+    throw BufferExceededException();
+
+  // write the dirty pages back all at once before giving up any frame
+  std::vector<FrameId> dirty;
+  int resident = 0;
+  for (std::size_t i = 0; i < retiring.size(); i++)
+  {
+    BufDesc* desc = &bufDescTable[retiring[i]];
+    replacer->retire(retiring[i]);
+    if (desc->valid)
+    {
+      resident++;
+      if (desc->dirty.exchange(false))
+        dirty.push_back(retiring[i]);
+    }
+  }
+  try
+  {
+    writeFrames(dirty);
+  }
+  catch (...)
+  {
+    for (std::size_t i = 0; i < retiring.size(); i++)
+    {
+      BufDesc* desc = &bufDescTable[retiring[i]];
+      if (desc->valid)
+      {
+        replacer->insert(retiring[i], desc->file, desc->pageNo);
+        desc->pinCnt -= BufDesc::CLAIMED;
+      }
+      else
+        desc->pinCnt = 0;
+    }
+    throw;
+  }
+  bufStats.dirtyEvictions += dirty.size();
+  bufStats.cleanEvictions += resident - dirty.size();
+
+  // evict the pages; the frames stay claimed
+  for (std::size_t i = 0; i < retiring.size(); i++)
+  {
+    BufDesc* desc = &bufDescTable[retiring[i]];
+    if (desc->valid)
+    {
+      if (tier != NULL)
+        tier->put(desc->file, desc->pageNo, &bufPool[retiring[i]]);
+      hashTable->remove(desc->file, desc->pageNo);
+    }
+    desc->Reset();
+    desc->retired = true;
+    bufPool[retiring[i]].~Page();
+  }
+
+  // give back the memory of the frames past the last one left, and of the
+  // holes below it
+  std::uint32_t frames = numFrames;
+  while (bufDescTable[frames - 1].retired)
+    frames--;
+  for (std::size_t i = 0; i < retiring.size(); i++)
+  {
+    if (retiring[i] < frames)
+      madvise(&bufPool[retiring[i]], sizeof(Page), MADV_DONTNEED);
+  }
+  for (std::uint32_t i = frames; i < numFrames; i++)
+    bufDescTable[i].~BufDesc();
+  decommitMemory(bufPool, std::size_t(frames) * sizeof(Page), std::size_t(numFrames) * sizeof(Page));
+  decommitMemory(bufDescTable, std::size_t(frames) * sizeof(BufDesc), std::size_t(numFrames) * sizeof(BufDesc));
+
+  numFrames = frames;
+  numBufs = newBufs;
+  replacer->resize(numFrames, numBufs);
+}
+
+void BufMgr::grow(const std::uint32_t newBufs)
+{
+  // fill the holes first, then add frames at the end
+  std::uint32_t holes = numFrames - numBufs;
+  std::uint32_t frames = newBufs - numBufs > holes ? newBufs : numFrames;
+  hashTable->resize(frames);
+  commitMemory(bufPool, std::size_t(numFrames) * sizeof(Page), std::size_t(frames) * sizeof(Page));
+  commitMemory(bufDescTable, std::size_t(numFrames) * sizeof(BufDesc), std::size_t(frames) * sizeof(BufDesc));
+
+  std::uint32_t adding = newBufs - numBufs;
+  for (std::uint32_t i = 0; i < numFrames && adding > 0; i++)
+  {
+    BufDesc* desc = &bufDescTable[i];
+    if (!desc->retired)
+      continue;
+    new (&bufPool[i]) Page();
+    desc->retired = false;
+    desc->Clear();
+    adding--;
+  }
+  for (std::uint32_t i = numFrames; i < frames; i++)
+  {
+    new (&bufDescTable[i]) BufDesc();
+    bufDescTable[i].frameNo = i;
+    new (&bufPool[i]) Page();
+  }
+
+  numFrames = frames;
+  numBufs = newBufs;
+  replacer->resize(numFrames, numBufs);
+}
+
+BufMgr::GateGuard::GateGuard(BufMgr* bufMgr)
+  : slot(bufMgr->gate[gateSlot() % GATE_SLOTS]), resizing(bufMgr->resizing)
+{
+  while (true)
+  {
+    slot.count++;
+    if (!resizing)
+      return;
+
+    // resize() is waiting for the calls in progress or changing the pool
+    slot.count--;
+    while (resizing)
+      std::this_thread::yield();
+  }
+}
+
+BufMgr::GateGuard::~GateGuard()
+{
+  slot.count--;
 }
 
 void BufMgr::printSelf(void) 
 {
+  GateGuard entry(this);
   BufDesc* tmpbuf;
 	int validFrames = 0;
   
-  for (std::uint32_t i = 0; i < numBufs; i++)
+  for (std::uint32_t i = 0; i < numFrames; i++)
 	{
   	tmpbuf = &(bufDescTable[i]);
+		if (tmpbuf->retired)
+			continue;
 		std::cout << "FrameNo:" << i << " ";
 		tmpbuf->Print();
 
@@ -246,4 +1743,282 @@ void BufMgr::printSelf(void)
 	std::cout << "Total Number of Valid Frames:" << validFrames << "\n";
 }
 
+FileCounters* BufMgr::fileCounters(const File* file)
+{
+  std::lock_guard<std::mutex> guard(fileStatsLatch);
+  std::unordered_map<const File*, FileCounters*>::iterator it = fileStats.find(file);
+  if (it == fileStats.end())
+    it = fileStats.insert(std::make_pair(file, new FileCounters(file->filename()))).first;
+  return it->second;
+}
+
+void BufMgr::countRequest(const FrameId frame, const bool hit)
+{
+  FileCounters* counters = bufDescTable[frame].counters;
+  if (hit)
+    counters->hits++;
+  else
+    counters->misses++;
+}
+
+void BufMgr::retireFileStats(const File* file)
+{
+  std::lock_guard<std::mutex> guard(fileStatsLatch);
+  std::unordered_map<const File*, FileCounters*>::iterator it = fileStats.find(file);
+  if (it == fileStats.end())
+    return;
+  FileStats& total = retiredFileStats[it->second->name];
+  total.hits += it->second->hits;
+  total.misses += it->second->misses;
+  delete it->second;
+  fileStats.erase(it);
+}
+
+std::map<std::string, FileStats> BufMgr::getFileStats()
+{
+  std::lock_guard<std::mutex> guard(fileStatsLatch);
+  std::map<std::string, FileStats> result = retiredFileStats;
+  std::unordered_map<const File*, FileCounters*>::iterator it;
+  for (it = fileStats.begin(); it != fileStats.end(); ++it)
+  {
+    FileStats& total = result[it->second->name];
+    total.hits += it->second->hits;
+    total.misses += it->second->misses;
+  }
+  return result;
+}
+
+void BufMgr::clearBufStats()
+{
+  bufStats.clear();
+  // frames still point to the counters of their files
+  std::lock_guard<std::mutex> guard(fileStatsLatch);
+  std::unordered_map<const File*, FileCounters*>::iterator it;
+  for (it = fileStats.begin(); it != fileStats.end(); ++it)
+  {
+    it->second->hits = 0;
+    it->second->misses = 0;
+  }
+  retiredFileStats.clear();
+}
+
+void BufMgr::dumpStats(std::ostream& out)
+{
+  int hits = bufStats.hits;
+  int misses = bufStats.misses;
+  out << "{\"frames\":" << numBufs
+      << ",\"accesses\":" << bufStats.accesses
+      << ",\"hits\":" << hits
+      << ",\"misses\":" << misses
+      << ",\"hitRatio\":" << (hits + misses > 0 ? double(hits) / (hits + misses) : 0.0)
+      << ",\"diskreads\":" << bufStats.diskreads
+      << ",\"diskwrites\":" << bufStats.diskwrites
+      << ",\"fgwrites\":" << bufStats.fgwrites
+      << ",\"bgwrites\":" << bufStats.bgwrites
+      << ",\"prefetches\":" << bufStats.prefetches
+      << ",\"tierHits\":" << bufStats.tierHits
+      << ",\"mappedReads\":" << bufStats.mappedReads
+      << ",\"evictions\":{\"clean\":" << bufStats.cleanEvictions
+      << ",\"dirty\":" << bufStats.dirtyEvictions
+      << ",\"dirtySkips\":" << bufStats.dirtySkips << "}"
+      << ",\"latch\":{\"waits\":" << bufStats.latchWaits
+      << ",\"restarts\":" << bufStats.latchRestarts << "}";
+
+  out << ",\"files\":{";
+  std::map<std::string, FileStats> files = getFileStats();
+  for (std::map<std::string, FileStats>::iterator it = files.begin(); it != files.end(); ++it)
+  {
+    if (it != files.begin())
+      out << ",";
+    writeJsonString(out, it->first);
+    out << ":{\"hits\":" << it->second.hits << ",\"misses\":" << it->second.misses << "}";
+  }
+  out << "}";
+
+  out << ",\"pinWaitNs\":";
+  bufStats.pinWait.writeJson(out);
+  out << ",\"scanLength\":";
+  bufStats.scanLength.writeJson(out);
+  out << ",\"readLatencyNs\":";
+  bufStats.readLatency.writeJson(out);
+  out << ",\"writeLatencyNs\":";
+  bufStats.writeLatency.writeJson(out);
+  out << ",\"tierLatencyNs\":";
+  bufStats.tierLatency.writeJson(out);
+  out << ",\"writeStallNs\":";
+  bufStats.writeStall.writeJson(out);
+  TierStats tierStats = getTierStats();
+  out << ",\"tier\":{\"pages\":" << tierStats.pages << ",\"bytes\":" << tierStats.bytes
+      << ",\"budget\":" << tierStats.budget << "}";
+  out << "}\n";
+}
+
+void BufMgr::startStatsReporter(std::ostream& out, const int periodMs)
+{
+  std::lock_guard<std::mutex> guard(reporterLatch);
+  if (reporterThread.joinable())
+    return;
+  reporterOut = &out;
+  reporterPeriodMs = periodMs;
+  reporterStop = false;
+  reporterThread = std::thread(&BufMgr::reporterLoop, this);
+}
+
+void BufMgr::stopStatsReporter()
+{
+  {
+    std::lock_guard<std::mutex> guard(reporterLatch);
+    if (!reporterThread.joinable())
+      return;
+    reporterStop = true;
+  }
+  reporterWake.notify_all();
+  reporterThread.join();
+}
+
+void BufMgr::startTrace(const std::string& path, const std::uint32_t capacity)
+{
+  std::lock_guard<std::mutex> serial(resizeLatch);
+  if (tracer.load() != NULL)
+    return;
+  tracer.store(new TraceRecorder(path, capacity), std::memory_order_release);
+}
+
+void BufMgr::enableCompressedTier(const std::size_t budget)
+{
+  // the tier may only go once no call is using it
+  std::lock_guard<std::mutex> serial(resizeLatch);
+  closeGate();
+  delete tier;
+  tier = budget > 0 ? new CompressedTier(budget) : NULL;
+  resizing = false;
+}
+
+TierStats BufMgr::getTierStats()
+{
+  GateGuard entry(this);
+  if (tier != NULL)
+    return tier->stats();
+  TierStats none = {0, 0, 0, 0, 0};
+  return none;
+}
+
+std::uint64_t BufMgr::stopTrace()
+{
+  // the recorder may only go once no call is using it
+  std::lock_guard<std::mutex> serial(resizeLatch);
+  TraceRecorder* recorder = tracer.load();
+  if (recorder == NULL)
+    return 0;
+  closeGate();
+  tracer = NULL;
+  resizing = false;
+
+  std::uint64_t dropped = recorder->dropped();
+  delete recorder;
+  return dropped;
+}
+
+void BufMgr::reporterLoop()
+{
+  std::unique_lock<std::mutex> lock(reporterLatch);
+  while (!reporterStop)
+  {
+    reporterWake.wait_for(lock, std::chrono::milliseconds(reporterPeriodMs));
+    if (reporterStop)
+      break;
+    dumpStats(*reporterOut);
+    reporterOut->flush();
+  }
+}
+
+PageGuard::PageGuard()
+  : bufMgr(NULL), pageNumber(Page::INVALID_NUMBER), frame(0), pagePtr(NULL), dirty(false),
+    latched(LATCH_NONE), version(0)
+{
+}
+
+PageGuard::PageGuard(BufMgr* bufMgrIn, const PageId pageNo, const FrameId frameNo, Page* page)
+  : bufMgr(bufMgrIn), pageNumber(pageNo), frame(frameNo), pagePtr(page), dirty(false),
+    latched(LATCH_NONE), version(0)
+{
+}
+
+PageGuard::PageGuard(PageGuard&& other)
+  : bufMgr(other.bufMgr), pageNumber(other.pageNumber), frame(other.frame),
+    pagePtr(other.pagePtr), dirty(other.dirty), latched(other.latched), version(other.version)
+{
+  other.pagePtr = NULL;
+  other.dirty = false;
+  other.latched = LATCH_NONE;
+}
+
+PageGuard& PageGuard::operator=(PageGuard&& other)
+{
+  if (this != &other)
+  {
+    release();
+    bufMgr = other.bufMgr;
+    pageNumber = other.pageNumber;
+    frame = other.frame;
+    pagePtr = other.pagePtr;
+    dirty = other.dirty;
+    latched = other.latched;
+    version = other.version;
+    other.pagePtr = NULL;
+    other.dirty = false;
+    other.latched = LATCH_NONE;
+  }
+  return *this;
+}
+
+PageGuard::~PageGuard()
+{
+  release();
+}
+
+void PageGuard::latch(const LatchMode mode)
+{
+  if (pagePtr == NULL)
+    return;
+  unlatch();
+  // the pages of a mapped file never change, so they need no latch
+  if (bufMgr != NULL)
+    bufMgr->latchGuarded(frame, mode, version);
+  latched = mode;
+}
+
+void PageGuard::unlatch()
+{
+  if (pagePtr == NULL)
+    return;
+  if (bufMgr != NULL)
+    bufMgr->unlatchGuarded(frame, latched);
+  latched = LATCH_NONE;
+}
+
+bool PageGuard::validate() const
+{
+  return latched != LATCH_OPTIMISTIC || bufMgr == NULL || bufMgr->checkGuarded(frame, version, false);
+}
+
+bool PageGuard::upgrade()
+{
+  if (latched != LATCH_OPTIMISTIC || (bufMgr != NULL && !bufMgr->checkGuarded(frame, version, true)))
+    return latched == LATCH_EXCLUSIVE;
+  latched = LATCH_EXCLUSIVE;
+  return true;
+}
+
+void PageGuard::release()
+{
+  if (pagePtr == NULL)
+    return;
+  unlatch();
+  if (bufMgr != NULL)
+    bufMgr->unpinGuarded(frame, dirty);
+  pagePtr = NULL;
+  dirty = false;
+}
+
 }
@@ -9,7 +9,22 @@
 
 #include "file.h"
 #include "bufHashTbl.h"
+#include "replacer.h"
+#include "histogram.h"
+#include "compressed_tier.h"
+#include "trace.h"
+#include "latch.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace badgerdb {
 
@@ -18,23 +33,44 @@ namespace badgerdb {
 */
 class BufMgr;
 
+struct FileCounters;
+
 /**
 * @brief Class for maintaining information about buffer pool frames
+*
+* The fields that other threads read without holding the frame are atomic. A
+* thread that wants to reuse or drop a frame first claims it by raising its pin
+* count from 0 to CLAIMED; the claim fails while the page is pinned, and a pin
+* taken while the frame is claimed makes the claimer back off.
+*
+* The pin count only keeps the page in the frame; threads sharing a page
+* coordinate reading and changing it through the latch of the frame.
 */
 class BufDesc {
 
 	friend class BufMgr;
+	friend class Replacer;
 
  private:
 	/**
+	 * Added to the pin count of a frame claimed for replacement or removal
+	 */
+	enum { CLAIMED = 1 << 20 };
+
+	/**
    * Pointer to file to which corresponding frame is assigned
 	 */
-  File* file;
+  std::atomic<File*> file;
+
+	/**
+   * Request counters of the file, set along with file
+	 */
+  std::atomic<FileCounters*> counters;
 
 	/**
    * Page within file to which corresponding frame is assigned
 	 */
-  PageId pageNo;
+  std::atomic<PageId> pageNo;
 
 	/**
    * Frame number of the frame, in the buffer pool, being used
@@ -42,36 +78,64 @@ class BufDesc {
   FrameId	frameNo;
 
 	/**
-   * Number of times this page has been pinned
+   * Number of times this page has been pinned, plus CLAIMED while claimed
 	 */
-  int pinCnt;
+  std::atomic<int> pinCnt;
 
 	/**
    * True if page is dirty;  false otherwise
 	 */
-  bool dirty;
+  std::atomic<bool> dirty;
 
 	/**
    * True if page is valid
 	 */
-  bool valid;
+  std::atomic<bool> valid;
 
 	/**
    * Has this buffer frame been reference recently
 	 */
-  bool refbit;
+  std::atomic<bool> refbit;
 
 	/**
-   * Initialize buffer frame for a new user
+   * True while the page is being read from disk into the frame
 	 */
-  void Clear()
+  std::atomic<bool> loading;
+
+	/**
+   * Latch over the contents of the page, taken by PageGuard::latch(); it is
+   * only held while the page is pinned, so it outlives the pages of the frame
+	 */
+  FrameLatch latch;
+
+	/**
+   * True if BufMgr::resize() took the frame out of the pool, in which case it
+   * stays claimed until the pool grows again
+	 */
+  bool retired;
+
+	/**
+   * Initialize buffer frame for a new user, leaving the pin count alone
+	 */
+  void Reset()
 	{
-    pinCnt = 0;
 		file = NULL;
+		counters = NULL;
 		pageNo = Page::INVALID_NUMBER;
+		valid = false;
     dirty = false;
     refbit = false;
-		valid = false;
+		loading = false;
+  }
+
+	/**
+   * Initialize buffer frame for a new user. The pin count is reset last, so a
+   * frame that can be claimed is always fully cleared.
+	 */
+  void Clear()
+	{
+		Reset();
+    pinCnt = 0;
   };
 
 	/**
@@ -85,17 +149,18 @@ class BufDesc {
 	{ 
 		file = filePtr;
     pageNo = pageNum;
-    pinCnt = 1;
     dirty = false;
-    valid = true;
     refbit = true;
+    valid = true;
+    pinCnt = 1;
   }
 
   void Print()
 	{
-		if(file != NULL)
+		File* f = file;
+		if(f != NULL)
 		{
-			std::cout << "file:" << file->filename() << " ";
+			std::cout << "file:" << f->filename() << " ";
 			std::cout << "pageNo:" << pageNo << " ";
 		}
 		else
@@ -113,36 +178,158 @@ class BufDesc {
   BufDesc()
 	{
   	Clear();
+		retired = false;
   }
 };
 
 
 /**
 * @brief Class to maintain statistics of buffer usage 
+*
+* Latencies are in nanoseconds.
 */
 struct BufStats
 {
 	/**
-   * Total number of accesses to buffer pool
+   * Total number of accesses to buffer pool, that is of calls to readPage()
+   * and allocPage()
 	 */
-  int accesses;
+  std::atomic<int> accesses;
+
+	/**
+   * Number of page requests satisfied from the buffer pool
+	 */
+  std::atomic<int> hits;
+
+	/**
+   * Number of page requests that read the page from disk
+	 */
+  std::atomic<int> misses;
 
 	/**
    * Number of pages read from disk (including allocs)
 	 */
-  int diskreads;
+  std::atomic<int> diskreads;
 
 	/**
    * Number of pages written back to disk
 	 */
-  int diskwrites;
+  std::atomic<int> diskwrites;
+
+	/**
+   * Number of dirty pages written back by the thread that needed their frame
+	 */
+  std::atomic<int> fgwrites;
+
+	/**
+   * Number of dirty pages written back ahead of replacement by the
+   * background writer
+	 */
+  std::atomic<int> bgwrites;
+
+	/**
+   * Number of pages read from disk by prefetch() ahead of a request
+	 */
+  std::atomic<int> prefetches;
+
+	/**
+   * Number of pages read into the pool from the compressed tier rather than
+   * from disk
+	 */
+  std::atomic<int> tierHits;
+
+	/**
+   * Number of pages of mapped files handed out from their mapping, which
+   * count as neither hits nor misses
+	 */
+  std::atomic<int> mappedReads;
+
+	/**
+   * Number of pages replaced without being written back
+	 */
+  std::atomic<int> cleanEvictions;
+
+	/**
+   * Number of pages replaced after being written back by the replacing thread
+	 */
+  std::atomic<int> dirtyEvictions;
+
+	/**
+   * Number of dirty pages the replacing thread passed over for a clean one,
+   * see BufMgr::setCleanLookahead()
+	 */
+  std::atomic<int> dirtySkips;
+
+	/**
+   * Number of times a PageGuard waited for another one to let go of the
+   * latch of its page
+	 */
+  std::atomic<int> latchWaits;
+
+	/**
+   * Number of optimistic reads through a PageGuard found invalid, because
+   * another guard latched the page exclusively meanwhile
+	 */
+  std::atomic<int> latchRestarts;
+
+	/**
+   * Time a page request spent waiting for another thread to finish reading
+   * or writing out the page, counted only for requests that had to wait
+	 */
+  Histogram pinWait;
+
+	/**
+   * Number of frames the replacement policy looked at to find a victim
+	 */
+  Histogram scanLength;
+
+	/**
+   * Time taken by each read from disk, of one page or of a batch of pages
+	 */
+  Histogram readLatency;
+
+	/**
+   * Time taken by each write to disk of one file's pages
+	 */
+  Histogram writeLatency;
+
+	/**
+   * Time taken to decompress a page from the compressed tier
+	 */
+  Histogram tierLatency;
+
+	/**
+   * Time a request spent writing back a dirty page, and the dirty pages next
+   * to it, before it could replace the page
+	 */
+  Histogram writeStall;
 
 	/**
    * Clear all values 
 	 */
   void clear()
   {
-		accesses = diskreads = diskwrites = 0;
+		accesses = 0;
+		hits = 0;
+		misses = 0;
+		diskreads = 0;
+		diskwrites = 0;
+		fgwrites = 0;
+		bgwrites = 0;
+		prefetches = 0;
+		tierHits = 0;
+		mappedReads = 0;
+		cleanEvictions = 0;
+		dirtyEvictions = 0;
+		dirtySkips = 0;
+		latchWaits = 0;
+		latchRestarts = 0;
+		pinWait.clear();
+		scanLength.clear();
+		readLatency.clear();
+		writeLatency.clear();
+		tierLatency.clear();
+		writeStall.clear();
   }
       
 	/**
@@ -155,21 +342,265 @@ struct BufStats
 };
 
 
+/**
+* @brief Page requests of one file, see BufMgr::getFileStats()
+*/
+struct FileStats
+{
+	/**
+   * Number of page requests satisfied from the buffer pool
+	 */
+  std::uint64_t hits;
+
+	/**
+   * Number of page requests that read the page from disk
+	 */
+  std::uint64_t misses;
+
+	/**
+   * Constructor of FileStats class 
+	 */
+  FileStats() : hits(0), misses(0) {}
+};
+
+
+/**
+* @brief Page requests of one file while it is read through a buffer pool.
+* The frames holding pages of the file point to them, so that a hit is
+* counted without a latch.
+*/
+struct FileCounters
+{
+	/**
+   * Name of the file
+	 */
+  std::string name;
+
+	/**
+   * Number of page requests satisfied from the buffer pool
+	 */
+  std::atomic<std::uint64_t> hits;
+
+	/**
+   * Number of page requests that read the page from disk
+	 */
+  std::atomic<std::uint64_t> misses;
+
+	/**
+   * Constructor of FileCounters class 
+	 */
+  explicit FileCounters(const std::string& fileName) : name(fileName), hits(0), misses(0) {}
+};
+
+
+/**
+* @brief How a caller is going to use the pages it asks for. Passed to
+* BufMgr::readPage(), allocPage() and prefetch().
+*
+* Pages read or allocated with a strategy other than ACCESS_NORMAL go into a
+* small ring of frames private to the File object and the strategy; once the
+* ring is full, each new page takes the frame of the oldest page in the ring
+* rather than a frame from the replacement policy, so that a large scan or
+* load evicts only its own pages. A page in the ring that some other request
+* used meanwhile is left to the pool. These requests also leave the reference
+* bit of the pages alone. The ring is given up by flushFile().
+*/
+enum AccessStrategy
+{
+	ACCESS_NORMAL,			/* Pages compete for the whole pool */
+	ACCESS_SEQUENTIAL,	/* Pages are read once, in order, as by a FileScan */
+	ACCESS_BULK_WRITE		/* Pages are written once, as by a bulk load; the ring is larger */
+};
+
+
+/**
+* @brief A pin on a page in the buffer pool, returned by the BufMgr::readPage()
+* and allocPage() overloads that do not take a page reference.
+*
+* The guard remembers the frame holding the page, so that dropping the pin
+* needs no lookup in the hash table: the page is unpinned when the guard is
+* destroyed or released, and written back later if markDirty() was called.
+* Guards can be moved but not copied; a default constructed or moved-from
+* guard holds no page. The page must not be disposed while a guard holds it.
+*
+* A guard may also latch its page, so that guards of several threads on the
+* same page read and change it in turn: shared for reading, exclusive for
+* writing, or optimistic, which reads without keeping writers out and tells
+* afterwards through validate() whether one came in meanwhile. An optimistic
+* reader must expect to see the page half changed, and rely on nothing it
+* read before validate() succeeds. Latches are dropped along with the pin;
+* pages pinned without a guard are not latched.
+*
+* A guard on a page of a mapped file holds no pin and needs no latch, as the
+* page lies in the mapping and never changes; it must not be marked dirty.
+*/
+class PageGuard
+{
+	friend class BufMgr;
+
+ public:
+	/**
+   * Constructor of an empty PageGuard
+	 */
+  PageGuard();
+
+	/**
+   * Takes over the pin of another guard, leaving that one empty
+	 */
+  PageGuard(PageGuard&& other);
+
+	/**
+   * Unpins the page held, if any, and takes over the pin of another guard
+	 */
+  PageGuard& operator=(PageGuard&& other);
+
+	/**
+   * Destructor of PageGuard class, unpins the page held, if any
+	 */
+  ~PageGuard();
+
+	/**
+   * Returns the page held, NULL if the guard is empty
+	 */
+  Page* page() const { return pagePtr; }
+
+  Page* operator->() const { return pagePtr; }
+
+  Page& operator*() const { return *pagePtr; }
+
+	/**
+   * Returns the number of the page held in its file
+	 */
+  PageId pageNo() const { return pageNumber; }
+
+	/**
+   * Returns true if the guard holds no page
+	 */
+  bool empty() const { return pagePtr == NULL; }
+
+	/**
+   * Marks the page held dirty, so that it is written back once unpinned
+	 */
+  void markDirty() { dirty = true; }
+
+	/**
+   * Unpins the page held before the guard is destroyed, leaving it empty.
+   * Does nothing if the guard is empty.
+	 */
+  void release();
+
+	/**
+   * Latches the page held, after dropping the latch held before, if any.
+   * Waits while another guard holds the page exclusively, and for an
+   * exclusive latch also while others hold it shared. Does nothing if the
+   * guard is empty.
+   *
+   * @param mode		How to latch the page
+	 */
+  void latch(const LatchMode mode);
+
+	/**
+   * Drops the latch held, keeping the pin.
+	 */
+  void unlatch();
+
+	/**
+   * Returns how the page held is latched
+	 */
+  LatchMode latchMode() const { return latched; }
+
+	/**
+   * Returns true if what was read of the page since it was latched
+   * optimistically is consistent, that is if no guard latched it exclusively
+   * meanwhile. Always true in the other modes.
+	 */
+  bool validate() const;
+
+	/**
+   * Turns an optimistic latch into an exclusive one, if no guard latched the
+   * page exclusively since. Otherwise the guard stays latched optimistically,
+   * never to validate again, and the caller starts over.
+   *
+   * @return				True if the page is now latched exclusively
+	 */
+  bool upgrade();
+
+ private:
+  PageGuard(BufMgr* bufMgr, const PageId pageNo, const FrameId frame, Page* page);
+
+  PageGuard(const PageGuard&);
+  PageGuard& operator=(const PageGuard&);
+
+	/**
+   * Buffer manager the page is pinned in
+	 */
+  BufMgr* bufMgr;
+
+	/**
+   * Number of the page held
+	 */
+  PageId pageNumber;
+
+	/**
+   * Frame holding the page
+	 */
+  FrameId frame;
+
+	/**
+   * Page held, NULL if the guard is empty
+	 */
+  Page* pagePtr;
+
+	/**
+   * True if the page is to be unpinned dirty
+	 */
+  bool dirty;
+
+	/**
+   * Latch held on the page
+	 */
+  LatchMode latched;
+
+	/**
+   * Version of the page read under an optimistic latch
+	 */
+  std::uint64_t version;
+};
+
+
 /**
 * @brief The central class which manages the buffer pool including frame allocation and deallocation to pages in the file 
+*
+* readPage, unPinPage and allocPage may be called from several threads at once.
+* flushFile and disposePage must not race with other calls on the same file.
+* resize may be called at any time; other calls wait for it to finish.
+*
+* Files opened with BACKEND_MMAP bypass the pool: readPage hands out their
+* pages where they lie in the mapping, without pinning them, unPinPage does
+* nothing for them, and prefetch asks the operating system to read them in.
+* Such files are read only, so allocPage, disposePage and unPinPage with
+* dirty set throw FileIOException.
 */
 class BufMgr 
 {
+	friend class PageGuard;
+
  private:
 	/**
-   * Current position of clockhand in our buffer pool
+   * Number of frames in the buffer pool
 	 */
-  FrameId clockHand;
+  std::atomic<std::uint32_t> numBufs;
 
 	/**
-   * Number of frames in the buffer pool
+   * Frame numbers in use are below numFrames; the frames retired by resize()
+   * among them are not counted in numBufs
+	 */
+  std::uint32_t numFrames;
+
+	/**
+   * Number of frames the address space reserved for the pool can hold
 	 */
-  std::uint32_t numBufs;
+  std::uint32_t maxFrames;
 	
 	/**
    * Hash table mapping (File, page) to frame
@@ -187,108 +618,905 @@ class BufMgr
   BufStats bufStats;
 
 	/**
-   * Advance clock to next frame in the buffer pool
+   * Replacement policy choosing the frames to reuse
 	 */
-  void advanceClock()
-  {
-		clockHand = (clockHand + 1) % numBufs;
-  }
+  Replacer *replacer;
 
 	/**
-	 * Allocate a free frame.  
-	 *
-	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
-	 * @throws BufferExceededException If no such buffer is found which can be allocated
+	 * Most frames in the ring of ACCESS_SEQUENTIAL and of ACCESS_BULK_WRITE
 	 */
-  void allocBuf(FrameId & frame);
+	static const std::size_t SEQUENTIAL_RING = 32;
+	static const std::size_t BULK_WRITE_RING = 256;
 
- public:
 	/**
-   * Actual buffer pool from which frames are allocated
+	 * Frames recycled by the requests of a File object with one strategy.
+	 * frames[next] holds the oldest page; numFrames marks a slot not filled yet.
 	 */
-  Page* bufPool;
+	struct Ring
+	{
+		std::mutex latch;
+		std::vector<FrameId> frames;
+		std::size_t next;
+	};
 
 	/**
-   * Constructor of BufMgr class
+	 * Rings by File object and strategy
 	 */
-  BufMgr(std::uint32_t bufs);
-	
+	std::map<std::pair<const File*, AccessStrategy>, Ring*> rings;
+	std::mutex ringsLatch;
+
 	/**
-   * Destructor of BufMgr class
+	 * Returns the ring of a File object and strategy, creating it if needed.
 	 */
-  ~BufMgr();
+	Ring* ringOf(const File* file, const AccessStrategy strategy);
 
 	/**
-	 * Reads the given page from the file into a frame and returns the pointer to page.
-	 * If the requested page is already present in the buffer pool pointer to that frame is returned
-	 * otherwise a new frame is allocated from the buffer pool for reading the page.
+	 * Deletes the rings of a File object.
+	 */
+	void dropRings(const File* file);
+
+	/**
+	 * Takes back the frame in a slot of a ring, if it still holds a page of
+	 * the file that nobody has pinned or referenced since it was read.
 	 *
-	 * @param file   	File object
-	 * @param PageNo  Page number in the file to be read
-	 * @param page  	Reference to page pointer. Used to fetch the Page object in which requested page from file is read in.
+	 * @param file   	File the ring belongs to
+	 * @param frame   	Frame in the slot; returned claimed and cleared on success
+	 * @return				False if the frame must be left to the pool
 	 */
-  void readPage(File* file, const PageId PageNo, Page*& page);
+  bool recycleRingFrame(const File* file, const FrameId frame);
 
 	/**
-	 * Unpin a page from memory since it is no longer required for it to remain in memory.
+	 * Allocate a free frame. The frame is returned cleared and claimed, so no
+	 * other thread uses it until the caller sets its pin count.
 	 *
-	 * @param file   	File object
-	 * @param PageNo  Page number
-	 * @param dirty		True if the page to be unpinned needs to be marked dirty	
-   * @throws  PageNotPinnedException If the page is not already pinned
+	 * @param file   	File of the page the frame is for
+	 * @param pageNo  Page number of the page the frame is for, or Page::INVALID_NUMBER if not yet known
+	 * @param frame   	Frame reference, frame ID of allocated frame returned via this variable
+	 * @param strategy	Strategy of the request, which decides whether the frame comes from a ring
+	 * @param ringOnly	True if a request with a strategy may not take a frame from the
+	 * 								pool once its ring is full
+	 * @throws BufferExceededException If no such buffer is found which can be allocated,
+	 * 								or if ringOnly is set and every frame of the ring is pinned
 	 */
-  void unPinPage(File* file, const PageId PageNo, const bool dirty);
+  void allocBuf(const File* file, const PageId pageNo, FrameId & frame,
+								const AccessStrategy strategy = ACCESS_NORMAL, const bool ringOnly = false);
 
 	/**
-	 * Allocates a new, empty page in the file and returns the Page object.
-	 * The newly allocated page is also assigned a frame in the buffer pool.
+	 * Writes back the page of a claimed frame if it is dirty and takes it out
+	 * of the hash table. If the page gets pinned meanwhile it is given back to
+	 * the replacement policy instead, and the claim dropped.
 	 *
-	 * @param file   	File object
-	 * @param PageNo  Page number. The number assigned to the page in the file is returned via this reference.
-	 * @param page  	Reference to page pointer. The newly allocated in-memory Page object is returned via this reference.
+	 * @param frame   	Claimed frame holding a page
+	 * @param keep			Whether to keep a copy of the page in the compressed tier
+	 * @return				True if the frame was cleared and is still claimed
 	 */
-  void allocPage(File* file, PageId &PageNo, Page*& page); 
+  bool evictFrame(const FrameId frame, const bool keep);
 
 	/**
-	 * Writes out all dirty pages of the file to disk.
-	 * All the frames assigned to the file need to be unpinned from buffer pool before this function can be successfully called.
-	 * Otherwise Error returned.
+	 * Reads a page from the compressed tier into the frame being loaded, for
+	 * loadPage() and loadPages().
 	 *
-	 * @param file   	File object
-   * @throws  PagePinnedException If any page of the file is pinned in the buffer pool 
-   * @throws BadBufferException If any frame allocated to the file is found to be invalid
+	 * @return				False if the tier does not hold the page
 	 */
-  void flushFile(const File* file);
+	bool loadFromTier(File* file, const PageId pageNo, const FrameId frame);
 
 	/**
-	 * Delete page from file and also from buffer pool if present.
-	 * Since the page is entirely deleted from file, its unnecessary to see if the page is dirty.
+	 * Reads a page that was not in the buffer pool into a new frame.
 	 *
 	 * @param file   	File object
-	 * @param PageNo  Page number
+	 * @param pageNo  Page number in the file
+	 * @param frame   	Frame reference, frame holding the page returned via this variable
+	 * @return				False if another thread read the page in first, true if the page
+	 * 								was read into frame, which is then pinned once
 	 */
-  void disposePage(File* file, const PageId PageNo);
+  bool loadPage(File* file, const PageId pageNo, FrameId & frame, const AccessStrategy strategy);
 
 	/**
-   * Print member variable values. 
+	 * Allocates a frame for a page that is not in the buffer pool and publishes
+	 * it as being read in, so that other threads asking for the page wait.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param frame   	Frame reference, frame for the page returned via this variable
+	 * @param strategy	Strategy of the request
+	 * @param ringOnly	Passed to allocBuf()
+	 * @return				False if another thread read the page in first, true if the frame
+	 * 								is pinned once and must be passed to finishLoad()
 	 */
-  void  printSelf();
+  bool beginLoad(File* file, const PageId pageNo, FrameId & frame, const AccessStrategy strategy,
+								 const bool ringOnly = false);
 
 	/**
-   * Get buffer pool usage statistics
+	 * Completes beginLoad() once the page has been read into the frame, or
+	 * gives the frame back if the read failed.
+	 *
+	 * @param read		True if the page was read into the frame
 	 */
-  BufStats & getBufStats()
-  {
-		return bufStats;
-  }
+  void finishLoad(File* file, const PageId pageNo, const FrameId frame, const bool read);
+
+	/**
+	 * Reads those of several pages that are not in the buffer pool, all at
+	 * once, into new frames; stops early when the pool runs out of frames,
+	 * or, for a strategy other than ACCESS_NORMAL, when every frame of the
+	 * ring is pinned: the pages read ahead must not push the pages of other
+	 * requests out of the pool.
+	 *
+	 * @param file   	File object
+	 * @param pageNos Page numbers in the file
+	 * @param frames  Set to the frames read into, each pinned once
+	 * @param strategy	Strategy of the request
+	 * @throws BufferExceededException If no page could be given a frame
+	 */
+  void loadPages(File* file, const std::vector<PageId>& pageNos, std::vector<FrameId>& frames,
+								 const AccessStrategy strategy);
+
+	/**
+	 * Writes the pages of frames that the caller keeps from changing hands,
+	 * grouped by file and in page order, each file's pages all at once. The
+	 * pages of a file whose write fails are marked dirty again.
+	 *
+	 * @param frames  Frames to write
+	 */
+  void writeFrames(std::vector<FrameId>& frames);
+
+	/**
+	 * Claims the resident, dirty and unpinned pages right before and after a
+	 * page, up to the first page that is not, and marks them clean so that
+	 * they can be written along with it.  At most WRITEBACK_CLUSTER frames, and
+	 * no more than a quarter of the pool, end up in frames.
+	 *
+	 * @param file    File of the page
+	 * @param pageNo  Page whose neighbours to claim
+	 * @param frames  Frames to append the claimed frames to
+	 */
+  void claimDirtyNeighbours(File* file, const PageId pageNo, std::vector<FrameId>& frames);
+
+	/**
+	 * Pins a page if it is in the buffer pool, waiting for it to be read in if
+	 * another thread is still reading it.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param frame   	Frame reference, frame holding the page returned via this variable
+	 * @param reference	True to set the reference bit of the frame
+	 * @return				False if the page is not in the buffer pool
+	 */
+  bool pinResident(File* file, const PageId pageNo, FrameId & frame, const bool reference = true);
+
+	/**
+	 * Looks up the page after a page in its file in the header of the page, if
+	 * the page is in the buffer pool and not being read in. Nothing is read
+	 * from disk and the replacement policy is not told of the lookup.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param nextPageNo	Set to the page after it, or Page::INVALID_NUMBER if it is the last
+	 * @return				False if the page is not in the buffer pool
+	 */
+  bool peekNextPage(File* file, const PageId pageNo, PageId& nextPageNo);
+
+	/**
+	 * Pins a page, reading it into the buffer pool if it is not there, and
+	 * counts the request; readPage() without the gate, which the caller holds.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param strategy	How the caller is going to use the page
+	 * @return				Frame holding the page, pinned once
+	 */
+  FrameId pinPage(File* file, const PageId pageNo, const AccessStrategy strategy);
+
+	/**
+	 * Drops one pin of a frame, if it has any.
+	 *
+	 * @return				False if the frame was not pinned
+	 */
+  bool unpinFrame(const FrameId frame);
+
+	/**
+	 * Unpins the frame held by a PageGuard.
+	 *
+	 * @param frame   	Frame holding the page
+	 * @param dirty		True if the page needs to be marked dirty
+	 */
+  void unpinGuarded(const FrameId frame, const bool dirty);
+
+	/**
+	 * Latches the frame held by a PageGuard, see PageGuard::latch().
+	 *
+	 * @param frame   	Frame holding the page
+	 * @param mode		How to latch it, other than LATCH_NONE
+	 * @param version	Set to the version of the page for LATCH_OPTIMISTIC
+	 */
+  void latchGuarded(const FrameId frame, const LatchMode mode, std::uint64_t & version);
+
+	/**
+	 * Drops the latch of a PageGuard on a frame.
+	 */
+  void unlatchGuarded(const FrameId frame, const LatchMode mode);
+
+	/**
+	 * Validates or upgrades an optimistic latch of a PageGuard, counting
+	 * the ones that fail.
+	 *
+	 * @param upgrade	True to turn the latch into an exclusive one
+	 * @return				False if the page was latched exclusively since version
+	 */
+  bool checkGuarded(const FrameId frame, const std::uint64_t version, const bool upgrade);
+
+	/**
+	 * Waits until no other thread has the frame claimed.
+	 */
+  void waitUnclaimed(const FrameId frame);
+
+	/**
+	 * Clears a frame that is no longer in the hash table and gives it back to
+	 * the replacement policy.
+	 */
+  void releaseBuf(const FrameId frame);
+
+	/**
+	 * Number of threads reading pages for prefetch()
+	 */
+	static const int PREFETCH_THREADS = 2;
+
+	/**
+	 * Most pages a prefetch thread reads at once
+	 */
+	static const std::size_t PREFETCH_BATCH = 16;
+
+	/**
+	 * A page waiting to be prefetched
+	 */
+	struct PrefetchRequest
+	{
+		File* file;
+		PageId pageNo;
+		AccessStrategy strategy;
+		bool reference;		/* False to read the page in with its reference bit clear */
+		std::uint32_t follow;	/* Pages after this one to prefetch as well, named by its header once read */
+	};
+
+	/**
+	 * Pages waiting to be prefetched, oldest first
+	 */
+  std::deque<PrefetchRequest> prefetchQueue;
+
+	/**
+	 * File each prefetch thread is reading from, or NULL when it is idle
+	 */
+  std::vector<const File*> prefetchActive;
+
+	/**
+	 * Prefetch threads, started by the first call to prefetch()
+	 */
+  std::vector<std::thread> prefetchThreads;
+
+	/**
+	 * Protects the prefetch queue and activity; prefetchWork is signalled
+	 * when pages are queued, prefetchDone when a thread finishes a page
+	 */
+  std::mutex prefetchLatch;
+  std::condition_variable prefetchWork;
+  std::condition_variable prefetchDone;
+
+	/**
+	 * Set when the prefetch threads must exit
+	 */
+  bool prefetchStop;
+
+	/**
+	 * Pause between rounds of the background writer, in milliseconds
+	 */
+	static const int BGWRITER_DELAY_MS = 10;
+
+	/**
+	 * Most pages the background writer writes in one round
+	 */
+	static const int BGWRITER_MAX_PAGES = 32;
+
+	/**
+	 * Most pages written at once when a dirty page is evicted
+	 */
+	static const std::size_t WRITEBACK_CLUSTER = 16;
+
+	/**
+	 * Background writer, which writes back dirty, unpinned pages that the
+	 * replacement policy will reach soon, so that replacing them needs no
+	 * write
+	 */
+  std::thread writerThread;
+
+	/**
+	 * Protects writerStop; writerWake is signalled to start a round early
+	 */
+  std::mutex writerLatch;
+  std::condition_variable writerWake;
+
+	/**
+	 * Held by the background writer for the length of a round
+	 */
+  std::mutex writerRound;
+
+	/**
+	 * Number of evictions writing dirty neighbours, whose frames they hold
+	 * claimed meanwhile
+	 */
+  std::atomic<int> clusterWrites;
+
+	/**
+	 * Set when the background writer must exit
+	 */
+  bool writerStop;
+
+	/**
+	 * Most dirty pages allocBuf() passes over looking for a clean one, see
+	 * setCleanLookahead()
+	 */
+  std::atomic<std::uint32_t> cleanLookahead;
+
+	/**
+	 * Frames of the dirty pages allocBuf() passed over, for the background
+	 * writer to write back on its next round; protected by writerLatch
+	 */
+  std::vector<FrameId> writebackQueue;
+
+	/**
+	 * Body of the background writer.
+	 */
+  void writerLoop();
+
+	/**
+	 * Writes back dirty, unpinned pages among the next numBufs / 4 frames the
+	 * replacement policy will consider, at most BGWRITER_MAX_PAGES of them.
+	 */
+  void cleanAhead();
+
+	/**
+	 * Writes back the dirty, unpinned pages of some frames, at most limit of
+	 * them, for the background writer.
+	 */
+  void cleanFrames(const std::vector<FrameId>& frames, const std::size_t limit);
+
+	/**
+	 * Queues the frames of dirty pages the replacement policy passed over in
+	 * allocBuf() for the background writer, if there is one.
+	 */
+  void deferWriteback(const std::vector<FrameId>& frames);
+
+	/**
+	 * Number of counters of the gate that resize() closes, each padded to a
+	 * cache line of its own
+	 */
+	static const int GATE_SLOTS = 16;
+
+	struct GateSlot
+	{
+		std::atomic<int> count;
+		char pad[64 - sizeof(std::atomic<int>)];
+	};
+
+	/**
+	 * Number of calls in progress that use the frames, counted in the slot of
+	 * the calling thread so that threads seldom share a counter
+	 */
+	GateSlot gate[GATE_SLOTS];
+
+	/**
+	 * Set while resize() waits for the calls in progress and changes the
+	 * pool; calls starting meanwhile wait for it to be cleared
+	 */
+	std::atomic<bool> resizing;
+
+	/**
+	 * Serializes calls of resize(), startTrace(), stopTrace() and
+	 * enableCompressedTier()
+	 */
+	std::mutex resizeLatch;
+
+	/**
+	 * Keeps resize() out for the lifetime of the object. Every public call
+	 * that uses the frames or the hash table, and every round of the
+	 * background threads, holds one; a call that holds one must not wait for
+	 * a thread that has yet to take its own.
+	 */
+	class GateGuard
+	{
+	 public:
+		explicit GateGuard(BufMgr* bufMgr);
+		~GateGuard();
+
+	 private:
+		GateGuard(const GateGuard&);
+		GateGuard& operator=(const GateGuard&);
+
+		GateSlot& slot;
+		std::atomic<bool>& resizing;
+	};
+
+	/**
+	 * Sets resizing and waits for the calls in progress to leave the gate.
+	 * The caller holds resizeLatch and clears resizing when done.
+	 */
+	void closeGate();
+
+	/**
+	 * Frees the frames of the pool above newBufs, for resize(). Fails without
+	 * changing the pool if fewer than numBufs - newBufs frames are unpinned.
+	 */
+	void shrink(const std::uint32_t newBufs);
+
+	/**
+	 * Adds frames to the pool up to newBufs, for resize(), first in the
+	 * holes left by shrink().
+	 */
+	void grow(const std::uint32_t newBufs);
+
+	/**
+	 * Request counters of the files read through the pool, created when the
+	 * first page of a file is read in; protected by fileStatsLatch
+	 */
+	std::unordered_map<const File*, FileCounters*> fileStats;
+
+	/**
+	 * Statistics of files that have been flushed, by name; a File object
+	 * may be destroyed once its file is flushed and its address reused.
+	 * Protected by fileStatsLatch.
+	 */
+	std::map<std::string, FileStats> retiredFileStats;
+	std::mutex fileStatsLatch;
+
+	/**
+	 * Returns the request counters of a file, creating them if needed.
+	 *
+	 * @param file   	File object
+	 */
+	FileCounters* fileCounters(const File* file);
+
+	/**
+	 * Counts a page request on the file of the page in a frame.
+	 *
+	 * @param frame		Frame holding the page, pinned
+	 * @param hit			True if the page was in the buffer pool
+	 */
+	void countRequest(const FrameId frame, const bool hit);
+
+	/**
+	 * Moves the request counters of a file to retiredFileStats, once no frame
+	 * holds a page of it.
+	 */
+	void retireFileStats(const File* file);
+
+	/**
+	 * Stream the statistics reporter writes to
+	 */
+	std::ostream* reporterOut;
+
+	/**
+	 * Pause between two reports, in milliseconds
+	 */
+	int reporterPeriodMs;
+
+	/**
+	 * Statistics reporter, started by startStatsReporter()
+	 */
+	std::thread reporterThread;
+
+	/**
+	 * Protects reporterStop; reporterWake is signalled to stop the reporter
+	 */
+	std::mutex reporterLatch;
+	std::condition_variable reporterWake;
+
+	/**
+	 * Set when the statistics reporter must exit
+	 */
+	bool reporterStop;
+
+	/**
+	 * Body of the statistics reporter.
+	 */
+	void reporterLoop();
+
+	/**
+	 * Recorder of the trace started by startTrace(), NULL if none is
+	 */
+	std::atomic<TraceRecorder*> tracer;
+
+	/**
+	 * Records a request in the trace, if one is being recorded.
+	 */
+	void traceRequest(const File* file, const PageId pageNo, const TraceOp op, const bool hit)
+	{
+		TraceRecorder* recorder = tracer.load(std::memory_order_acquire);
+		if (recorder != NULL)
+			recorder->record(file->filename(), pageNo, op, hit);
+	}
+
+	/**
+	 * Second tier of the pool, NULL unless enableCompressedTier() was called
+	 */
+	CompressedTier* tier;
+
+	/**
+	 * Body of a prefetch thread.
+	 *
+	 * @param id			Index of the thread in prefetchActive
+	 */
+  void prefetchLoop(const int id);
+
+	/**
+	 * Drops the queued prefetches of a file and waits for the ones being read.
+	 *
+	 * @param file   	File object
+	 */
+  void cancelPrefetch(const File* file);
+
+	/**
+	 * Queues pages for the prefetch threads, starting them if needed; pages
+	 * already in the pool are skipped.
+	 *
+	 * @param requests	Pages to read, in the order they will be needed
+	 */
+  void queuePrefetch(const std::vector<PrefetchRequest>& requests);
+
+	/**
+	 * Waits until the queued prefetches of a file have been read.
+	 *
+	 * @param file   	File object
+	 */
+  void waitPrefetch(const File* file);
+
+	/**
+	 * First line of a snapshot file, see enableSnapshot()
+	 */
+	static const char* const SNAPSHOT_HEADER;
+
+	/**
+	 * A page listed in a snapshot
+	 */
+	struct SnapshotEntry
+	{
+		std::string fileName;
+		PageId pageNo;
+		bool refbit;
+	};
+
+	/**
+	 * File the destructor writes the snapshot to, empty if enableSnapshot()
+	 * was not called
+	 */
+	std::string snapshotPath;
+
+	/**
+	 * Pages dropped by flushFile() since the snapshot was enabled, oldest
+	 * first; no more than numBufs of them are kept
+	 */
+	std::deque<SnapshotEntry> flushedPages;
+
+	/**
+	 * Pages listed by the snapshot read by enableSnapshot() that prewarm() has
+	 * yet to read, as (reference bit, page number) pairs by file name
+	 */
+	std::map<std::string, std::vector<std::pair<bool, PageId> > > snapshotPages;
+
+	/**
+	 * Protects the snapshot path and pages
+	 */
+	std::mutex snapshotLatch;
+
+	/**
+	 * Writes the snapshot of the pool, from the destructor.
+	 */
+	void writeSnapshot();
+
+ public:
+	/**
+   * Most frames a pool can grow to by resize(), unless it was constructed
+   * with more
+	 */
+  static const std::uint32_t MAX_FRAMES = 1 << 20;
+
+	/**
+   * How many times its initial size a pool can grow to by resize(), unless
+   * the constructor is given another limit
+	 */
+  static const std::uint32_t DEFAULT_GROWTH = 8;
 
 	/**
-   * Clear buffer pool usage statistics
+   * Actual buffer pool from which frames are allocated. Its address space is
+   * reserved for maxFrames frames up front, so that resize() never moves it.
 	 */
-  void clearBufStats() 
+  Page* bufPool;
+
+	/**
+   * Constructor of BufMgr class
+   *
+   * @param bufs   	Number of frames in the buffer pool
+   * @param policy	Replacement policy used to choose the frames to reuse
+   * @param backgroundWriter	True to clean frames ahead of replacement in a background thread
+   * @param maxBufs	Most frames resize() may grow the pool to, at most MAX_FRAMES
+   * 								and at least bufs; 0 for DEFAULT_GROWTH times bufs. Address
+   * 								space for that many frames is reserved up front.
+	 */
+  BufMgr(std::uint32_t bufs, ReplacementPolicy policy = POLICY_CLOCK, bool backgroundWriter = true,
+         std::uint32_t maxBufs = 0);
+	
+	/**
+   * Destructor of BufMgr class
+	 */
+  ~BufMgr();
+
+	/**
+	 * Reads the given page from the file into a frame and returns the pointer to page.
+	 * If the requested page is already present in the buffer pool pointer to that frame is returned
+	 * otherwise a new frame is allocated from the buffer pool for reading the page.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file to be read
+	 * @param page  	Reference to page pointer. Used to fetch the Page object in which requested page from file is read in.
+	 * @param strategy	How the caller is going to use the page
+	 */
+  void readPage(File* file, const PageId PageNo, Page*& page, const AccessStrategy strategy = ACCESS_NORMAL);
+
+	/**
+	 * Reads the given page as readPage() above does, but returns it pinned by a
+	 * PageGuard, which unpins it without looking the page up again.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number in the file to be read
+	 * @param strategy	How the caller is going to use the page
+	 * @return				Guard holding the page
+	 */
+  PageGuard readPage(File* file, const PageId PageNo, const AccessStrategy strategy = ACCESS_NORMAL);
+
+	/**
+	 * Reads several pages of a file as readPage() does, each pinned once and
+	 * unpinned by the caller as usual. Pages in the buffer pool are pinned
+	 * first; the others are read all at once, with each run of adjacent pages
+	 * read by a single read, and the rest of them kept in flight together.
+	 * If any page cannot be read, none of them is left pinned.
+	 *
+	 * @param file   	File object
+	 * @param pageNos Page numbers in the file, in any order
+	 * @param pages  	Set to the pages, pages[i] to page pageNos[i]
+	 * @param count		Number of pages
+	 * @param strategy	How the caller is going to use the pages
+	 */
+  void readPages(File* file, const PageId* pageNos, Page** pages, const std::size_t count,
+								 const AccessStrategy strategy = ACCESS_NORMAL);
+
+	/**
+	 * Asks for pages to be read into the buffer pool in the background, so a
+	 * later readPage() finds them there. The pages are not pinned; pages
+	 * already in the pool, and pages that cannot be read, are skipped. The
+	 * file must stay open until flushFile() has been called for it.
+	 *
+	 * @param file   	File object
+	 * @param pageNos Page numbers in the file, in the order they will be needed
+	 * @param strategy	Strategy the pages will be read with
+	 */
+  void prefetch(File* file, const std::vector<PageId>& pageNos, const AccessStrategy strategy = ACCESS_NORMAL);
+
+	/**
+	 * Asks for the pages that follow a page in its file to be read into the
+	 * buffer pool in the background, like prefetch(). The page numbers are
+	 * taken from the headers of the pages already in the pool and, past them,
+	 * of the pages the prefetch threads read in, so the caller reads nothing
+	 * from disk to learn them. The page itself is read as well if it is not in
+	 * the pool. Pages of a mapped file are left to the operating system.
+	 *
+	 * @param file   	File object
+	 * @param pageNo  Page number in the file
+	 * @param count		Number of pages after it to prefetch
+	 * @param strategy	Strategy the pages will be read with
+	 */
+  void prefetchFollowing(File* file, PageId pageNo, std::uint32_t count,
+                         const AccessStrategy strategy = ACCESS_NORMAL);
+
+	/**
+	 * Unpin a page from memory since it is no longer required for it to remain in memory.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number
+	 * @param dirty		True if the page to be unpinned needs to be marked dirty	
+   * @throws  PageNotPinnedException If the page is not already pinned
+	 */
+  void unPinPage(File* file, const PageId PageNo, const bool dirty);
+
+	/**
+	 * Allocates a new, empty page in the file and returns the Page object.
+	 * The newly allocated page is also assigned a frame in the buffer pool.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number. The number assigned to the page in the file is returned via this reference.
+	 * @param page  	Reference to page pointer. The newly allocated in-memory Page object is returned via this reference.
+	 * @param strategy	How the caller is going to use the page
+	 */
+  void allocPage(File* file, PageId &PageNo, Page*& page, const AccessStrategy strategy = ACCESS_NORMAL); 
+
+	/**
+	 * Allocates a new, empty page in the file as allocPage() above does, but
+	 * returns it pinned by a PageGuard, which gives the number of the page.
+	 *
+	 * @param file   	File object
+	 * @param strategy	How the caller is going to use the page
+	 * @return				Guard holding the page
+	 */
+  PageGuard allocPage(File* file, const AccessStrategy strategy = ACCESS_NORMAL);
+
+	/**
+	 * Writes out all dirty pages of the file to disk.
+	 * All the frames assigned to the file need to be unpinned from buffer pool before this function can be successfully called.
+	 * Otherwise Error returned. Pending prefetches of the file are dropped first.
+	 * Only the frames holding pages of the file are visited, and dirty pages are
+	 * written in page number order.  Unless the file's durability policy is
+	 * DURABILITY_NONE, the file is then synced.  The rings of the file, see
+	 * AccessStrategy, are given up.
+	 *
+	 * @param file   	File object
+   * @throws  PagePinnedException If any page of the file is pinned in the buffer pool 
+   * @throws  FileIOException     If syncing the file fails
+	 */
+  void flushFile(const File* file);
+
+	/**
+	 * Delete page from file and also from buffer pool if present.
+	 * Since the page is entirely deleted from file, its unnecessary to see if the page is dirty.
+	 *
+	 * @param file   	File object
+	 * @param PageNo  Page number
+	 */
+  void disposePage(File* file, const PageId PageNo);
+
+	/**
+	 * Lets the pool be rebuilt after a restart. When the buffer manager is
+	 * destroyed, the pages in the pool and the ones flushFile() dropped
+	 * lately, no more than the pool holds, are listed with their reference
+	 * bits in a small text file at path; the files with pages in the pool must
+	 * still be open then. A list left at path by an earlier buffer manager is
+	 * read now, for prewarm().
+	 *
+	 * @param path   	Name of the snapshot file
+	 */
+  void enableSnapshot(const std::string& path);
+
+	/**
+	 * Reads the pages of a file listed in the snapshot read by
+	 * enableSnapshot() back into the pool, in batches by the prefetch threads,
+	 * and returns once they are in. The pages that were referenced are read
+	 * last, so that the replacement policy keeps them longest, and are the
+	 * ones read if the pool cannot hold them all; each kind is read in page
+	 * order. The pages of a file are only read the first time.
+	 *
+	 * @param file   	File object, matched with the snapshot by name
+	 * @return				Number of pages of the file asked for
+	 */
+  std::size_t prewarm(File* file);
+
+	/**
+	 * Keeps the pages evicted from the pool compressed in memory, in a tier
+	 * of at most budget bytes, and reads a page that is not in the pool from
+	 * there rather than from disk when the tier holds it. Pages that do not
+	 * compress to 3/4 of their size, and those passed over by a read ahead
+	 * ring, are not kept. Replaces the tier there was, dropping its pages.
+	 *
+	 * @param budget		Most bytes of compressed pages to keep; 0 to remove the tier
+	 */
+  void enableCompressedTier(const std::size_t budget);
+
+	/**
+	 * Returns the occupancy of the compressed tier, all zero if there is none.
+	 */
+  TierStats getTierStats();
+
+	/**
+	 * Makes replacement prefer clean pages. Up to frames dirty pages the
+	 * replacement policy would replace are passed over for the next clean one
+	 * in its order, so that the request need not wait for a write; only past
+	 * that, or if no clean page is left, is a dirty page written back and
+	 * replaced. The pages passed over stay in the pool untouched, as far as
+	 * the policy is concerned too, and the background writer writes them back
+	 * on its next round. 0, the default, replaces the first page the policy
+	 * offers.
+	 *
+	 * @param frames		Most dirty pages to pass over for each frame needed
+	 */
+  void setCleanLookahead(const std::uint32_t frames) { cleanLookahead = frames; }
+
+	/**
+	 * Changes the number of frames of the buffer pool while it is in use.
+	 * Calls made meanwhile wait for the change; pinned pages stay where they
+	 * are, so callers may keep their Page pointers and guards.
+	 *
+	 * Growing adds empty frames and sizes the hash table for them. Shrinking
+	 * writes back and evicts as many unpinned pages as needed, from the
+	 * highest frame down; a pinned page in the way leaves a hole below the
+	 * last frame instead, which growing fills first. The rings of every
+	 * file, see AccessStrategy, are given up.
+	 *
+	 * @param newBufs	New number of frames, at most the maxBufs the pool was
+	 * 								constructed with
+	 * @throws  BufferExceededException If newBufs is 0 or too large, or if more
+	 * 								than newBufs frames are pinned; the pool is then left as it was
+	 * @throws  FileIOException     If writing back a dirty page fails, leaving
+	 * 								the pool as it was
+	 */
+  void resize(const std::uint32_t newBufs);
+
+	/**
+	 * Returns the number of frames in the buffer pool.
+	 */
+  std::uint32_t size() const { return numBufs; }
+
+	/**
+   * Print member variable values. 
+	 */
+  void  printSelf();
+
+	/**
+   * Get buffer pool usage statistics
+	 */
+  BufStats & getBufStats()
   {
-		bufStats.clear();
+		return bufStats;
   }
+
+	/**
+   * Get the page requests of each file read since the statistics were last
+   * cleared, by file name
+	 */
+  std::map<std::string, FileStats> getFileStats();
+
+	/**
+   * Clear buffer pool usage statistics, including the per-file ones
+	 */
+  void clearBufStats();
+
+	/**
+	 * Writes the buffer pool usage statistics, the per-file ones and the
+	 * histograms as a single line of JSON.
+	 *
+	 * @param out   	Stream to write to
+	 */
+  void dumpStats(std::ostream& out);
+
+	/**
+	 * Starts a thread that calls dumpStats() every periodMs milliseconds,
+	 * until stopStatsReporter() is called or the buffer manager is destroyed.
+	 * Does nothing if the reporter is already running.
+	 *
+	 * @param out   	Stream to write to, which must outlive the reporter
+	 * @param periodMs	Pause between two reports, in milliseconds
+	 */
+  void startStatsReporter(std::ostream& out, const int periodMs);
+
+	/**
+	 * Stops the statistics reporter, if it is running.
+	 */
+  void stopStatsReporter();
+
+	/**
+	 * Starts recording every readPage(), allocPage(), disposePage() and
+	 * flushFile() to a trace file, with the file and page number and whether
+	 * the page was in the pool, until stopTrace() is called or the buffer
+	 * manager is destroyed. Does nothing if a trace is already being recorded.
+	 * See readTrace() and badgerdb_sim.
+	 *
+	 * @param path   	Name of the trace file, replaced if it exists
+	 * @param capacity	Number of requests buffered before they are written; requests
+	 * 									made while the buffer is full are dropped
+	 * @throws  FileIOException if the trace file cannot be created
+	 */
+  void startTrace(const std::string& path, const std::uint32_t capacity = 1 << 16);
+
+	/**
+	 * Stops recording the trace, if one is being recorded, and writes the
+	 * rest of it.
+	 *
+	 * @return				Number of requests dropped from the trace
+	 */
+  std::uint64_t stopTrace();
 };
 
 }
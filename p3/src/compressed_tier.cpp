@@ -0,0 +1,102 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "compressed_tier.h"
+#include "lz.h"
+
+namespace badgerdb {
+
+const std::size_t CompressedTier::ENTRY_OVERHEAD;
+const std::size_t CompressedTier::MAX_COMPRESSED;
+
+CompressedTier::CompressedTier(const std::size_t budgetIn)
+	: used(0), budget(budgetIn), stores(0), rejects(0)
+{
+}
+
+bool CompressedTier::put(const File* file, const PageId pageNo, const Page* page)
+{
+	char buffer[MAX_COMPRESSED];
+	std::size_t length = lzCompress(reinterpret_cast<const char*>(page), Page::SIZE, buffer, sizeof(buffer));
+	Key key(file, pageNo);
+
+	std::lock_guard<std::mutex> guard(latch);
+	std::map<Key, Entry>::iterator it = entries.find(key);
+	if (it != entries.end())
+		erase(it);
+	if (length == 0 || length + ENTRY_OVERHEAD > budget)
+	{
+		rejects++;
+		return false;
+	}
+
+	// the pages stored longest ago make room
+	while (used + length + ENTRY_OVERHEAD > budget)
+		erase(entries.find(storeOrder.front()));
+
+	Entry& entry = entries[key];
+	entry.data.assign(buffer, length);
+	entry.order = storeOrder.insert(storeOrder.end(), key);
+	used += length + ENTRY_OVERHEAD;
+	stores++;
+	return true;
+}
+
+bool CompressedTier::take(const File* file, const PageId pageNo, Page* page)
+{
+	std::string data;
+	{
+		std::lock_guard<std::mutex> guard(latch);
+		std::map<Key, Entry>::iterator it = entries.find(Key(file, pageNo));
+		if (it == entries.end())
+			return false;
+		data.swap(it->second.data);
+		used -= data.size() + ENTRY_OVERHEAD;
+		storeOrder.erase(it->second.order);
+		entries.erase(it);
+	}
+
+	// the tier only holds blocks it compressed itself
+	return lzDecompress(data.data(), data.size(), reinterpret_cast<char*>(page), Page::SIZE);
+}
+
+void CompressedTier::remove(const File* file, const PageId pageNo)
+{
+	std::lock_guard<std::mutex> guard(latch);
+	std::map<Key, Entry>::iterator it = entries.find(Key(file, pageNo));
+	if (it != entries.end())
+		erase(it);
+}
+
+void CompressedTier::removeFile(const File* file)
+{
+	std::lock_guard<std::mutex> guard(latch);
+	std::map<Key, Entry>::iterator it = entries.lower_bound(Key(file, 0));
+	while (it != entries.end() && it->first.first == file)
+		erase(it++);
+}
+
+TierStats CompressedTier::stats()
+{
+	std::lock_guard<std::mutex> guard(latch);
+	TierStats result;
+	result.pages = entries.size();
+	result.bytes = used;
+	result.budget = budget;
+	result.stores = stores;
+	result.rejects = rejects;
+	return result;
+}
+
+void CompressedTier::erase(std::map<Key, Entry>::iterator it)
+{
+	used -= it->second.data.size() + ENTRY_OVERHEAD;
+	storeOrder.erase(it->second.order);
+	entries.erase(it);
+}
+
+}
@@ -0,0 +1,169 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include "file.h"
+#include "page.h"
+
+namespace badgerdb {
+
+/**
+* @brief Occupancy of a CompressedTier, see BufMgr::getTierStats()
+*/
+struct TierStats
+{
+	/**
+	 * Number of pages held
+	 */
+	std::uint64_t pages;
+
+	/**
+	 * Bytes charged to the budget for them
+	 */
+	std::uint64_t bytes;
+
+	/**
+	 * Most bytes the tier may hold
+	 */
+	std::uint64_t budget;
+
+	/**
+	 * Number of pages stored since the tier was created
+	 */
+	std::uint64_t stores;
+
+	/**
+	 * Number of pages turned away because they did not compress well enough
+	 */
+	std::uint64_t rejects;
+};
+
+/**
+* @brief Second tier of the buffer pool, holding copies of pages evicted from
+* it compressed with lzCompress().
+*
+* The tier only holds pages as they are on disk, and a page only while it is
+* not in the pool: the buffer manager moves a page here as it evicts it and
+* takes it back out on a miss, and drops the copy of a page it disposes of or
+* of a file it flushes. When the compressed pages would exceed the budget, the
+* ones stored longest ago make room.
+*
+* All methods may be called from several threads at once; pages are
+* compressed and decompressed outside of the latch.
+*/
+class CompressedTier
+{
+ public:
+	/**
+	 * Bytes charged to the budget for every page on top of its compressed size,
+	 * for the bookkeeping
+	 */
+	static const std::size_t ENTRY_OVERHEAD = 96;
+
+	/**
+	 * Largest compressed size of a page the tier keeps; pages that compress
+	 * worse are left to be read from disk
+	 */
+	static const std::size_t MAX_COMPRESSED = Page::SIZE * 3 / 4;
+
+	/**
+	 * Constructor of CompressedTier class
+	 *
+	 * @param budget		Most bytes of compressed pages and their bookkeeping to hold
+	 */
+	explicit CompressedTier(const std::size_t budget);
+
+	/**
+	 * Stores a copy of a page, replacing any copy held before.
+	 *
+	 * @param file   	File of the page
+	 * @param pageNo  Page number of the page
+	 * @param page		Contents of the page, as on disk
+	 * @return				False if the page did not compress well enough to be kept
+	 */
+	bool put(const File* file, const PageId pageNo, const Page* page);
+
+	/**
+	 * Moves a page out of the tier.
+	 *
+	 * @param file   	File of the page
+	 * @param pageNo  Page number of the page
+	 * @param page		Memory the page is decompressed into
+	 * @return				False if the tier does not hold the page
+	 */
+	bool take(const File* file, const PageId pageNo, Page* page);
+
+	/**
+	 * Drops the copy of a page, if the tier holds one.
+	 */
+	void remove(const File* file, const PageId pageNo);
+
+	/**
+	 * Drops the copies of every page of a file.
+	 */
+	void removeFile(const File* file);
+
+	/**
+	 * Returns the occupancy of the tier.
+	 */
+	TierStats stats();
+
+ private:
+	CompressedTier(const CompressedTier&);
+	CompressedTier& operator=(const CompressedTier&);
+
+	typedef std::pair<const File*, PageId> Key;
+
+	/**
+	 * A compressed page, and its place in storeOrder
+	 */
+	struct Entry
+	{
+		std::string data;
+		std::list<Key>::iterator order;
+	};
+
+	/**
+	 * Pages held, by file and page number so that the pages of a file are
+	 * adjacent
+	 */
+	std::map<Key, Entry> entries;
+
+	/**
+	 * Pages held, the one stored longest ago first
+	 */
+	std::list<Key> storeOrder;
+
+	/**
+	 * Bytes charged for the pages held, and the most that may be
+	 */
+	std::size_t used;
+	const std::size_t budget;
+
+	std::uint64_t stores;
+	std::uint64_t rejects;
+
+	/**
+	 * Protects all of the above
+	 */
+	std::mutex latch;
+
+	/**
+	 * Drops an entry. Called with the latch held.
+	 */
+	void erase(std::map<Key, Entry>::iterator it);
+};
+
+}
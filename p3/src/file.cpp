@@ -11,10 +11,13 @@
 #include <iostream>
 #include <memory>
 #include <string>
+#include <vector>
 #include <cstdio>
 #include <cassert>
+#include <sys/mman.h>
 
 #include "exceptions/file_exists_exception.h"
+#include "exceptions/file_io_exception.h"
 #include "exceptions/file_not_found_exception.h"
 #include "exceptions/file_open_exception.h"
 #include "exceptions/invalid_page_exception.h"
@@ -23,14 +26,22 @@
 
 namespace badgerdb {
 
-File::StreamMap File::open_streams_;
+static_assert(sizeof(Page) == Page::SIZE,
+              "Pages are read and written as Page::SIZE bytes of memory.");
+
+File::IOMap File::open_files_;
 File::CountMap File::open_counts_;
+File::LatchMap File::open_latches_;
+File::HeaderMap File::open_headers_;
+std::mutex File::open_files_latch_;
+Durability File::default_durability_ = DURABILITY_FLUSH;
 
 void File::remove(const std::string& filename) {
   if (!exists(filename)) {
     throw FileNotFoundException(filename);
   }
-  if (isOpen(filename)) {
+  std::lock_guard<std::mutex> guard(open_files_latch_);
+  if (open_counts_.find(filename) != open_counts_.end()) {
     throw FileOpenException(filename);
   }
   std::remove(filename.c_str());
@@ -40,6 +51,7 @@ bool File::isOpen(const std::string& filename) {
   if (!exists(filename)) {
     return false;
   }
+  std::lock_guard<std::mutex> guard(open_files_latch_);
   return open_counts_.find(filename) != open_counts_.end();
 }
 
@@ -64,84 +76,230 @@ PageId File::getFirstPageNo() {
   return header.first_used_page;
 }
 
-File::File(const std::string& name, const bool create_new) : filename_(name) {
-  openIfNeeded(create_new);
+File::File(const std::string& name, const bool create_new,
+           const FileBackend backend) : filename_(name) {
+  openIfNeeded(create_new, backend);
 
   if (create_new) {
     // File starts with 1 page (the header).
     FileHeader header = {1 /* num_pages */, 0 /* first_used_page */,
                          0 /* num_free_pages */, 0 /* first_free_page */};
+    std::lock_guard<std::recursive_mutex> guard(*latch_);
     writeHeader(header);
+    storeHeader();
   }
 }
 
-void File::openIfNeeded(const bool create_new) {
+void File::openIfNeeded(const bool create_new, const FileBackend backend) {
+  std::lock_guard<std::mutex> guard(open_files_latch_);
   if (open_counts_.find(filename_) != open_counts_.end()) {	//exists an entry already
+    // the handles share one FileIO, so they must agree on how it is accessed
+    if (open_files_[filename_]->backend() != backend) {
+      throw FileOpenException(filename_);
+    }
     ++open_counts_[filename_];
-    stream_ = open_streams_[filename_];
+    io_ = open_files_[filename_];
+    latch_ = open_latches_[filename_];
+    header_ = open_headers_[filename_];
   } else {
-    std::ios_base::openmode mode =
-        std::fstream::in | std::fstream::out | std::fstream::binary;
     const bool already_exists = exists(filename_);
     if (create_new) {
       // Error if we try to overwrite an existing file.
       if (already_exists) {
         throw FileExistsException(filename_);
       }
-      // New files have to be truncated on open.
-      mode = mode | std::fstream::trunc;
     } else {
       // Error if we try to open a file that doesn't exist.
       if (!already_exists) {
         throw FileNotFoundException(filename_);
       }
     }
-    stream_.reset(new std::fstream(filename_, mode));
-    open_streams_[filename_] = stream_;
+    io_.reset(FileIO::open(filename_, create_new, backend));
+    io_->setDurability(default_durability_);
+    latch_.reset(new std::recursive_mutex);
+    header_.reset(new CachedHeader);
+    io_->read(0 /* pos */, reinterpret_cast<char*>(&header_->header),
+              sizeof(FileHeader));
+    header_->dirty = false;
+    open_files_[filename_] = io_;
+    open_latches_[filename_] = latch_;
+    open_headers_[filename_] = header_;
     open_counts_[filename_] = 1;
   }
 }
 
 void File::close() {
+  std::lock_guard<std::mutex> guard(open_files_latch_);
 	if(open_counts_[filename_] > 0)
   	--open_counts_[filename_];
 
-  stream_.reset();
+  if (open_counts_[filename_] == 0 && io_) {
+    // write back the header and sync as the policy asks; there is no caller
+    // to report a failure to
+    try {
+      std::lock_guard<std::recursive_mutex> io_guard(*latch_);
+      storeHeader();
+      if (io_->durability() != DURABILITY_NONE) {
+        io_->sync(io_->durability() == DURABILITY_SYNC);
+      }
+    } catch (const FileIOException&) {
+    }
+  }
+
+  io_.reset();
+  latch_.reset();
+  header_.reset();
 	assert(open_counts_[filename_] >= 0);
 
   if (open_counts_[filename_] == 0) {
-    open_streams_.erase(filename_);
+    open_files_.erase(filename_);
+    open_latches_.erase(filename_);
+    open_headers_.erase(filename_);
     open_counts_.erase(filename_);
   }
 }
 
+void File::sync() {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  storeHeader();
+  io_->sync(io_->durability() == DURABILITY_SYNC);
+}
+
+Durability File::durability() const {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  return io_->durability();
+}
+
+void File::setDurability(const Durability durability) {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  io_->setDurability(durability);
+}
+
+void File::setDefaultDurability(const Durability durability) {
+  std::lock_guard<std::mutex> guard(open_files_latch_);
+  default_durability_ = durability;
+}
+
 FileHeader File::readHeader() const {
-  FileHeader header;
-  stream_->seekg(0 /* pos */, std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(FileHeader));
-  return header;
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  return header_->header;
 }
 
 void File::writeHeader(const FileHeader& header) {
-  stream_->seekp(0 /* pos */, std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
-  stream_->flush();
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  header_->header = header;
+  header_->dirty = true;
 }
 
+void File::storeHeader() {
+  if (header_->dirty) {
+    io_->write(0 /* pos */, reinterpret_cast<const char*>(&header_->header),
+               sizeof(FileHeader));
+    header_->dirty = false;
+  }
+}
 
+Page* File::mappedPage(const PageId page_number) const {
+  std::size_t length;
+  const char* data = io_->mapping(length);
+  if (data == NULL || page_number == Page::INVALID_NUMBER ||
+      pagePosition(page_number) + Page::SIZE > length) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  return reinterpret_cast<Page*>(
+      const_cast<char*>(data) + pagePosition(page_number));
+}
 
+void File::adviseWillNeed(const PageId* page_numbers,
+                          const std::size_t count) const {
+  if (!mapped()) {
+    return;
+  }
+  // one hint for each run of consecutive pages
+  std::size_t first = 0;
+  while (first < count) {
+    std::size_t last = first + 1;
+    while (last < count && page_numbers[last] == page_numbers[last - 1] + 1) {
+      last++;
+    }
+    io_->advise(pagePosition(page_numbers[first]), (last - first) * Page::SIZE,
+                MADV_WILLNEED);
+    first = last;
+  }
+}
 
+void File::adviseSequential() const {
+  std::size_t length;
+  if (io_->mapping(length) != NULL) {
+    io_->advise(0, length, MADV_SEQUENTIAL);
+  }
+}
 
-PageFile PageFile::create(const std::string& filename) {
-  return PageFile(filename, true /* create_new */);
+void File::readCoalesced(const PageId* page_numbers, char* const* buffers,
+                         const std::size_t count) const {
+  std::vector<std::uint64_t> offsets;
+  std::vector<char*> scattered;
+  std::size_t first = 0;
+  while (first < count) {
+    std::size_t last = first + 1;
+    while (last < count && page_numbers[last] == page_numbers[last - 1] + 1) {
+      last++;
+    }
+    if (last - first > 1) {
+      io_->readRun(pagePosition(page_numbers[first]), buffers + first,
+                   Page::SIZE, last - first);
+    } else {
+      offsets.push_back(pagePosition(page_numbers[first]));
+      scattered.push_back(buffers[first]);
+    }
+    first = last;
+  }
+  if (!offsets.empty()) {
+    io_->readBatch(&offsets[0], &scattered[0], Page::SIZE, offsets.size());
+  }
+}
+
+void File::writeCoalesced(const PageId* page_numbers,
+                          const char* const* buffers, const std::size_t count) {
+  std::vector<std::uint64_t> offsets;
+  std::vector<const char*> scattered;
+  std::size_t first = 0;
+  while (first < count) {
+    std::size_t last = first + 1;
+    while (last < count && page_numbers[last] == page_numbers[last - 1] + 1) {
+      last++;
+    }
+    if (last - first > 1) {
+      io_->writeRun(pagePosition(page_numbers[first]), buffers + first,
+                    Page::SIZE, last - first);
+    } else {
+      offsets.push_back(pagePosition(page_numbers[first]));
+      scattered.push_back(buffers[first]);
+    }
+    first = last;
+  }
+  if (!offsets.empty()) {
+    io_->writeBatch(&offsets[0], &scattered[0], Page::SIZE, offsets.size());
+  }
+}
+
+
+
+
+
+PageFile PageFile::create(const std::string& filename,
+                         const FileBackend backend) {
+  return PageFile(filename, true /* create_new */, backend);
 }
 
-PageFile PageFile::open(const std::string& filename) {
-  return PageFile(filename, false /* create_new */);
+PageFile PageFile::open(const std::string& filename,
+                       const FileBackend backend) {
+  return PageFile(filename, false /* create_new */, backend);
 }
 
-PageFile::PageFile(const std::string& name, const bool create_new)
-: File(name, create_new)
+PageFile::PageFile(const std::string& name, const bool create_new,
+                   const FileBackend backend)
+: File(name, create_new, backend)
 {
 }
 
@@ -149,7 +307,7 @@ PageFile::~PageFile() {
 }
 
 PageFile::PageFile(const PageFile& other)
-: File(other.filename_, false /* create_new */)
+: File(other.filename_, false /* create_new */, other.backend())
 {
 }
 
@@ -163,101 +321,93 @@ PageFile& PageFile::operator=(const PageFile& rhs) {
 }
 
 Page PageFile::allocatePage(PageId &new_page_number) {
-  FileHeader header = readHeader();
   Page new_page;
-  Page existing_page;
+  allocatePageInto(new_page_number, &new_page);
+  return new_page;
+}
+
+void PageFile::allocatePageInto(PageId &new_page_number, Page* new_page) {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  FileHeader header = readHeader();
   if (header.num_free_pages > 0) {
-    new_page = readPage(header.first_free_page, true /* allow_free */);
-    new_page.set_page_number(header.first_free_page);
-		new_page_number = new_page.page_number();
-    header.first_free_page = new_page.next_page_number();
+    readPageInto(header.first_free_page, new_page, true /* allow_free */);
+    new_page->set_page_number(header.first_free_page);
+    header.first_free_page = new_page->next_page_number();
     --header.num_free_pages;
 
-    if (header.first_used_page == Page::INVALID_NUMBER ||
-        header.first_used_page > new_page.page_number()) {
-      // Either have no pages used or the head of the used list is a page later
-      // than the one we just allocated, so add the new page to the head.
-      if (header.first_used_page > new_page.page_number()) {
-        new_page.set_next_page_number(header.first_used_page);
-      }
-      header.first_used_page = new_page.page_number();
-    } else {
-      // New page is reused from somewhere after the beginning, so we need to
-      // find where in the used list to insert it.
-      PageId next_page_number = Page::INVALID_NUMBER;
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        next_page_number = (*iter).next_page_number();
-        if (next_page_number > new_page.page_number() ||
-            next_page_number == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
-      }
-      existing_page.set_next_page_number(new_page.page_number());
-      new_page.set_next_page_number(next_page_number);
-    }
-
     assert((header.num_free_pages == 0) ==
            (header.first_free_page == Page::INVALID_NUMBER));
   }
 	else
 	{
-    new_page.set_page_number(header.num_pages);
-		new_page_number = new_page.page_number();
-
-    if (header.first_used_page == Page::INVALID_NUMBER)
-		{
-      header.first_used_page = new_page.page_number();
-    }
-		else
-		{
-      // If we have pages allocated, we need to add the new page to the tail
-      // of the linked list.
-      for (FileIterator iter = begin(); iter != end(); ++iter) {
-        if ((*iter).next_page_number() == Page::INVALID_NUMBER) {
-          existing_page = *iter;
-          break;
-        }
-      }
-      assert(existing_page.isUsed());
-      existing_page.set_next_page_number(new_page.page_number());
-    }
+    new_page->initialize();
+    new_page->set_page_number(header.num_pages);
     ++header.num_pages;
   }
-  writePage(new_page_number, new_page.header_, new_page);
-  if (existing_page.page_number() != Page::INVALID_NUMBER) {
-    // If we updated an existing page by inserting the new page into the
-    // used list, we need to write it out.
-    writePage(existing_page.page_number(), existing_page.header_, existing_page);
+  new_page_number = new_page->page_number();
+
+  PageId previous_page_number = Page::INVALID_NUMBER;
+  PageHeader previous_header;
+  if (header.first_used_page == Page::INVALID_NUMBER ||
+      header.first_used_page > new_page_number) {
+    // Either have no pages used or the head of the used list is a page later
+    // than the one we just allocated, so add the new page to the head.
+    new_page->set_next_page_number(header.first_used_page);
+    header.first_used_page = new_page_number;
+  } else {
+    // Find the used page the new one goes after, which is the last one when
+    // the page was not reused.  Only the headers of the used pages are read,
+    // and only the header of that page is written back.
+    previous_page_number = header.first_used_page;
+    previous_header = readPageHeader(previous_page_number);
+    while (previous_header.next_page_number != Page::INVALID_NUMBER &&
+           previous_header.next_page_number < new_page_number) {
+      previous_page_number = previous_header.next_page_number;
+      previous_header = readPageHeader(previous_page_number);
+    }
+    new_page->set_next_page_number(previous_header.next_page_number);
+    previous_header.next_page_number = new_page_number;
   }
-  writeHeader(header);
 
-  return new_page;
+  io_->write(pagePosition(new_page_number),
+             reinterpret_cast<const char*>(new_page), Page::SIZE);
+  if (previous_page_number != Page::INVALID_NUMBER) {
+    writePageHeader(previous_page_number, previous_header);
+  }
+  writeHeader(header);
 }
 
 Page PageFile::readPage(const PageId page_number) const {
+  Page page;
+  readPageInto(page_number, &page);
+  return page;
+}
+
+void PageFile::readPageInto(const PageId page_number, Page* page) const {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
   FileHeader header = readHeader();
 
 	if (page_number >= header.num_pages)
 	{
 		throw InvalidPageException(page_number, filename_);
 	}
-	return readPage(page_number, false /* allow_free */);
+	readPageInto(page_number, page, false /* allow_free */);
 }
 
-Page PageFile::readPage(const PageId page_number, const bool allow_free) const {
-  Page page;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&page.header_), sizeof(PageHeader));
-  stream_->read(&page.data_[0], Page::DATA_SIZE);
-  if (!allow_free && !page.isUsed()) {
+void PageFile::readPageInto(const PageId page_number, Page* page,
+                            const bool allow_free) const {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  // the header and the data are adjacent both on disk and in the Page, so
+  // the page takes a single transfer
+  io_->read(pagePosition(page_number), reinterpret_cast<char*>(page),
+            Page::SIZE);
+  if (!allow_free && !page->isUsed()) {
     throw InvalidPageException(page_number, filename_);
   }
-
-  return page;
 }
 
 void PageFile::writePage(const PageId new_page_number, const Page& new_page) {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
 	PageHeader header = readPageHeader(new_page_number);
 	if (header.current_page_number == Page::INVALID_NUMBER)
 	{
@@ -273,21 +423,103 @@ void PageFile::writePage(const PageId new_page_number, const Page& new_page) {
 	writePage(new_page_number, header, new_page);
 }
 
+Page* PageFile::mappedPage(const PageId page_number) const {
+  Page* page = File::mappedPage(page_number);
+  if (!page->isUsed()) {
+    throw InvalidPageException(page_number, filename_);
+  }
+  return page;
+}
+
+void PageFile::readPages(const PageId* page_numbers, Page* const* pages,
+                         const std::size_t count) const {
+  if (count == 0) {
+    return;
+  }
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  FileHeader header = readHeader();
+  for (std::size_t i = 0; i < count; i++) {
+    if (page_numbers[i] >= header.num_pages) {
+      throw InvalidPageException(page_numbers[i], filename_);
+    }
+  }
+
+  readCoalesced(page_numbers, reinterpret_cast<char* const*>(pages), count);
+  for (std::size_t i = 0; i < count; i++) {
+    if (!pages[i]->isUsed()) {
+      throw InvalidPageException(page_numbers[i], filename_);
+    }
+  }
+}
+
+void PageFile::writePages(const PageId* page_numbers, const Page* const* pages,
+                          const std::size_t count) {
+  if (count == 0) {
+    return;
+  }
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+
+  // as in writePage(), keep the next page pointers on disk: read the pages
+  // on disk into the copies that get written, a run of adjacent pages with
+  // one read and the headers of the others as a batch
+  std::vector<Page> copies(count);
+  std::vector<std::uint64_t> offsets;
+  std::vector<char*> header_buffers;
+  std::size_t first = 0;
+  while (first < count) {
+    std::size_t last = first + 1;
+    while (last < count && page_numbers[last] == page_numbers[last - 1] + 1) {
+      last++;
+    }
+    if (last - first > 1) {
+      io_->read(pagePosition(page_numbers[first]),
+                reinterpret_cast<char*>(&copies[first]),
+                (last - first) * Page::SIZE);
+    } else {
+      offsets.push_back(pagePosition(page_numbers[first]));
+      header_buffers.push_back(reinterpret_cast<char*>(&copies[first]));
+    }
+    first = last;
+  }
+  if (!offsets.empty()) {
+    io_->readBatch(&offsets[0], &header_buffers[0], sizeof(PageHeader),
+                   offsets.size());
+  }
+
+  std::vector<const char*> buffers(count);
+  for (std::size_t i = 0; i < count; i++) {
+    if (copies[i].header_.current_page_number == Page::INVALID_NUMBER) {
+      // Page has been deleted since it was read.
+      throw InvalidPageException(page_numbers[i], filename_);
+    }
+    const PageId next_page_number = copies[i].header_.next_page_number;
+    copies[i] = *pages[i];
+    copies[i].header_.next_page_number = next_page_number;
+    buffers[i] = reinterpret_cast<const char*>(&copies[i]);
+  }
+  writeCoalesced(page_numbers, &buffers[0], count);
+}
+
 void PageFile::deletePage(const PageId page_number) {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
   FileHeader header = readHeader();
 
   Page existing_page = readPage(page_number);
-  Page previous_page;
+  PageId previous_page_number = Page::INVALID_NUMBER;
+  PageHeader previous_header;
   // If this page is the head of the used list, update the header to point to
   // the next page in line.
   if (page_number == header.first_used_page) {
     header.first_used_page = existing_page.next_page_number();
   } else {
-    // Walk the used list so we can update the page that points to this one.
+    // Walk the headers of the used list so we can update the page that
+    // points to this one.
     for (FileIterator iter = begin(); iter != end(); ++iter) {
-      previous_page = *iter;
-      if (previous_page.next_page_number() == existing_page.page_number()) {
-        previous_page.set_next_page_number(existing_page.next_page_number());
+      PageHeader iter_header = readPageHeader(iter.page_number());
+      if (iter_header.next_page_number == page_number) {
+        previous_page_number = iter.page_number();
+        previous_header = iter_header;
+        previous_header.next_page_number = existing_page.next_page_number();
         break;
       }
     }
@@ -297,8 +529,8 @@ void PageFile::deletePage(const PageId page_number) {
   existing_page.set_next_page_number(header.first_free_page);
   header.first_free_page = page_number;
   ++header.num_free_pages;
-  if (previous_page.isUsed()) {
-    writePage(previous_page.page_number(), previous_page.header_, previous_page);
+  if (previous_page_number != Page::INVALID_NUMBER) {
+    writePageHeader(previous_page_number, previous_header);
   }
   writePage(page_number, existing_page.header_, existing_page);
   writeHeader(header);
@@ -315,39 +547,52 @@ FileIterator PageFile::end() {
 
 void PageFile::writePage(const PageId page_number, const PageHeader& header,
                      const Page& new_page) {
-  stream_->seekp(pagePosition(page_number), std::ios::beg);
-  stream_->write(reinterpret_cast<const char*>(&header), sizeof(PageHeader));
-  stream_->write(&new_page.data_[0], Page::DATA_SIZE);
-  stream_->flush();
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  // copy the page so that it goes out with its header in a single transfer
+  Page page = new_page;
+  page.header_ = header;
+  io_->write(pagePosition(page_number), reinterpret_cast<const char*>(&page),
+             Page::SIZE);
 }
 
 PageHeader PageFile::readPageHeader(PageId page_number) const {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
   PageHeader header;
-  stream_->seekg(pagePosition(page_number), std::ios::beg);
-  stream_->read(reinterpret_cast<char*>(&header), sizeof(PageHeader));
+  io_->read(pagePosition(page_number), reinterpret_cast<char*>(&header),
+            sizeof(PageHeader));
   return header;
 }
 
+void PageFile::writePageHeader(const PageId page_number,
+                               const PageHeader& header) {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  io_->write(pagePosition(page_number),
+             reinterpret_cast<const char*>(&header), sizeof(PageHeader));
+}
+
 
 
 
-BlobFile BlobFile::create(const std::string& filename) {
-  return BlobFile(filename, true /* create_new */);
+BlobFile BlobFile::create(const std::string& filename,
+                         const FileBackend backend) {
+  return BlobFile(filename, true /* create_new */, backend);
 }
 
-BlobFile BlobFile::open(const std::string& filename) {
-  return BlobFile(filename, false /* create_new */);
+BlobFile BlobFile::open(const std::string& filename,
+                       const FileBackend backend) {
+  return BlobFile(filename, false /* create_new */, backend);
 }
 
-BlobFile::BlobFile(const std::string& name, const bool create_new)
-: File(name, create_new) {
+BlobFile::BlobFile(const std::string& name, const bool create_new,
+                   const FileBackend backend)
+: File(name, create_new, backend) {
 }
 
 BlobFile::~BlobFile() {
 }
 
 BlobFile::BlobFile(const BlobFile& other)
-: File(other.filename_, false /* create_new */)
+: File(other.filename_, false /* create_new */, other.backend())
 {
 }
 
@@ -361,8 +606,15 @@ BlobFile& BlobFile::operator=(const BlobFile& rhs) {
 }
 
 Page BlobFile::allocatePage(PageId &new_page_number) {
-  FileHeader header = readHeader();
 	Page new_page;
+	allocatePageInto(new_page_number, &new_page);
+	return new_page;
+}
+
+void BlobFile::allocatePageInto(PageId &new_page_number, Page* new_page) {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  FileHeader header = readHeader();
+	new_page->initialize();
 
 	new_page_number = header.num_pages;
 
@@ -372,23 +624,43 @@ Page BlobFile::allocatePage(PageId &new_page_number) {
 
 	++header.num_pages;
 
-	writePage(new_page_number, new_page);
+	writePage(new_page_number, *new_page);
 	writeHeader(header);
-
-	return new_page;
 }
 
 Page BlobFile::readPage(const PageId page_number) const {
 	Page page;
-	stream_->seekg(pagePosition(page_number), std::ios::beg);
-	stream_->read(reinterpret_cast<char*>(&page), Page::SIZE);
+	readPageInto(page_number, &page);
 	return page;
 }
 
+void BlobFile::readPageInto(const PageId page_number, Page* page) const {
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+	io_->read(pagePosition(page_number), reinterpret_cast<char*>(page), Page::SIZE);
+}
+
 void BlobFile::writePage(const PageId new_page_number, const Page& new_page) {
-	stream_->seekp(pagePosition(new_page_number), std::ios::beg);
-	stream_->write(reinterpret_cast<const char*>(&new_page), Page::SIZE);
-	stream_->flush();
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+	io_->write(pagePosition(new_page_number), reinterpret_cast<const char*>(&new_page), Page::SIZE);
+}
+
+void BlobFile::readPages(const PageId* page_numbers, Page* const* pages,
+                         const std::size_t count) const {
+  if (count == 0) {
+    return;
+  }
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  readCoalesced(page_numbers, reinterpret_cast<char* const*>(pages), count);
+}
+
+void BlobFile::writePages(const PageId* page_numbers, const Page* const* pages,
+                          const std::size_t count) {
+  if (count == 0) {
+    return;
+  }
+  std::lock_guard<std::recursive_mutex> guard(*latch_);
+  writeCoalesced(page_numbers, reinterpret_cast<const char* const*>(pages),
+                 count);
 }
 
 //delePage should not be called for a blob_file, not supported
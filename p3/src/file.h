@@ -7,11 +7,13 @@
 
 #pragma once
 
-#include <fstream>
+#include <cstdint>
 #include <string>
 #include <map>
 #include <memory>
+#include <mutex>
 
+#include "file_io.h"
 #include "page.h"
 
 namespace badgerdb {
@@ -60,15 +62,21 @@ struct FileHeader {
  * @brief Class which represents a file in the filesystem containing database
  *        pages.
  *
- * The File class wraps a stream to an underlying file on disk.  Files contain
+ * The File class wraps a FileIO for an underlying file on disk, which reads
+ * and writes it through a stream or, with pread/pwrite, through a file
+ * descriptor (see FileBackend).  Files contain
  * fixed-sized pages, and they never deallocate space (though they do reuse
  * deleted pages if possible).  If multiple File objects refer to the same
- * underlying file, they will share the stream in memory.
+ * underlying file, they will share the FileIO in memory.
  * If a file that has already been opened (possibly by another query), then the File class
- * detects this (by looking in the open_streams_ map) and just returns a file object with
- * the already created stream for the file without actually opening the UNIX file again. 
+ * detects this (by looking in the open_files_ map) and just returns a file object with
+ * the already created FileIO for the file without actually opening the UNIX file again,
+ * whatever backend it asks for.
  *
- * @warning This class is not threadsafe.
+ * File objects for the same file also share a latch which serializes their
+ * use of the FileIO, so pages of one file may be read and written from
+ * several threads. A single File object must still not be opened, closed or
+ * assigned concurrently with its own use.
  */
 
 
@@ -80,12 +88,16 @@ class File {
    *
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param backend     How to access the file; the backend it is open with, if it
+   *                    is open already.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
+   * @throws  FileOpenException       If the file is open with another backend.
    */
-  File(const std::string& name, const bool create_new);
+  File(const std::string& name, const bool create_new,
+       const FileBackend backend);
 
   /**
    * Deletes an existing file.
@@ -124,6 +136,15 @@ class File {
    */
   virtual Page allocatePage(PageId &new_page_number) = 0;
 
+  /**
+   * Allocates a new page in the file, building it in the given memory rather
+   * than returning a copy, such as in a frame of the buffer pool.
+   *
+   * @param new_page_number Set to the number of the new page.
+   * @param new_page        Set to the new page.
+   */
+  virtual void allocatePageInto(PageId &new_page_number, Page* new_page) = 0;
+
   /**
    * Reads an existing page from the file.
    *
@@ -134,6 +155,18 @@ class File {
    */
   virtual Page readPage(const PageId page_number) const = 0;
 
+  /**
+   * Reads an existing page from the file straight into the given memory,
+   * such as a frame of the buffer pool, with no copy through a Page of its
+   * own.
+   *
+   * @param page_number   Number of page to read.
+   * @param page          Set to the page.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   */
+  virtual void readPageInto(const PageId page_number, Page* page) const = 0;
+
   /**
    * Writes a page into the file at the given page number.
    * No bounds checking is performed.
@@ -143,6 +176,32 @@ class File {
    */
   virtual void writePage(const PageId page_number, const Page& new_page) = 0;
 
+  /**
+   * Reads several existing pages from the file, keeping the reads in flight
+   * at once where the backend allows.  Runs of consecutive page numbers, in
+   * ascending order, are read with one read each.
+   *
+   * @param page_numbers  Numbers of pages to read.
+   * @param pages         Pages to read them into.
+   * @param count         Number of pages.
+   * @throws  InvalidPageException  If a page doesn't exist in the file or is
+   *                                not currently used.
+   */
+  virtual void readPages(const PageId* page_numbers, Page* const* pages,
+                         const std::size_t count) const = 0;
+
+  /**
+   * Writes several pages into the file, keeping the writes in flight at once
+   * where the backend allows.  No bounds checking is performed.  Runs of
+   * consecutive page numbers, in ascending order, go out as one write each.
+   *
+   * @param page_numbers  Numbers of pages whose contents to replace.
+   * @param pages         Pages to write.
+   * @param count         Number of pages.
+   */
+  virtual void writePages(const PageId* page_numbers, const Page* const* pages,
+                          const std::size_t count) = 0;
+
   /**
    * Deletes a page from the file.
    *
@@ -157,6 +216,79 @@ class File {
    */
   const std::string& filename() const { return filename_; }
 
+  /**
+   * Returns how the underlying file is accessed.
+   *
+   * @return Backend of the shared FileIO.
+   */
+  FileBackend backend() const { return io_->backend(); }
+
+  /**
+   * Returns true if the file is mapped into memory (see BACKEND_MMAP).
+   */
+  bool mapped() const { return io_->backend() == BACKEND_MMAP; }
+
+  /**
+   * Returns a page of a mapped file where it lies in the mapping, to be read
+   * in place.  The page must not be changed.
+   *
+   * @param page_number   Number of page.
+   * @return  Page in the mapping.
+   * @throws  InvalidPageException  If the file is not mapped, or the page
+   *                                doesn't exist in it.
+   */
+  virtual Page* mappedPage(const PageId page_number) const;
+
+  /**
+   * Hints that pages of a mapped file are going to be read soon, so that the
+   * operating system reads them in ahead.  Does nothing if the file is not
+   * mapped.
+   *
+   * @param page_numbers  Numbers of pages.
+   * @param count         Number of pages.
+   */
+  void adviseWillNeed(const PageId* page_numbers,
+                      const std::size_t count) const;
+
+  /**
+   * Hints that a mapped file is going to be read in order, so that the
+   * operating system reads further ahead and drops the pages read sooner.
+   * Does nothing if the file is not mapped.
+   */
+  void adviseSequential() const;
+
+  /**
+   * Writes the file header if it changed, hands every write made to the file
+   * so far to the operating system, and with DURABILITY_SYNC waits until
+   * they are on disk.  This also happens when the last File object for the
+   * file closes it, except that errors are not reported then.
+   *
+   * @throws  FileIOException   If the operating system reports an error.
+   */
+  void sync();
+
+  /**
+   * Returns the durability policy of the file.
+   *
+   * @return Durability policy, shared by all File objects for the file.
+   */
+  Durability durability() const;
+
+  /**
+   * Sets the durability policy of the file, for all File objects using it.
+   *
+   * @param durability  New durability policy.
+   */
+  void setDurability(const Durability durability);
+
+  /**
+   * Sets the durability policy given to files opened from now on that are
+   * not open yet.  DURABILITY_FLUSH unless set.
+   *
+   * @param durability  Durability policy of newly opened files.
+   */
+  static void setDefaultDurability(const Durability durability);
+
  	/**
    * Returns pageid of first page in the file.
    *
@@ -172,66 +304,150 @@ class File {
    * @param page_number   Number of page.
    * @return  Position of page in file.
    */
-  static std::streampos pagePosition(const PageId page_number) {
+  static std::uint64_t pagePosition(const PageId page_number) {
     return sizeof(FileHeader) + ((page_number - 1) * Page::SIZE);
   }
 
+  /**
+   * Reads whole pages for readPages(): each run of consecutive page numbers
+   * with a single readRun(), and the remaining pages as one batch.  The
+   * caller holds the latch.
+   *
+   * @param page_numbers  Numbers of pages to read.
+   * @param buffers       Memory to read them into, Page::SIZE bytes each.
+   * @param count         Number of pages.
+   */
+  void readCoalesced(const PageId* page_numbers, char* const* buffers,
+                     const std::size_t count) const;
+
+  /**
+   * Writes whole pages for writePages(): each run of consecutive page numbers
+   * with a single writeRun(), and the remaining pages as one batch.  The
+   * caller holds the latch.
+   *
+   * @param page_numbers  Numbers of pages whose contents to replace.
+   * @param buffers       Contents of the pages, Page::SIZE bytes each.
+   * @param count         Number of pages.
+   */
+  void writeCoalesced(const PageId* page_numbers, const char* const* buffers,
+                      const std::size_t count);
+
   /**
    * Opens the underlying file named in filename_.
    * This method only opens the file if no other File objects exist that access
-   * the same filesystem file; otherwise, it reuses the existing stream.
+   * the same filesystem file; otherwise, it reuses the existing FileIO.
    *
    * @param create_new  Whether to create a new file.
+   * @param backend     How to access the file; the backend it is open with, if it
+   *                    is open already.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
+   * @throws  FileOpenException       If the file is open with another backend.
    */
-  void openIfNeeded(const bool create_new);
+  void openIfNeeded(const bool create_new,
+                    const FileBackend backend = BACKEND_PREAD);
 
   /**
-   * Closes the underlying file stream in <stream_>.
+   * Closes the underlying file accessed through <io_>.
    * This method only closes the file if no other File objects exist that access
    * the same file.
    */
   void close();
 
   /**
-   * Reads the header for this file from disk.
+   * Returns the header for this file.
    *
    * @return  The file header.
    */
   FileHeader readHeader() const;
 
   /**
-   * Writes the given header to the disk as the header for this file.
+   * Replaces the header for this file.  The header on disk is only brought
+   * up to date when the file is synced or closed.
    *
    * @param header  File header to write.
    */
   void writeHeader(const FileHeader& header);
 
-  typedef std::map<std::string, std::shared_ptr<std::fstream> > StreamMap;
+  /**
+   * Writes the header for this file to disk if it has changed since it was
+   * last written.  The caller holds the latch.
+   */
+  void storeHeader();
+
+  /**
+   * @brief Header of an open file, shared by all File objects for it, so that
+   * allocating and deleting pages need not read and write it on disk.
+   */
+  struct CachedHeader {
+    /**
+     * The header as it is now.
+     */
+    FileHeader header;
+
+    /**
+     * True if header differs from the header on disk.
+     */
+    bool dirty;
+  };
+
+  typedef std::map<std::string, std::shared_ptr<FileIO> > IOMap;
+  typedef std::map<std::string, std::shared_ptr<std::recursive_mutex> > LatchMap;
+  typedef std::map<std::string, std::shared_ptr<CachedHeader> > HeaderMap;
   typedef std::map<std::string, int> CountMap;
 
   /**
-   * Streams for opened files.
+   * FileIOs for opened files.
    */
-  static StreamMap open_streams_;
+  static IOMap open_files_;
 
   /**
    * Counts for opened files.
    */
   static CountMap open_counts_;
 
+  /**
+   * Latches serializing the use of the FileIOs of opened files.
+   */
+  static LatchMap open_latches_;
+
+  /**
+   * Headers of opened files.
+   */
+  static HeaderMap open_headers_;
+
+  /**
+   * Latch protecting the maps of opened files.
+   */
+  static std::mutex open_files_latch_;
+
+  /**
+   * Durability policy of newly opened files.
+   */
+  static Durability default_durability_;
+
   /**
    * Name of the file this object represents.
    */
   std::string filename_;
 
   /**
-   * Stream for underlying filesystem object.
+   * Reads and writes the underlying filesystem object.
+   */
+  std::shared_ptr<FileIO> io_;
+
+  /**
+   * Latch held while using io_, shared with other objects for the file.
    */
-  std::shared_ptr<std::fstream> stream_;
+  std::shared_ptr<std::recursive_mutex> latch_;
+
+  /**
+   * Header of the file, shared with other objects for the file and guarded
+   * by latch_.
+   */
+  std::shared_ptr<CachedHeader> header_;
 
   friend class FileIterator;
 };
@@ -243,33 +459,43 @@ class PageFile : public File {
    * Creates a new file.
    *
    * @param filename  Name of the file.
+   * @param backend   How to access the file.
    * @throws  FileExistsException     If the requested file already exists.
    */
-  static PageFile create(const std::string& filename);
+  static PageFile create(const std::string& filename,
+                         const FileBackend backend = BACKEND_PREAD);
 
   /**
    * Opens the file named fileName and returns the corresponding File object.
-	 * It first checks if the file is already open. If so, then the new File object created uses the same input-output stream to read to or write fom
+	 * It first checks if the file is already open. If so, then the new File object created uses the same FileIO to read from or write to
 	 * that already open file. Reference count (open_counts_ static variable inside the File object) is incremented whenever an already open file is
-	 * opened again. Otherwise the UNIX file is actually opened. The fileName and the stream associated with this File object are inserted into the
-	 * open_streams_ map.
+	 * opened again. Otherwise the UNIX file is actually opened. The fileName and the FileIO associated with this File object are inserted into the
+	 * open_files_ map.
    *
    * @param filename  Name of the file.
+   * @param backend   How to access the file; the backend it is open with, if it
+   *                  is open already.
    * @throws  FileNotFoundException   If the requested file doesn't exist.
+   * @throws  FileOpenException       If the file is open with another backend.
    */
-  static PageFile open(const std::string& filename);
+  static PageFile open(const std::string& filename,
+                       const FileBackend backend = BACKEND_PREAD);
 
   /**
    * Constructs a file object representing a file on the filesystem.
    *
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param backend     How to access the file; the backend it is open with, if it
+   *                    is open already.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
+   * @throws  FileOpenException       If the file is open with another backend.
    */
-  PageFile(const std::string& name, const bool create_new);
+  PageFile(const std::string& name, const bool create_new,
+           const FileBackend backend = BACKEND_PREAD);
 
   /**
    * Copy constructor.
@@ -300,6 +526,14 @@ class PageFile : public File {
    */
   Page allocatePage(PageId &new_page_number) override;
 
+  /**
+   * Allocates a new page in the file into the given memory.
+   *
+   * @param new_page_number Set to the number of the new page.
+   * @param new_page        Set to the new page.
+   */
+  void allocatePageInto(PageId &new_page_number, Page* new_page) override;
+
   /**
    * Reads an existing page from the file.
    *
@@ -310,6 +544,21 @@ class PageFile : public File {
    */
   Page readPage(const PageId page_number) const override;
 
+  /**
+   * Reads an existing page from the file into the given memory.
+   *
+   * @param page_number   Number of page to read.
+   * @param page          Set to the page.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   */
+  void readPageInto(const PageId page_number, Page* page) const override;
+
+  /**
+   * As File::mappedPage(), but the page must also be currently used.
+   */
+  Page* mappedPage(const PageId page_number) const override;
+
   /**
    * Writes a page into the file at the given page number.
    * No bounds checking is performed.
@@ -319,6 +568,28 @@ class PageFile : public File {
    */
   void writePage(const PageId page_number, const Page& new_page) override;
 
+  /**
+   * Reads several existing pages from the file.
+   *
+   * @param page_numbers  Numbers of pages to read.
+   * @param pages         Pages to read them into.
+   * @param count         Number of pages.
+   * @throws  InvalidPageException  If a page doesn't exist in the file or is
+   *                                not currently used.
+   */
+  void readPages(const PageId* page_numbers, Page* const* pages,
+                 const std::size_t count) const override;
+
+  /**
+   * Writes several pages into the file.
+   *
+   * @param page_numbers  Numbers of pages whose contents to replace.
+   * @param pages         Pages to write.
+   * @param count         Number of pages.
+   */
+  void writePages(const PageId* page_numbers, const Page* const* pages,
+                  const std::size_t count) override;
+
   /**
    * Deletes a page from the file.
    *
@@ -347,16 +618,17 @@ class PageFile : public File {
    * Reads a page from the file.  If <allow_free> is not set, an exception
    * will be thrown if the page read from disk is not currently in use.
    *
-   * No bounds checking is performed; the underlying file stream will throw
-   * an exception if the page is past the end of the file.
+   * No bounds checking is performed; a page past the end of the file reads
+   * as zeros.
    *
    * @param page_number   Number of page to read.
+   * @param page          Set to the page.
    * @param allow_free    Whether to allow reading a free (unused) page.
-   * @return  The page.
    * @throws  InvalidPageException  If the page is free (unused) and
    *                                allow_free is false.
    */
-  Page readPage(const PageId page_number, const bool allow_free) const;
+  void readPageInto(const PageId page_number, Page* page,
+                    const bool allow_free) const;
 
   /**
    * Writes a page into the file at the given page number with the given header.
@@ -379,6 +651,15 @@ class PageFile : public File {
    */
   PageHeader readPageHeader(const PageId page_number) const;
 
+  /**
+   * Writes only the header of the given page to disk, leaving its record
+   * data alone.  No bounds checking is performed.
+   *
+   * @param page_number   Number of page whose header is to be written.
+   * @param header        Header to write.
+   */
+  void writePageHeader(const PageId page_number, const PageHeader& header);
+
   friend class FileIterator;
 };
 
@@ -389,21 +670,27 @@ class BlobFile : public File {
    * Creates a new BlobFile.
    *
    * @param filename  Name of the file.
+   * @param backend   How to access the file.
    * @throws  FileExistsException     If the requested file already exists.
    */
-  static BlobFile create(const std::string& filename);
+  static BlobFile create(const std::string& filename,
+                         const FileBackend backend = BACKEND_PREAD);
 
   /**
    * Opens the file named fileName and returns the corresponding File object.
-	 * It first checks if the file is already open. If so, then the new File object created uses the same input-output stream to read to or write fom
+	 * It first checks if the file is already open. If so, then the new File object created uses the same FileIO to read from or write to
 	 * that already open file. Reference count (open_counts_ static variable inside the File object) is incremented whenever an already open file is
-	 * opened again. Otherwise the UNIX file is actually opened. The fileName and the stream associated with this File object are inserted into the
-	 * open_streams_ map.
+	 * opened again. Otherwise the UNIX file is actually opened. The fileName and the FileIO associated with this File object are inserted into the
+	 * open_files_ map.
    *
    * @param filename  Name of the file.
+   * @param backend   How to access the file; the backend it is open with, if it
+   *                  is open already.
    * @throws  FileNotFoundException   If the requested file doesn't exist.
+   * @throws  FileOpenException       If the file is open with another backend.
    */
-  static BlobFile open(const std::string& filename);
+  static BlobFile open(const std::string& filename,
+                       const FileBackend backend = BACKEND_PREAD);
 
   /**
    * Constructs a file object representing a file on the filesystem.
@@ -412,12 +699,16 @@ class BlobFile : public File {
    * @see File::open()
    * @param name        Name of file.
    * @param create_new  Whether to create a new file.
+   * @param backend     How to access the file; the backend it is open with, if it
+   *                    is open already.
    * @throws  FileExistsException     If the underlying file exists and
    *                                  create_new is true.
    * @throws  FileNotFoundException   If the underlying file doesn't exist and
    *                                  create_new is false.
+   * @throws  FileOpenException       If the file is open with another backend.
    */
-  BlobFile(const std::string& name, const bool create_new);
+  BlobFile(const std::string& name, const bool create_new,
+           const FileBackend backend = BACKEND_PREAD);
 
   /**
    * Copy constructor.
@@ -448,6 +739,14 @@ class BlobFile : public File {
    */
   Page allocatePage(PageId &new_page_number) override;
 
+  /**
+   * Allocates a new page in the file into the given memory.
+   *
+   * @param new_page_number Set to the number of the new page.
+   * @param new_page        Set to the new page.
+   */
+  void allocatePageInto(PageId &new_page_number, Page* new_page) override;
+
   /**
    * Reads an existing page from the file.
    *
@@ -458,6 +757,16 @@ class BlobFile : public File {
    */
   Page readPage(const PageId page_number) const override;
 
+  /**
+   * Reads an existing page from the file into the given memory.
+   *
+   * @param page_number   Number of page to read.
+   * @param page          Set to the page.
+   * @throws  InvalidPageException  If the page doesn't exist in the file or is
+   *                                not currently used.
+   */
+  void readPageInto(const PageId page_number, Page* page) const override;
+
   /**
    * Writes a page into the file at the given page number.
    * No bounds checking is performed.
@@ -467,6 +776,28 @@ class BlobFile : public File {
    */
   void writePage(const PageId page_number, const Page& new_page) override;
 
+  /**
+   * Reads several existing pages from the file.
+   *
+   * @param page_numbers  Numbers of pages to read.
+   * @param pages         Pages to read them into.
+   * @param count         Number of pages.
+   * @throws  InvalidPageException  If a page doesn't exist in the file or is
+   *                                not currently used.
+   */
+  void readPages(const PageId* page_numbers, Page* const* pages,
+                 const std::size_t count) const override;
+
+  /**
+   * Writes several pages into the file.
+   *
+   * @param page_numbers  Numbers of pages whose contents to replace.
+   * @param pages         Pages to write.
+   * @param count         Number of pages.
+   */
+  void writePages(const PageId* page_numbers, const Page* const* pages,
+                  const std::size_t count) override;
+
   /**
    * Deletes a page from the file.
    *
@@ -0,0 +1,517 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include "file_io.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "async_io.h"
+#include "exceptions/file_io_exception.h"
+
+namespace badgerdb {
+
+const std::size_t FileIO::ALIGNMENT;
+
+FileIO* FileIO::open(const std::string& name, const bool create_new,
+                     const FileBackend backend) {
+  if (backend == BACKEND_STREAM) {
+    return new StreamIO(name, create_new);
+  }
+  if (backend == BACKEND_MMAP) {
+    return new MappedIO(name, create_new);
+  }
+  return new DescriptorIO(name, create_new, backend == BACKEND_DIRECT);
+}
+
+void FileIO::readBatch(const std::uint64_t* offsets, char* const* buffers,
+                       const std::size_t length, const std::size_t count) {
+  for (std::size_t i = 0; i < count; i++) {
+    read(offsets[i], buffers[i], length);
+  }
+}
+
+void FileIO::writeBatch(const std::uint64_t* offsets,
+                        const char* const* buffers,
+                        const std::size_t length, const std::size_t count) {
+  for (std::size_t i = 0; i < count; i++) {
+    write(offsets[i], buffers[i], length);
+  }
+}
+
+void FileIO::readRun(const std::uint64_t offset, char* const* buffers,
+                     const std::size_t length, const std::size_t count) {
+  std::vector<char> run(length * count);
+  if (count > 0) {
+    read(offset, &run[0], run.size());
+  }
+  for (std::size_t i = 0; i < count; i++) {
+    std::memcpy(buffers[i], &run[i * length], length);
+  }
+}
+
+void FileIO::writeRun(const std::uint64_t offset, const char* const* buffers,
+                      const std::size_t length, const std::size_t count) {
+  std::vector<char> run(length * count);
+  for (std::size_t i = 0; i < count; i++) {
+    std::memcpy(&run[i * length], buffers[i], length);
+  }
+  if (count > 0) {
+    write(offset, &run[0], run.size());
+  }
+}
+
+StreamIO::StreamIO(const std::string& name, const bool create_new)
+    : filename_(name) {
+  std::ios_base::openmode mode =
+      std::fstream::in | std::fstream::out | std::fstream::binary;
+  if (create_new) {
+    // New files have to be truncated on open.
+    mode = mode | std::fstream::trunc;
+  }
+  stream_.open(name, mode);
+}
+
+void StreamIO::read(const std::uint64_t offset, char* buffer,
+                    const std::size_t length) {
+  stream_.seekg(offset, std::ios::beg);
+  stream_.read(buffer, length);
+  if (!stream_) {
+    // read past the end of the file; the stream must not stay failed
+    std::memset(buffer + stream_.gcount(), 0, length - stream_.gcount());
+    stream_.clear();
+  }
+}
+
+void StreamIO::write(const std::uint64_t offset, const char* buffer,
+                     const std::size_t length) {
+  stream_.seekp(offset, std::ios::beg);
+  stream_.write(buffer, length);
+}
+
+void StreamIO::sync(const bool durable) {
+  stream_.flush();
+  if (!stream_) {
+    stream_.clear();
+    throw FileIOException(filename_, EIO);
+  }
+  if (durable) {
+    // the stream has no descriptor to offer, but the data of the file can be
+    // synced through any descriptor open on it
+    int fd = ::open(filename_.c_str(), O_RDONLY);
+    if (fd < 0 || ::fdatasync(fd) != 0) {
+      int error = errno;
+      if (fd >= 0) {
+        ::close(fd);
+      }
+      throw FileIOException(filename_, error);
+    }
+    ::close(fd);
+  }
+}
+
+DescriptorIO::DescriptorIO(const std::string& name, const bool create_new,
+                           const bool direct)
+    : filename_(name), direct_(direct) {
+  int flags = O_RDWR;
+  if (create_new) {
+    flags |= O_CREAT | O_TRUNC;
+  }
+  if (direct) {
+    flags |= O_DIRECT;
+  }
+  fd_ = ::open(name.c_str(), flags, 0644);
+  if (fd_ < 0) {
+    throw FileIOException(filename_, errno);
+  }
+}
+
+DescriptorIO::~DescriptorIO() {
+  ::close(fd_);
+}
+
+bool DescriptorIO::aligned(const std::uint64_t offset, const void* buffer,
+                           const std::size_t length) const {
+  return offset % ALIGNMENT == 0 && length % ALIGNMENT == 0 &&
+      reinterpret_cast<std::uintptr_t>(buffer) % ALIGNMENT == 0;
+}
+
+void DescriptorIO::readFully(const std::uint64_t offset, char* buffer,
+                             const std::size_t length) {
+  std::size_t done = 0;
+  while (done < length) {
+    ssize_t n = ::pread(fd_, buffer + done, length - done, offset + done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw FileIOException(filename_, errno);
+    }
+    if (n == 0) {
+      // end of file
+      std::memset(buffer + done, 0, length - done);
+      return;
+    }
+    done += n;
+  }
+}
+
+void DescriptorIO::writeFully(const std::uint64_t offset, const char* buffer,
+                              const std::size_t length) {
+  std::size_t done = 0;
+  while (done < length) {
+    ssize_t n = ::pwrite(fd_, buffer + done, length - done, offset + done);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw FileIOException(filename_, errno);
+    }
+    done += n;
+  }
+}
+
+void DescriptorIO::read(const std::uint64_t offset, char* buffer,
+                        const std::size_t length) {
+  if (!direct_ || aligned(offset, buffer, length)) {
+    readFully(offset, buffer, length);
+    return;
+  }
+
+  // read the enclosing blocks into an aligned buffer
+  std::uint64_t start = offset - offset % ALIGNMENT;
+  std::size_t span = (offset + length - start + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+  void* bounce;
+  if (posix_memalign(&bounce, ALIGNMENT, span) != 0) {
+    throw FileIOException(filename_, ENOMEM);
+  }
+  try {
+    readFully(start, static_cast<char*>(bounce), span);
+  } catch (...) {
+    free(bounce);
+    throw;
+  }
+  std::memcpy(buffer, static_cast<char*>(bounce) + (offset - start), length);
+  free(bounce);
+}
+
+void DescriptorIO::write(const std::uint64_t offset, const char* buffer,
+                         const std::size_t length) {
+  if (!direct_ || aligned(offset, buffer, length)) {
+    writeFully(offset, buffer, length);
+    return;
+  }
+
+  // patch the bytes into the enclosing blocks and write those back; blocks
+  // past the end of the file read as zero, which only pads the file
+  std::uint64_t start = offset - offset % ALIGNMENT;
+  std::size_t span = (offset + length - start + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+  void* bounce;
+  if (posix_memalign(&bounce, ALIGNMENT, span) != 0) {
+    throw FileIOException(filename_, ENOMEM);
+  }
+  try {
+    char* blocks = static_cast<char*>(bounce);
+    if (offset != start) {
+      readFully(start, blocks, ALIGNMENT);
+    }
+    if ((offset + length) % ALIGNMENT != 0 &&
+        (span > ALIGNMENT || offset == start)) {
+      readFully(start + span - ALIGNMENT, blocks + span - ALIGNMENT, ALIGNMENT);
+    }
+    std::memcpy(blocks + (offset - start), buffer, length);
+    writeFully(start, blocks, span);
+  } catch (...) {
+    free(bounce);
+    throw;
+  }
+  free(bounce);
+}
+
+void DescriptorIO::sync(const bool durable) {
+  // writes reach the operating system as they are made; fdatasync also
+  // covers the size of the file, which is all the metadata a reader needs
+  if (durable && ::fdatasync(fd_) != 0) {
+    throw FileIOException(filename_, errno);
+  }
+}
+
+void DescriptorIO::readBatch(const std::uint64_t* offsets,
+                             char* const* buffers, const std::size_t length,
+                             const std::size_t count) {
+  // unaligned direct reads land in bounce buffers over the enclosing blocks
+  std::vector<IORequest> requests(count);
+  std::vector<void*> bounces(count, NULL);
+  int error = 0;
+  for (std::size_t i = 0; i < count; i++) {
+    IORequest& request = requests[i];
+    request.fd = fd_;
+    request.write = false;
+    request.buffer = buffers[i];
+    request.length = length;
+    request.offset = offsets[i];
+    if (direct_ && !aligned(offsets[i], buffers[i], length)) {
+      request.offset = offsets[i] - offsets[i] % ALIGNMENT;
+      request.length = (offsets[i] + length - request.offset + ALIGNMENT - 1) /
+          ALIGNMENT * ALIGNMENT;
+      if (posix_memalign(&bounces[i], ALIGNMENT, request.length) != 0) {
+        bounces[i] = NULL;
+        error = ENOMEM;
+      }
+      request.buffer = static_cast<char*>(bounces[i]);
+    }
+  }
+
+  if (error == 0 && count > 0) {
+    AsyncIO::local().run(&requests[0], count);
+  }
+
+  for (std::size_t i = 0; i < count && error == 0; i++) {
+    IORequest& request = requests[i];
+    if (request.result < 0) {
+      error = static_cast<int>(-request.result);
+      break;
+    }
+    // finish short reads, which stop at the end of the file or were cut
+    // short; a direct read only stops short at the end of the file
+    if (static_cast<std::size_t>(request.result) < request.length && direct_) {
+      std::memset(request.buffer + request.result, 0,
+                  request.length - request.result);
+    } else if (static_cast<std::size_t>(request.result) < request.length) {
+      try {
+        readFully(request.offset + request.result,
+                  request.buffer + request.result,
+                  request.length - request.result);
+      } catch (const FileIOException& e) {
+        error = e.error();
+        break;
+      }
+    }
+    if (bounces[i] != NULL) {
+      std::memcpy(buffers[i], request.buffer + (offsets[i] - request.offset),
+                  length);
+    }
+  }
+
+  for (std::size_t i = 0; i < count; i++) {
+    free(bounces[i]);
+  }
+  if (error != 0) {
+    throw FileIOException(filename_, error);
+  }
+}
+
+void DescriptorIO::writeBatch(const std::uint64_t* offsets,
+                              const char* const* buffers,
+                              const std::size_t length,
+                              const std::size_t count) {
+  std::vector<IORequest> requests(count);
+  for (std::size_t i = 0; i < count; i++) {
+    if (direct_ && !aligned(offsets[i], buffers[i], length)) {
+      // read-modify-writes of shared blocks must not overlap
+      FileIO::writeBatch(offsets, buffers, length, count);
+      return;
+    }
+    IORequest& request = requests[i];
+    request.fd = fd_;
+    request.write = true;
+    request.buffer = const_cast<char*>(buffers[i]);
+    request.length = length;
+    request.offset = offsets[i];
+  }
+
+  if (count > 0) {
+    AsyncIO::local().run(&requests[0], count);
+  }
+
+  for (std::size_t i = 0; i < count; i++) {
+    IORequest& request = requests[i];
+    if (request.result < 0) {
+      throw FileIOException(filename_, static_cast<int>(-request.result));
+    }
+    if (static_cast<std::size_t>(request.result) < length) {
+      writeFully(request.offset + request.result,
+                 request.buffer + request.result, length - request.result);
+    }
+  }
+}
+
+void DescriptorIO::readRun(const std::uint64_t offset,
+                           char* const* buffers, const std::size_t length,
+                           const std::size_t count) {
+  if (direct_) {
+    for (std::size_t i = 0; i < count; i++) {
+      if (!aligned(offset + i * length, buffers[i], length)) {
+        // one bounced read of the blocks the whole run spans
+        FileIO::readRun(offset, buffers, length, count);
+        return;
+      }
+    }
+  }
+
+  std::vector<iovec> vectors(count);
+  for (std::size_t i = 0; i < count; i++) {
+    vectors[i].iov_base = buffers[i];
+    vectors[i].iov_len = length;
+  }
+
+  std::size_t first = 0;
+  std::uint64_t position = offset;
+  while (first < count) {
+    int n = static_cast<int>(std::min<std::size_t>(count - first, IOV_MAX));
+    ssize_t done = ::preadv(fd_, &vectors[first], n, position);
+    if (done < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw FileIOException(filename_, errno);
+    }
+    if (done == 0) {
+      // end of file
+      for (; first < count; first++) {
+        std::memset(vectors[first].iov_base, 0, vectors[first].iov_len);
+      }
+      return;
+    }
+    position += done;
+    // skip what was read, which may end inside a buffer
+    while (done > 0) {
+      if (static_cast<std::size_t>(done) >= vectors[first].iov_len) {
+        done -= vectors[first].iov_len;
+        first++;
+      } else {
+        vectors[first].iov_base =
+            static_cast<char*>(vectors[first].iov_base) + done;
+        vectors[first].iov_len -= done;
+        done = 0;
+      }
+    }
+  }
+}
+
+void DescriptorIO::writeRun(const std::uint64_t offset,
+                            const char* const* buffers,
+                            const std::size_t length,
+                            const std::size_t count) {
+  if (direct_) {
+    for (std::size_t i = 0; i < count; i++) {
+      if (!aligned(offset + i * length, buffers[i], length)) {
+        // one read-modify-write of the blocks the whole run spans
+        FileIO::writeRun(offset, buffers, length, count);
+        return;
+      }
+    }
+  }
+
+  std::vector<iovec> vectors(count);
+  for (std::size_t i = 0; i < count; i++) {
+    vectors[i].iov_base = const_cast<char*>(buffers[i]);
+    vectors[i].iov_len = length;
+  }
+
+  std::size_t first = 0;
+  std::uint64_t position = offset;
+  while (first < count) {
+    int n = static_cast<int>(std::min<std::size_t>(count - first, IOV_MAX));
+    ssize_t written = ::pwritev(fd_, &vectors[first], n, position);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      throw FileIOException(filename_, errno);
+    }
+    position += written;
+    // skip what was written, which may end inside a buffer
+    while (written > 0) {
+      if (static_cast<std::size_t>(written) >= vectors[first].iov_len) {
+        written -= vectors[first].iov_len;
+        first++;
+      } else {
+        vectors[first].iov_base =
+            static_cast<char*>(vectors[first].iov_base) + written;
+        vectors[first].iov_len -= written;
+        written = 0;
+      }
+    }
+  }
+}
+
+MappedIO::MappedIO(const std::string& name, const bool create_new)
+    : filename_(name), data_(NULL), length_(0) {
+  if (create_new) {
+    // a new file has nothing to map, and a mapped file cannot be written
+    throw FileIOException(filename_, EROFS);
+  }
+  int fd = ::open(name.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw FileIOException(filename_, errno);
+  }
+  struct stat status;
+  if (::fstat(fd, &status) != 0) {
+    int error = errno;
+    ::close(fd);
+    throw FileIOException(filename_, error);
+  }
+  length_ = status.st_size;
+  if (length_ > 0) {
+    void* data = ::mmap(NULL, length_, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+      int error = errno;
+      ::close(fd);
+      throw FileIOException(filename_, error);
+    }
+    data_ = static_cast<char*>(data);
+  }
+  // the mapping keeps the file open
+  ::close(fd);
+}
+
+MappedIO::~MappedIO() {
+  if (data_ != NULL) {
+    ::munmap(data_, length_);
+  }
+}
+
+void MappedIO::read(const std::uint64_t offset, char* buffer,
+                    const std::size_t length) {
+  std::size_t available = offset < length_ ? length_ - offset : 0;
+  std::size_t copied = std::min(length, available);
+  if (copied > 0) {
+    std::memcpy(buffer, data_ + offset, copied);
+  }
+  // bytes past the end of the file read as zero
+  std::memset(buffer + copied, 0, length - copied);
+}
+
+void MappedIO::write(const std::uint64_t offset, const char* buffer,
+                     const std::size_t length) {
+  throw FileIOException(filename_, EROFS);
+}
+
+void MappedIO::advise(const std::uint64_t offset, const std::size_t length,
+                      const int advice) {
+  if (offset >= length_) {
+    return;
+  }
+  // madvise() wants the start of a memory page
+  const std::uint64_t page_size = ::sysconf(_SC_PAGESIZE);
+  std::uint64_t start = offset - offset % page_size;
+  std::size_t end = std::min<std::uint64_t>(offset + length, length_);
+  // the advice is only a hint, so it failing is no error
+  ::madvise(data_ + start, end - start, advice);
+}
+
+}
@@ -0,0 +1,353 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+namespace badgerdb {
+
+/**
+ * @brief How a File reads and writes the underlying filesystem file.
+ */
+enum FileBackend {
+  /**
+   * Through a std::fstream, whose buffer holds writes until it fills or the
+   * file is synced.
+   */
+  BACKEND_STREAM,
+
+  /**
+   * With pread/pwrite on a file descriptor, through the OS page cache.  The
+   * default.
+   */
+  BACKEND_PREAD,
+
+  /**
+   * With pread/pwrite on a file descriptor opened with O_DIRECT, bypassing the
+   * OS page cache, which would otherwise hold a second copy of every page the
+   * buffer pool caches.
+   */
+  BACKEND_DIRECT,
+
+  /**
+   * Mapped into memory read-only, for files that no longer change.  The
+   * buffer manager hands out pages of such a file straight from the mapping,
+   * without pinning them or caching a copy.  Writes fail with EROFS.
+   */
+  BACKEND_MMAP
+};
+
+/**
+ * @brief How far a File forces its writes out on its own.
+ *
+ * File::sync() writes the file header, which a File keeps in memory between
+ * syncs, and hands every write made so far to the operating system, so that
+ * it survives a crash of the process.  Closing the file does the same.  The
+ * policy decides whether the buffer manager's flushFile() also syncs, and
+ * whether a sync waits for the disk.
+ */
+enum Durability {
+  /**
+   * Syncs only when asked to and when the file is closed.  Pages allocated
+   * since then are lost if the process dies.
+   */
+  DURABILITY_NONE,
+
+  /**
+   * Also syncs when BufMgr::flushFile() writes the file back.  The default.
+   */
+  DURABILITY_FLUSH,
+
+  /**
+   * As DURABILITY_FLUSH, and every sync also waits for fdatasync, so that the
+   * writes survive a crash of the system.
+   */
+  DURABILITY_SYNC
+};
+
+/**
+ * @brief Positional reads and writes of an open filesystem file.
+ *
+ * One FileIO is shared by all File objects open on the same file, which
+ * serialize their calls with the file's latch.
+ */
+class FileIO {
+ public:
+  /**
+   * Alignment of offsets, lengths and memory required by O_DIRECT, and of the
+   * frames of the buffer pool.
+   */
+  static const std::size_t ALIGNMENT = 4096;
+
+  /**
+   * Opens a file with the given backend.
+   *
+   * @param name        Name of file.
+   * @param create_new  Whether to create the file, truncating any existing one.
+   * @param backend     How to access the file.
+   * @return  New FileIO, owned by the caller.
+   * @throws  FileIOException   If the operating system cannot open the file.
+   */
+  static FileIO* open(const std::string& name, const bool create_new,
+                      const FileBackend backend);
+
+  virtual ~FileIO() {}
+
+  /**
+   * Reads length bytes at offset into buffer.  Bytes past the end of the file
+   * read as zero.
+   *
+   * @throws  FileIOException   If the read fails.
+   */
+  virtual void read(const std::uint64_t offset, char* buffer,
+                    const std::size_t length) = 0;
+
+  /**
+   * Writes length bytes from buffer at offset, extending the file if needed.
+   *
+   * @throws  FileIOException   If the write fails.
+   */
+  virtual void write(const std::uint64_t offset, const char* buffer,
+                     const std::size_t length) = 0;
+
+  /**
+   * Reads count ranges of length bytes, the i-th at offsets[i] into
+   * buffers[i], with as many reads in flight at once as the backend allows.
+   * The default runs them one after the other.
+   *
+   * @throws  FileIOException   If a read fails; the other reads still complete.
+   */
+  virtual void readBatch(const std::uint64_t* offsets, char* const* buffers,
+                         const std::size_t length, const std::size_t count);
+
+  /**
+   * Writes count ranges of length bytes, the i-th from buffers[i] at
+   * offsets[i], with as many writes in flight at once as the backend allows.
+   * The default runs them one after the other.
+   *
+   * @throws  FileIOException   If a write fails; the other writes still complete.
+   */
+  virtual void writeBatch(const std::uint64_t* offsets,
+                          const char* const* buffers,
+                          const std::size_t length, const std::size_t count);
+
+  /**
+   * Reads count buffers of length bytes back to back, the first at offset.
+   * The default makes a single read() and scatters it.
+   *
+   * @throws  FileIOException   If the read fails.
+   */
+  virtual void readRun(const std::uint64_t offset, char* const* buffers,
+                       const std::size_t length, const std::size_t count);
+
+  /**
+   * Writes count buffers of length bytes back to back, the first at offset.
+   * The default gathers them and makes a single write().
+   *
+   * @throws  FileIOException   If the write fails.
+   */
+  virtual void writeRun(const std::uint64_t offset, const char* const* buffers,
+                        const std::size_t length, const std::size_t count);
+
+  /**
+   * Hands every write made so far to the operating system and, if durable is
+   * set, waits until it has written them to disk.
+   *
+   * @throws  FileIOException   If the operating system reports an error.
+   */
+  virtual void sync(const bool durable) = 0;
+
+  /**
+   * Returns the backend the file was opened with.
+   */
+  virtual FileBackend backend() const = 0;
+
+  /**
+   * Returns the start of the file in memory if it is mapped, otherwise NULL.
+   *
+   * @param length  Set to the number of bytes mapped.
+   */
+  virtual const char* mapping(std::size_t& length) const {
+    length = 0;
+    return NULL;
+  }
+
+  /**
+   * Tells the operating system how a range of a mapped file is going to be
+   * read, with an madvise() advice such as MADV_WILLNEED.  Does nothing if
+   * the file is not mapped.
+   */
+  virtual void advise(const std::uint64_t offset, const std::size_t length,
+                      const int advice) {}
+
+  /**
+   * Returns the durability policy of the file.
+   */
+  Durability durability() const { return durability_; }
+
+  /**
+   * Sets the durability policy of the file.
+   */
+  void setDurability(const Durability durability) { durability_ = durability; }
+
+ protected:
+  FileIO() : durability_(DURABILITY_FLUSH) {}
+
+ private:
+  /**
+   * Durability policy of the file.
+   */
+  Durability durability_;
+};
+
+/**
+ * @brief FileIO through a std::fstream.
+ */
+class StreamIO : public FileIO {
+ public:
+  StreamIO(const std::string& name, const bool create_new);
+
+  void read(const std::uint64_t offset, char* buffer,
+            const std::size_t length) override;
+  void write(const std::uint64_t offset, const char* buffer,
+             const std::size_t length) override;
+  void sync(const bool durable) override;
+  FileBackend backend() const override { return BACKEND_STREAM; }
+
+ private:
+  /**
+   * Name of the file, to open a descriptor on it for fdatasync.
+   */
+  std::string filename_;
+
+  /**
+   * Stream for underlying filesystem object.
+   */
+  std::fstream stream_;
+};
+
+/**
+ * @brief FileIO with pread/pwrite on a file descriptor, optionally opened with
+ *        O_DIRECT.
+ *
+ * Batches go through the calling thread's AsyncIO engine, io_uring or a pool
+ * of pread/pwrite workers.
+ *
+ * Pages of a BadgerDB file start sizeof(FileHeader) bytes past a multiple of
+ * the page size, so in direct mode most transfers do not start on an
+ * ALIGNMENT boundary.  Those go through an aligned bounce buffer spanning the
+ * enclosing blocks; a write then reads, patches and rewrites the blocks it
+ * shares with its neighbours, which is safe because calls on a file are
+ * serialized.  Aligned transfers into aligned memory go straight to the
+ * device.  Batched reads use one bounce buffer per read; batched writes that
+ * need one are run one after the other, since neighbouring pages of a batch
+ * share blocks.  A run of adjacent buffers is read with preadv and written
+ * with pwritev, or in direct mode scattered from a single bounced read and
+ * gathered into a single bounced write.
+ */
+class DescriptorIO : public FileIO {
+ public:
+  DescriptorIO(const std::string& name, const bool create_new,
+               const bool direct);
+  ~DescriptorIO();
+
+  void read(const std::uint64_t offset, char* buffer,
+            const std::size_t length) override;
+  void write(const std::uint64_t offset, const char* buffer,
+             const std::size_t length) override;
+  void readBatch(const std::uint64_t* offsets, char* const* buffers,
+                 const std::size_t length, const std::size_t count) override;
+  void writeBatch(const std::uint64_t* offsets, const char* const* buffers,
+                  const std::size_t length, const std::size_t count) override;
+  void readRun(const std::uint64_t offset, char* const* buffers,
+               const std::size_t length, const std::size_t count) override;
+  void writeRun(const std::uint64_t offset, const char* const* buffers,
+                const std::size_t length, const std::size_t count) override;
+  void sync(const bool durable) override;
+  FileBackend backend() const override {
+    return direct_ ? BACKEND_DIRECT : BACKEND_PREAD;
+  }
+
+ private:
+  /**
+   * Reads exactly length bytes at offset, zero filling past the end of file.
+   */
+  void readFully(const std::uint64_t offset, char* buffer,
+                 const std::size_t length);
+
+  /**
+   * Writes exactly length bytes at offset.
+   */
+  void writeFully(const std::uint64_t offset, const char* buffer,
+                  const std::size_t length);
+
+  /**
+   * Returns true if a transfer can skip the bounce buffer.
+   */
+  bool aligned(const std::uint64_t offset, const void* buffer,
+               const std::size_t length) const;
+
+  /**
+   * Name of the file, for error messages.
+   */
+  std::string filename_;
+
+  /**
+   * Descriptor of the open file.
+   */
+  int fd_;
+
+  /**
+   * Whether fd_ was opened with O_DIRECT.
+   */
+  bool direct_;
+};
+
+/**
+ * @brief Read-only FileIO over a mapping of the whole file.
+ *
+ * The file is mapped as it is when opened; it must not grow or shrink while
+ * it is mapped.  Reads copy out of the mapping, and the buffer manager reads
+ * pages in place through mapping().
+ */
+class MappedIO : public FileIO {
+ public:
+  MappedIO(const std::string& name, const bool create_new);
+  ~MappedIO();
+
+  void read(const std::uint64_t offset, char* buffer,
+            const std::size_t length) override;
+  void write(const std::uint64_t offset, const char* buffer,
+             const std::size_t length) override;
+  void sync(const bool durable) override {}
+  FileBackend backend() const override { return BACKEND_MMAP; }
+  const char* mapping(std::size_t& length) const override {
+    length = length_;
+    return data_;
+  }
+  void advise(const std::uint64_t offset, const std::size_t length,
+              const int advice) override;
+
+ private:
+  /**
+   * Name of the file, for error messages.
+   */
+  std::string filename_;
+
+  /**
+   * Start and size of the mapping; NULL for an empty file, which cannot be
+   * mapped.
+   */
+  char* data_;
+  std::size_t length_;
+};
+
+}
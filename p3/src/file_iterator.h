@@ -94,6 +94,14 @@ class FileIterator {
         (current_page_number_ != rhs.current_page_number_);
   }
 
+  /**
+   * Returns the number of the current page without reading it from the file.
+   *
+   * @return  Number of the current page.
+   */
+	inline PageId page_number() const
+  { return current_page_number_; }
+
   /**
    * Dereferences the iterator, returning a copy of the current page in the
    * file.
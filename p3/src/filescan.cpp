@@ -5,30 +5,30 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <errno.h>
 #include "filescan.h"
 #include "exceptions/end_of_file_exception.h"
+#include "exceptions/file_io_exception.h"
 
 namespace badgerdb { 
 
-FileScan::FileScan(const std::string &name, BufMgr *bufferMgr)
+FileScan::FileScan(const std::string &name, BufMgr *bufferMgr, const int readAheadPages,
+                   const AccessStrategy accessStrategy, const FileBackend backend)
 {
-  file = new PageFile(name, false);	//dont create new file
+  file = new PageFile(name, false, backend);	//dont create new file
+  if (accessStrategy == ACCESS_SEQUENTIAL)
+    file->adviseSequential();
 	bufMgr = bufferMgr;
-	curDirtyFlag = false;
-  curPage = NULL;
 	filePageIter = file->begin();
+	readAhead = readAheadPages;
+	pagesAhead = 0;
+	strategy = accessStrategy;
 }
 
 FileScan::~FileScan()
 {
   // generally must unpin last page of the scan
-  if (curPage != NULL)
-  {
-    bufMgr->unPinPage(file, (*filePageIter).page_number(), curDirtyFlag);
-    curPage = NULL;
-		curDirtyFlag = false;
-    filePageIter = file->begin();
-  }
+  curPage.release();
   bufMgr->flushFile(file);
   delete file;
 }
@@ -43,7 +43,7 @@ void FileScan::scanNext(RecordId& outRid)
 	}
 
   // special case of the first record of the first page of the file
-  if (curPage == NULL)
+  if (curPage.empty())
   {
     // need to get the first page of the file
 		filePageIter = file->begin();
@@ -51,10 +51,16 @@ void FileScan::scanNext(RecordId& outRid)
 		{
 			throw EndOfFileException();
 		}
-	 
+
 		// read the first page of the file
-    bufMgr->readPage(file, (*filePageIter).page_number(), curPage); 
-		curDirtyFlag = false;
+    curPage = bufMgr->readPage(file, filePageIter.page_number(), strategy); 
+
+		// start reading ahead of the first page
+		if (readAhead > 0)
+		{
+			pagesAhead = 0;
+			prefetchAhead();
+		}
 
 		// get the first record off the page
     pageRecordIter = curPage->begin(); 
@@ -76,19 +82,21 @@ void FileScan::scanNext(RecordId& outRid)
   while (pageRecordIter == curPage->end())
   {
     // unpin the current page
-    bufMgr->unPinPage(file, (*filePageIter).page_number(), curDirtyFlag);
-    curPage = NULL;
-    curDirtyFlag = false;
+    curPage.release();
 
     filePageIter++;
     if (filePageIter == file->end())
     {
-      curPage = NULL;
 			throw EndOfFileException();
     }
 
+    if (pagesAhead > 0)
+      pagesAhead--;
+
     // read the next page of the file
-    bufMgr->readPage(file, (*filePageIter).page_number(), curPage);
+    curPage = bufMgr->readPage(file, filePageIter.page_number(), strategy);
+    if (readAhead > 0)
+      prefetchAhead();
 
     // get the first record off the page
     pageRecordIter = curPage->begin(); 
@@ -104,6 +112,18 @@ void FileScan::scanNext(RecordId& outRid)
 	return;
 }
 
+// tops the read ahead window back up once half of it has been read, so the
+// prefetch threads are woken once per batch rather than once per page; the
+// pages after the current one are found from the headers of the pages in
+// the pool rather than read from disk here
+void FileScan::prefetchAhead()
+{
+  if (pagesAhead > readAhead / 2)
+    return;
+  bufMgr->prefetchFollowing(file, filePageIter.page_number(), readAhead, strategy);
+  pagesAhead = readAhead;
+}
+
 // returns pointer to the current record.  page is left pinned
 // and the scan logic is required to unpin the page 
 std::string FileScan::getRecord()
@@ -114,7 +134,10 @@ std::string FileScan::getRecord()
 // mark current page of scan dirty
 void FileScan::markDirty()
 {
-  curDirtyFlag = true;
+  // the guard of a mapped page holds no pin to write the page back from
+  if (file->mapped())
+    throw FileIOException(file->filename(), EROFS);
+  curPage.markDirty();
 }
 
 }
@@ -19,12 +19,32 @@ namespace badgerdb {
 
 /**
  * @brief This class is used to sequentially scan records in a relation.
+ *
+ * The scan can ask the buffer manager to prefetch the next few pages of the
+ * file while it works through the current one; the prefetch threads find
+ * their page numbers, so the scan reads nothing more from disk for them.
+ * Its pages are read with
+ * ACCESS_SEQUENTIAL by default, so that they recycle a few frames of their
+ * own rather than evicting the rest of the buffer pool.
+ *
+ * A relation that no longer changes can be scanned with BACKEND_MMAP, in
+ * which case the pages come straight from the mapping of the file, the
+ * operating system is told that the file is read in order, and the pages
+ * read ahead are left to it to read in.  markDirty() throws FileIOException
+ * on such a scan.
  */
 class FileScan
 {
  public:
 
-  FileScan(const std::string &name, BufMgr *bufMgr);
+  /**
+   * Number of pages read ahead by default, none as read ahead has not been
+   * shown to shorten a scan
+   */
+  static const int READ_AHEAD = 0;
+
+  FileScan(const std::string &name, BufMgr *bufMgr, const int readAhead = READ_AHEAD,
+           const AccessStrategy strategy = ACCESS_SEQUENTIAL, const FileBackend backend = BACKEND_PREAD);
 
   ~FileScan();
 
@@ -49,17 +69,29 @@ class FileScan
 	BufMgr				*bufMgr;
 
   /**
-   * Current page being scanned.
+   * Current page being scanned, marked dirty by markDirty().
    */
-  Page*         curPage;
+  PageGuard     curPage;
 
   FileIterator  filePageIter;
   PageIterator  pageRecordIter;
 
   /**
-   * True if page has been updated
+   * Number of pages to keep prefetched ahead of the current one, and the
+   * number of pages prefetched ahead of it now
+   */
+  int           readAhead;
+  int           pagesAhead;
+
+  /**
+   * Strategy the pages of the scan are read with
+   */
+  AccessStrategy strategy;
+
+  /**
+   * Prefetches more pages once the scan has used up half of the read ahead.
    */
-  bool  	      curDirtyFlag;
+  void prefetchAhead();
 };
 
 }
@@ -0,0 +1,88 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include "histogram.h"
+
+namespace badgerdb {
+
+const int Histogram::NUM_BUCKETS;
+
+Histogram::Histogram()
+{
+	clear();
+}
+
+int Histogram::bucketOf(const std::uint64_t value)
+{
+	return value == 0 ? 0 : 64 - __builtin_clzll(value);
+}
+
+std::uint64_t Histogram::upperBound(const int bucket)
+{
+	if (bucket == 0)
+		return 0;
+	if (bucket == 64)
+		return ~std::uint64_t(0);
+	return (std::uint64_t(1) << bucket) - 1;
+}
+
+void Histogram::record(const std::uint64_t value)
+{
+	buckets[bucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+	total.fetch_add(1, std::memory_order_relaxed);
+	sumOfValues.fetch_add(value, std::memory_order_relaxed);
+
+	std::uint64_t largest = maxValue.load(std::memory_order_relaxed);
+	while (value > largest && !maxValue.compare_exchange_weak(largest, value, std::memory_order_relaxed))
+		;
+}
+
+void Histogram::clear()
+{
+	for (int b = 0; b < NUM_BUCKETS; b++)
+		buckets[b] = 0;
+	total = 0;
+	sumOfValues = 0;
+	maxValue = 0;
+}
+
+std::uint64_t Histogram::percentile(const double fraction) const
+{
+	// samples recorded meanwhile may leave the buckets short of the total
+	std::uint64_t rank = static_cast<std::uint64_t>(std::ceil(fraction * total));
+	if (rank == 0)
+		rank = 1;
+	std::uint64_t seen = 0;
+	for (int b = 0; b < NUM_BUCKETS; b++)
+	{
+		seen += buckets[b];
+		if (seen >= rank)
+			return std::min<std::uint64_t>(upperBound(b), maxValue);
+	}
+	return maxValue;
+}
+
+void Histogram::writeJson(std::ostream& out) const
+{
+	out << "{\"count\":" << count() << ",\"sum\":" << sum() << ",\"max\":" << max()
+			<< ",\"p50\":" << percentile(0.5) << ",\"p90\":" << percentile(0.9)
+			<< ",\"p99\":" << percentile(0.99) << ",\"buckets\":[";
+	bool first = true;
+	for (int b = 0; b < NUM_BUCKETS; b++)
+	{
+		std::uint64_t n = buckets[b];
+		if (n == 0)
+			continue;
+		out << (first ? "" : ",") << "[" << upperBound(b) << "," << n << "]";
+		first = false;
+	}
+	out << "]}";
+}
+
+}
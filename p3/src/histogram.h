@@ -0,0 +1,114 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+
+namespace badgerdb {
+
+/**
+* @brief Distribution of non-negative integer samples, such as latencies in
+* nanoseconds, in power of two buckets.
+*
+* Bucket 0 counts zeros and bucket b > 0 counts the values in [2^(b-1), 2^b),
+* so percentiles are known to within a factor of two. Samples may be recorded
+* from several threads at once without a latch.
+*/
+class Histogram
+{
+ public:
+	/**
+	 * Number of buckets, enough for any 64 bit value
+	 */
+	static const int NUM_BUCKETS = 65;
+
+	/**
+	 * Constructor of Histogram class
+	 */
+	Histogram();
+
+	/**
+	 * Adds a sample.
+	 *
+	 * @param value		Value of the sample
+	 */
+	void record(const std::uint64_t value);
+
+	/**
+	 * Forgets all samples.
+	 */
+	void clear();
+
+	/**
+	 * Returns the number of samples.
+	 */
+	std::uint64_t count() const { return total; }
+
+	/**
+	 * Returns the sum of the samples.
+	 */
+	std::uint64_t sum() const { return sumOfValues; }
+
+	/**
+	 * Returns the largest sample, 0 if there is none.
+	 */
+	std::uint64_t max() const { return maxValue; }
+
+	/**
+	 * Returns an upper bound of the given percentile: the largest value the
+	 * bucket holding it can hold, but no more than the largest sample.
+	 *
+	 * @param fraction	Percentile as a fraction, 0.5 for the median
+	 * @return					Upper bound of the percentile, 0 if there are no samples
+	 */
+	std::uint64_t percentile(const double fraction) const;
+
+	/**
+	 * Writes the histogram as a JSON object with its count, sum, largest
+	 * sample, median, 90th and 99th percentiles, and the non-empty buckets as
+	 * [upper bound, count] pairs.
+	 *
+	 * @param out		Stream to write to
+	 */
+	void writeJson(std::ostream& out) const;
+
+ private:
+	/**
+	 * Returns the bucket counting a value.
+	 */
+	static int bucketOf(const std::uint64_t value);
+
+	/**
+	 * Returns the largest value a bucket counts.
+	 */
+	static std::uint64_t upperBound(const int bucket);
+
+	/**
+	 * Number of samples in each bucket
+	 */
+	std::atomic<std::uint64_t> buckets[NUM_BUCKETS];
+
+	/**
+	 * Number of samples
+	 */
+	std::atomic<std::uint64_t> total;
+
+	/**
+	 * Sum of the samples
+	 */
+	std::atomic<std::uint64_t> sumOfValues;
+
+	/**
+	 * Largest sample
+	 */
+	std::atomic<std::uint64_t> maxValue;
+};
+
+}
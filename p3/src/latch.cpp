@@ -0,0 +1,112 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <thread>
+#include "latch.h"
+
+namespace badgerdb {
+
+const std::uint64_t FrameLatch::EXCLUSIVE;
+const std::uint64_t FrameLatch::SHARED;
+const std::uint64_t FrameLatch::READERS;
+const int FrameLatch::VERSION_SHIFT;
+const std::uint64_t FrameLatch::VERSION;
+
+namespace {
+
+/**
+ * Spins a few rounds before giving the processor away, which on a machine
+ * with fewer cores than threads is the only way the holder gets to run.
+ */
+void backOff(int& round)
+{
+	if (++round < 64)
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_ia32_pause();
+#endif
+	}
+	else
+		std::this_thread::yield();
+}
+
+}
+
+bool FrameLatch::lockShared()
+{
+	std::uint64_t now = state.load(std::memory_order_relaxed);
+	int round = 0;
+	while (true)
+	{
+		if ((now & EXCLUSIVE) == 0 &&
+				state.compare_exchange_weak(now, now + SHARED, std::memory_order_acquire, std::memory_order_relaxed))
+			return round > 0;
+		if (now & EXCLUSIVE)
+		{
+			backOff(round);
+			now = state.load(std::memory_order_relaxed);
+		}
+	}
+}
+
+bool FrameLatch::lockExclusive()
+{
+	std::uint64_t now = state.load(std::memory_order_relaxed);
+	int round = 0;
+	while (true)
+	{
+		if ((now & EXCLUSIVE) == 0 &&
+				state.compare_exchange_weak(now, now | EXCLUSIVE, std::memory_order_acquire, std::memory_order_relaxed))
+			break;
+		if (now & EXCLUSIVE)
+		{
+			backOff(round);
+			now = state.load(std::memory_order_relaxed);
+		}
+	}
+	bool waited = round > 0;
+	drainReaders(waited);
+	return waited;
+}
+
+std::uint64_t FrameLatch::readVersion(bool& waited)
+{
+	std::uint64_t now = state.load(std::memory_order_acquire);
+	int round = 0;
+	while (now & EXCLUSIVE)
+	{
+		backOff(round);
+		now = state.load(std::memory_order_acquire);
+	}
+	waited = round > 0;
+	return now >> VERSION_SHIFT;
+}
+
+bool FrameLatch::tryUpgrade(const std::uint64_t version)
+{
+	std::uint64_t now = state.load(std::memory_order_relaxed);
+	while ((now & EXCLUSIVE) == 0 && now >> VERSION_SHIFT == version)
+	{
+		if (state.compare_exchange_weak(now, now | EXCLUSIVE, std::memory_order_acquire, std::memory_order_relaxed))
+		{
+			bool waited = false;
+			drainReaders(waited);
+			return true;
+		}
+	}
+	return false;
+}
+
+void FrameLatch::drainReaders(bool& waited)
+{
+	int round = 0;
+	while (state.load(std::memory_order_acquire) & READERS)
+		backOff(round);
+	waited = waited || round > 0;
+}
+
+}
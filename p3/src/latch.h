@@ -0,0 +1,121 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+namespace badgerdb {
+
+/**
+* @brief Ways of latching the contents of a page held by a PageGuard
+*/
+enum LatchMode
+{
+	LATCH_NONE,				/* Only pinned; the page may change underneath */
+	LATCH_SHARED,			/* Read; other readers may hold the page too */
+	LATCH_EXCLUSIVE,	/* Written; nobody else reads or writes the page */
+	LATCH_OPTIMISTIC	/* Read without latching, and checked afterwards */
+};
+
+/**
+* @brief Reader-writer latch of a buffer frame, with a version for optimistic
+* readers, in a single 64 bit word.
+*
+* Bit 0 is set while a writer holds or waits for the latch, bits 1 to 15
+* count the readers holding it, and the bits above are the version, which
+* goes up every time a writer lets go. A writer announces itself before the
+* readers have left, so that new readers wait behind it instead of keeping
+* it out for ever. An optimistic reader takes nothing: it remembers the
+* version, reads, and validates that no writer came in meanwhile; readers
+* holding the latch shared do not disturb it.
+*
+* Waiters spin and then yield, as latches on frames are held for the few
+* instructions it takes to read or change a page.
+*/
+class FrameLatch
+{
+ public:
+	/**
+	 * Constructor of FrameLatch class, unlatched at version 0
+	 */
+	FrameLatch() : state(0) {}
+
+	/**
+	 * Waits until no writer holds or waits for the latch, then holds it shared.
+	 *
+	 * @return				True if the caller had to wait
+	 */
+	bool lockShared();
+
+	/**
+	 * Lets go of a shared hold.
+	 */
+	void unlockShared() { state.fetch_sub(SHARED, std::memory_order_release); }
+
+	/**
+	 * Waits until the latch is free, then holds it exclusively.
+	 *
+	 * @return				True if the caller had to wait
+	 */
+	bool lockExclusive();
+
+	/**
+	 * Lets go of an exclusive hold, moving to the next version.
+	 */
+	void unlockExclusive() { state.fetch_add(VERSION - EXCLUSIVE, std::memory_order_release); }
+
+	/**
+	 * Waits until no writer holds or waits for the latch, and returns the
+	 * version to validate an optimistic read against.
+	 *
+	 * @param waited	Set to true if the caller had to wait
+	 */
+	std::uint64_t readVersion(bool& waited);
+
+	/**
+	 * Returns true if no writer came in since readVersion() returned version,
+	 * so that what was read meanwhile is consistent.
+	 */
+	bool validate(const std::uint64_t version) const
+	{
+		std::atomic_thread_fence(std::memory_order_acquire);
+		std::uint64_t now = state.load(std::memory_order_relaxed);
+		return (now & EXCLUSIVE) == 0 && now >> VERSION_SHIFT == version;
+	}
+
+	/**
+	 * Turns an optimistic read into an exclusive hold, if no writer came in
+	 * since readVersion() returned version.
+	 *
+	 * @return				False if a writer came in, in which case nothing is held
+	 */
+	bool tryUpgrade(const std::uint64_t version);
+
+ private:
+	FrameLatch(const FrameLatch&);
+	FrameLatch& operator=(const FrameLatch&);
+
+	static const std::uint64_t EXCLUSIVE = 1;
+	static const std::uint64_t SHARED = 2;
+	static const std::uint64_t READERS = 0xfffe;
+	static const int VERSION_SHIFT = 16;
+	static const std::uint64_t VERSION = std::uint64_t(1) << VERSION_SHIFT;
+
+	/**
+	 * Writer bit, number of readers and version, as described above
+	 */
+	std::atomic<std::uint64_t> state;
+
+	/**
+	 * Waits for the readers to leave once the writer bit is set.
+	 */
+	void drainReaders(bool& waited);
+};
+
+}
@@ -0,0 +1,203 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include "lz.h"
+
+namespace badgerdb {
+
+namespace {
+
+/**
+ * Shortest back reference
+ */
+const std::size_t MIN_MATCH = 4;
+
+/**
+ * Furthest back a reference reaches, as its offset takes two bytes
+ */
+const std::size_t MAX_OFFSET = 65535;
+
+/**
+ * Log2 of the number of positions the compressor remembers
+ */
+const int HASH_BITS = 11;
+
+std::uint32_t read32(const char* p)
+{
+	std::uint32_t value;
+	std::memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+std::uint64_t read64(const char* p)
+{
+	std::uint64_t value;
+	std::memcpy(&value, p, sizeof(value));
+	return value;
+}
+
+std::uint32_t hash32(const std::uint32_t value)
+{
+	return (value * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/**
+ * Appends a length in excess of 15, the most the token holds, as bytes of
+ * 255 and a last byte below 255. Returns false if it does not fit.
+ */
+bool putLength(std::size_t length, char* dst, std::size_t& op, const std::size_t capacity)
+{
+	while (length >= 255)
+	{
+		if (op >= capacity)
+			return false;
+		dst[op++] = char(255);
+		length -= 255;
+	}
+	if (op >= capacity)
+		return false;
+	dst[op++] = char(length);
+	return true;
+}
+
+/**
+ * Appends a sequence: a token with both lengths, the literals and, unless
+ * matchLength is 0 at the end of the block, the offset of the match.
+ */
+bool putSequence(const char* literals, const std::size_t literalLength, const std::size_t offset,
+								 const std::size_t matchLength, char* dst, std::size_t& op, const std::size_t capacity)
+{
+	std::size_t extra = matchLength == 0 ? 0 : matchLength - MIN_MATCH;
+	if (op >= capacity)
+		return false;
+	dst[op++] = char(((literalLength < 15 ? literalLength : 15) << 4) | (extra < 15 ? extra : 15));
+	if (literalLength >= 15 && !putLength(literalLength - 15, dst, op, capacity))
+		return false;
+	if (literalLength > capacity - op)
+		return false;
+	std::memcpy(dst + op, literals, literalLength);
+	op += literalLength;
+	if (matchLength == 0)
+		return true;
+
+	if (2 > capacity - op)
+		return false;
+	dst[op++] = char(offset & 0xff);
+	dst[op++] = char(offset >> 8);
+	return extra < 15 || putLength(extra - 15, dst, op, capacity);
+}
+
+/**
+ * Reads a length in excess of 15. Returns false at the end of the block.
+ */
+bool getLength(const unsigned char* src, std::size_t& ip, const std::size_t length, std::size_t& value)
+{
+	while (true)
+	{
+		if (ip >= length)
+			return false;
+		unsigned char byte = src[ip++];
+		value += byte;
+		if (byte != 255)
+			return true;
+	}
+}
+
+}
+
+std::size_t lzCompress(const char* src, const std::size_t length, char* dst, const std::size_t capacity)
+{
+	std::uint32_t table[1 << HASH_BITS];
+	std::memset(table, 0, sizeof(table));
+
+	std::size_t ip = 0;
+	std::size_t anchor = 0;
+	std::size_t op = 0;
+	std::size_t misses = 0;
+	while (ip + MIN_MATCH <= length)
+	{
+		std::uint32_t value = read32(src + ip);
+		std::uint32_t& slot = table[hash32(value)];
+		std::size_t candidate = slot;
+		slot = ip;
+		if (candidate >= ip || ip - candidate > MAX_OFFSET || read32(src + candidate) != value)
+		{
+			// skip faster through bytes that do not compress
+			ip += 1 + (misses++ >> 5);
+			continue;
+		}
+
+		// compare 8 bytes at a time, then the bytes of the first that differ
+		std::size_t matchLength = MIN_MATCH;
+		while (ip + matchLength + 8 <= length && read64(src + candidate + matchLength) == read64(src + ip + matchLength))
+			matchLength += 8;
+		while (ip + matchLength < length && src[candidate + matchLength] == src[ip + matchLength])
+			matchLength++;
+		if (!putSequence(src + anchor, ip - anchor, ip - candidate, matchLength, dst, op, capacity))
+			return 0;
+		ip += matchLength;
+		anchor = ip;
+		misses = 0;
+	}
+
+	if (!putSequence(src + anchor, length - anchor, 0, 0, dst, op, capacity))
+		return 0;
+	return op;
+}
+
+bool lzDecompress(const char* src, const std::size_t length, char* dst, const std::size_t size)
+{
+	const unsigned char* in = reinterpret_cast<const unsigned char*>(src);
+	std::size_t ip = 0;
+	std::size_t op = 0;
+	while (ip < length)
+	{
+		unsigned char token = in[ip++];
+		std::size_t literalLength = token >> 4;
+		if (literalLength == 15 && !getLength(in, ip, length, literalLength))
+			return false;
+		if (literalLength > length - ip || literalLength > size - op)
+			return false;
+		std::memcpy(dst + op, src + ip, literalLength);
+		ip += literalLength;
+		op += literalLength;
+
+		// the last sequence has no match
+		if (ip == length)
+			break;
+
+		if (2 > length - ip)
+			return false;
+		std::size_t offset = in[ip] | (std::size_t(in[ip + 1]) << 8);
+		ip += 2;
+		std::size_t matchLength = token & 15;
+		if (matchLength == 15 && !getLength(in, ip, length, matchLength))
+			return false;
+		matchLength += MIN_MATCH;
+		if (offset == 0 || offset > op || matchLength > size - op)
+			return false;
+
+		// 8 bytes at a time when they were all produced before, and there is
+		// room for the last 8 to run over; otherwise byte by byte
+		if (offset >= 8 && matchLength + 8 <= size - op)
+		{
+			for (std::size_t i = 0; i < matchLength; i += 8)
+				std::memcpy(dst + op + i, dst + op - offset + i, 8);
+			op += matchLength;
+		}
+		else
+		{
+			for (std::size_t i = 0; i < matchLength; i++, op++)
+				dst[op] = dst[op - offset];
+		}
+	}
+	return op == size;
+}
+
+}
@@ -0,0 +1,40 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace badgerdb {
+
+/**
+ * Compresses a block of bytes with a byte oriented LZ77 codec in the manner
+ * of LZ4: a sequence of literals and back references of at least 4 bytes up
+ * to 64 KB back, found through a hash table of the last position of every 4
+ * byte string. Fast rather than tight; pages full of zeros or of repeated
+ * records shrink several times over.
+ *
+ * @param src				Bytes to compress
+ * @param length		Number of bytes to compress
+ * @param dst				Memory the compressed block is written to
+ * @param capacity	Size of dst
+ * @return					Size of the compressed block, 0 if it does not fit in capacity bytes
+ */
+std::size_t lzCompress(const char* src, const std::size_t length, char* dst, const std::size_t capacity);
+
+/**
+ * Decompresses a block written by lzCompress().
+ *
+ * @param src				Compressed block
+ * @param length		Size of the compressed block
+ * @param dst				Memory the bytes are written to
+ * @param size			Number of bytes the block was compressed from
+ * @return					False if the block is corrupt or does not hold exactly size bytes
+ */
+bool lzDecompress(const char* src, const std::size_t length, char* dst, const std::size_t size);
+
+}
@@ -5,9 +5,21 @@
  * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
  */
 
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <thread>
 #include <vector>
+#include "async_io.h"
 #include "btree.h"
 #include "page.h"
+#include "lz.h"
 #include "filescan.h"
 #include "page_iterator.h"
 #include "file_iterator.h"
@@ -19,6 +31,12 @@
 #include "exceptions/bad_opcodes_exception.h"
 #include "exceptions/scan_not_initialized_exception.h"
 #include "exceptions/end_of_file_exception.h"
+#include "exceptions/invalid_page_exception.h"
+#include "exceptions/page_not_pinned_exception.h"
+#include "exceptions/page_pinned_exception.h"
+#include "exceptions/buffer_exceeded_exception.h"
+#include "exceptions/file_io_exception.h"
+#include "exceptions/file_open_exception.h"
 
 #define checkPassFail(a, b) 																				\
 {																																		\
@@ -80,10 +98,37 @@ void test5();
 void test6();
 void test7();
 void test8();
+void test9();
+void test10();
+void test11();
+void test12();
+void test13();
+void test14();
+void test15();
+void test16();
+void test17();
+void test18();
+void test19();
+void test20();
+void test21();
+void test22();
+void test23();
+void test24();
+void test25();
+void test26();
+void test27();
+void test28();
+void test29();
+void test30();
+void crashWriter(Durability durability, FileBackend backend);
+void concurrentWorker(File *file, const std::vector<std::pair<PageId, RecordId> > *records, int thread, int numThreads, int rounds, std::atomic<int> *finished, int *errors);
 void deleteRelation();
 
 int main(int argc, char **argv)
 {
+	// the writer that test17 lets die
+	if (argc == 4 && std::strcmp(argv[1], "--crash") == 0)
+		crashWriter(static_cast<Durability>(std::atoi(argv[2])), static_cast<FileBackend>(std::atoi(argv[3])));
 
   // Clean up from any previous runs that crashed.
   try
@@ -149,6 +194,28 @@ int main(int argc, char **argv)
 	test6();
 	test8();
 	test7();
+	test9();
+	test10();
+	test11();
+	test12();
+	test13();
+	test14();
+	test15();
+	test16();
+	test17();
+	test18();
+	test19();
+	test20();
+	test21();
+	test22();
+	test23();
+	test24();
+	test25();
+	test26();
+	test27();
+	test28();
+	test29();
+	test30();
 
 	delete bufMgr;
 
@@ -283,6 +350,1988 @@ void test8()
 	deleteRelation();
 }
 
+void test9()
+{
+	// Build and scan an index through a buffer pool using each of the other
+	// replacement policies
+	const ReplacementPolicy policies[] = {POLICY_LRU2, POLICY_2Q, POLICY_ARC, POLICY_CLOCK_PRO};
+	BufMgr *savedBufMgr = bufMgr;
+
+	for (int i = 0; i < 4; i++)
+	{
+		std::cout << "--------------------" << std::endl;
+		std::cout << "Replacement policy test: " << policyName(policies[i]) << std::endl;
+		bufMgr = new BufMgr(100, policies[i]);
+		createRelationRandom();
+		indexTests();
+		deleteRelation();
+		delete bufMgr;
+	}
+
+	bufMgr = savedBufMgr;
+}
+
+void test10()
+{
+	// Share a small buffer pool between several threads under each
+	// replacement policy: every thread rewrites its own pages many times,
+	// then every thread reads all pages back
+	const int numThreads = 4;
+	const int numPages = 400;
+	const int rounds = 5;
+	BufMgr *savedBufMgr = bufMgr;
+
+	for (int policy = 0; policy < NUM_POLICIES; policy++)
+	{
+		std::cout << "--------------------" << std::endl;
+		std::cout << "Concurrent buffer test: " << policyName((ReplacementPolicy)policy) << std::endl;
+		bufMgr = new BufMgr(20, (ReplacementPolicy)policy);
+
+		std::vector<std::pair<PageId, RecordId> > records;
+		{
+			PageFile file = PageFile::create(relationName);
+			for (int i = 0; i < numPages; i++)
+			{
+				PageId pageNo;
+				Page *page;
+				char record[32];
+				bufMgr->allocPage(&file, pageNo, page);
+				sprintf(record, "%08d%08d", pageNo, 0);
+				records.push_back(std::make_pair(pageNo, page->insertRecord(record)));
+				bufMgr->unPinPage(&file, pageNo, true);
+			}
+
+			int errors[numThreads] = {0};
+			std::atomic<int> finished(0);
+			std::vector<std::thread> threads;
+			for (int t = 0; t < numThreads; t++)
+				threads.push_back(std::thread(concurrentWorker, &file, &records, t, numThreads, rounds, &finished, &errors[t]));
+			for (int t = 0; t < numThreads; t++)
+				threads[t].join();
+
+			int totalErrors = 0;
+			for (int t = 0; t < numThreads; t++)
+				totalErrors += errors[t];
+			checkPassFail(totalErrors, 0)
+
+			bufMgr->flushFile(&file);
+		}
+
+		{
+			// the last versions made it to disk
+			PageFile file = PageFile::open(relationName);
+			int stale = 0;
+			for (int i = 0; i < numPages; i++)
+			{
+				char record[32];
+				sprintf(record, "%08d%08d", records[i].first, rounds);
+				if (file.readPage(records[i].first).getRecord(records[i].second) != record)
+					stale++;
+			}
+			checkPassFail(stale, 0)
+		}
+
+		delete bufMgr;
+		File::remove(relationName);
+	}
+
+	bufMgr = savedBufMgr;
+}
+
+void test11()
+{
+	// Pages prefetched in the background are found in the pool by readPage
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Prefetch test" << std::endl;
+	const int numPages = 50;
+	BufMgr *prefetchBufMgr = new BufMgr(100);
+
+	{
+		PageFile file = PageFile::create(relationName);
+		std::vector<PageId> pageNos;
+		for (int i = 0; i < numPages; i++)
+		{
+			PageId pageNo;
+			Page page = file.allocatePage(pageNo);
+			page.insertRecord("prefetched");
+			file.writePage(pageNo, page);
+			pageNos.push_back(pageNo);
+		}
+
+		prefetchBufMgr->prefetch(&file, pageNos);
+		while (prefetchBufMgr->getBufStats().prefetches < numPages)
+			std::this_thread::yield();
+
+		int found = 0;
+		for (int i = 0; i < numPages; i++)
+		{
+			Page *page;
+			prefetchBufMgr->readPage(&file, pageNos[i], page);
+			if (page->getRecord(RecordId{pageNos[i], 1}) == "prefetched")
+				found++;
+			prefetchBufMgr->unPinPage(&file, pageNos[i], false);
+		}
+		checkPassFail(found, numPages)
+		checkPassFail(prefetchBufMgr->getBufStats().hits, numPages)
+
+		// prefetching pages already in the pool reads nothing
+		prefetchBufMgr->prefetch(&file, pageNos);
+		prefetchBufMgr->flushFile(&file);
+		checkPassFail(prefetchBufMgr->getBufStats().prefetches, numPages)
+
+		// the pages after a page are found from the headers of the pages read
+		Page *first;
+		prefetchBufMgr->readPage(&file, pageNos[0], first);
+		prefetchBufMgr->unPinPage(&file, pageNos[0], false);
+		prefetchBufMgr->prefetchFollowing(&file, pageNos[0], numPages - 1);
+		for (int wait = 0; wait < 500 && prefetchBufMgr->getBufStats().prefetches < 2 * numPages - 1; wait++)
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		checkPassFail(prefetchBufMgr->getBufStats().prefetches, 2 * numPages - 1)
+		prefetchBufMgr->clearBufStats();
+		for (int i = 1; i < numPages; i++)
+		{
+			Page *page;
+			prefetchBufMgr->readPage(&file, pageNos[i], page);
+			prefetchBufMgr->unPinPage(&file, pageNos[i], false);
+		}
+		checkPassFail(prefetchBufMgr->getBufStats().hits, numPages - 1)
+		prefetchBufMgr->flushFile(&file);
+	}
+
+	delete prefetchBufMgr;
+	File::remove(relationName);
+}
+
+void test12()
+{
+	// The background writer cleans dirty pages that are about to be replaced,
+	// and the pages it writes are the ones read back from disk
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Background writer test" << std::endl;
+	const int numPages = 40;
+	BufMgr *writerBufMgr = new BufMgr(8);
+
+	{
+		PageFile file = PageFile::create(relationName);
+		std::vector<PageId> pageNos;
+		for (int i = 0; i < numPages; i++)
+		{
+			PageId pageNo;
+			Page *page;
+			writerBufMgr->allocPage(&file, pageNo, page);
+			page->insertRecord("written");
+			writerBufMgr->unPinPage(&file, pageNo, true);
+			pageNos.push_back(pageNo);
+
+			// give the writer a round now and then
+			if (i % 8 == 7)
+				std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		}
+
+		const BufStats &stats = writerBufMgr->getBufStats();
+		checkPassFail((stats.bgwrites > 0), true)
+		checkPassFail(stats.fgwrites + stats.bgwrites, stats.diskwrites)
+
+		writerBufMgr->flushFile(&file);
+		int found = 0;
+		for (int i = 0; i < numPages; i++)
+			if (file.readPage(pageNos[i]).getRecord(RecordId{pageNos[i], 1}) == "written")
+				found++;
+		checkPassFail(found, numPages)
+	}
+
+	delete writerBufMgr;
+	File::remove(relationName);
+
+	// without the background writer every dirty victim is written in the
+	// foreground
+	writerBufMgr = new BufMgr(8, POLICY_CLOCK, false);
+	{
+		PageFile file = PageFile::create(relationName);
+		for (int i = 0; i < numPages; i++)
+		{
+			PageId pageNo;
+			Page *page;
+			writerBufMgr->allocPage(&file, pageNo, page);
+			writerBufMgr->unPinPage(&file, pageNo, true);
+		}
+		checkPassFail(writerBufMgr->getBufStats().bgwrites, 0)
+		checkPassFail(writerBufMgr->getBufStats().fgwrites, numPages - 8)
+		writerBufMgr->flushFile(&file);
+	}
+
+	delete writerBufMgr;
+	File::remove(relationName);
+}
+
+void test13()
+{
+	// Flushing one file writes and drops its pages only, leaving the pages of
+	// another file in the pool
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Flush file test" << std::endl;
+	const int numPages = 30;
+	const std::string otherName = relationName + ".other";
+	BufMgr *flushBufMgr = new BufMgr(100, POLICY_CLOCK, false);
+
+	{
+		PageFile file = PageFile::create(relationName);
+		PageFile other = PageFile::create(otherName);
+		std::vector<PageId> pageNos, otherPageNos;
+		for (int i = 0; i < numPages; i++)
+		{
+			PageId pageNo;
+			Page *page;
+			flushBufMgr->allocPage(&file, pageNo, page);
+			page->insertRecord("flushed");
+			flushBufMgr->unPinPage(&file, pageNo, true);
+			pageNos.push_back(pageNo);
+
+			flushBufMgr->allocPage(&other, pageNo, page);
+			page->insertRecord("kept");
+			flushBufMgr->unPinPage(&other, pageNo, true);
+			otherPageNos.push_back(pageNo);
+		}
+
+		// a disposed page is forgotten by the file's frame list too
+		flushBufMgr->disposePage(&file, pageNos.back());
+		pageNos.pop_back();
+
+		flushBufMgr->flushFile(&file);
+
+		int found = 0;
+		for (std::size_t i = 0; i < pageNos.size(); i++)
+			if (file.readPage(pageNos[i]).getRecord(RecordId{pageNos[i], 1}) == "flushed")
+				found++;
+		checkPassFail(found, numPages - 1)
+
+		// the pages of the flushed file are read back in, those of the other
+		// file are still there
+		flushBufMgr->clearBufStats();
+		for (int i = 0; i < numPages; i++)
+		{
+			Page *page;
+			flushBufMgr->readPage(&other, otherPageNos[i], page);
+			flushBufMgr->unPinPage(&other, otherPageNos[i], false);
+			if (i < numPages - 1)
+			{
+				flushBufMgr->readPage(&file, pageNos[i], page);
+				flushBufMgr->unPinPage(&file, pageNos[i], false);
+			}
+		}
+		checkPassFail(flushBufMgr->getBufStats().hits, numPages)
+		checkPassFail(flushBufMgr->getBufStats().diskreads, numPages - 1)
+
+		flushBufMgr->flushFile(&file);
+		flushBufMgr->flushFile(&other);
+	}
+
+	delete flushBufMgr;
+	File::remove(relationName);
+	File::remove(otherName);
+}
+
+void test14()
+{
+	// Pages written through one file backend read back the same through the
+	// others
+	const FileBackend backends[] = {BACKEND_STREAM, BACKEND_PREAD, BACKEND_DIRECT};
+	const char *backendNames[] = {"fstream", "pread", "O_DIRECT"};
+	const int numPages = 30;
+
+	for (int w = 0; w < 3; w++)
+	{
+		std::cout << "--------------------" << std::endl;
+		std::cout << "File backend test: " << backendNames[w] << std::endl;
+		std::vector<std::pair<PageId, RecordId> > records;
+		{
+			PageFile file = PageFile::create(relationName, backends[w]);
+			checkPassFail(file.backend(), backends[w])
+			for (int i = 0; i < numPages; i++)
+			{
+				PageId pageNo;
+				Page *page;
+				char record[32];
+				bufMgr->allocPage(&file, pageNo, page);
+				sprintf(record, "%08d backend %d", pageNo, w);
+				records.push_back(std::make_pair(pageNo, page->insertRecord(record)));
+				bufMgr->unPinPage(&file, pageNo, true);
+			}
+			bufMgr->flushFile(&file);
+		}
+
+		for (int r = 0; r < 3; r++)
+		{
+			PageFile file = PageFile::open(relationName, backends[r]);
+			int found = 0;
+			int used = 0;
+			for (FileIterator iter = file.begin(); iter != file.end(); ++iter)
+				used++;
+			for (int i = 0; i < numPages; i++)
+			{
+				char record[32];
+				sprintf(record, "%08d backend %d", records[i].first, w);
+				if (file.readPage(records[i].first).getRecord(records[i].second) == record)
+					found++;
+			}
+			checkPassFail(found, numPages)
+			checkPassFail(used, numPages)
+		}
+
+		File::remove(relationName);
+	}
+}
+
+void test15()
+{
+	// Batches of page reads and writes give the same pages under both
+	// asynchronous I/O engines and every file backend
+	const AsyncEngine engines[] = {ENGINE_URING, ENGINE_THREADS};
+	const char *engineNames[] = {"io_uring", "thread pool"};
+	const FileBackend backends[] = {BACKEND_STREAM, BACKEND_PREAD, BACKEND_DIRECT};
+	const char *backendNames[] = {"fstream", "pread", "O_DIRECT"};
+	const int numPages = 100;
+
+	for (int e = 0; e < 2; e++)
+	{
+		if (engines[e] == ENGINE_URING && !AsyncIO::uringSupported())
+			continue;
+		AsyncIO::setEngine(engines[e]);
+
+		for (int b = 0; b < 3; b++)
+		{
+			std::cout << "--------------------" << std::endl;
+			std::cout << "Batched I/O test: " << engineNames[e] << ", " << backendNames[b] << std::endl;
+			{
+				PageFile file = PageFile::create(relationName, backends[b]);
+				std::vector<PageId> pageNos;
+				std::vector<Page> pages(numPages);
+				std::vector<const Page*> written;
+				for (int i = 0; i < numPages; i++)
+				{
+					PageId pageNo;
+					pages[i] = file.allocatePage(pageNo);
+					char record[32];
+					sprintf(record, "%08d batch", pageNo);
+					pages[i].insertRecord(record);
+					pageNos.push_back(pageNo);
+					written.push_back(&pages[i]);
+				}
+				file.writePages(&pageNos[0], &written[0], numPages);
+
+				std::vector<Page> read(numPages);
+				std::vector<Page*> into;
+				for (int i = 0; i < numPages; i++)
+					into.push_back(&read[i]);
+				file.readPages(&pageNos[0], &into[0], numPages);
+
+				int found = 0;
+				for (int i = 0; i < numPages; i++)
+				{
+					char record[32];
+					sprintf(record, "%08d batch", pageNos[i]);
+					if (read[i].getRecord(RecordId{pageNos[i], 1}) == record &&
+							read[i].next_page_number() == (i + 1 < numPages ? pageNos[i + 1] : Page::INVALID_NUMBER))
+						found++;
+				}
+				checkPassFail(found, numPages)
+
+				// a page past the end of the file fails the batch
+				PageId missing = pageNos.back() + 1;
+				Page *page = &read[0];
+				int invalid = 0;
+				try
+				{
+					file.readPages(&missing, &page, 1);
+				}
+				catch (const InvalidPageException &e)
+				{
+					invalid++;
+				}
+				checkPassFail(invalid, 1)
+			}
+			File::remove(relationName);
+		}
+	}
+
+	AsyncIO::setEngine(ENGINE_DEFAULT);
+}
+
+void test16()
+{
+	// Evicting a dirty page writes its dirty neighbours along with it, and
+	// pages written in runs keep their contents and their place in the file
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Coalesced writeback test" << std::endl;
+	const int numBufs = 20;
+	BufMgr *clusterBufMgr = new BufMgr(numBufs, POLICY_CLOCK, false);
+	std::vector<PageId> pageNos;
+
+	{
+		PageFile file = PageFile::create(relationName);
+		for (int i = 0; i < numBufs; i++)
+		{
+			PageId pageNo;
+			Page *page;
+			char record[32];
+			clusterBufMgr->allocPage(&file, pageNo, page);
+			sprintf(record, "%08d cluster", pageNo);
+			page->insertRecord(record);
+			clusterBufMgr->unPinPage(&file, pageNo, true);
+			pageNos.push_back(pageNo);
+		}
+
+		// one more page evicts a dirty one and cleans its neighbours
+		clusterBufMgr->clearBufStats();
+		PageId pageNo;
+		Page *page;
+		clusterBufMgr->allocPage(&file, pageNo, page);
+		page->insertRecord("last");
+		clusterBufMgr->unPinPage(&file, pageNo, true);
+		checkPassFail((clusterBufMgr->getBufStats().diskwrites > 1), true)
+		checkPassFail(clusterBufMgr->getBufStats().diskwrites, clusterBufMgr->getBufStats().fgwrites)
+
+		// the rest go out when the pool goes away
+		delete clusterBufMgr;
+
+		int found = 0;
+		for (int i = 0; i < numBufs; i++)
+		{
+			Page onDisk = file.readPage(pageNos[i]);
+			char record[32];
+			sprintf(record, "%08d cluster", pageNos[i]);
+			if (onDisk.getRecord(RecordId{pageNos[i], 1}) == record &&
+					onDisk.next_page_number() == (i + 1 < numBufs ? pageNos[i + 1] : pageNo))
+				found++;
+		}
+		checkPassFail(found, numBufs)
+		checkPassFail(file.readPage(pageNo).getRecord(RecordId{pageNo, 1}), "last")
+	}
+
+	File::remove(relationName);
+}
+
+const int numDurablePages = 20;
+
+void test17()
+{
+	// Pages written back at a sync point survive the process dying right
+	// after it, under every durability policy and backend.  A killed process
+	// leaves the operating system's cache intact, so this checks that the
+	// writes reached it, not that fdatasync reached the disk.
+	const Durability policies[] = {DURABILITY_NONE, DURABILITY_FLUSH, DURABILITY_SYNC};
+	const char *policyNames[] = {"none", "flush", "sync"};
+	const FileBackend backends[] = {BACKEND_STREAM, BACKEND_PREAD};
+	const char *backendNames[] = {"fstream", "pread"};
+
+	for (int p = 0; p < 3; p++)
+	{
+		for (int b = 0; b < 2; b++)
+		{
+			std::cout << "--------------------" << std::endl;
+			std::cout << "Crash consistency test: " << policyNames[p] << ", " << backendNames[b] << std::endl;
+			std::string policyArg = std::to_string(policies[p]);
+			std::string backendArg = std::to_string(backends[b]);
+			char *args[] = {const_cast<char *>("badgerdb_main"), const_cast<char *>("--crash"),
+											&policyArg[0], &backendArg[0], NULL};
+			pid_t pid;
+			int status = -1;
+			if (posix_spawn(&pid, "/proc/self/exe", NULL, NULL, args, environ) == 0)
+				waitpid(pid, &status, 0);
+			checkPassFail((WIFEXITED(status) && WEXITSTATUS(status) == 0), true)
+
+			int found = 0;
+			{
+				PageFile file = PageFile::open(relationName);
+				for (PageId pageNo = 1; pageNo <= numDurablePages; pageNo++)
+				{
+					char record[32];
+					sprintf(record, "%08d durable", pageNo);
+					try
+					{
+						if (file.readPage(pageNo).getRecord(RecordId{pageNo, 1}) == record)
+							found++;
+					}
+					catch (const InvalidPageException &e)
+					{
+					}
+				}
+			}
+			checkPassFail(found, numDurablePages)
+			File::remove(relationName);
+		}
+	}
+}
+
+void test18()
+{
+	// Every request is a hit or a miss, counted per file as well, and the
+	// histograms see every victim search and every read
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Statistics test" << std::endl;
+	const int numBufs = 10;
+	BufMgr *statsBufMgr = new BufMgr(numBufs, POLICY_CLOCK, false);
+
+	{
+		PageFile file = PageFile::create(relationName);
+		std::vector<PageId> pageNos;
+		for (int i = 0; i < 2 * numBufs; i++)
+		{
+			PageId pageNo;
+			Page *page;
+			statsBufMgr->allocPage(&file, pageNo, page);
+			page->insertRecord("stats");
+			statsBufMgr->unPinPage(&file, pageNo, true);
+			pageNos.push_back(pageNo);
+		}
+		const BufStats &stats = statsBufMgr->getBufStats();
+		checkPassFail(stats.accesses, 2 * numBufs)
+		checkPassFail((stats.dirtyEvictions > 0), true)
+		checkPassFail(stats.cleanEvictions + stats.dirtyEvictions, numBufs)
+		checkPassFail((int)stats.scanLength.count(), 2 * numBufs)
+
+		// the last pages allocated are still in the pool, the first ones not
+		statsBufMgr->clearBufStats();
+		for (int i = 2 * numBufs - 1; i >= 0; i--)
+		{
+			Page *page;
+			statsBufMgr->readPage(&file, pageNos[i], page);
+			statsBufMgr->unPinPage(&file, pageNos[i], false);
+		}
+		checkPassFail(stats.hits, numBufs)
+		checkPassFail(stats.misses, numBufs)
+		checkPassFail(stats.accesses, stats.hits + stats.misses)
+		checkPassFail((int)stats.readLatency.count(), numBufs)
+		checkPassFail((stats.readLatency.percentile(0.5) <= stats.readLatency.max()), true)
+		checkPassFail(stats.cleanEvictions + stats.dirtyEvictions, numBufs)
+
+		std::map<std::string, FileStats> files = statsBufMgr->getFileStats();
+		checkPassFail((int)files.size(), 1)
+		checkPassFail((int)files[relationName].hits, numBufs)
+		checkPassFail((int)files[relationName].misses, numBufs)
+
+		std::ostringstream dump;
+		statsBufMgr->dumpStats(dump);
+		checkPassFail((dump.str().find("\"hits\":10,\"misses\":10") != std::string::npos), true)
+		checkPassFail((dump.str().find("\"files\":{\"relA\":{\"hits\":10") != std::string::npos), true)
+		checkPassFail((dump.str().find("\"scanLength\":{\"count\":10") != std::string::npos), true)
+
+		// flushing forgets the File object but not the counts of its file
+		statsBufMgr->flushFile(&file);
+		files = statsBufMgr->getFileStats();
+		checkPassFail((int)files[relationName].misses, numBufs)
+
+		std::ostringstream reports;
+		statsBufMgr->startStatsReporter(reports, 1);
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		statsBufMgr->stopStatsReporter();
+		checkPassFail((reports.str().find("{\"frames\":10,") == 0), true)
+	}
+
+	delete statsBufMgr;
+	File::remove(relationName);
+}
+
+void test19()
+{
+	// A scan or bulk load with a strategy recycles a ring of frames and leaves
+	// the pages other requests use in the pool; a normal scan evicts them
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Access strategy test" << std::endl;
+	const int numBufs = 40;
+	const int numPages = 200;
+	const int hotPages = 10;
+	const std::string otherName = relationName + ".other";
+
+	{
+		PageFile relation = PageFile::create(relationName);
+		for (int i = 0; i < numPages; i++)
+		{
+			PageId pageNo;
+			Page page = relation.allocatePage(pageNo);
+			page.insertRecord("scanned");
+			relation.writePage(pageNo, page);
+		}
+	}
+
+	const AccessStrategy strategies[] = {ACCESS_SEQUENTIAL, ACCESS_NORMAL, ACCESS_BULK_WRITE};
+	for (int s = 0; s < 3; s++)
+	{
+		BufMgr *ringBufMgr = new BufMgr(numBufs, POLICY_CLOCK, false);
+		{
+			PageFile hot = PageFile::create(otherName);
+			std::vector<PageId> hotNos;
+			for (int i = 0; i < hotPages; i++)
+			{
+				PageId pageNo;
+				Page *page;
+				ringBufMgr->allocPage(&hot, pageNo, page);
+				ringBufMgr->unPinPage(&hot, pageNo, true);
+				hotNos.push_back(pageNo);
+			}
+
+			if (strategies[s] == ACCESS_BULK_WRITE)
+			{
+				PageFile loaded = PageFile::open(relationName);
+				for (int i = 0; i < numPages; i++)
+				{
+					PageId pageNo;
+					Page *page;
+					ringBufMgr->allocPage(&loaded, pageNo, page, ACCESS_BULK_WRITE);
+					page->insertRecord("loaded");
+					ringBufMgr->unPinPage(&loaded, pageNo, true);
+				}
+				ringBufMgr->flushFile(&loaded);
+			}
+			else
+			{
+				int numRecords = 0;
+				FileScan scan(relationName, ringBufMgr, FileScan::READ_AHEAD, strategies[s]);
+				try
+				{
+					RecordId rid;
+					while (true)
+					{
+						scan.scanNext(rid);
+						numRecords++;
+					}
+				}
+				catch (const EndOfFileException &e)
+				{
+				}
+				checkPassFail(numRecords, numPages)
+			}
+
+			ringBufMgr->clearBufStats();
+			for (int i = 0; i < hotPages; i++)
+			{
+				Page *page;
+				ringBufMgr->readPage(&hot, hotNos[i], page);
+				ringBufMgr->unPinPage(&hot, hotNos[i], false);
+			}
+			if (strategies[s] == ACCESS_NORMAL)
+				checkPassFail((ringBufMgr->getBufStats().hits < hotPages), true)
+			else
+				checkPassFail(ringBufMgr->getBufStats().hits, hotPages)
+			ringBufMgr->flushFile(&hot);
+		}
+		delete ringBufMgr;
+		File::remove(otherName);
+	}
+
+	// the bulk loaded pages made it to disk
+	{
+		PageFile relation = PageFile::open(relationName);
+		int numLoaded = 0;
+		for (FileIterator it = relation.begin(); it != relation.end(); ++it)
+		{
+			Page page = *it;
+			for (PageIterator rec = page.begin(); rec != page.end(); ++rec)
+				if (*rec == "loaded")
+					numLoaded++;
+		}
+		checkPassFail(numLoaded, numPages)
+	}
+	File::remove(relationName);
+}
+
+void test20()
+{
+	// A PageGuard holds one pin, which moves with it and is dropped, dirty if
+	// the guard was marked so, when the guard is released or destroyed
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Page guard test" << std::endl;
+	BufMgr *guardBufMgr = new BufMgr(10, POLICY_CLOCK, false);
+
+	{
+		PageFile file = PageFile::create(relationName);
+		PageId pageNo;
+		{
+			PageGuard guard = guardBufMgr->allocPage(&file);
+			pageNo = guard.pageNo();
+			guard->insertRecord("guarded");
+			guard.markDirty();
+
+			// the page stays pinned while the guard holds it
+			bool pinned = false;
+			try
+			{
+				guardBufMgr->flushFile(&file);
+			}
+			catch (const PagePinnedException &e)
+			{
+				pinned = true;
+			}
+			checkPassFail(pinned, true)
+		}
+		guardBufMgr->flushFile(&file);
+		checkPassFail(file.readPage(pageNo).getRecord(RecordId{pageNo, 1}), std::string("guarded"))
+
+		// moving a guard moves its pin: the page is unpinned exactly once
+		PageGuard moved;
+		checkPassFail(moved.empty(), true)
+		{
+			PageGuard guard = guardBufMgr->readPage(&file, pageNo);
+			moved = std::move(guard);
+			checkPassFail(guard.empty(), true)
+		}
+		checkPassFail(moved.empty(), false)
+		checkPassFail((moved->getRecord(RecordId{pageNo, 1}) == "guarded"), true)
+		moved.release();
+		checkPassFail(moved.empty(), true)
+		bool notPinned = false;
+		try
+		{
+			guardBufMgr->unPinPage(&file, pageNo, false);
+		}
+		catch (const PageNotPinnedException &e)
+		{
+			notPinned = true;
+		}
+		checkPassFail(notPinned, true)
+
+		// assigning to a guard drops the page it held
+		PageGuard first = guardBufMgr->allocPage(&file);
+		PageId firstNo = first.pageNo();
+		first = guardBufMgr->readPage(&file, pageNo);
+		checkPassFail(first.pageNo(), pageNo)
+		notPinned = false;
+		try
+		{
+			guardBufMgr->unPinPage(&file, firstNo, false);
+		}
+		catch (const PageNotPinnedException &e)
+		{
+			notPinned = true;
+		}
+		checkPassFail(notPinned, true)
+		first.release();
+		guardBufMgr->flushFile(&file);
+	}
+
+	delete guardBufMgr;
+	File::remove(relationName);
+}
+
+void test21()
+{
+	// Pages read and allocated into memory the caller owns, as the buffer
+	// manager does with its frames, keep the used list of the file in order
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Direct page I/O test" << std::endl;
+	const int numPages = 6;
+
+	{
+		PageFile file = PageFile::create(relationName);
+		Page *frame = new Page;
+		std::vector<PageId> pageNos;
+		for (int i = 0; i < numPages; i++)
+		{
+			// whatever the memory held before is overwritten
+			memset(reinterpret_cast<char*>(frame), 0x5a, Page::SIZE);
+			PageId pageNo;
+			file.allocatePageInto(pageNo, frame);
+			checkPassFail(frame->page_number(), pageNo)
+			checkPassFail((int)frame->getFreeSpace(), (int)Page::DATA_SIZE)
+			frame->insertRecord("direct " + std::to_string(i));
+			file.writePage(pageNo, *frame);
+			pageNos.push_back(pageNo);
+		}
+
+		for (int i = numPages - 1; i >= 0; i--)
+		{
+			file.readPageInto(pageNos[i], frame);
+			checkPassFail(frame->getRecord(RecordId{pageNos[i], 1}), "direct " + std::to_string(i))
+		}
+
+		// the first and a middle page are reused in place, in page order
+		file.deletePage(pageNos[2]);
+		file.deletePage(pageNos[0]);
+		bool invalid = false;
+		try
+		{
+			file.readPageInto(pageNos[2], frame);
+		}
+		catch (const InvalidPageException &e)
+		{
+			invalid = true;
+		}
+		checkPassFail(invalid, true)
+
+		PageId pageNo;
+		file.allocatePageInto(pageNo, frame);
+		checkPassFail(pageNo, pageNos[0])
+		file.allocatePageInto(pageNo, frame);
+		checkPassFail(pageNo, pageNos[2])
+
+		std::vector<PageId> used;
+		for (FileIterator it = file.begin(); it != file.end(); ++it)
+			used.push_back(it.page_number());
+		checkPassFail((used == pageNos), true)
+
+		// a file whose every page was deleted starts its used list afresh
+		for (int i = 0; i < numPages; i++)
+			file.deletePage(pageNos[i]);
+		file.allocatePageInto(pageNo, frame);
+		int numUsed = 0;
+		for (FileIterator it = file.begin(); it != file.end(); ++it)
+			numUsed++;
+		checkPassFail(numUsed, 1)
+		delete frame;
+	}
+
+	File::remove(relationName);
+}
+
+void test22()
+{
+	// The pool grows and shrinks under a scan that keeps its page pinned, and
+	// refuses to shrink below the pages pinned
+	const int numPages = 200;
+	{
+		PageFile relation = PageFile::create(relationName);
+		for (int i = 0; i < numPages; i++)
+		{
+			PageId pageNo;
+			Page page = relation.allocatePage(pageNo);
+			page.insertRecord("record " + std::to_string(i));
+			relation.writePage(pageNo, page);
+		}
+	}
+
+	for (int policy = 0; policy < NUM_POLICIES; policy++)
+	{
+		std::cout << "--------------------" << std::endl;
+		std::cout << "Online resize test: " << policyName((ReplacementPolicy)policy) << std::endl;
+		BufMgr *resizeBufMgr = new BufMgr(20, (ReplacementPolicy)policy, false);
+		const std::uint32_t sizes[] = {100, 5, 1, 40, 3, 60};
+		{
+			FileScan scan(relationName, resizeBufMgr, 0, ACCESS_NORMAL);
+			int numRecords = 0;
+			bool intact = true;
+			try
+			{
+				RecordId rid;
+				while (true)
+				{
+					scan.scanNext(rid);
+					if (numRecords % 30 == 29)
+						resizeBufMgr->resize(sizes[numRecords / 30]);
+					intact = intact && scan.getRecord() == "record " + std::to_string(numRecords);
+					numRecords++;
+				}
+			}
+			catch (const EndOfFileException &e)
+			{
+			}
+			checkPassFail(numRecords, numPages)
+			checkPassFail(intact, true)
+			checkPassFail(resizeBufMgr->size(), (std::uint32_t)60)
+		}
+
+		// dirty pages are written back as their frames go, and the pages pinned
+		// keep the pool from shrinking below them
+		PageFile relation = PageFile::open(relationName);
+		std::vector<PageGuard> pinned;
+		for (int i = 0; i < 10; i++)
+		{
+			PageGuard guard = resizeBufMgr->readPage(&relation, i + 1);
+			guard->updateRecord(RecordId{PageId(i + 1), 1}, "resized " + std::to_string(i));
+			guard.markDirty();
+			pinned.push_back(std::move(guard));
+		}
+		bool refused = false;
+		try
+		{
+			resizeBufMgr->resize(8);
+		}
+		catch (const BufferExceededException &e)
+		{
+			refused = true;
+		}
+		checkPassFail(refused, true)
+		checkPassFail(resizeBufMgr->size(), (std::uint32_t)60)
+		resizeBufMgr->resize(12);
+		checkPassFail(resizeBufMgr->size(), (std::uint32_t)12)
+		for (int i = 0; i < 10; i++)
+			checkPassFail(pinned[i]->getRecord(RecordId{PageId(i + 1), 1}), "resized " + std::to_string(i))
+		pinned.clear();
+		resizeBufMgr->resize(2);
+		int numWritten = 0;
+		for (int i = 0; i < 10; i++)
+			if (relation.readPage(i + 1).getRecord(RecordId{PageId(i + 1), 1}) == "resized " + std::to_string(i))
+				numWritten++;
+		checkPassFail((numWritten >= 8), true)
+
+		// the frames given back grow the pool again; the records are put back
+		// for the next policy
+		resizeBufMgr->resize(30);
+		for (int i = 0; i < 30; i++)
+		{
+			PageGuard guard = resizeBufMgr->readPage(&relation, i + 1);
+			if (i < 10)
+			{
+				guard->updateRecord(RecordId{PageId(i + 1), 1}, "record " + std::to_string(i));
+				guard.markDirty();
+			}
+			pinned.push_back(std::move(guard));
+		}
+		pinned.clear();
+		resizeBufMgr->flushFile(&relation);
+		delete resizeBufMgr;
+	}
+
+	// another thread resizes the pool while scans run
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Concurrent resize test" << std::endl;
+	{
+		BufMgr *resizeBufMgr = new BufMgr(50);
+		std::atomic<bool> done(false);
+		std::atomic<int> numResizes(0);
+		std::thread resizer([&]()
+		{
+			std::uint32_t size = 50;
+			while (!done)
+			{
+				size = size > 10 ? size - 7 : 64;
+				try
+				{
+					resizeBufMgr->resize(size);
+					numResizes++;
+				}
+				catch (const BufferExceededException &e)
+				{
+				}
+				std::this_thread::yield();
+			}
+		});
+
+		bool complete = true;
+		for (int round = 0; round < 5; round++)
+		{
+			FileScan scan(relationName, resizeBufMgr);
+			int numRecords = 0;
+			try
+			{
+				RecordId rid;
+				while (true)
+				{
+					scan.scanNext(rid);
+					numRecords++;
+				}
+			}
+			catch (const EndOfFileException &e)
+			{
+			}
+			complete = complete && numRecords == numPages;
+		}
+		done = true;
+		resizer.join();
+		checkPassFail(complete, true)
+		checkPassFail((numResizes > 0), true)
+		delete resizeBufMgr;
+	}
+
+	// a pool only grows as far as the address space reserved for it
+	{
+		BufMgr *resizeBufMgr = new BufMgr(4, POLICY_CLOCK, false, 6);
+		resizeBufMgr->resize(6);
+		int invalid = 0;
+		try
+		{
+			resizeBufMgr->resize(7);
+		}
+		catch (const BufferExceededException &e)
+		{
+			invalid++;
+		}
+		checkPassFail(invalid, 1)
+		checkPassFail(resizeBufMgr->size(), (std::uint32_t)6)
+		delete resizeBufMgr;
+
+		resizeBufMgr = new BufMgr(4);
+		resizeBufMgr->resize(4 * BufMgr::DEFAULT_GROWTH);
+		invalid = 0;
+		try
+		{
+			resizeBufMgr->resize(4 * BufMgr::DEFAULT_GROWTH + 1);
+		}
+		catch (const BufferExceededException &e)
+		{
+			invalid++;
+		}
+		checkPassFail(invalid, 1)
+		delete resizeBufMgr;
+	}
+	File::remove(relationName);
+}
+
+void test23()
+{
+	// A snapshot of the pool written on shutdown brings its pages back after a
+	// restart, the referenced ones first when the new pool is smaller
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Warm restart test" << std::endl;
+	const std::string snapshotName = relationName + ".snapshot";
+	const int numPages = 30;
+	std::remove(snapshotName.c_str());
+	{
+		PageFile relation = PageFile::create(relationName);
+		for (int i = 0; i < numPages; i++)
+		{
+			PageId pageNo;
+			Page page = relation.allocatePage(pageNo);
+			page.insertRecord("record " + std::to_string(i));
+			relation.writePage(pageNo, page);
+		}
+	}
+
+	{
+		PageFile file = PageFile::open(relationName);
+		BufMgr *warmBufMgr = new BufMgr(20, POLICY_CLOCK, false);
+		warmBufMgr->enableSnapshot(snapshotName);
+		checkPassFail((int)warmBufMgr->prewarm(&file), 0)
+
+		// pages 1 to 10 are referenced; a scan of pages 11 to 20 leaves the
+		// last five in its ring, unreferenced
+		Page *page;
+		for (PageId i = 1; i <= 10; i++)
+		{
+			warmBufMgr->readPage(&file, i, page);
+			warmBufMgr->unPinPage(&file, i, false);
+		}
+		for (PageId i = 11; i <= 20; i++)
+		{
+			warmBufMgr->readPage(&file, i, page, ACCESS_SEQUENTIAL);
+			warmBufMgr->unPinPage(&file, i, false);
+		}
+
+		// pages flushed before shutdown are listed along with the ones left
+		warmBufMgr->flushFile(&file);
+		for (PageId i = 1; i <= 5; i++)
+		{
+			warmBufMgr->readPage(&file, i, page);
+			warmBufMgr->unPinPage(&file, i, false);
+		}
+		delete warmBufMgr;
+	}
+
+	{
+		PageFile file = PageFile::open(relationName);
+		BufMgr *warmBufMgr = new BufMgr(20, POLICY_CLOCK, false);
+		warmBufMgr->enableSnapshot(snapshotName);
+		checkPassFail((int)warmBufMgr->prewarm(&file), 15)
+		checkPassFail((int)warmBufMgr->prewarm(&file), 0)
+
+		warmBufMgr->clearBufStats();
+		Page *page;
+		for (PageId i = 1; i <= 10; i++)
+		{
+			warmBufMgr->readPage(&file, i, page);
+			warmBufMgr->unPinPage(&file, i, false);
+		}
+		for (PageId i = 16; i <= 20; i++)
+		{
+			warmBufMgr->readPage(&file, i, page, ACCESS_SEQUENTIAL);
+			warmBufMgr->unPinPage(&file, i, false);
+		}
+		checkPassFail(warmBufMgr->getBufStats().hits, 15)
+		checkPassFail(warmBufMgr->getBufStats().diskreads, 0)
+		warmBufMgr->flushFile(&file);
+		delete warmBufMgr;
+	}
+
+	{
+		PageFile file = PageFile::open(relationName);
+		BufMgr *warmBufMgr = new BufMgr(8, POLICY_CLOCK, false);
+		warmBufMgr->enableSnapshot(snapshotName);
+		checkPassFail((int)warmBufMgr->prewarm(&file), 8)
+
+		warmBufMgr->clearBufStats();
+		Page *page;
+		for (PageId i = 3; i <= 10; i++)
+		{
+			warmBufMgr->readPage(&file, i, page);
+			warmBufMgr->unPinPage(&file, i, false);
+		}
+		checkPassFail(warmBufMgr->getBufStats().hits, 8)
+		warmBufMgr->flushFile(&file);
+		delete warmBufMgr;
+	}
+
+	std::remove(snapshotName.c_str());
+	File::remove(relationName);
+}
+
+void test24()
+{
+	// Requests recorded in a trace read back in order, with the name of their
+	// file; requests that find the ring full are counted, not lost silently
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Trace recorder test" << std::endl;
+	const std::string traceName = relationName + ".trace";
+	{
+		PageFile relation = PageFile::create(relationName);
+		for (int i = 0; i < 3; i++)
+		{
+			PageId pageNo;
+			relation.allocatePage(pageNo);
+		}
+	}
+
+	{
+		PageFile file = PageFile::open(relationName);
+		BufMgr *traceBufMgr = new BufMgr(3);
+		Page *page;
+		PageId newPageNo;
+		traceBufMgr->startTrace(traceName);
+		traceBufMgr->readPage(&file, 1, page);
+		traceBufMgr->readPage(&file, 1, page);
+		traceBufMgr->unPinPage(&file, 1, false);
+		traceBufMgr->unPinPage(&file, 1, false);
+		traceBufMgr->allocPage(&file, newPageNo, page);
+		traceBufMgr->unPinPage(&file, newPageNo, false);
+		traceBufMgr->disposePage(&file, newPageNo);
+		traceBufMgr->flushFile(&file);
+		checkPassFail(traceBufMgr->stopTrace(), 0)
+
+		// not recorded
+		traceBufMgr->readPage(&file, 2, page);
+		traceBufMgr->unPinPage(&file, 2, false);
+		traceBufMgr->flushFile(&file);
+		delete traceBufMgr;
+
+		std::vector<TraceRecord> records;
+		std::map<std::uint32_t, std::string> names;
+		readTrace(traceName, records, names);
+		checkPassFail(records.size(), 5)
+		checkPassFail(names.size(), 1)
+		checkPassFail(names[traceFileId(relationName)], relationName)
+		const int ops[] = {TRACE_READ, TRACE_READ, TRACE_ALLOC, TRACE_DISPOSE, TRACE_FLUSH};
+		const int hits[] = {0, 1, 0, 1, 0};
+		const PageId pageNos[] = {1, 1, newPageNo, newPageNo, Page::INVALID_NUMBER};
+		int matching = 0;
+		for (int i = 0; i < 5; i++)
+		{
+			if (records[i].op == ops[i] && records[i].hit == hits[i] && records[i].pageNo == pageNos[i]
+					&& records[i].fileId == traceFileId(relationName)
+					&& (i == 0 || records[i].timestamp >= records[i - 1].timestamp))
+				matching++;
+		}
+		checkPassFail(matching, 5)
+	}
+
+	{
+		// a small ring shared by several threads
+		PageFile file = PageFile::open(relationName);
+		BufMgr *traceBufMgr = new BufMgr(3);
+		const int numThreads = 4;
+		const int numReads = 5000;
+		traceBufMgr->startTrace(traceName, 64);
+		std::vector<std::thread> threads;
+		for (int t = 0; t < numThreads; t++)
+		{
+			threads.push_back(std::thread([traceBufMgr, &file, t]()
+			{
+				Page *page;
+				for (int i = 0; i < numReads; i++)
+				{
+					PageId pageNo = 1 + (i + t) % 3;
+					traceBufMgr->readPage(&file, pageNo, page);
+					traceBufMgr->unPinPage(&file, pageNo, false);
+				}
+			}));
+		}
+		for (int t = 0; t < numThreads; t++)
+			threads[t].join();
+		std::uint64_t dropped = traceBufMgr->stopTrace();
+		traceBufMgr->flushFile(&file);
+		delete traceBufMgr;
+
+		std::vector<TraceRecord> records;
+		std::map<std::uint32_t, std::string> names;
+		readTrace(traceName, records, names);
+		checkPassFail(records.size() + dropped, std::uint64_t(numThreads * numReads))
+	}
+
+	// a file that is not a trace
+	int invalid = 0;
+	try
+	{
+		std::vector<TraceRecord> records;
+		std::map<std::uint32_t, std::string> names;
+		readTrace(relationName, records, names);
+	}
+	catch (const FileIOException &e)
+	{
+		invalid++;
+	}
+	checkPassFail(invalid, 1)
+
+	std::remove(traceName.c_str());
+	File::remove(relationName);
+}
+
+void test25()
+{
+	// Pages evicted from a small pool come back from the compressed tier with
+	// their latest contents, and without reading the disk
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Compressed tier test" << std::endl;
+
+	{
+		// a block of records shrinks and decompresses to itself; random bytes
+		// do not fit in fewer bytes, and a corrupt block is turned away
+		std::string records;
+		for (int i = 0; records.size() < Page::SIZE; i++)
+			records += "record " + std::to_string(i % 100) + " ";
+		records.resize(Page::SIZE);
+		std::string random(Page::SIZE, '\0');
+		srand(7);
+		for (std::size_t i = 0; i < random.size(); i++)
+			random[i] = rand();
+
+		std::vector<char> block(Page::SIZE);
+		std::vector<char> bytes(Page::SIZE);
+		std::size_t length = lzCompress(records.data(), records.size(), &block[0], block.size());
+		bool shrunk = length > 0 && length < Page::SIZE / 4;
+		checkPassFail(shrunk, true)
+		checkPassFail(lzDecompress(&block[0], length, &bytes[0], bytes.size()), true)
+		checkPassFail(std::string(bytes.begin(), bytes.end()), records)
+		checkPassFail(lzDecompress(&block[0], length / 2, &bytes[0], bytes.size()), false)
+		checkPassFail((int)lzCompress(random.data(), random.size(), &block[0], block.size()), 0)
+	}
+
+	const int numPages = 10;
+	{
+		PageFile relation = PageFile::create(relationName);
+		for (int i = 0; i < numPages; i++)
+		{
+			PageId pageNo;
+			Page page = relation.allocatePage(pageNo);
+			page.insertRecord("record " + std::to_string(pageNo));
+			relation.writePage(pageNo, page);
+		}
+	}
+
+	{
+		PageFile file = PageFile::open(relationName);
+		BufMgr *tierBufMgr = new BufMgr(3);
+		tierBufMgr->enableCompressedTier(1 << 20);
+		Page *page;
+		for (PageId i = 1; i <= numPages; i++)
+		{
+			tierBufMgr->readPage(&file, i, page);
+			if (i == 1)
+				page->updateRecord(RecordId{i, 1}, "changed " + std::to_string(i));
+			tierBufMgr->unPinPage(&file, i, i == 1);
+		}
+		checkPassFail((int)tierBufMgr->getTierStats().pages, numPages - 3)
+
+		// pages 1 to 7 were evicted, page 1 after being written back
+		tierBufMgr->clearBufStats();
+		int matching = 0;
+		for (PageId i = 1; i <= 7; i++)
+		{
+			tierBufMgr->readPage(&file, i, page);
+			if (page->getRecord(RecordId{i, 1}) == (i == 1 ? "changed " : "record ") + std::to_string(i))
+				matching++;
+			tierBufMgr->unPinPage(&file, i, false);
+		}
+		checkPassFail(matching, 7)
+		checkPassFail(tierBufMgr->getBufStats().tierHits, 7)
+		checkPassFail(tierBufMgr->getBufStats().diskreads, 0)
+
+		// a disposed page leaves the tier with the pool
+		tierBufMgr->disposePage(&file, 8);
+		checkPassFail((int)tierBufMgr->getTierStats().pages, numPages - 3 - 1)
+
+		// pages passed over by a ring are not kept; only the frame the ring
+		// takes from the pool at first evicts a page into the tier
+		std::uint64_t stores = tierBufMgr->getTierStats().stores;
+		for (PageId i = 1; i <= 7; i++)
+		{
+			tierBufMgr->readPage(&file, i, page, ACCESS_SEQUENTIAL);
+			tierBufMgr->unPinPage(&file, i, false);
+		}
+		checkPassFail(tierBufMgr->getTierStats().stores, stores + 1)
+
+		tierBufMgr->flushFile(&file);
+		checkPassFail((int)tierBufMgr->getTierStats().pages, 0)
+
+		// a budget too small for a page keeps none
+		tierBufMgr->enableCompressedTier(CompressedTier::ENTRY_OVERHEAD);
+		for (PageId i = 1; i <= 7; i++)
+		{
+			tierBufMgr->readPage(&file, i, page);
+			tierBufMgr->unPinPage(&file, i, false);
+		}
+		checkPassFail((int)tierBufMgr->getTierStats().pages, 0)
+		tierBufMgr->enableCompressedTier(0);
+		checkPassFail((int)tierBufMgr->getTierStats().budget, 0)
+		tierBufMgr->flushFile(&file);
+		delete tierBufMgr;
+	}
+
+	{
+		// threads sharing a pool too small for their pages; page 8 is gone
+		PageFile file = PageFile::open(relationName);
+		BufMgr *tierBufMgr = new BufMgr(4);
+		tierBufMgr->enableCompressedTier(1 << 20);
+		const int numThreads = 4;
+		std::atomic<int> matching(0);
+		std::vector<std::thread> threads;
+		for (int t = 0; t < numThreads; t++)
+		{
+			threads.push_back(std::thread([tierBufMgr, &file, &matching, t]()
+			{
+				unsigned int seed = t + 1;
+				Page *page;
+				for (int i = 0; i < 500; i++)
+				{
+					PageId pageNo = 1 + rand_r(&seed) % 7;
+					tierBufMgr->readPage(&file, pageNo, page);
+					if (page->getRecord(RecordId{pageNo, 1}) == (pageNo == 1 ? "changed " : "record ") + std::to_string(pageNo))
+						matching++;
+					tierBufMgr->unPinPage(&file, pageNo, false);
+				}
+			}));
+		}
+		for (int t = 0; t < numThreads; t++)
+			threads[t].join();
+		checkPassFail(matching, numThreads * 500)
+		bool fromTier = tierBufMgr->getBufStats().tierHits > 0;
+		checkPassFail(fromTier, true)
+		tierBufMgr->flushFile(&file);
+		delete tierBufMgr;
+	}
+
+	File::remove(relationName);
+}
+
+void test26()
+{
+	// A batch of pages, some in the pool, some in adjacent runs and some on
+	// their own, reads the same through every backend as page by page
+	const FileBackend backends[] = {BACKEND_STREAM, BACKEND_PREAD, BACKEND_DIRECT};
+	const char *backendNames[] = {"fstream", "pread", "O_DIRECT"};
+	const int numPages = 20;
+
+	for (int b = 0; b < 3; b++)
+	{
+		std::cout << "--------------------" << std::endl;
+		std::cout << "Batch read test: " << backendNames[b] << std::endl;
+		{
+			PageFile relation = PageFile::create(relationName);
+			for (int i = 0; i < numPages; i++)
+			{
+				PageId pageNo;
+				Page page = relation.allocatePage(pageNo);
+				page.insertRecord("record " + std::to_string(pageNo));
+				relation.writePage(pageNo, page);
+			}
+		}
+
+		{
+			PageFile file = PageFile::open(relationName, backends[b]);
+			BufMgr *batchBufMgr = new BufMgr(30);
+			Page *page;
+			batchBufMgr->readPage(&file, 5, page);
+			batchBufMgr->unPinPage(&file, 5, false);
+			batchBufMgr->clearBufStats();
+
+			// page 5 twice from the pool, runs 3-5 and 9-12, pages 1 and 20 alone
+			const PageId pageNos[] = {9, 5, 3, 4, 5, 10, 20, 11, 12, 1, 12};
+			const int count = sizeof(pageNos) / sizeof(pageNos[0]);
+			Page *pages[count];
+			batchBufMgr->readPages(&file, pageNos, pages, count);
+			int matching = 0;
+			for (int i = 0; i < count; i++)
+			{
+				if (pages[i]->getRecord(RecordId{pageNos[i], 1}) == "record " + std::to_string(pageNos[i]))
+					matching++;
+			}
+			checkPassFail(matching, count)
+			checkPassFail(batchBufMgr->getBufStats().accesses, count)
+			checkPassFail(batchBufMgr->getBufStats().hits, 3)
+			checkPassFail(batchBufMgr->getBufStats().diskreads, 8)
+			for (int i = 0; i < count; i++)
+				batchBufMgr->unPinPage(&file, pageNos[i], false);
+			int invalid = 0;
+			try
+			{
+				batchBufMgr->unPinPage(&file, 12, false);
+			}
+			catch (const PageNotPinnedException &e)
+			{
+				invalid++;
+			}
+			checkPassFail(invalid, 1)
+
+			// a page past the end of the file fails the batch and leaves no pins
+			const PageId pastEnd[] = {2, 6, 7, numPages + 5, 13};
+			invalid = 0;
+			try
+			{
+				batchBufMgr->readPages(&file, pastEnd, pages, 5);
+			}
+			catch (const InvalidPageException &e)
+			{
+				invalid++;
+			}
+			checkPassFail(invalid, 1)
+			invalid = 0;
+			try
+			{
+				batchBufMgr->flushFile(&file);
+			}
+			catch (const PagePinnedException &e)
+			{
+				invalid++;
+			}
+			checkPassFail(invalid, 0)
+			delete batchBufMgr;
+
+			// as does a batch larger than the pool
+			batchBufMgr = new BufMgr(3);
+			const PageId tooMany[] = {1, 2, 3, 4};
+			invalid = 0;
+			try
+			{
+				batchBufMgr->readPages(&file, tooMany, pages, 4);
+			}
+			catch (const BufferExceededException &e)
+			{
+				invalid++;
+			}
+			checkPassFail(invalid, 1)
+			batchBufMgr->readPages(&file, tooMany, pages, 3);
+			checkPassFail(pages[2]->getRecord(RecordId{3, 1}), "record 3")
+			for (int i = 0; i < 3; i++)
+				batchBufMgr->unPinPage(&file, tooMany[i], false);
+			batchBufMgr->flushFile(&file);
+			delete batchBufMgr;
+		}
+
+		File::remove(relationName);
+	}
+}
+
+void test27()
+{
+	// Guards on the same page latch it shared, exclusively and optimistically
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Page latch test" << std::endl;
+
+	{
+		PageFile relation = PageFile::create(relationName);
+		PageId pageNo;
+		Page page = relation.allocatePage(pageNo);
+		page.insertRecord("00000000");
+		page.insertRecord("00000000");
+		relation.writePage(pageNo, page);
+	}
+
+	{
+		PageFile file = PageFile::open(relationName);
+		BufMgr *latchBufMgr = new BufMgr(5);
+		{
+			PageGuard first = latchBufMgr->readPage(&file, 1);
+			PageGuard second = latchBufMgr->readPage(&file, 1);
+			first.latch(LATCH_SHARED);
+			second.latch(LATCH_SHARED);
+			checkPassFail(second.latchMode(), LATCH_SHARED)
+
+			// readers leave an optimistic read valid, a writer does not
+			second.latch(LATCH_OPTIMISTIC);
+			checkPassFail(second.validate(), true)
+			first.unlatch();
+			first.latch(LATCH_EXCLUSIVE);
+			first.unlatch();
+			checkPassFail(second.validate(), false)
+			checkPassFail(second.upgrade(), false)
+			checkPassFail(second.latchMode(), LATCH_OPTIMISTIC)
+
+			// of two optimistic readers only the first upgrades
+			second.latch(LATCH_OPTIMISTIC);
+			first.latch(LATCH_OPTIMISTIC);
+			checkPassFail(second.upgrade(), true)
+			checkPassFail(second.latchMode(), LATCH_EXCLUSIVE)
+			checkPassFail(first.upgrade(), false)
+			checkPassFail(latchBufMgr->getBufStats().latchRestarts, 3)
+
+			// moving a guard moves its latch, releasing it drops the latch
+			PageGuard moved(std::move(second));
+			checkPassFail(second.latchMode(), LATCH_NONE)
+			checkPassFail(moved.latchMode(), LATCH_EXCLUSIVE)
+			moved.release();
+			first.latch(LATCH_EXCLUSIVE);
+			checkPassFail(first.latchMode(), LATCH_EXCLUSIVE)
+		}
+
+		// writers keep both records equal, readers holding the latch shared
+		// never see them differ
+		const int numThreads = 4;
+		const int rounds = 2000;
+		std::atomic<int> torn(0);
+		std::vector<std::thread> threads;
+		for (int t = 0; t < numThreads; t++)
+		{
+			threads.push_back(std::thread([latchBufMgr, &file, &torn, t]()
+			{
+				for (int i = 0; i < rounds; i++)
+				{
+					PageGuard guard = latchBufMgr->readPage(&file, 1);
+					if (t % 2 == 0)
+					{
+						guard.latch(LATCH_EXCLUSIVE);
+						char record[16];
+						sprintf(record, "%08d", std::atoi(guard->getRecord(RecordId{1, 1}).c_str()) + 1);
+						guard->updateRecord(RecordId{1, 1}, record);
+						guard->updateRecord(RecordId{1, 2}, record);
+						guard.markDirty();
+					}
+					else
+					{
+						guard.latch(LATCH_SHARED);
+						if (guard->getRecord(RecordId{1, 1}) != guard->getRecord(RecordId{1, 2}))
+							torn++;
+					}
+				}
+			}));
+		}
+		for (int t = 0; t < numThreads; t++)
+			threads[t].join();
+		checkPassFail(torn, 0)
+		{
+			PageGuard guard = latchBufMgr->readPage(&file, 1);
+			guard.latch(LATCH_SHARED);
+			checkPassFail(std::atoi(guard->getRecord(RecordId{1, 2}).c_str()), numThreads / 2 * rounds)
+		}
+		latchBufMgr->flushFile(&file);
+		delete latchBufMgr;
+	}
+
+	File::remove(relationName);
+}
+
+void test28()
+{
+	// Files opened with BACKEND_MMAP are read in place, around the pool
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Mapped file test" << std::endl;
+	const int numPages = 10;
+
+	{
+		PageFile relation = PageFile::create(relationName);
+		for (int i = 0; i < numPages; i++)
+		{
+			PageId pageNo;
+			Page page = relation.allocatePage(pageNo);
+			page.insertRecord("record " + std::to_string(pageNo));
+			relation.writePage(pageNo, page);
+		}
+	}
+
+	{
+		PageFile file = PageFile::open(relationName, BACKEND_MMAP);
+		BufMgr *mappedBufMgr = new BufMgr(5);
+		Page *page;
+		mappedBufMgr->readPage(&file, 3, page);
+		checkPassFail(page->getRecord(RecordId{3, 1}), "record 3")
+		mappedBufMgr->unPinPage(&file, 3, false);
+
+		// more pages than the pool holds, none of them taking a frame
+		const PageId pageNos[] = {1, 2, 4, 5, 6, 7, 8, 9, 10};
+		const int count = sizeof(pageNos) / sizeof(pageNos[0]);
+		Page *pages[count];
+		mappedBufMgr->readPages(&file, pageNos, pages, count);
+		int matching = 0;
+		for (int i = 0; i < count; i++)
+		{
+			if (pages[i]->getRecord(RecordId{pageNos[i], 1}) == "record " + std::to_string(pageNos[i]))
+				matching++;
+		}
+		checkPassFail(matching, count)
+		checkPassFail(mappedBufMgr->getBufStats().mappedReads, count + 1)
+		checkPassFail(mappedBufMgr->getBufStats().hits, 0)
+		checkPassFail(mappedBufMgr->getBufStats().diskreads, 0)
+		{
+			PageGuard guard = mappedBufMgr->readPage(&file, 7);
+			guard.latch(LATCH_SHARED);
+			checkPassFail(guard->getRecord(RecordId{7, 1}), "record 7")
+		}
+
+		int invalid = 0;
+		try
+		{
+			mappedBufMgr->readPage(&file, numPages + 1, page);
+		}
+		catch (const InvalidPageException &e)
+		{
+			invalid++;
+		}
+		checkPassFail(invalid, 1)
+
+		// nothing may be written through the mapping
+		int readOnly = 0;
+		try
+		{
+			mappedBufMgr->unPinPage(&file, 3, true);
+		}
+		catch (const FileIOException &e)
+		{
+			readOnly++;
+		}
+		try
+		{
+			PageId pageNo;
+			mappedBufMgr->allocPage(&file, pageNo, page);
+		}
+		catch (const FileIOException &e)
+		{
+			readOnly++;
+		}
+		try
+		{
+			mappedBufMgr->disposePage(&file, 3);
+		}
+		catch (const FileIOException &e)
+		{
+			readOnly++;
+		}
+		checkPassFail(readOnly, 3)
+
+		// nor may the file be opened buffered while it is mapped
+		invalid = 0;
+		try
+		{
+			PageFile::open(relationName);
+		}
+		catch (const FileOpenException &e)
+		{
+			invalid++;
+		}
+		checkPassFail(invalid, 1)
+		mappedBufMgr->flushFile(&file);
+		delete mappedBufMgr;
+	}
+
+	{
+		BlobFile blob = BlobFile::create(relationName + ".other");
+		PageId pageNo;
+		Page page = blob.allocatePage(pageNo);
+		page.insertRecord("blob");
+		blob.writePage(pageNo, page);
+	}
+
+	{
+		BlobFile blob = BlobFile::open(relationName + ".other", BACKEND_MMAP);
+		BufMgr *mappedBufMgr = new BufMgr(5);
+		Page *page;
+		mappedBufMgr->readPage(&blob, 1, page);
+		// blob pages keep no page number of their own
+		checkPassFail(page->getRecord(RecordId{page->page_number(), 1}), "blob")
+		mappedBufMgr->unPinPage(&blob, 1, false);
+		delete mappedBufMgr;
+	}
+	File::remove(relationName + ".other");
+
+	int invalid = 0;
+	try
+	{
+		PageFile::create(relationName + ".other", BACKEND_MMAP);
+	}
+	catch (const FileIOException &e)
+	{
+		invalid++;
+	}
+	checkPassFail(invalid, 1)
+	File::remove(relationName);
+
+	// scans and indexes read a mapped relation transparently
+	createRelationForward();
+	delete file1;
+	file1 = new PageFile(relationName, false, BACKEND_MMAP);
+	{
+		FileScan scan(relationName, bufMgr, FileScan::READ_AHEAD, ACCESS_SEQUENTIAL, BACKEND_MMAP);
+		int records = 0;
+		int readOnly = 0;
+		try
+		{
+			RecordId rid;
+			while (true)
+			{
+				scan.scanNext(rid);
+				if (records == 0)
+				{
+					try
+					{
+						scan.markDirty();
+					}
+					catch (const FileIOException &e)
+					{
+						readOnly++;
+					}
+				}
+				records++;
+			}
+		}
+		catch (const EndOfFileException &e)
+		{
+		}
+		checkPassFail(records, relationSize)
+		checkPassFail(readOnly, 1)
+	}
+
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, BACKEND_MMAP);
+		checkPassFail(intScan(&index, 25, GT, 40, LT), 14)
+		checkPassFail(intScan(&index, 3000, GTE, 4000, LT), 1000)
+	}
+	{
+		BTreeIndex index(relationName, intIndexName, bufMgr, offsetof(tuple, i), INTEGER, BACKEND_MMAP);
+		checkPassFail(intScan(&index, -1000, GTE, 6000, LTE), relationSize)
+		int key = relationSize;
+		invalid = 0;
+		try
+		{
+			index.insertEntry(&key, RecordId{1, 1});
+		}
+		catch (const FileIOException &e)
+		{
+			invalid++;
+		}
+		checkPassFail(invalid, 1)
+	}
+	File::remove(intIndexName);
+	deleteRelation();
+}
+
+void test29()
+{
+	// Replacement passes over dirty pages for clean ones, up to the lookahead
+	const int numPages = 20;
+	const int numBufs = 10;
+
+	{
+		PageFile relation = PageFile::create(relationName);
+		for (int i = 0; i < numPages; i++)
+		{
+			PageId pageNo;
+			Page page = relation.allocatePage(pageNo);
+			page.insertRecord("clean");
+			relation.writePage(pageNo, page);
+		}
+	}
+
+	for (int policy = 0; policy < NUM_POLICIES; policy++)
+	{
+		std::cout << "--------------------" << std::endl;
+		std::cout << "Clean victim test: " << policyName((ReplacementPolicy)policy) << std::endl;
+		PageFile file = PageFile::open(relationName);
+		// without a background writer, so that nothing is written but by replacement
+		BufMgr *victimBufMgr = new BufMgr(numBufs, (ReplacementPolicy)policy, false);
+		victimBufMgr->setCleanLookahead(numBufs);
+		Page *page;
+		for (PageId pageNo = 1; pageNo <= numBufs; pageNo++)
+		{
+			victimBufMgr->readPage(&file, pageNo, page);
+			if (pageNo <= numBufs / 2)
+				page->updateRecord(RecordId{pageNo, 1}, "dirty");
+			victimBufMgr->unPinPage(&file, pageNo, pageNo <= numBufs / 2);
+		}
+
+		// the clean pages go first, the dirty ones passed over stay
+		for (PageId pageNo = numBufs + 1; pageNo <= numBufs + numBufs / 2; pageNo++)
+		{
+			victimBufMgr->readPage(&file, pageNo, page);
+			victimBufMgr->unPinPage(&file, pageNo, true);
+		}
+		checkPassFail(victimBufMgr->getBufStats().fgwrites, 0)
+		checkPassFail(victimBufMgr->getBufStats().cleanEvictions, numBufs / 2)
+		checkPassFail((victimBufMgr->getBufStats().dirtySkips > 0), true)
+		checkPassFail((int)victimBufMgr->getBufStats().writeStall.count(), 0)
+
+		// with only dirty pages left, one is written after all
+		victimBufMgr->setCleanLookahead(2);
+		victimBufMgr->readPage(&file, numPages, page);
+		victimBufMgr->unPinPage(&file, numPages, false);
+		checkPassFail(victimBufMgr->getBufStats().dirtyEvictions, 1)
+		checkPassFail((victimBufMgr->getBufStats().fgwrites > 0), true)
+		checkPassFail((int)victimBufMgr->getBufStats().writeStall.count(), 1)
+		victimBufMgr->flushFile(&file);
+		delete victimBufMgr;
+
+		// the pages passed over are written back by the background writer
+		victimBufMgr = new BufMgr(numBufs, (ReplacementPolicy)policy);
+		victimBufMgr->setCleanLookahead(numBufs);
+		for (PageId pageNo = 1; pageNo <= numBufs; pageNo++)
+		{
+			victimBufMgr->readPage(&file, pageNo, page);
+			victimBufMgr->unPinPage(&file, pageNo, pageNo % 2 == 0);
+		}
+		for (PageId pageNo = numBufs + 1; pageNo <= numPages; pageNo++)
+		{
+			victimBufMgr->readPage(&file, pageNo, page);
+			victimBufMgr->unPinPage(&file, pageNo, false);
+		}
+		for (int wait = 0; wait < 500 && victimBufMgr->getBufStats().bgwrites < numBufs / 2; wait++)
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		const BufStats &stats = victimBufMgr->getBufStats();
+		checkPassFail(stats.fgwrites + stats.bgwrites, stats.diskwrites)
+		checkPassFail(stats.bgwrites, numBufs / 2)
+		victimBufMgr->flushFile(&file);
+		delete victimBufMgr;
+	}
+
+	{
+		PageFile file = PageFile::open(relationName);
+		int dirty = 0;
+		for (PageId pageNo = 1; pageNo <= numBufs / 2; pageNo++)
+		{
+			Page page = file.readPage(pageNo);
+			if (page.getRecord(RecordId{pageNo, 1}) == "dirty")
+				dirty++;
+		}
+		checkPassFail(dirty, numBufs / 2)
+	}
+
+	File::remove(relationName);
+}
+
+void test30()
+{
+	// Flushing a file makes the replacement policy forget its evicted pages
+	std::cout << "--------------------" << std::endl;
+	std::cout << "Replacement history test" << std::endl;
+
+	{
+		PageFile relation = PageFile::create(relationName);
+		for (int i = 0; i < 10; i++)
+		{
+			PageId pageNo;
+			Page page = relation.allocatePage(pageNo);
+			relation.writePage(pageNo, page);
+		}
+	}
+
+	{
+		PageFile file = PageFile::open(relationName);
+		// 2Q over 4 frames keeps one page in A1in and remembers two that left it
+		BufMgr *historyBufMgr = new BufMgr(4, POLICY_2Q, false);
+		Page *page;
+		for (PageId pageNo = 1; pageNo <= 5; pageNo++)
+		{
+			historyBufMgr->readPage(&file, pageNo, page);
+			historyBufMgr->unPinPage(&file, pageNo, false);
+		}
+		historyBufMgr->flushFile(&file);
+
+		// page 1 left A1in before the flush, but comes back as a new page
+		// rather than a hot one, and is the first to go
+		const PageId pageNos[] = {1, 6, 7, 8, 9};
+		for (int i = 0; i < 5; i++)
+		{
+			historyBufMgr->readPage(&file, pageNos[i], page);
+			historyBufMgr->unPinPage(&file, pageNos[i], false);
+		}
+		historyBufMgr->clearBufStats();
+		historyBufMgr->readPage(&file, 1, page);
+		historyBufMgr->unPinPage(&file, 1, false);
+		checkPassFail(historyBufMgr->getBufStats().misses, 1)
+		historyBufMgr->flushFile(&file);
+		delete historyBufMgr;
+	}
+
+	File::remove(relationName);
+}
+
+void crashWriter(Durability durability, FileBackend backend)
+{
+	// write pages through a pool up to a sync point, then dirty more and die
+	// without closing anything
+	BufMgr *crashBufMgr = new BufMgr(50, POLICY_CLOCK, false);
+	PageFile *file = new PageFile(relationName, true, backend);
+	file->setDurability(durability);
+	for (int i = 0; i < 2 * numDurablePages; i++)
+	{
+		if (i == numDurablePages)
+		{
+			crashBufMgr->flushFile(file);
+			if (durability == DURABILITY_NONE)
+				file->sync();
+		}
+
+		PageId pageNo;
+		Page *page;
+		char record[32];
+		crashBufMgr->allocPage(file, pageNo, page);
+		sprintf(record, "%08d %s", pageNo, i < numDurablePages ? "durable" : "lost");
+		page->insertRecord(record);
+		crashBufMgr->unPinPage(file, pageNo, true);
+	}
+	_exit(0);
+}
+
+void concurrentWorker(File *file, const std::vector<std::pair<PageId, RecordId> > *records, int thread, int numThreads, int rounds, std::atomic<int> *finished, int *errors)
+{
+	unsigned int seed = thread + 1;
+	int numPages = records->size();
+
+	// rewrite the pages i with i % numThreads == thread, which only this
+	// thread touches, in a different order each round
+	for (int round = 0; round < rounds; round++)
+	{
+		int start = rand_r(&seed) % numPages;
+		for (int n = 0; n < numPages; n++)
+		{
+			int i = (start + n * 7) % numPages;
+			if (i % numThreads != thread)
+				continue;
+
+			PageId pageNo = (*records)[i].first;
+			const RecordId &rid = (*records)[i].second;
+			Page *page;
+			char record[32];
+			bufMgr->readPage(file, pageNo, page);
+
+			// pin the page a second time now and then
+			bool twice = rand_r(&seed) % 4 == 0;
+			if (twice)
+				bufMgr->readPage(file, pageNo, page);
+
+			sprintf(record, "%08d%08d", pageNo, round);
+			if (page->getRecord(rid) != record)
+				(*errors)++;
+			sprintf(record, "%08d%08d", pageNo, round + 1);
+			page->updateRecord(rid, record);
+
+			if (twice)
+				bufMgr->unPinPage(file, pageNo, false);
+			bufMgr->unPinPage(file, pageNo, true);
+		}
+	}
+
+	// wait for the other threads to finish writing, then read every page
+	(*finished)++;
+	while (*finished < numThreads)
+		std::this_thread::yield();
+
+	for (int n = 0; n < numPages; n++)
+	{
+		PageId pageNo = (*records)[(thread + n) % numPages].first;
+		const RecordId &rid = (*records)[(thread + n) % numPages].second;
+		Page *page;
+		char record[32];
+		sprintf(record, "%08d%08d", pageNo, rounds);
+		bufMgr->readPage(file, pageNo, page);
+		if (page->getRecord(rid) != record)
+			(*errors)++;
+		bufMgr->unPinPage(file, pageNo, false);
+	}
+}
+
 // -----------------------------------------------------------------------------
 // createRelationForward
 // -----------------------------------------------------------------------------
@@ -0,0 +1,1078 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <algorithm>
+#include "buffer.h"
+#include "replacer.h"
+
+namespace badgerdb {
+
+const char* policyName(const ReplacementPolicy policy)
+{
+	switch (policy)
+	{
+		case POLICY_CLOCK: return "clock";
+		case POLICY_LRU2: return "lru2";
+		case POLICY_2Q: return "2q";
+		case POLICY_ARC: return "arc";
+		case POLICY_CLOCK_PRO: return "clockpro";
+	}
+	return "unknown";
+}
+
+//----------------------------------------
+// Replacer
+//----------------------------------------
+
+Replacer* Replacer::create(const ReplacementPolicy policy, const std::uint32_t bufs,
+													 BufDesc* descTable, BufStats& stats)
+{
+	switch (policy)
+	{
+		case POLICY_LRU2: return new LRU2Replacer(bufs, descTable, stats);
+		case POLICY_2Q: return new TwoQReplacer(bufs, descTable, stats);
+		case POLICY_ARC: return new ARCReplacer(bufs, descTable, stats);
+		case POLICY_CLOCK_PRO: return new ClockProReplacer(bufs, descTable, stats);
+		case POLICY_CLOCK: break;
+	}
+	return new ClockReplacer(bufs, descTable, stats);
+}
+
+Replacer::Replacer(const std::uint32_t bufs, BufDesc* descTable, BufStats& stats)
+	: numBufs(bufs), numFrames(bufs), bufDescTable(descTable), bufStats(stats)
+{
+	// hand out low frame numbers first
+	for (std::uint32_t i = bufs; i > 0; i--)
+		freeFrames.push_back(i - 1);
+}
+
+bool Replacer::evictable(const FrameId frame) const
+{
+	return bufDescTable[frame].valid && bufDescTable[frame].pinCnt == 0;
+}
+
+bool Replacer::tryClaim(const FrameId frame)
+{
+	if (!claimFree(frame))
+		return false;
+
+	// the page may have been dropped since it was checked
+	if (isValid(frame))
+		return true;
+	bufDescTable[frame].pinCnt = 0;
+	return false;
+}
+
+bool Replacer::claimFree(const FrameId frame)
+{
+	int unpinned = 0;
+	return bufDescTable[frame].pinCnt.compare_exchange_strong(unpinned, BufDesc::CLAIMED);
+}
+
+bool Replacer::isValid(const FrameId frame) const
+{
+	return bufDescTable[frame].valid;
+}
+
+bool Replacer::passOver(const FrameId frame, const std::uint32_t lookahead,
+											std::vector<FrameId>& skipped)
+{
+	if (lookahead == 0 || !bufDescTable[frame].dirty || !evictable(frame))
+		return false;
+	if (std::find(skipped.begin(), skipped.end(), frame) != skipped.end())
+		return true;
+	if (skipped.size() >= lookahead)
+		return false;
+	skipped.push_back(frame);
+	return true;
+}
+
+bool Replacer::testAndClearRef(const FrameId frame)
+{
+	return bufDescTable[frame].refbit.exchange(false);
+}
+
+bool Replacer::takeFreeFrame(FrameId& frame)
+{
+	if (freeFrames.empty())
+		return false;
+	frame = freeFrames.back();
+	freeFrames.pop_back();
+	bufDescTable[frame].pinCnt = BufDesc::CLAIMED;
+	return true;
+}
+
+void Replacer::releaseFrame(const FrameId frame)
+{
+	freeFrames.push_back(frame);
+}
+
+bool Replacer::claim(const FrameId frame)
+{
+	if (!tryClaim(frame))
+		return false;
+	std::lock_guard<std::mutex> guard(latch);
+	untrack(frame);
+	return true;
+}
+
+bool Replacer::retire(const FrameId frame)
+{
+	if (isValid(frame))
+		return claim(frame);
+	return claimFree(frame);
+}
+
+void Replacer::resize(const std::uint32_t frames, const std::uint32_t bufs)
+{
+	numFrames = frames;
+	numBufs = bufs;
+
+	// hand out low frame numbers first
+	freeFrames.clear();
+	for (std::uint32_t i = frames; i > 0; i--)
+	{
+		BufDesc* desc = &bufDescTable[i - 1];
+		if (!desc->retired && !desc->valid && desc->pinCnt == 0)
+			freeFrames.push_back(i - 1);
+	}
+}
+
+void Replacer::recordScan(const std::uint32_t frames)
+{
+	bufStats.scanLength.record(frames);
+}
+
+//----------------------------------------
+// CLOCK
+//----------------------------------------
+
+ClockReplacer::ClockReplacer(const std::uint32_t bufs, BufDesc* descTable, BufStats& stats)
+	: Replacer(bufs, descTable, stats), clockHand(0)
+{
+}
+
+bool ClockReplacer::victim(const File* file, const PageId pageNo, FrameId& frame,
+													 const std::uint32_t lookahead, std::vector<FrameId>& skipped)
+{
+	std::uint32_t numScanned = 0;
+	std::uint32_t sweep = 2*numFrames;
+	std::uint32_t limit = lookahead;
+
+	while (numScanned < sweep)	//Need to scn twice
+	{
+		// twice around without a clean page: one more turn, taking dirty ones
+		if (numScanned == 2*numFrames && limit > 0 && !skipped.empty())
+		{
+			limit = 0;
+			sweep += numFrames;
+		}
+
+		// advance the clock
+		FrameId hand = static_cast<FrameId>(clockHand++ % numFrames);
+		numScanned++;
+
+		// if invalid, use frame
+		if (!isValid(hand))
+		{
+			if (claimFree(hand))
+			{
+				frame = hand;
+				recordScan(numScanned);
+				return true;
+			}
+			continue;
+		}
+
+		// is valid, check referenced bit; if it was set, it is now clear
+		if (!testAndClearRef(hand))
+		{
+			if (passOver(hand, limit, skipped))
+				continue;
+
+			// hasn't been referenced and is not pinned, use it
+			if (tryClaim(hand))
+			{
+				frame = hand;
+				recordScan(numScanned);
+				return true;
+			}
+		}
+	}
+
+	recordScan(numScanned);
+	return false;
+}
+
+void ClockReplacer::upcoming(const std::uint32_t count, std::vector<FrameId>& frames)
+{
+	std::uint64_t hand = clockHand;
+	for (std::uint32_t i = 0; i < count && i < numFrames; i++)
+		frames.push_back(static_cast<FrameId>((hand + i) % numFrames));
+}
+
+//----------------------------------------
+// LRU-2
+//----------------------------------------
+
+LRU2Replacer::LRU2Replacer(const std::uint32_t bufs, BufDesc* descTable, BufStats& stats)
+	: Replacer(bufs, descTable, stats), now(0), last(bufs, 0), prev(bufs, 0),
+		keys(bufs), tracked(bufs, false)
+{
+}
+
+void LRU2Replacer::rank(const FrameId frame)
+{
+	ranks.insert(std::make_pair(std::make_pair(prev[frame], last[frame]), frame));
+}
+
+bool LRU2Replacer::victim(const File* file, const PageId pageNo, FrameId& frame,
+													const std::uint32_t lookahead, std::vector<FrameId>& skipped)
+{
+	std::lock_guard<std::mutex> guard(latch);
+	if (takeFreeFrame(frame))
+	{
+		recordScan(0);
+		return true;
+	}
+
+	// a second pass takes a dirty page if no clean one was ranked
+	std::uint32_t scanned = 0;
+	for (std::uint32_t limit = lookahead; ; limit = 0)
+	{
+		for (RankSet::iterator it = ranks.begin(); it != ranks.end(); ++it)
+		{
+			scanned++;
+			if (passOver(it->second, limit, skipped) || !tryClaim(it->second))
+				continue;
+
+			frame = it->second;
+			ranks.erase(it);
+			tracked[frame] = false;
+
+			// remember when the page was last referenced
+			historyOrder.push_back(keys[frame]);
+			history[keys[frame]] = std::make_pair(last[frame], --historyOrder.end());
+			if (historyOrder.size() > numBufs)
+			{
+				history.erase(historyOrder.front());
+				historyOrder.pop_front();
+			}
+			recordScan(scanned);
+			return true;
+		}
+		if (limit == 0 || skipped.empty())
+			break;
+	}
+
+	recordScan(scanned);
+	return false;
+}
+
+void LRU2Replacer::insert(const FrameId frame, const File* file, const PageId pageNo)
+{
+	std::lock_guard<std::mutex> guard(latch);
+	PageKey key = {file, pageNo};
+	prev[frame] = 0;
+	std::unordered_map<PageKey, std::pair<std::uint64_t, HistoryList::iterator>, PageKeyHash>::iterator
+		old = history.find(key);
+	if (old != history.end())
+	{
+		prev[frame] = old->second.first;
+		historyOrder.erase(old->second.second);
+		history.erase(old);
+	}
+
+	last[frame] = ++now;
+	keys[frame] = key;
+	tracked[frame] = true;
+	rank(frame);
+}
+
+void LRU2Replacer::access(const FrameId frame)
+{
+	std::lock_guard<std::mutex> guard(latch);
+	if (!tracked[frame])
+		return;
+	ranks.erase(std::make_pair(std::make_pair(prev[frame], last[frame]), frame));
+	prev[frame] = last[frame];
+	last[frame] = ++now;
+	rank(frame);
+}
+
+void LRU2Replacer::untrack(const FrameId frame)
+{
+	if (tracked[frame])
+	{
+		ranks.erase(std::make_pair(std::make_pair(prev[frame], last[frame]), frame));
+		tracked[frame] = false;
+	}
+}
+
+void LRU2Replacer::remove(const FrameId frame)
+{
+	std::lock_guard<std::mutex> guard(latch);
+	untrack(frame);
+	releaseFrame(frame);
+}
+
+void LRU2Replacer::resize(const std::uint32_t frames, const std::uint32_t bufs)
+{
+	Replacer::resize(frames, bufs);
+	last.resize(frames, 0);
+	prev.resize(frames, 0);
+	keys.resize(frames);
+	tracked.resize(frames, false);
+
+	while (historyOrder.size() > numBufs)
+	{
+		history.erase(historyOrder.front());
+		historyOrder.pop_front();
+	}
+}
+
+void LRU2Replacer::forgetFile(const File* file)
+{
+	std::lock_guard<std::mutex> guard(latch);
+	for (HistoryList::iterator it = historyOrder.begin(); it != historyOrder.end(); )
+	{
+		if (it->file == file)
+		{
+			history.erase(*it);
+			it = historyOrder.erase(it);
+		}
+		else
+			++it;
+	}
+}
+
+void LRU2Replacer::upcoming(const std::uint32_t count, std::vector<FrameId>& frames)
+{
+	std::lock_guard<std::mutex> guard(latch);
+	std::uint32_t listed = 0;
+	for (RankSet::iterator it = ranks.begin(); it != ranks.end() && listed < count; ++it, listed++)
+		frames.push_back(it->second);
+}
+
+//----------------------------------------
+// 2Q
+//----------------------------------------
+
+TwoQReplacer::TwoQReplacer(const std::uint32_t bufs, BufDesc* descTable, BufStats& stats)
+	: Replacer(bufs, descTable, stats),
+		kin(std::max<std::uint32_t>(1, bufs / 4)),
+		kout(std::max<std::uint32_t>(1, bufs / 2)),
+		inAm(bufs, false), tracked(bufs, false), position(bufs), keys(bufs)
+{
+}
+
+bool TwoQReplacer::evictFrom(std::list<FrameId>& queue, FrameId& frame, std::uint32_t& scanned,
+														 const std::uint32_t lookahead, std::vector<FrameId>& skipped)
+{
+	for (std::list<FrameId>::iterator it = queue.end(); it != queue.begin(); )
+	{
+		--it;
+		scanned++;
+		if (passOver(*it, lookahead, skipped) || !tryClaim(*it))
+			continue;
+
+		frame = *it;
+		queue.erase(it);
+		tracked[frame] = false;
+
+		// pages leaving A1in are remembered in A1out
+		if (&queue == &a1in)
+		{
+			a1out.push_front(keys[frame]);
+			a1outIndex[keys[frame]] = a1out.begin();
+			if (a1out.size() > kout)
+			{
+				a1outIndex.erase(a1out.back());
+				a1out.pop_back();
+			}
+		}
+		return true;
+	}
+
+	return false;
+}
+
+bool TwoQReplacer::victim(const File* file, const PageId pageNo, FrameId& frame,
+													const std::uint32_t lookahead, std::vector<FrameId>& skipped)
+{
+	std::lock_guard<std::mutex> guard(latch);
+	if (takeFreeFrame(frame))
+	{
+		recordScan(0);
+		return true;
+	}
+
+	// a second pass takes a dirty page if neither queue had a clean one
+	std::uint32_t scanned = 0;
+	bool found;
+	std::list<FrameId>& first = a1in.size() > kin ? a1in : am;
+	std::list<FrameId>& second = a1in.size() > kin ? am : a1in;
+	for (std::uint32_t limit = lookahead; ; limit = 0)
+	{
+		found = evictFrom(first, frame, scanned, limit, skipped)
+			|| evictFrom(second, frame, scanned, limit, skipped);
+		if (found || limit == 0 || skipped.empty())
+			break;
+	}
+	recordScan(scanned);
+	return found;
+}
+
+void TwoQReplacer::insert(const FrameId frame, const File* file, const PageId pageNo)
+{
+	std::lock_guard<std::mutex> guard(latch);
+	PageKey key = {file, pageNo};
+	std::unordered_map<PageKey, std::list<PageKey>::iterator, PageKeyHash>::iterator
+		ghost = a1outIndex.find(key);
+	if (ghost != a1outIndex.end())
+	{
+		// referenced again after leaving A1in: a hot page
+		a1out.erase(ghost->second);
+		a1outIndex.erase(ghost);
+		am.push_front(frame);
+		position[frame] = am.begin();
+		inAm[frame] = true;
+	}
+	else
+	{
+		a1in.push_front(frame);
+		position[frame] = a1in.begin();
+		inAm[frame] = false;
+	}
+
+	keys[frame] = key;
+	tracked[frame] = true;
+}
+
+void TwoQReplacer::access(const FrameId frame)
+{
+	std::lock_guard<std::mutex> guard(latch);
+	// hits in A1in are correlated references and do not move the page
+	if (tracked[frame] && inAm[frame])
+		am.splice(am.begin(), am, position[frame]);
+}
+
+void TwoQReplacer::untrack(const FrameId frame)
+{
+	if (tracked[frame])
+	{
+		if (inAm[frame])
+			am.erase(position[frame]);
+		else
+			a1in.erase(position[frame]);
+		tracked[frame] = false;
+	}
+}
+
+void TwoQReplacer::remove(const FrameId frame)
+{
+	std::lock_guard<std::mutex> guard(latch);
+	untrack(frame);
+	releaseFrame(frame);
+}
+
+void TwoQReplacer::resize(const std::uint32_t frames, const std::uint32_t bufs)
+{
+	Replacer::resize(frames, bufs);
+	kin = std::max<std::uint32_t>(1, bufs / 4);
+	kout = std::max<std::uint32_t>(1, bufs / 2);
+	inAm.resize(frames, false);
+	tracked.resize(frames, false);
+	position.resize(frames);
+	keys.resize(frames);
+
+	while (a1out.size() > kout)
+	{
+		a1outIndex.erase(a1out.back());
+		a1out.pop_back();
+	}
+}
+
+void TwoQReplacer::forgetFile(const File* file)
+{
+	std::lock_guard<std::mutex> guard(latch);
+	for (std::list<PageKey>::iterator it = a1out.begin(); it != a1out.end(); )
+	{
+		if (it->file == file)
+		{
+			a1outIndex.erase(*it);
+			it = a1out.erase(it);
+		}
+		else
+			++it;
+	}
+}
+
+void TwoQReplacer::upcoming(const std::uint32_t count, std::vector<FrameId>& frames)
+{
+	std::lock_guard<std::mutex> guard(latch);
+	std::uint32_t listed = 0;
+
+	// A1in goes first while it is over its target size
+	std::list<FrameId>* queues[2] = {&a1in, &am};
+	if (a1in.size() <= kin)
+		std::swap(queues[0], queues[1]);
+	for (int q = 0; q < 2; q++)
+	{
+		for (std::list<FrameId>::reverse_iterator it = queues[q]->rbegin();
+				 it != queues[q]->rend() && listed < count; ++it, listed++)
+			frames.push_back(*it);
+	}
+}
+
+//----------------------------------------
+// ARC
+//----------------------------------------
+
+ARCReplacer::ARCReplacer(const std::uint32_t bufs, BufDesc* descTable, BufStats& stats)
+	: Replacer(bufs, descTable, stats), p(0),
+		inT2(bufs, false), tracked(bufs, false), position(bufs), keys(bufs)
+{
+}
+
+bool ARCReplacer::evictFrom(std::list<FrameId>& list, GhostList& ghosts, GhostIndex& index,
+														FrameId& frame, std::uint32_t& scanned,
+														const std::uint32_t lookahead, std::vector<FrameId>& skipped)
+{
+	for (std::list<FrameId>::iterator it = list.end(); it != list.begin(); )
+	{
+		--it;
+		scanned++;
+		if (passOver(*it, lookahead, skipped) || !tryClaim(*it))
+			continue;
+
+		frame = *it;
+		list.erase(it);
+		tracked[frame] = false;
+		ghosts.push_front(keys[frame]);
+		index[keys[frame]] = ghosts.begin();
+		return true;
+	}
+
+	return false;
+}
+
+void ARCReplacer::trimGhosts()
+{
+	while (t1.size() + b1.size() > numBufs && !b1.empty())
+	{
+		b1Index.erase(b1.back());
+		b1.pop_back();
+	}
+	while (t1.size() + t2.size() + b1.size() + b2.size() > 2 * numBufs && !b2.empty())
+	{
+		b2Index.erase(b2.back());
+		b2.pop_back();
+	}
+}
+
+bool ARCReplacer::victim(const File* file, const PageId pageNo, FrameId& frame,
+												 const std::uint32_t lookahead, std::vector<FrameId>& skipped)
+{
+	std::lock_guard<std::mutex> guard(latch);
+	PageKey key = {file, pageNo};
+	bool inB2 = false;
+
+	// forget pages whose read never completed
+	if (pending.size() > numBufs)
+		pending.clear();
+
+	// a miss on a ghost moves the target size of T1 towards the list that
+	// would have kept the page
+	GhostIndex::iterator ghost = b1Index.find(key);
+	if (ghost != b1Index.end())
+	{
+		std::uint32_t delta = std::max<std::uint32_t>(1, b2.size() / b1.size());
+		p = std::min(numBufs, p + delta);
+		b1.erase(ghost->second);
+		b1Index.erase(ghost);
+		pending.insert(key);
+	}
+	else if ((ghost = b2Index.find(key)) != b2Index.end())
+	{
+		std::uint32_t delta = std::max<std::uint32_t>(1, b1.size() / b2.size());
+		p = p > delta ? p - delta : 0;
+		b2.erase(ghost->second);
+		b2Index.erase(ghost);
+		pending.insert(key);
+		inB2 = true;
+	}
+
+	if (takeFreeFrame(frame))
+	{
+		recordScan(0);
+		return true;
+	}
+
+	// a second pass takes a dirty page if neither list had a clean one
+	std::uint32_t scanned = 0;
+	bool found;
+	bool fromT1 = !t1.empty() && (t1.size() > p || (inB2 && t1.size() == p));
+	for (std::uint32_t limit = lookahead; ; limit = 0)
+	{
+		if (fromT1)
+			found = evictFrom(t1, b1, b1Index, frame, scanned, limit, skipped)
+				|| evictFrom(t2, b2, b2Index, frame, scanned, limit, skipped);
+		else
+			found = evictFrom(t2, b2, b2Index, frame, scanned, limit, skipped)
+				|| evictFrom(t1, b1, b1Index, frame, scanned, limit, skipped);
+		if (found || limit == 0 || skipped.empty())
+			break;
+	}
+	recordScan(scanned);
+
+	trimGhosts();
+	return found;
+}
+
+void ARCReplacer::insert(const FrameId frame, const File* file, const PageId pageNo)
+{
+	std::lock_guard<std::mutex> guard(latch);
+	PageKey key = {file, pageNo};
+	if (pending.erase(key) > 0)
+	{
+		t2.push_front(frame);
+		position[frame] = t2.begin();
+		inT2[frame] = true;
+	}
+	else
+	{
+		t1.push_front(frame);
+		position[frame] = t1.begin();
+		inT2[frame] = false;
+	}
+
+	keys[frame] = key;
+	tracked[frame] = true;
+	trimGhosts();
+}
+
+void ARCReplacer::access(const FrameId frame)
+{
+	std::lock_guard<std::mutex> guard(latch);
+	if (!tracked[frame])
+		return;
+	t2.splice(t2.begin(), inT2[frame] ? t2 : t1, position[frame]);
+	inT2[frame] = true;
+}
+
+void ARCReplacer::untrack(const FrameId frame)
+{
+	if (tracked[frame])
+	{
+		if (inT2[frame])
+			t2.erase(position[frame]);
+		else
+			t1.erase(position[frame]);
+		tracked[frame] = false;
+	}
+}
+
+void ARCReplacer::remove(const FrameId frame)
+{
+	std::lock_guard<std::mutex> guard(latch);
+	untrack(frame);
+	releaseFrame(frame);
+}
+
+void ARCReplacer::resize(const std::uint32_t frames, const std::uint32_t bufs)
+{
+	Replacer::resize(frames, bufs);
+	p = std::min(p, bufs);
+	inT2.resize(frames, false);
+	tracked.resize(frames, false);
+	position.resize(frames);
+	keys.resize(frames);
+	trimGhosts();
+}
+
+void ARCReplacer::forgetFile(const File* file)
+{
+	std::lock_guard<std::mutex> guard(latch);
+	GhostList* ghosts[2] = {&b1, &b2};
+	GhostIndex* indexes[2] = {&b1Index, &b2Index};
+	for (int g = 0; g < 2; g++)
+	{
+		for (GhostList::iterator it = ghosts[g]->begin(); it != ghosts[g]->end(); )
+		{
+			if (it->file == file)
+			{
+				indexes[g]->erase(*it);
+				it = ghosts[g]->erase(it);
+			}
+			else
+				++it;
+		}
+	}
+	for (std::unordered_set<PageKey, PageKeyHash>::iterator it = pending.begin(); it != pending.end(); )
+	{
+		if (it->file == file)
+			it = pending.erase(it);
+		else
+			++it;
+	}
+}
+
+void ARCReplacer::upcoming(const std::uint32_t count, std::vector<FrameId>& frames)
+{
+	std::lock_guard<std::mutex> guard(latch);
+	std::uint32_t listed = 0;
+
+	// T1 goes first while it is over its target size
+	std::list<FrameId>* lists[2] = {&t1, &t2};
+	if (t1.size() <= p)
+		std::swap(lists[0], lists[1]);
+	for (int l = 0; l < 2; l++)
+	{
+		for (std::list<FrameId>::reverse_iterator it = lists[l]->rbegin();
+				 it != lists[l]->rend() && listed < count; ++it, listed++)
+			frames.push_back(*it);
+	}
+}
+
+//----------------------------------------
+// CLOCK-Pro
+//----------------------------------------
+
+ClockProReplacer::ClockProReplacer(const std::uint32_t bufs, BufDesc* descTable, BufStats& stats)
+	: Replacer(bufs, descTable, stats),
+		coldTarget(std::max<std::uint32_t>(1, bufs / 4)),
+		numHot(0), numGhosts(0),
+		tracked(bufs, false), position(bufs)
+{
+	handHot = handCold = handTest = ring.end();
+}
+
+void ClockProReplacer::advance(Ring::iterator& hand)
+{
+	++hand;
+	if (hand == ring.end())
+		hand = ring.begin();
+}
+
+void ClockProReplacer::erase(Ring::iterator entry)
+{
+	Ring::iterator* hands[] = {&handHot, &handCold, &handTest};
+	for (int i = 0; i < 3; i++)
+	{
+		if (*hands[i] == entry)
+		{
+			if (ring.size() == 1)
+				*hands[i] = ring.end();
+			else
+				advance(*hands[i]);
+		}
+	}
+
+	if (!entry->resident)
+	{
+		ghosts.erase(entry->key);
+		numGhosts--;
+	}
+	ring.erase(entry);
+}
+
+void ClockProReplacer::moveToHead(Ring::iterator entry)
+{
+	if (ring.size() <= 1)
+		return;
+
+	Ring::iterator* hands[] = {&handHot, &handCold, &handTest};
+	for (int i = 0; i < 3; i++)
+	{
+		if (*hands[i] == entry)
+			advance(*hands[i]);
+	}
+
+	ring.splice(handHot, ring, entry);
+}
+
+void ClockProReplacer::endTest(Ring::iterator& hand)
+{
+	// the page was not referenced during its test period
+	coldTarget = std::max<std::uint32_t>(1, coldTarget - 1);
+
+	Ring::iterator entry = hand;
+	if (!entry->resident)
+	{
+		erase(entry);	// moves the hand on
+	}
+	else
+	{
+		entry->test = false;
+		advance(hand);
+	}
+}
+
+void ClockProReplacer::runHandHot()
+{
+	// demotes one hot page, ending the test periods the hand passes
+	while (numHot > 0)
+	{
+		Ring::iterator entry = handHot;
+		if (entry->hot)
+		{
+			if (entry->ref)
+			{
+				entry->ref = false;
+				advance(handHot);
+			}
+			else
+			{
+				entry->hot = false;
+				numHot--;
+				advance(handHot);
+				return;
+			}
+		}
+		else if (entry->test)
+		{
+			endTest(handHot);
+		}
+		else
+		{
+			advance(handHot);
+		}
+	}
+}
+
+void ClockProReplacer::runHandTest()
+{
+	// removes one non-resident page, ending the test periods the hand passes
+	while (numGhosts > 0)
+	{
+		Ring::iterator entry = handTest;
+		if (!entry->hot && entry->test)
+		{
+			bool resident = entry->resident;
+			endTest(handTest);
+			if (!resident)
+				return;
+		}
+		else
+		{
+			advance(handTest);
+		}
+	}
+}
+
+bool ClockProReplacer::victim(const File* file, const PageId pageNo, FrameId& frame,
+															const std::uint32_t lookahead, std::vector<FrameId>& skipped)
+{
+	std::lock_guard<std::mutex> guard(latch);
+	PageKey key = {file, pageNo};
+
+	// forget pages whose read never completed
+	if (pending.size() > numBufs)
+		pending.clear();
+
+	// a miss on a page in its test period: the page deserves to be hot, and
+	// cold pages deserve more frames
+	std::unordered_map<PageKey, Ring::iterator, PageKeyHash>::iterator ghost = ghosts.find(key);
+	if (ghost != ghosts.end())
+	{
+		coldTarget = std::min<std::uint32_t>(numBufs > 1 ? numBufs - 1 : 1, coldTarget + 1);
+		erase(ghost->second);
+		pending.insert(key);
+	}
+
+	if (takeFreeFrame(frame))
+	{
+		recordScan(0);
+		return true;
+	}
+
+	// run the cold hand to the first unreferenced, unpinned cold page
+	std::uint32_t scanned = 0;
+	std::size_t sinceProgress = 0;
+	std::uint32_t limit = lookahead;
+	while (true)
+	{
+		if (sinceProgress >= ring.size() && limit > 0 && !skipped.empty())
+		{
+			// a whole turn without a clean page: take dirty ones rather than
+			// demote a hot page
+			limit = 0;
+			sinceProgress = 0;
+		}
+		if (sinceProgress >= ring.size())
+		{
+			// a whole turn without a candidate: demote a hot page
+			if (numHot == 0)
+			{
+				recordScan(scanned);
+				return false;
+			}
+			runHandHot();
+			sinceProgress = 0;
+		}
+		sinceProgress++;
+		scanned++;
+
+		Ring::iterator entry = handCold;
+		if (!entry->resident || entry->hot || !evictable(entry->frame))
+		{
+			advance(handCold);
+			continue;
+		}
+
+		if (entry->ref)
+		{
+			entry->ref = false;
+			if (entry->test)
+			{
+				// re-referenced within its test period
+				entry->hot = true;
+				entry->test = false;
+				numHot++;
+				moveToHead(entry);
+				while (numHot > numBufs - coldTarget)
+					runHandHot();
+			}
+			else
+			{
+				entry->test = true;
+				moveToHead(entry);
+			}
+			sinceProgress = 0;
+			continue;
+		}
+
+		if (passOver(entry->frame, limit, skipped) || !tryClaim(entry->frame))
+		{
+			advance(handCold);
+			continue;
+		}
+
+		frame = entry->frame;
+		tracked[frame] = false;
+		if (entry->test)
+		{
+			// stays in the clock until its test period ends
+			entry->resident = false;
+			ghosts[entry->key] = entry;
+			numGhosts++;
+			advance(handCold);
+			while (numGhosts > numBufs)
+				runHandTest();
+		}
+		else
+		{
+			erase(entry);
+		}
+		recordScan(scanned);
+		return true;
+	}
+}
+
+void ClockProReplacer::insert(const FrameId frame, const File* file, const PageId pageNo)
+{
+	std::lock_guard<std::mutex> guard(latch);
+	PageKey key = {file, pageNo};
+	bool hot = pending.erase(key) > 0;
+
+	Entry entry = {key, frame, true, hot, !hot, false};
+	Ring::iterator it = ring.insert(handHot, entry);
+	if (ring.size() == 1)
+		handHot = handCold = handTest = it;
+
+	tracked[frame] = true;
+	position[frame] = it;
+	if (hot)
+	{
+		numHot++;
+		while (numHot > numBufs - coldTarget)
+			runHandHot();
+	}
+}
+
+void ClockProReplacer::access(const FrameId frame)
+{
+	std::lock_guard<std::mutex> guard(latch);
+	if (tracked[frame])
+		position[frame]->ref = true;
+}
+
+void ClockProReplacer::untrack(const FrameId frame)
+{
+	if (tracked[frame])
+	{
+		if (position[frame]->hot)
+			numHot--;
+		erase(position[frame]);
+		tracked[frame] = false;
+	}
+}
+
+void ClockProReplacer::remove(const FrameId frame)
+{
+	std::lock_guard<std::mutex> guard(latch);
+	untrack(frame);
+	releaseFrame(frame);
+}
+
+void ClockProReplacer::resize(const std::uint32_t frames, const std::uint32_t bufs)
+{
+	Replacer::resize(frames, bufs);
+	tracked.resize(frames, false);
+	position.resize(frames);
+
+	// keep the hot pages and the pages in their test period within the new size
+	coldTarget = std::min<std::uint32_t>(coldTarget, bufs > 1 ? bufs - 1 : 1);
+	while (numHot > numBufs - coldTarget)
+		runHandHot();
+	while (numGhosts > numBufs)
+		runHandTest();
+}
+
+void ClockProReplacer::forgetFile(const File* file)
+{
+	std::lock_guard<std::mutex> guard(latch);
+	std::vector<Ring::iterator> entries;
+	for (std::unordered_map<PageKey, Ring::iterator, PageKeyHash>::iterator it = ghosts.begin();
+			 it != ghosts.end(); ++it)
+	{
+		if (it->first.file == file)
+			entries.push_back(it->second);
+	}
+	for (std::size_t i = 0; i < entries.size(); i++)
+		erase(entries[i]);
+	for (std::unordered_set<PageKey, PageKeyHash>::iterator it = pending.begin(); it != pending.end(); )
+	{
+		if (it->file == file)
+			it = pending.erase(it);
+		else
+			++it;
+	}
+}
+
+void ClockProReplacer::upcoming(const std::uint32_t count, std::vector<FrameId>& frames)
+{
+	std::lock_guard<std::mutex> guard(latch);
+	if (ring.empty())
+		return;
+
+	// the resident cold pages the cold hand reaches next
+	Ring::iterator it = handCold;
+	std::uint32_t listed = 0;
+	for (std::size_t i = 0; i < ring.size() && listed < count; i++)
+	{
+		if (it->resident && !it->hot)
+		{
+			frames.push_back(it->frame);
+			listed++;
+		}
+		advance(it);
+	}
+}
+
+}
@@ -0,0 +1,577 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "file.h"
+
+namespace badgerdb {
+
+class BufDesc;
+struct BufStats;
+
+/**
+ * @brief Replacement policy enumeration. Passed to the BufMgr constructor.
+ */
+enum ReplacementPolicy
+{
+	POLICY_CLOCK,			/* Second chance clock sweep over the frames */
+	POLICY_LRU2,			/* LRU-K with K = 2 */
+	POLICY_2Q,				/* Full 2Q with A1in, A1out and Am queues */
+	POLICY_ARC,				/* Adaptive Replacement Cache */
+	POLICY_CLOCK_PRO	/* CLOCK-Pro with hot, cold and test hands */
+};
+
+/**
+ * Number of values in ReplacementPolicy.
+ */
+const int NUM_POLICIES = 5;
+
+/**
+ * Returns a printable name of a replacement policy.
+ *
+ * @param policy	Replacement policy
+ * @return				Name of the policy
+ */
+const char* policyName(const ReplacementPolicy policy);
+
+/**
+ * @brief Identity of a page, used by policies that remember pages which are no
+ * longer in the buffer pool.
+ */
+struct PageKey
+{
+	/**
+	 * File the page belongs to
+	 */
+	const File* file;
+
+	/**
+	 * Page number within the file
+	 */
+	PageId pageNo;
+
+	bool operator==(const PageKey& rhs) const
+	{
+		return file == rhs.file && pageNo == rhs.pageNo;
+	}
+};
+
+/**
+ * @brief Hash function for PageKey.
+ */
+struct PageKeyHash
+{
+	std::size_t operator()(const PageKey& key) const
+	{
+		std::uint64_t k = (reinterpret_cast<std::uintptr_t>(key.file) << 16) ^ key.pageNo;
+		return static_cast<std::size_t>((k * 0x9e3779b97f4a7c15ULL) >> 32);
+	}
+};
+
+/**
+ * @brief Interface of the buffer replacement policies.
+ *
+ * The buffer manager reports every page placed into a frame, every hit on a
+ * resident page and every frame freed outside of replacement, and asks the
+ * policy for a frame whenever it needs one. Pin counts, validity and the
+ * reference bit are read from the frame descriptors, which the policy shares
+ * with the buffer manager.
+ *
+ * All methods may be called from several threads at once. The clock sweeps
+ * the frames without a latch; the other policies serialize on their latch.
+ */
+class Replacer
+{
+ public:
+	/**
+	 * Creates a policy managing the frames of a buffer pool.
+	 *
+	 * @param policy				Replacement policy
+	 * @param bufs					Number of frames in the buffer pool
+	 * @param descTable			Frame descriptors of the buffer pool
+	 * @param stats					Buffer pool usage statistics
+	 * @return							New policy object, owned by the caller
+	 */
+	static Replacer* create(const ReplacementPolicy policy, const std::uint32_t bufs,
+													BufDesc* descTable, BufStats& stats);
+
+	virtual ~Replacer() {}
+
+	/**
+	 * Chooses a frame to hold a page. A free frame is returned if there is
+	 * one, otherwise an unpinned frame which the policy stops tracking; the
+	 * caller must then either insert() a page into it or remove() it. The
+	 * frame is returned claimed, see BufDesc.
+	 *
+	 * Up to lookahead candidates holding dirty pages are passed over for the
+	 * next clean one in the policy's order, without claiming them or changing
+	 * what the policy knows of them. If the candidates run out first, a dirty
+	 * page passed over is taken after all.
+	 *
+	 * @param file   	File of the page that will be read, if known
+	 * @param pageNo  Page number of the page that will be read, or Page::INVALID_NUMBER
+	 * @param frame		Frame reference, frame chosen returned via this variable
+	 * @param lookahead	Most dirty pages to pass over, counting those already in skipped
+	 * @param skipped	Frames of the dirty pages passed over, appended to this vector
+	 * @return				False if every frame is pinned
+	 */
+	virtual bool victim(const File* file, const PageId pageNo, FrameId& frame,
+											const std::uint32_t lookahead, std::vector<FrameId>& skipped) = 0;
+
+	/**
+	 * Records that a page has been placed into a frame returned by victim().
+	 *
+	 * @param frame		Frame holding the page
+	 * @param file   	File of the page
+	 * @param pageNo  Page number of the page
+	 */
+	virtual void insert(const FrameId frame, const File* file, const PageId pageNo) = 0;
+
+	/**
+	 * Records a hit on the page held in a frame. Hits on a frame the policy
+	 * does not track at the moment are ignored.
+	 *
+	 * @param frame		Frame holding the page
+	 */
+	virtual void access(const FrameId frame) = 0;
+
+	/**
+	 * Records that a frame has been freed by the buffer manager, for
+	 * instance when its file is flushed or its page disposed.
+	 *
+	 * @param frame		Frame that is now free
+	 */
+	virtual void remove(const FrameId frame) = 0;
+
+	/**
+	 * Lists frames in the order the policy would consider them for
+	 * replacement, so that they can be cleaned before they are needed. Frames
+	 * that are pinned or hold no page may be included.
+	 *
+	 * @param count		Maximum number of frames to list
+	 * @param frames	Frames, most imminent first, appended to this vector
+	 */
+	virtual void upcoming(const std::uint32_t count, std::vector<FrameId>& frames) = 0;
+
+	/**
+	 * Claims an unpinned frame chosen by the buffer manager rather than by the
+	 * policy, which stops tracking it as if victim() had returned it.
+	 *
+	 * @param frame		Frame to claim
+	 * @return				False if the frame is pinned, claimed or empty
+	 */
+	bool claim(const FrameId frame);
+
+	/**
+	 * Claims an unpinned frame for good, as the buffer pool shrinks, whether
+	 * or not it holds a page. A page it holds must then be evicted by the
+	 * caller, and the frame marked retired before the next resize().
+	 *
+	 * @param frame		Frame to retire
+	 * @return				False if the frame is pinned or claimed
+	 */
+	bool retire(const FrameId frame);
+
+	/**
+	 * Adapts the policy to a buffer pool that has changed size. The frames
+	 * that are neither retired nor holding a page become free, so frames
+	 * added at the end or given back in a hole must have been cleared. Must
+	 * not be called while other threads use the policy.
+	 *
+	 * @param frames	Frame numbers in use are below this; frames at or above
+	 * 								it are retired
+	 * @param bufs		Number of frames that are not retired
+	 */
+	virtual void resize(const std::uint32_t frames, const std::uint32_t bufs);
+
+	/**
+	 * Forgets the pages of a file that the policy remembers after they left
+	 * the buffer pool, once the file is flushed, so that a file opened later
+	 * at the same address does not inherit them.
+	 *
+	 * @param file		File flushed from the buffer pool
+	 */
+	virtual void forgetFile(const File* file) {}
+
+ protected:
+	Replacer(const std::uint32_t bufs, BufDesc* descTable, BufStats& stats);
+
+	/**
+	 * Stops tracking a frame, if the policy tracks it. Called with the latch
+	 * held.
+	 */
+	virtual void untrack(const FrameId frame) = 0;
+
+	/**
+	 * Returns true if the frame holds a page and nobody has it pinned.
+	 */
+	bool evictable(const FrameId frame) const;
+
+	/**
+	 * Claims an unpinned frame holding a page, returning false if it is
+	 * pinned, claimed or empty.
+	 */
+	bool tryClaim(const FrameId frame);
+
+	/**
+	 * Claims an unpinned frame whether or not it holds a page.
+	 */
+	bool claimFree(const FrameId frame);
+
+	/**
+	 * Returns true if the frame holds a page.
+	 */
+	bool isValid(const FrameId frame) const;
+
+	/**
+	 * Returns true if victim() is to pass over an unpinned frame, as its page
+	 * is dirty and it is in skipped already or fewer than lookahead frames
+	 * are; the frame is then added to skipped. A lookahead of 0 passes over
+	 * nothing.
+	 */
+	bool passOver(const FrameId frame, const std::uint32_t lookahead, std::vector<FrameId>& skipped);
+
+	/**
+	 * Clears the reference bit of a frame, returning its previous value.
+	 */
+	bool testAndClearRef(const FrameId frame);
+
+	/**
+	 * Pops and claims a free frame, returning false if there is none.
+	 */
+	bool takeFreeFrame(FrameId& frame);
+
+	/**
+	 * Returns a frame to the free list.
+	 */
+	void releaseFrame(const FrameId frame);
+
+	/**
+	 * Records how many frames a call of victim() looked at.
+	 */
+	void recordScan(const std::uint32_t frames);
+
+	/**
+	 * Number of frames in the buffer pool
+	 */
+	std::uint32_t numBufs;
+
+	/**
+	 * Frame numbers in use are below numFrames, which is numBufs plus the
+	 * number of frames retired below the last one
+	 */
+	std::uint32_t numFrames;
+
+	/**
+	 * Frame descriptors of the buffer pool
+	 */
+	BufDesc* bufDescTable;
+
+	/**
+	 * Buffer pool usage statistics
+	 */
+	BufStats& bufStats;
+
+	/**
+	 * Frames that hold no page, lowest frame number last
+	 */
+	std::vector<FrameId> freeFrames;
+
+	/**
+	 * Serializes the policies that keep lists of frames
+	 */
+	std::mutex latch;
+};
+
+/**
+ * @brief Second chance clock: the hand sweeps the frames, clearing reference
+ * bits and taking the first unpinned frame whose bit is already clear.
+ */
+class ClockReplacer : public Replacer
+{
+ public:
+	ClockReplacer(const std::uint32_t bufs, BufDesc* descTable, BufStats& stats);
+
+	bool victim(const File* file, const PageId pageNo, FrameId& frame,
+							const std::uint32_t lookahead, std::vector<FrameId>& skipped);
+	void insert(const FrameId frame, const File* file, const PageId pageNo) {}
+	void access(const FrameId frame) {}
+	void remove(const FrameId frame) {}
+	void upcoming(const std::uint32_t count, std::vector<FrameId>& frames);
+
+ protected:
+	void untrack(const FrameId frame) {}
+
+ private:
+	/**
+	 * Number of times the clock hand has advanced; the hand points at frame
+	 * clockHand % numFrames, so threads sweep without a latch
+	 */
+	std::atomic<std::uint64_t> clockHand;
+};
+
+/**
+ * @brief LRU-2 evicts the page whose second most recent reference is oldest,
+ * so pages referenced only once, such as those of a scan, go before pages that
+ * are referenced repeatedly. The last reference time of evicted pages is
+ * remembered for as many pages as there are frames.
+ */
+class LRU2Replacer : public Replacer
+{
+ public:
+	LRU2Replacer(const std::uint32_t bufs, BufDesc* descTable, BufStats& stats);
+
+	bool victim(const File* file, const PageId pageNo, FrameId& frame,
+							const std::uint32_t lookahead, std::vector<FrameId>& skipped);
+	void insert(const FrameId frame, const File* file, const PageId pageNo);
+	void access(const FrameId frame);
+	void remove(const FrameId frame);
+	void upcoming(const std::uint32_t count, std::vector<FrameId>& frames);
+	void resize(const std::uint32_t frames, const std::uint32_t bufs);
+	void forgetFile(const File* file);
+
+ protected:
+	void untrack(const FrameId frame);
+
+ private:
+	/**
+	 * Eviction order: (second last reference, last reference, frame), where a
+	 * second last reference of 0 means the page was referenced only once
+	 */
+	typedef std::set<std::pair<std::pair<std::uint64_t, std::uint64_t>, FrameId> > RankSet;
+
+	void rank(const FrameId frame);
+
+	/**
+	 * Logical time, advanced on every reference
+	 */
+	std::uint64_t now;
+
+	/**
+	 * Last and second last reference time of each frame's page
+	 */
+	std::vector<std::uint64_t> last;
+	std::vector<std::uint64_t> prev;
+
+	/**
+	 * Page held by each frame
+	 */
+	std::vector<PageKey> keys;
+	std::vector<bool> tracked;
+
+	RankSet ranks;
+
+	/**
+	 * Last reference time of recently evicted pages, and their eviction order
+	 */
+	typedef std::list<PageKey> HistoryList;
+	std::unordered_map<PageKey, std::pair<std::uint64_t, HistoryList::iterator>, PageKeyHash> history;
+	HistoryList historyOrder;
+};
+
+/**
+ * @brief 2Q admits new pages into a FIFO queue A1in and promotes a page into
+ * the LRU queue Am only when it is referenced again after leaving A1in, which
+ * the ghost queue A1out remembers.
+ */
+class TwoQReplacer : public Replacer
+{
+ public:
+	TwoQReplacer(const std::uint32_t bufs, BufDesc* descTable, BufStats& stats);
+
+	bool victim(const File* file, const PageId pageNo, FrameId& frame,
+							const std::uint32_t lookahead, std::vector<FrameId>& skipped);
+	void insert(const FrameId frame, const File* file, const PageId pageNo);
+	void access(const FrameId frame);
+	void remove(const FrameId frame);
+	void upcoming(const std::uint32_t count, std::vector<FrameId>& frames);
+	void resize(const std::uint32_t frames, const std::uint32_t bufs);
+	void forgetFile(const File* file);
+
+ protected:
+	void untrack(const FrameId frame);
+
+ private:
+	bool evictFrom(std::list<FrameId>& queue, FrameId& frame, std::uint32_t& scanned,
+								 const std::uint32_t lookahead, std::vector<FrameId>& skipped);
+
+	/**
+	 * Target size of A1in and maximum size of A1out
+	 */
+	std::uint32_t kin;
+	std::uint32_t kout;
+
+	/**
+	 * Resident queues, most recent page at the front
+	 */
+	std::list<FrameId> a1in;
+	std::list<FrameId> am;
+
+	/**
+	 * Ghost queue of pages evicted from A1in, most recent at the front
+	 */
+	std::list<PageKey> a1out;
+	std::unordered_map<PageKey, std::list<PageKey>::iterator, PageKeyHash> a1outIndex;
+
+	/**
+	 * Queue and position of each frame
+	 */
+	std::vector<bool> inAm;
+	std::vector<bool> tracked;
+	std::vector<std::list<FrameId>::iterator> position;
+	std::vector<PageKey> keys;
+};
+
+/**
+ * @brief ARC splits the pool between pages seen once (T1) and pages seen at
+ * least twice (T2), and moves the split towards whichever side's ghost list
+ * (B1 or B2) sees more misses.
+ */
+class ARCReplacer : public Replacer
+{
+ public:
+	ARCReplacer(const std::uint32_t bufs, BufDesc* descTable, BufStats& stats);
+
+	bool victim(const File* file, const PageId pageNo, FrameId& frame,
+							const std::uint32_t lookahead, std::vector<FrameId>& skipped);
+	void insert(const FrameId frame, const File* file, const PageId pageNo);
+	void access(const FrameId frame);
+	void remove(const FrameId frame);
+	void upcoming(const std::uint32_t count, std::vector<FrameId>& frames);
+	void resize(const std::uint32_t frames, const std::uint32_t bufs);
+	void forgetFile(const File* file);
+
+ protected:
+	void untrack(const FrameId frame);
+
+ private:
+	typedef std::list<PageKey> GhostList;
+	typedef std::unordered_map<PageKey, GhostList::iterator, PageKeyHash> GhostIndex;
+
+	bool evictFrom(std::list<FrameId>& list, GhostList& ghosts, GhostIndex& index, FrameId& frame,
+								 std::uint32_t& scanned, const std::uint32_t lookahead,
+								 std::vector<FrameId>& skipped);
+	void trimGhosts();
+
+	/**
+	 * Target size of T1
+	 */
+	std::uint32_t p;
+
+	/**
+	 * Resident lists, most recent page at the front
+	 */
+	std::list<FrameId> t1;
+	std::list<FrameId> t2;
+
+	/**
+	 * Ghost lists, most recent page at the front
+	 */
+	GhostList b1;
+	GhostList b2;
+	GhostIndex b1Index;
+	GhostIndex b2Index;
+
+	/**
+	 * Pages found in a ghost list by victim() and not inserted yet, which go
+	 * to T2
+	 */
+	std::unordered_set<PageKey, PageKeyHash> pending;
+
+	/**
+	 * List and position of each frame
+	 */
+	std::vector<bool> inT2;
+	std::vector<bool> tracked;
+	std::vector<std::list<FrameId>::iterator> position;
+	std::vector<PageKey> keys;
+};
+
+/**
+ * @brief CLOCK-Pro keeps resident hot and cold pages and non-resident cold
+ * pages in one clock. A cold page re-referenced during its test period
+ * becomes hot; the hot hand demotes hot pages that are not referenced, and the
+ * share of frames given to cold pages adapts to hits on non-resident pages.
+ */
+class ClockProReplacer : public Replacer
+{
+ public:
+	ClockProReplacer(const std::uint32_t bufs, BufDesc* descTable, BufStats& stats);
+
+	bool victim(const File* file, const PageId pageNo, FrameId& frame,
+							const std::uint32_t lookahead, std::vector<FrameId>& skipped);
+	void insert(const FrameId frame, const File* file, const PageId pageNo);
+	void access(const FrameId frame);
+	void remove(const FrameId frame);
+	void upcoming(const std::uint32_t count, std::vector<FrameId>& frames);
+	void resize(const std::uint32_t frames, const std::uint32_t bufs);
+	void forgetFile(const File* file);
+
+ protected:
+	void untrack(const FrameId frame);
+
+ private:
+	struct Entry
+	{
+		PageKey key;
+		FrameId frame;
+		bool resident;
+		bool hot;
+		bool test;
+		bool ref;
+	};
+	typedef std::list<Entry> Ring;
+
+	void advance(Ring::iterator& hand);
+	void moveToHead(Ring::iterator entry);
+	void erase(Ring::iterator entry);
+	void runHandHot();
+	void runHandTest();
+	void endTest(Ring::iterator& hand);
+
+	/**
+	 * Target number of resident cold pages
+	 */
+	std::uint32_t coldTarget;
+
+	std::uint32_t numHot;
+	std::uint32_t numGhosts;
+
+	/**
+	 * The clock; the head is the position just behind the hot hand
+	 */
+	Ring ring;
+	Ring::iterator handHot;
+	Ring::iterator handCold;
+	Ring::iterator handTest;
+
+	/**
+	 * Non-resident pages in their test period
+	 */
+	std::unordered_map<PageKey, Ring::iterator, PageKeyHash> ghosts;
+
+	/**
+	 * Pages found among the non-resident pages by victim() and not inserted
+	 * yet, which are inserted hot
+	 */
+	std::unordered_set<PageKey, PageKeyHash> pending;
+
+	std::vector<bool> tracked;
+	std::vector<Ring::iterator> position;
+};
+
+}
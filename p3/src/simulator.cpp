@@ -0,0 +1,366 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+/**
+ * Replays a trace recorded by BufMgr::startTrace() against several
+ * replacement policies and pool sizes, and prints their miss ratio curves.
+ *
+ * Usage: badgerdb_sim trace [frames ...]
+ * Simulates pools of the given numbers of frames, by default powers of two
+ * from 16 up to the number of distinct pages in the trace. Prints one comma
+ * separated line per pool size with the miss ratio of LRU, CLOCK, ARC and
+ * OPT (Belady's optimal policy, which evicts the page used furthest in the
+ * future).
+ *
+ * Every read and allocation is a reference to its page. Disposals and
+ * flushes, which free frames whatever the policy, are left out, as are the
+ * hits and misses of the recording pool. LRU is simulated for every size in
+ * a single pass over the trace, by the stack distance of each reference; the
+ * other policies once per size.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "trace.h"
+#include "exceptions/badgerdb_exception.h"
+
+using namespace badgerdb;
+
+// Page numbers in the trace are replaced by dense ids, 0 to numPages - 1.
+static const std::uint32_t NO_PAGE = ~std::uint32_t(0);
+
+// -----------------------------------------------------------------------------
+// LRU
+// -----------------------------------------------------------------------------
+
+// Miss ratio of LRU at every size in sizes, from the stack distance of every
+// reference: the number of distinct pages referenced since the page was last
+// referenced, counted with a Fenwick tree marking the latest reference of
+// each page. A reference hits in a pool of at least that many frames plus one.
+static std::vector<double> simulateLru(const std::vector<std::uint32_t>& refs, const std::uint32_t numPages,
+																			 const std::vector<std::uint32_t>& sizes)
+{
+	const std::size_t n = refs.size();
+	std::vector<std::uint32_t> tree(n + 1, 0);
+	std::vector<std::size_t> last(numPages, 0);
+	std::vector<std::uint64_t> distances(numPages + 1, 0);
+	std::uint64_t coldMisses = 0;
+
+	for (std::size_t i = 1; i <= n; i++)
+	{
+		std::uint32_t page = refs[i - 1];
+		if (last[page] == 0)
+		{
+			coldMisses++;
+		}
+		else
+		{
+			// latest references after the previous one of this page
+			std::uint64_t marked = 0;
+			for (std::size_t j = i - 1; j > 0; j -= j & -j)
+				marked += tree[j];
+			for (std::size_t j = last[page]; j > 0; j -= j & -j)
+				marked -= tree[j];
+			distances[marked + 1]++;
+			for (std::size_t j = last[page]; j <= n; j += j & -j)
+				tree[j]--;
+		}
+		for (std::size_t j = i; j <= n; j += j & -j)
+			tree[j]++;
+		last[page] = i;
+	}
+
+	std::vector<double> ratios;
+	for (std::size_t s = 0; s < sizes.size(); s++)
+	{
+		std::uint64_t misses = coldMisses;
+		for (std::uint32_t d = sizes[s] + 1; d <= numPages; d++)
+			misses += distances[d];
+		ratios.push_back(n == 0 ? 0.0 : double(misses) / n);
+	}
+	return ratios;
+}
+
+// -----------------------------------------------------------------------------
+// CLOCK
+// -----------------------------------------------------------------------------
+
+// Second chance clock, as BufMgr runs it for ACCESS_NORMAL requests: a page
+// read in, or hit, gets its reference bit set.
+static double simulateClock(const std::vector<std::uint32_t>& refs, const std::uint32_t numPages,
+														const std::uint32_t frames)
+{
+	std::vector<std::uint32_t> pageOf;
+	std::vector<char> refbit;
+	std::vector<std::uint32_t> frameOf(numPages, NO_PAGE);
+	std::uint32_t hand = 0;
+	std::uint64_t misses = 0;
+
+	for (std::size_t i = 0; i < refs.size(); i++)
+	{
+		std::uint32_t page = refs[i];
+		if (frameOf[page] != NO_PAGE)
+		{
+			refbit[frameOf[page]] = 1;
+			continue;
+		}
+
+		misses++;
+		if (pageOf.size() < frames)
+		{
+			frameOf[page] = pageOf.size();
+			pageOf.push_back(page);
+			refbit.push_back(1);
+			continue;
+		}
+		while (refbit[hand])
+		{
+			refbit[hand] = 0;
+			hand = (hand + 1) % frames;
+		}
+		frameOf[pageOf[hand]] = NO_PAGE;
+		pageOf[hand] = page;
+		refbit[hand] = 1;
+		frameOf[page] = hand;
+		hand = (hand + 1) % frames;
+	}
+	return refs.empty() ? 0.0 : double(misses) / refs.size();
+}
+
+// -----------------------------------------------------------------------------
+// ARC
+// -----------------------------------------------------------------------------
+
+// Adaptive Replacement Cache of Megiddo and Modha: T1 and T2 hold the pages
+// seen once and more than once lately, B1 and B2 remember the pages evicted
+// from them, and the target size of T1 moves towards the list whose ghosts
+// are hit.
+class ArcSimulator
+{
+ public:
+	ArcSimulator(const std::uint32_t numPages, const std::uint32_t frames)
+		: capacity(frames), target(0), where(numPages, NONE), position(numPages)
+	{
+	}
+
+	// Returns true on a hit.
+	bool reference(const std::uint32_t page)
+	{
+		switch (where[page])
+		{
+		case T1:
+		case T2:
+			moveTo(page, T2);
+			return true;
+
+		case B1:
+			target = std::min<double>(capacity, target + std::max<double>(1.0, double(lists[B2].size()) / lists[B1].size()));
+			replace(false);
+			moveTo(page, T2);
+			return false;
+
+		case B2:
+			target = std::max<double>(0.0, target - std::max<double>(1.0, double(lists[B1].size()) / lists[B2].size()));
+			replace(true);
+			moveTo(page, T2);
+			return false;
+
+		default:
+			break;
+		}
+
+		std::size_t l1 = lists[T1].size() + lists[B1].size();
+		std::size_t total = l1 + lists[T2].size() + lists[B2].size();
+		if (l1 == capacity)
+		{
+			if (lists[T1].size() < capacity)
+			{
+				forget(B1);
+				replace(false);
+			}
+			else
+			{
+				forget(T1);
+			}
+		}
+		else if (total >= capacity)
+		{
+			if (total == 2 * std::size_t(capacity))
+				forget(B2);
+			replace(false);
+		}
+		lists[T1].push_front(page);
+		where[page] = T1;
+		position[page] = lists[T1].begin();
+		return false;
+	}
+
+ private:
+	enum Where {T1, T2, B1, B2, NONE};
+
+	const std::uint32_t capacity;
+	double target;
+	std::list<std::uint32_t> lists[4];
+	std::vector<std::uint8_t> where;
+	std::vector<std::list<std::uint32_t>::iterator> position;
+
+	// Moves a page to the most recent end of a list.
+	void moveTo(const std::uint32_t page, const Where list)
+	{
+		lists[list].splice(lists[list].begin(), lists[where[page]], position[page]);
+		where[page] = list;
+	}
+
+	// Evicts the least recent page of T1 or T2 to its ghost list.
+	void replace(const bool inB2)
+	{
+		std::size_t t1 = lists[T1].size();
+		Where from = t1 > 0 && (t1 > target || (inB2 && t1 == target)) ? T1 : T2;
+		moveTo(lists[from].back(), from == T1 ? B1 : B2);
+	}
+
+	// Drops the least recent page of a list altogether.
+	void forget(const Where list)
+	{
+		where[lists[list].back()] = NONE;
+		lists[list].pop_back();
+	}
+};
+
+static double simulateArc(const std::vector<std::uint32_t>& refs, const std::uint32_t numPages,
+													const std::uint32_t frames)
+{
+	ArcSimulator arc(numPages, frames);
+	std::uint64_t misses = 0;
+	for (std::size_t i = 0; i < refs.size(); i++)
+	{
+		if (!arc.reference(refs[i]))
+			misses++;
+	}
+	return refs.empty() ? 0.0 : double(misses) / refs.size();
+}
+
+// -----------------------------------------------------------------------------
+// OPT
+// -----------------------------------------------------------------------------
+
+// Belady's optimal policy, from the position of the next reference to the
+// page of every reference, refs.size() if there is none.
+static double simulateOpt(const std::vector<std::uint32_t>& refs, const std::vector<std::size_t>& nextUse,
+													const std::uint32_t numPages, const std::uint32_t frames)
+{
+	std::set<std::pair<std::size_t, std::uint32_t> > resident;
+	std::vector<std::size_t> residentUntil(numPages, 0);
+	std::vector<char> isResident(numPages, 0);
+	std::uint64_t misses = 0;
+
+	for (std::size_t i = 0; i < refs.size(); i++)
+	{
+		std::uint32_t page = refs[i];
+		if (isResident[page])
+		{
+			resident.erase(std::make_pair(residentUntil[page], page));
+		}
+		else
+		{
+			misses++;
+			if (resident.size() == frames)
+			{
+				std::set<std::pair<std::size_t, std::uint32_t> >::iterator furthest = --resident.end();
+				isResident[furthest->second] = 0;
+				resident.erase(furthest);
+			}
+			isResident[page] = 1;
+		}
+		residentUntil[page] = nextUse[i];
+		resident.insert(std::make_pair(nextUse[i], page));
+	}
+	return refs.empty() ? 0.0 : double(misses) / refs.size();
+}
+
+// -----------------------------------------------------------------------------
+// Main
+// -----------------------------------------------------------------------------
+
+int main(int argc, char **argv)
+{
+	if (argc < 2)
+	{
+		std::cerr << "usage: " << argv[0] << " trace [frames ...]" << std::endl;
+		return 2;
+	}
+
+	std::vector<TraceRecord> records;
+	std::map<std::uint32_t, std::string> names;
+	try
+	{
+		readTrace(argv[1], records, names);
+	}
+	catch (const BadgerDbException &e)
+	{
+		std::cerr << e.message() << std::endl;
+		return 1;
+	}
+
+	// number the pages densely
+	std::unordered_map<std::uint64_t, std::uint32_t> ids;
+	std::vector<std::uint32_t> refs;
+	std::uint64_t recordedHits = 0;
+	for (std::size_t i = 0; i < records.size(); i++)
+	{
+		if (records[i].op != TRACE_READ && records[i].op != TRACE_ALLOC)
+			continue;
+		std::uint64_t key = (std::uint64_t(records[i].fileId) << 32) | records[i].pageNo;
+		std::unordered_map<std::uint64_t, std::uint32_t>::iterator it = ids.find(key);
+		if (it == ids.end())
+			it = ids.insert(std::make_pair(key, std::uint32_t(ids.size()))).first;
+		refs.push_back(it->second);
+		recordedHits += records[i].hit;
+	}
+	const std::uint32_t numPages = ids.size();
+
+	std::vector<std::size_t> nextUse(refs.size());
+	std::vector<std::size_t> seenAt(numPages, refs.size());
+	for (std::size_t i = refs.size(); i-- > 0; )
+	{
+		nextUse[i] = seenAt[refs[i]];
+		seenAt[refs[i]] = i;
+	}
+
+	std::vector<std::uint32_t> sizes;
+	for (int i = 2; i < argc; i++)
+		sizes.push_back(std::strtoul(argv[i], NULL, 10));
+	if (argc == 2)
+	{
+		for (std::uint32_t frames = 16; frames < numPages; frames *= 2)
+			sizes.push_back(frames);
+		sizes.push_back(std::max<std::uint32_t>(numPages, 1));
+	}
+
+	std::cout << "# references " << refs.size() << ", pages " << numPages << ", files " << names.size()
+						<< ", recorded hit ratio " << (refs.empty() ? 0.0 : double(recordedHits) / refs.size()) << std::endl;
+	std::cout << "frames,lru,clock,arc,opt" << std::endl;
+	std::vector<double> lru = simulateLru(refs, numPages, sizes);
+	for (std::size_t s = 0; s < sizes.size(); s++)
+	{
+		if (sizes[s] == 0)
+			continue;
+		std::cout << sizes[s] << "," << lru[s] << "," << simulateClock(refs, numPages, sizes[s])
+							<< "," << simulateArc(refs, numPages, sizes[s])
+							<< "," << simulateOpt(refs, nextUse, numPages, sizes[s]) << std::endl;
+	}
+
+	return 0;
+}
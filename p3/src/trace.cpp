@@ -0,0 +1,238 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include "trace.h"
+#include "page.h"
+#include "exceptions/file_io_exception.h"
+#include "exceptions/file_not_found_exception.h"
+
+namespace badgerdb {
+
+const char TRACE_MAGIC[8] = {'B', 'D', 'B', 'T', 'R', 'A', 'C', 'E'};
+
+const int TraceRecorder::WRITE_PERIOD_MS;
+const std::uint32_t TraceRecorder::NAME_SLOTS;
+
+std::uint32_t traceFileId(const std::string& fileName)
+{
+	std::uint32_t hash = 2166136261u;
+	for (std::size_t i = 0; i < fileName.size(); i++)
+	{
+		hash ^= static_cast<unsigned char>(fileName[i]);
+		hash *= 16777619u;
+	}
+	return hash == 0 ? 1 : hash;
+}
+
+void readTrace(const std::string& path, std::vector<TraceRecord>& records,
+							 std::map<std::uint32_t, std::string>& names)
+{
+	std::ifstream in(path.c_str(), std::ios::in | std::ios::binary);
+	if (!in)
+		throw FileNotFoundException(path);
+
+	TraceHeader header;
+	if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))
+			|| std::memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0
+			|| header.version != TRACE_VERSION || header.recordSize != sizeof(TraceRecord))
+		throw FileIOException(path, EINVAL);
+
+	TraceRecord record;
+	while (in.read(reinterpret_cast<char*>(&record), sizeof(record)))
+	{
+		if (record.op != TRACE_FILE)
+		{
+			records.push_back(record);
+			continue;
+		}
+
+		std::size_t padded = (record.nameLength + sizeof(TraceRecord) - 1) / sizeof(TraceRecord) * sizeof(TraceRecord);
+		std::string name(padded, '\0');
+		if (!in.read(&name[0], padded))
+			break;
+		name.resize(record.nameLength);
+		names[record.fileId] = name;
+	}
+}
+
+TraceRecorder::TraceRecorder(const std::string& path, const std::uint32_t capacity)
+	: start(std::chrono::steady_clock::now()), head(0), tail(0), droppedRecords(0), writerStop(false)
+{
+	fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		throw FileIOException(path, errno);
+
+	TraceHeader header;
+	std::memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+	header.version = TRACE_VERSION;
+	header.recordSize = sizeof(TraceRecord);
+	if (!writeAll(reinterpret_cast<const char*>(&header), sizeof(header)))
+	{
+		int error = errno;
+		close(fd);
+		throw FileIOException(path, error);
+	}
+
+	std::uint64_t slots = 2;
+	while (slots < capacity)
+		slots *= 2;
+	mask = slots - 1;
+	ring = new Slot[slots];
+	for (std::uint64_t i = 0; i < slots; i++)
+		ring[i].seq = 0;
+	for (std::uint32_t i = 0; i < NAME_SLOTS; i++)
+		namedIds[i] = 0;
+
+	writerThread = std::thread(&TraceRecorder::writerLoop, this);
+}
+
+TraceRecorder::~TraceRecorder()
+{
+	{
+		std::lock_guard<std::mutex> guard(writerLatch);
+		writerStop = true;
+	}
+	writerWake.notify_all();
+	writerThread.join();
+
+	drain();
+	close(fd);
+	delete [] ring;
+}
+
+void TraceRecorder::record(const std::string& fileName, const PageId pageNo, const TraceOp op, const bool hit)
+{
+	std::uint32_t fileId = traceFileId(fileName);
+	nameFile(fileId, fileName);
+
+	std::uint64_t ticket = head.load(std::memory_order_relaxed);
+	do
+	{
+		// the slot is free once the writer has moved past the record before
+		if (ticket - tail.load(std::memory_order_acquire) > mask)
+		{
+			droppedRecords++;
+			return;
+		}
+	} while (!head.compare_exchange_weak(ticket, ticket + 1, std::memory_order_relaxed));
+
+	Slot& slot = ring[ticket & mask];
+	slot.record.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now() - start).count();
+	slot.record.fileId = fileId;
+	slot.record.pageNo = pageNo;
+	slot.record.op = op;
+	slot.record.hit = hit;
+	slot.record.nameLength = 0;
+	slot.record.reserved = 0;
+	slot.seq.store(ticket + 1, std::memory_order_release);
+
+	if (ticket - tail.load(std::memory_order_relaxed) == (mask + 1) / 2)
+		writerWake.notify_one();
+}
+
+void TraceRecorder::nameFile(const std::uint32_t fileId, const std::string& fileName)
+{
+	for (std::uint32_t i = 0; i < NAME_SLOTS; i++)
+	{
+		std::uint32_t id = namedIds[(fileId + i) % NAME_SLOTS].load(std::memory_order_acquire);
+		if (id == fileId)
+			return;
+		if (id != 0)
+			continue;
+
+		// not named yet; look again under the latch, as another thread may be
+		// naming the file or another one in this slot
+		std::lock_guard<std::mutex> guard(namesLatch);
+		for (; i < NAME_SLOTS; i++)
+		{
+			std::atomic<std::uint32_t>& slot = namedIds[(fileId + i) % NAME_SLOTS];
+			if (slot == fileId)
+				return;
+			if (slot == 0)
+			{
+				pendingNames.push_back(std::make_pair(fileId, fileName));
+				slot.store(fileId, std::memory_order_release);
+				return;
+			}
+		}
+	}
+}
+
+void TraceRecorder::drain()
+{
+	// find the published records first, so that the name of every file they
+	// refer to has been queued by the time the names are taken
+	std::uint64_t first = tail.load(std::memory_order_relaxed);
+	std::uint64_t end = first;
+	while (end - first <= mask && ring[end & mask].seq.load(std::memory_order_acquire) == end + 1)
+		end++;
+
+	std::vector<std::pair<std::uint32_t, std::string> > names;
+	{
+		std::lock_guard<std::mutex> guard(namesLatch);
+		names.swap(pendingNames);
+	}
+
+	std::vector<char> buffer;
+	for (std::size_t i = 0; i < names.size(); i++)
+	{
+		TraceRecord record;
+		std::memset(&record, 0, sizeof(record));
+		record.fileId = names[i].first;
+		record.pageNo = Page::INVALID_NUMBER;
+		record.op = TRACE_FILE;
+		record.nameLength = names[i].second.size();
+		const char* bytes = reinterpret_cast<const char*>(&record);
+		buffer.insert(buffer.end(), bytes, bytes + sizeof(record));
+		buffer.insert(buffer.end(), names[i].second.begin(), names[i].second.end());
+		buffer.resize((buffer.size() + sizeof(record) - 1) / sizeof(record) * sizeof(record), '\0');
+	}
+	for (std::uint64_t ticket = first; ticket < end; ticket++)
+	{
+		const char* bytes = reinterpret_cast<const char*>(&ring[ticket & mask].record);
+		buffer.insert(buffer.end(), bytes, bytes + sizeof(TraceRecord));
+	}
+	tail.store(end, std::memory_order_release);
+
+	if (!buffer.empty() && !writeAll(&buffer[0], buffer.size()))
+		droppedRecords += end - first;
+}
+
+bool TraceRecorder::writeAll(const char* data, std::size_t length)
+{
+	while (length > 0)
+	{
+		ssize_t written = write(fd, data, length);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0)
+			return false;
+		data += written;
+		length -= written;
+	}
+	return true;
+}
+
+void TraceRecorder::writerLoop()
+{
+	std::unique_lock<std::mutex> lock(writerLatch);
+	while (!writerStop)
+	{
+		writerWake.wait_for(lock, std::chrono::milliseconds(WRITE_PERIOD_MS));
+		lock.unlock();
+		drain();
+		lock.lock();
+	}
+}
+
+}
@@ -0,0 +1,274 @@
+/**
+ * @author See Contributors.txt for code contributors and overview of BadgerDB.
+ *
+ * @section LICENSE
+ * Copyright (c) 2012 Database Group, Computer Sciences Department, University of Wisconsin-Madison.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "types.h"
+
+namespace badgerdb {
+
+/**
+ * @brief Kinds of buffer pool requests recorded in a trace.
+ */
+enum TraceOp
+{
+	TRACE_READ = 0,			/* readPage(), a hit if the page was in the pool */
+	TRACE_ALLOC = 1,		/* allocPage(), never a hit */
+	TRACE_DISPOSE = 2,	/* disposePage(), a hit if the page was in the pool */
+	TRACE_FLUSH = 3,		/* flushFile(), for every page of the file */
+	TRACE_FILE = 4			/* Name of a file, in the bytes after the record */
+};
+
+/**
+ * @brief One request in a trace file.
+ *
+ * A trace file is a TraceHeader followed by TraceRecords, in the byte order
+ * of the machine that wrote it. A TRACE_FILE record gives the name of the
+ * file with the id fileId the first time the id appears, in the nameLength
+ * bytes following it, padded to a multiple of sizeof(TraceRecord).
+ */
+struct TraceRecord
+{
+	/**
+	 * Nanoseconds since the trace was started
+	 */
+	std::uint64_t timestamp;
+
+	/**
+	 * Hash of the file name, the same in every trace
+	 */
+	std::uint32_t fileId;
+
+	/**
+	 * Page number, Page::INVALID_NUMBER for TRACE_FLUSH and TRACE_FILE
+	 */
+	PageId pageNo;
+
+	/**
+	 * TraceOp of the request
+	 */
+	std::uint8_t op;
+
+	/**
+	 * 1 if the page was found in the pool, 0 otherwise
+	 */
+	std::uint8_t hit;
+
+	/**
+	 * Length of the name following a TRACE_FILE record
+	 */
+	std::uint16_t nameLength;
+
+	std::uint32_t reserved;
+};
+
+/**
+ * @brief First bytes of a trace file.
+ */
+struct TraceHeader
+{
+	/**
+	 * TRACE_MAGIC, not NUL terminated
+	 */
+	char magic[8];
+
+	/**
+	 * TRACE_VERSION
+	 */
+	std::uint32_t version;
+
+	/**
+	 * sizeof(TraceRecord)
+	 */
+	std::uint32_t recordSize;
+};
+
+/**
+ * Magic bytes a trace file starts with.
+ */
+extern const char TRACE_MAGIC[8];
+
+/**
+ * Version of the trace file format.
+ */
+const std::uint32_t TRACE_VERSION = 1;
+
+/**
+ * Returns the id of a file in a trace: a 32 bit FNV-1a hash of its name,
+ * never 0.
+ *
+ * @param fileName	Name of the file
+ * @return					Id of the file
+ */
+std::uint32_t traceFileId(const std::string& fileName);
+
+/**
+ * Reads a trace file written by a TraceRecorder. A record cut short at the
+ * end, by a process that died while writing it, is ignored.
+ *
+ * @param path			Name of the trace file
+ * @param records		Requests of the trace, without the TRACE_FILE records, returned via this vector
+ * @param names			File names by file id, returned via this map
+ * @throws  FileNotFoundException if the trace file does not exist
+ * @throws  FileIOException if it is not a trace file
+ */
+void readTrace(const std::string& path, std::vector<TraceRecord>& records,
+							 std::map<std::uint32_t, std::string>& names);
+
+/**
+* @brief Records buffer pool requests to a trace file, for the replacement
+* policy simulator.
+*
+* Requests go to a ring of fixed size records that a thread of the recorder
+* writes to the file every few milliseconds, or sooner once the ring is half
+* full. Recording takes no latch; a request that finds the ring full is
+* dropped and counted rather than waiting for the writer.
+*/
+class TraceRecorder
+{
+ public:
+	/**
+	 * Creates the trace file, replacing any file of the same name, and starts
+	 * the thread that writes to it.
+	 *
+	 * @param path			Name of the trace file
+	 * @param capacity	Number of records the ring holds, rounded up to a power of two
+	 * @throws  FileIOException if the trace file cannot be created
+	 */
+	TraceRecorder(const std::string& path, const std::uint32_t capacity);
+
+	/**
+	 * Writes the records still in the ring and closes the trace file. No
+	 * thread may be recording meanwhile.
+	 */
+	~TraceRecorder();
+
+	/**
+	 * Records a request. May be called from several threads at once.
+	 *
+	 * @param fileName	Name of the file of the page
+	 * @param pageNo		Page number, Page::INVALID_NUMBER for TRACE_FLUSH
+	 * @param op				Kind of request
+	 * @param hit				Whether the page was in the pool
+	 */
+	void record(const std::string& fileName, const PageId pageNo, const TraceOp op, const bool hit);
+
+	/**
+	 * Returns the number of requests dropped because the ring was full or the
+	 * trace file could not be written.
+	 */
+	std::uint64_t dropped() const { return droppedRecords; }
+
+ private:
+	TraceRecorder(const TraceRecorder&);
+	TraceRecorder& operator=(const TraceRecorder&);
+
+	/**
+	 * Pause of the writer thread between two writes when the ring fills slowly,
+	 * in milliseconds
+	 */
+	static const int WRITE_PERIOD_MS = 10;
+
+	/**
+	 * Number of file ids the recorder remembers having named in the trace;
+	 * files beyond that many go unnamed
+	 */
+	static const std::uint32_t NAME_SLOTS = 1024;
+
+	/**
+	 * Slot of the ring, published to the writer by storing the ticket of its
+	 * record plus one in seq
+	 */
+	struct Slot
+	{
+		std::atomic<std::uint64_t> seq;
+		TraceRecord record;
+	};
+
+	/**
+	 * Descriptor of the trace file
+	 */
+	int fd;
+
+	/**
+	 * Time the recorder was created, which timestamps count from
+	 */
+	std::chrono::steady_clock::time_point start;
+
+	/**
+	 * The ring, of mask + 1 slots
+	 */
+	Slot* ring;
+	std::uint64_t mask;
+
+	/**
+	 * Ticket of the next record; records are in slot ticket & mask
+	 */
+	std::atomic<std::uint64_t> head;
+
+	/**
+	 * Ticket of the oldest record the writer has yet to take from the ring
+	 */
+	std::atomic<std::uint64_t> tail;
+
+	std::atomic<std::uint64_t> droppedRecords;
+
+	/**
+	 * Ids of the files whose name has been queued, in an open addressing
+	 * table; 0 is an empty slot
+	 */
+	std::atomic<std::uint32_t> namedIds[NAME_SLOTS];
+
+	/**
+	 * Names to write before the next records, and the latch that guards them
+	 * and inserts into namedIds
+	 */
+	std::vector<std::pair<std::uint32_t, std::string> > pendingNames;
+	std::mutex namesLatch;
+
+	/**
+	 * Writer thread, and the latch and condition it waits on
+	 */
+	std::thread writerThread;
+	std::mutex writerLatch;
+	std::condition_variable writerWake;
+	bool writerStop;
+
+	/**
+	 * Queues the name of a file unless it has been queued before.
+	 */
+	void nameFile(const std::uint32_t fileId, const std::string& fileName);
+
+	/**
+	 * Writes the queued names and the records published in the ring to the
+	 * trace file.
+	 */
+	void drain();
+
+	/**
+	 * Writes bytes to the trace file.
+	 *
+	 * @return		False if the write failed
+	 */
+	bool writeAll(const char* data, std::size_t length);
+
+	/**
+	 * Body of the writer thread.
+	 */
+	void writerLoop();
+};
+
+}